@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2021, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <AK/Types.h>
+
+// Shared memory layout of an I/O ring created with io_ring_create().
+//
+// Map the ring by calling mmap() on its file descriptor with MAP_SHARED and the
+// size that io_ring_create() returned (also found in IORingHeader::size).
+// Userspace fills submissions and then advances sq_tail, the kernel consumes
+// them in io_ring_enter() and advances sq_head. Completions flow the other way:
+// the kernel advances cq_tail, userspace advances cq_head once it has looked at
+// them. Both queues are indexed modulo their (power of two) number of entries.
+
+#define IO_RING_MAX_ENTRIES 4096
+
+enum IORingOpcode : u8 {
+    IO_RING_OP_NOP,
+    IO_RING_OP_READ,
+    IO_RING_OP_WRITE,
+    IO_RING_OP_ACCEPT,
+    IO_RING_OP_FSYNC,
+};
+
+struct IORingSubmission {
+    u8 opcode { IO_RING_OP_NOP };
+    u8 flags { 0 };
+    u16 reserved { 0 };
+    i32 fd { -1 };
+    // For reads and writes, -1 means at (and advancing) the current file offset.
+    i64 offset { -1 };
+    u64 address { 0 };
+    u32 length { 0 };
+    u32 reserved2 { 0 };
+    u64 user_data { 0 };
+};
+
+struct IORingCompletion {
+    u64 user_data { 0 };
+    // The return value of the equivalent system call, or a negated errno.
+    i32 result { 0 };
+    u32 flags { 0 };
+};
+
+struct IORingHeader {
+    u32 sq_head;
+    u32 sq_tail;
+    u32 sq_entries;
+    u32 sq_offset;
+    u32 cq_head;
+    u32 cq_tail;
+    u32 cq_entries;
+    u32 cq_offset;
+    u32 size;
+};
@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2021, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <AK/Types.h>
+
+// These are the records returned by get_process_statistics(). Every live
+// process is described either by a ProcessStatisticsRecord followed by one
+// ThreadStatisticsRecord per thread, or, if nothing about it has changed
+// since the generation that was asked about, by a single
+// UnchangedProcessStatisticsRecord.
+
+enum class ProcessStatisticsRecordType : u32 {
+    Process,
+    UnchangedProcess,
+    Thread,
+};
+
+enum class ProcessStatisticsVeilState : u8 {
+    None,
+    Dropped,
+    Locked,
+};
+
+struct ProcessStatisticsRecord {
+    ProcessStatisticsRecordType type { ProcessStatisticsRecordType::Process };
+    i32 pid { 0 };
+    i32 pgid { 0 };
+    i32 pgp { 0 };
+    i32 sid { 0 };
+    u32 uid { 0 };
+    u32 gid { 0 };
+    i32 ppid { 0 };
+    u32 nfds { 0 };
+    u32 thread_count { 0 };
+    bool kernel { false };
+    bool dumpable { false };
+    ProcessStatisticsVeilState veil { ProcessStatisticsVeilState::None };
+    u32 amount_virtual { 0 };
+    u32 amount_resident { 0 };
+    u32 amount_dirty_private { 0 };
+    u32 amount_clean_inode { 0 };
+    u32 amount_shared { 0 };
+    u32 amount_purgeable_volatile { 0 };
+    u32 amount_purgeable_nonvolatile { 0 };
+    char name[64] {};
+    char tty[32] {};
+    char pledge[192] {};
+    char executable[256] {};
+};
+
+struct UnchangedProcessStatisticsRecord {
+    ProcessStatisticsRecordType type { ProcessStatisticsRecordType::UnchangedProcess };
+    i32 pid { 0 };
+};
+
+struct ThreadStatisticsRecord {
+    ProcessStatisticsRecordType type { ProcessStatisticsRecordType::Thread };
+    i32 tid { 0 };
+    u32 times_scheduled { 0 };
+    u32 ticks_user { 0 };
+    u32 ticks_kernel { 0 };
+    u32 cpu { 0 };
+    u32 priority { 0 };
+    u32 syscall_count { 0 };
+    u32 inode_faults { 0 };
+    u32 zero_faults { 0 };
+    u32 cow_faults { 0 };
+    u32 file_read_bytes { 0 };
+    u32 file_write_bytes { 0 };
+    u32 unix_socket_read_bytes { 0 };
+    u32 unix_socket_write_bytes { 0 };
+    u32 ipv4_socket_read_bytes { 0 };
+    u32 ipv4_socket_write_bytes { 0 };
+    char state[32] {};
+    char name[64] {};
+};
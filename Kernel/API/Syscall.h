@@ -193,7 +193,17 @@ namespace Kernel {
     S(anon_create)            \
     S(msyscall)               \
     S(readv)                  \
-    S(emuctl)
+    S(emuctl)                 \
+    S(epoll_create1)          \
+    S(epoll_ctl)              \
+    S(epoll_wait)             \
+    S(sendfile)               \
+    S(splice)                 \
+    S(profiling_drain)        \
+    S(get_process_statistics) \
+    S(io_ring_create)         \
+    S(io_ring_enter)          \
+    S(posix_spawn)
 
 namespace Syscall {
 
@@ -278,6 +288,43 @@ struct SC_poll_params {
     const u32* sigmask;
 };
 
+struct SC_epoll_ctl_params {
+    int epfd;
+    int op;
+    int fd;
+    const struct epoll_event* event;
+};
+
+struct SC_epoll_wait_params {
+    int epfd;
+    struct epoll_event* events;
+    int max_events;
+    const struct timespec* timeout;
+};
+
+struct SC_sendfile_params {
+    int out_fd;
+    int in_fd;
+    int64_t* offset;
+    size_t count;
+};
+
+struct SC_splice_params {
+    int in_fd;
+    int64_t* in_offset;
+    int out_fd;
+    int64_t* out_offset;
+    size_t count;
+    unsigned flags;
+};
+
+struct SC_get_process_statistics_params {
+    u32 since_generation;
+    void* buffer;
+    size_t buffer_size;
+    u32* generation;
+};
+
 struct SC_clock_nanosleep_params {
     int clock_id;
     int flags;
@@ -374,6 +421,36 @@ struct SC_execve_params {
     StringListArgument environment;
 };
 
+enum class SpawnFileActionType : u8 {
+    Open,
+    Close,
+    Dup2,
+    Chdir,
+    Fchdir,
+};
+
+struct SC_posix_spawn_file_action {
+    SpawnFileActionType type;
+    int fd;
+    int new_fd;
+    int options;
+    u16 mode;
+    StringArgument path;
+};
+
+struct SC_posix_spawn_params {
+    StringArgument path;
+    StringListArgument arguments;
+    StringListArgument environment;
+    const SC_posix_spawn_file_action* file_actions;
+    size_t file_action_count;
+    // The POSIX_SPAWN_* flags from posix_spawnattr_t, and the attributes they enable.
+    int flags;
+    int pgroup;
+    int sched_priority;
+    u32 sigmask;
+};
+
 struct SC_readlink_params {
     StringArgument path;
     MutableBufferArgument<char, size_t> buffer;
@@ -831,6 +831,11 @@ FlatPtr read_cr3()
 
 void write_cr3(FlatPtr cr3)
 {
+    // Publish the new page directory before loading it: a processor that changes page table
+    // entries either sees us using it and sends us a TLB shootdown, or we observe its
+    // changes when walking the page tables after the reload.
+    Processor::current().set_active_cr3(cr3);
+
     // NOTE: If you're here from a GPF crash, it's very likely that a PDPT entry is incorrect, not this!
 #if ARCH(I386)
     asm volatile("mov %%eax, %%cr3" ::"a"(cr3)
@@ -1149,15 +1154,20 @@ UNMAP_AFTER_INIT void Processor::early_initialize(u32 cpu)
     m_cpu = cpu;
     m_in_irq = 0;
     m_in_critical = 0;
+    m_active_cr3 = read_cr3();
+    m_tlb_statistics = {};
 
     m_invoke_scheduler_async = false;
     m_scheduler_initialized = false;
+    m_in_tickless_idle = false;
+    m_next_scheduler_tick = {};
 
     m_message_queue = nullptr;
     m_idle_thread = nullptr;
     m_current_thread = nullptr;
     m_scheduler_data = nullptr;
     m_mm_data = nullptr;
+    m_kmalloc_data = nullptr;
     m_info = nullptr;
 
     m_halt_requested = false;
@@ -1395,8 +1405,16 @@ extern "C" void enter_thread_context(Thread* from_thread, Thread* to_thread)
     tls_descriptor.set_base(to_thread->thread_specific_data());
     tls_descriptor.set_limit(to_thread->thread_specific_region_size());
 
-    if (from_tss.cr3 != to_tss.cr3)
+    // Kernel threads only touch kernel mappings, which are shared by all page directories,
+    // so they keep running on whatever page directory is loaded unless they explicitly
+    // entered another process' address space.
+    auto& to_process = to_thread->process();
+    if (to_process.is_kernel_process() && to_tss.cr3 == to_process.space().page_directory().cr3()) {
+        if (processor.active_cr3() != to_tss.cr3)
+            processor.did_lazy_tlb_switch();
+    } else if (processor.active_cr3() != to_tss.cr3) {
         write_cr3(to_tss.cr3);
+    }
 
     to_thread->set_cpu(processor.get_id());
     processor.restore_in_critical(to_thread->saved_critical());
@@ -1821,10 +1839,82 @@ void Processor::flush_tlb_local(VirtualAddress vaddr, size_t page_count)
 
 void Processor::flush_tlb(const PageDirectory* page_directory, VirtualAddress vaddr, size_t page_count)
 {
-    if (s_smp_enabled && (!is_user_address(vaddr) || Process::current()->thread_count() > 1))
-        smp_broadcast_flush_tlb(page_directory, vaddr, page_count);
+    TLBFlushRange range { vaddr.get(), page_count };
+    flush_tlb(page_directory, &range, 1, false);
+}
+
+void Processor::flush_tlb(const PageDirectory* page_directory, const TLBFlushRange* ranges, size_t range_count, bool flush_all)
+{
+    VERIFY(range_count > 0);
+    ScopedCritical critical;
+    if (s_smp_enabled)
+        smp_flush_tlb(page_directory, ranges, range_count, flush_all);
     else
-        flush_tlb_local(vaddr, page_count);
+        Processor::current().handle_tlb_flush(page_directory, ranges, range_count, flush_all);
+}
+
+void Processor::handle_tlb_flush(const PageDirectory* page_directory, const TLBFlushRange* ranges, size_t range_count, bool flush_all)
+{
+    if (is_user_address(VirtualAddress(ranges[0].base))) {
+        auto active_cr3 = this->active_cr3();
+        if (active_cr3 != page_directory->cr3()) {
+            // This processor isn't using this page directory right now, we can ignore this request
+            dbgln_if(SMP_DEBUG, "SMP[{}]: No need to flush {} ranges at {}", id(), range_count, VirtualAddress(ranges[0].base));
+            return;
+        }
+        auto* current_thread = m_current_thread;
+        if (current_thread && current_thread->tss().cr3 != active_cr3) {
+            // We're only borrowing this page directory for a kernel thread. Rather than
+            // flushing it, go back to our own one so we won't be bothered again.
+            write_cr3(current_thread->tss().cr3);
+            ++m_tlb_statistics.full_flushes;
+            return;
+        }
+        if (flush_all) {
+            // User mappings are never global, so reloading cr3 gets rid of all of them.
+            write_cr3(active_cr3);
+            ++m_tlb_statistics.full_flushes;
+            return;
+        }
+    }
+    for (size_t i = 0; i < range_count; ++i) {
+        // We assume that we don't cross into kernel land!
+        VERIFY(is_user_address(VirtualAddress(ranges[i].base)) == is_user_address(VirtualAddress(ranges[0].base)));
+        flush_tlb_local(VirtualAddress(ranges[i].base), ranges[i].page_count);
+        m_tlb_statistics.pages_flushed += ranges[i].page_count;
+    }
+}
+
+void Processor::evict_page_directory(FlatPtr cr3, FlatPtr replacement_cr3)
+{
+    ScopedCritical critical;
+    auto& cur_proc = Processor::current();
+    cur_proc.handle_page_directory_eviction(cr3, replacement_cr3);
+    if (!s_smp_enabled)
+        return;
+    u32 cpu_mask = 0;
+    for_each(
+        [&](Processor& proc) -> IterationDecision {
+            if (&proc != &cur_proc && proc.active_cr3() == cr3)
+                cpu_mask |= 1u << proc.get_id();
+            return IterationDecision::Continue;
+        });
+    if (!cpu_mask)
+        return;
+    auto& msg = smp_get_from_pool();
+    msg.type = ProcessorMessage::EvictPageDirectory;
+    msg.evict_page_directory.cr3 = cr3;
+    msg.evict_page_directory.replacement_cr3 = replacement_cr3;
+    smp_multicast_message(cpu_mask, msg, false);
+}
+
+void Processor::handle_page_directory_eviction(FlatPtr cr3, FlatPtr replacement_cr3)
+{
+    // Only kernel threads borrowing a page directory can still have it loaded when it goes away.
+    if (active_cr3() != cr3)
+        return;
+    VERIFY(!m_current_thread || m_current_thread->tss().cr3 != cr3);
+    write_cr3(replacement_cr3);
 }
 
 static volatile ProcessorMessage* s_message_pool;
@@ -1988,16 +2078,10 @@ bool Processor::smp_process_pending_messages()
                 msg->callback_with_data.handler(msg->callback_with_data.data);
                 break;
             case ProcessorMessage::FlushTlb:
-                if (is_user_address(VirtualAddress(msg->flush_tlb.ptr))) {
-                    // We assume that we don't cross into kernel land!
-                    VERIFY(is_user_range(VirtualAddress(msg->flush_tlb.ptr), msg->flush_tlb.page_count * PAGE_SIZE));
-                    if (read_cr3() != msg->flush_tlb.page_directory->cr3()) {
-                        // This processor isn't using this page directory right now, we can ignore this request
-                        dbgln_if(SMP_DEBUG, "SMP[{}]: No need to flush {} pages at {}", id(), msg->flush_tlb.page_count, VirtualAddress(msg->flush_tlb.ptr));
-                        break;
-                    }
-                }
-                flush_tlb_local(VirtualAddress(msg->flush_tlb.ptr), msg->flush_tlb.page_count);
+                handle_tlb_flush(msg->flush_tlb.page_directory, msg->flush_tlb.ranges, msg->flush_tlb.range_count, msg->flush_tlb.flush_all);
+                break;
+            case ProcessorMessage::EvictPageDirectory:
+                handle_page_directory_eviction(msg->evict_page_directory.cr3, msg->evict_page_directory.replacement_cr3);
                 break;
             }
 
@@ -2136,6 +2220,50 @@ void Processor::smp_unicast_message(u32 cpu, ProcessorMessage& msg, bool async)
     }
 }
 
+void Processor::smp_multicast_message(u32 cpu_mask, ProcessorMessage& msg, bool async)
+{
+    auto& cur_proc = Processor::current();
+    VERIFY(cpu_mask != 0);
+    VERIFY(!(cpu_mask & (1u << cur_proc.get_id())));
+    msg.async = async;
+
+    dbgln_if(SMP_DEBUG, "SMP[{}]: Multicast message {} to cpus: {:#x}", cur_proc.get_id(), VirtualAddress(&msg), cpu_mask);
+
+    atomic_store(&msg.refs, (u32)__builtin_popcount(cpu_mask), AK::MemoryOrder::memory_order_release);
+    auto& apic = APIC::the();
+    for (u32 mask = cpu_mask; mask;) {
+        u32 cpu = __builtin_ffs(mask) - 1;
+        mask &= ~(1u << cpu);
+        if (processors()[cpu]->smp_queue_message(msg)) {
+            apic.send_ipi(cpu);
+            ++cur_proc.m_tlb_statistics.ipis_sent;
+        }
+    }
+
+    if (!async)
+        smp_broadcast_wait_sync(msg);
+}
+
+u32 Processor::smp_processors_using(const PageDirectory* page_directory, bool include_all)
+{
+    // Pairs with the barrier in set_active_cr3(): our page table changes are visible
+    // before we look at which page directories the other processors have loaded.
+    full_memory_barrier();
+    auto& cur_proc = Processor::current();
+    u32 cpu_mask = 0;
+    for_each(
+        [&](Processor& proc) -> IterationDecision {
+            if (&proc == &cur_proc)
+                return IterationDecision::Continue;
+            if (include_all || proc.active_cr3() == page_directory->cr3())
+                cpu_mask |= 1u << proc.get_id();
+            else
+                ++cur_proc.m_tlb_statistics.processors_skipped;
+            return IterationDecision::Continue;
+        });
+    return cpu_mask;
+}
+
 void Processor::smp_unicast(u32 cpu, void (*callback)(void*), void* data, void (*free_data)(void*), bool async)
 {
     auto& msg = smp_get_from_pool();
@@ -2154,19 +2282,26 @@ void Processor::smp_unicast(u32 cpu, void (*callback)(), bool async)
     smp_unicast_message(cpu, msg, async);
 }
 
-void Processor::smp_broadcast_flush_tlb(const PageDirectory* page_directory, VirtualAddress vaddr, size_t page_count)
+void Processor::smp_flush_tlb(const PageDirectory* page_directory, const TLBFlushRange* ranges, size_t range_count, bool flush_all)
 {
+    VERIFY(Processor::current().in_critical());
+    // Kernel mappings are shared by everyone, but user mappings only need to be
+    // flushed on processors that currently have this page directory loaded.
+    u32 cpu_mask = smp_processors_using(page_directory, !is_user_address(VirtualAddress(ranges[0].base)));
+    auto& cur_proc = Processor::current();
+    cur_proc.handle_tlb_flush(page_directory, ranges, range_count, flush_all);
+    if (!cpu_mask)
+        return;
+
+    ++cur_proc.m_tlb_statistics.shootdowns;
     auto& msg = smp_get_from_pool();
-    msg.async = false;
     msg.type = ProcessorMessage::FlushTlb;
     msg.flush_tlb.page_directory = page_directory;
-    msg.flush_tlb.ptr = vaddr.as_ptr();
-    msg.flush_tlb.page_count = page_count;
-    smp_broadcast_message(msg);
-    // While the other processors handle this request, we'll flush ours
-    flush_tlb_local(vaddr, page_count);
-    // Now wait until everybody is done as well
-    smp_broadcast_wait_sync(msg);
+    msg.flush_tlb.ranges = ranges;
+    msg.flush_tlb.range_count = range_count;
+    msg.flush_tlb.flush_all = flush_all;
+    // NOTE: The ranges may live on the caller's stack, so this has to be synchronous.
+    smp_multicast_message(cpu_mask, msg, false);
 }
 
 void Processor::smp_broadcast_halt()
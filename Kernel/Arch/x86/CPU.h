@@ -29,6 +29,7 @@
 #include <AK/Atomic.h>
 #include <AK/Badge.h>
 #include <AK/Noncopyable.h>
+#include <AK/Time.h>
 #include <AK/Vector.h>
 
 #include <Kernel/Arch/x86/DescriptorTable.h>
@@ -42,6 +43,7 @@
 #define UNMAP_AFTER_INIT NEVER_INLINE __attribute__((section(".unmap_after_init")))
 
 #define PAGE_SIZE 4096
+#define LARGE_PAGE_SIZE 0x200000
 #define GENERIC_INTERRUPT_HANDLERS_COUNT (256 - IRQ_VECTOR_BASE)
 #define PAGE_MASK ((FlatPtr)0xfffff000u)
 
@@ -566,11 +568,27 @@ static_assert(GDT_SELECTOR_CODE0 + 24 == GDT_SELECTOR_DATA3); // SS3 = CS0 + 32
 class ProcessorInfo;
 class SchedulerPerProcessorData;
 struct MemoryManagerData;
+struct KmallocPerProcessorData;
 struct ProcessorMessageEntry;
 
+struct TLBFlushRange {
+    FlatPtr base;
+    size_t page_count;
+};
+
+struct TLBShootdownStatistics {
+    u64 shootdowns { 0 };
+    u64 ipis_sent { 0 };
+    u64 processors_skipped { 0 };
+    u64 pages_flushed { 0 };
+    u64 full_flushes { 0 };
+    u64 lazy_switches { 0 };
+};
+
 struct ProcessorMessage {
     enum Type {
         FlushTlb,
+        EvictPageDirectory,
         Callback,
         CallbackWithData
     };
@@ -588,9 +606,14 @@ struct ProcessorMessage {
         } callback_with_data;
         struct {
             const PageDirectory* page_directory;
-            u8* ptr;
-            size_t page_count;
+            const TLBFlushRange* ranges;
+            size_t range_count;
+            bool flush_all;
         } flush_tlb;
+        struct {
+            FlatPtr cr3;
+            FlatPtr replacement_cr3;
+        } evict_page_directory;
     };
 
     volatile bool async;
@@ -633,6 +656,8 @@ class Processor {
 
     u32 m_cpu;
     u32 m_in_irq;
+    Atomic<FlatPtr> m_active_cr3;
+    TLBShootdownStatistics m_tlb_statistics;
     Atomic<u32, AK::MemoryOrder::memory_order_relaxed> m_in_critical;
     static Atomic<u32> s_idle_cpu_mask;
 
@@ -645,6 +670,7 @@ class Processor {
     ProcessorInfo* m_info;
     MemoryManagerData* m_mm_data;
     SchedulerPerProcessorData* m_scheduler_data;
+    KmallocPerProcessorData* m_kmalloc_data;
     Thread* m_current_thread;
     Thread* m_idle_thread;
 
@@ -652,6 +678,8 @@ class Processor {
 
     bool m_invoke_scheduler_async;
     bool m_scheduler_initialized;
+    bool m_in_tickless_idle;
+    Time m_next_scheduler_tick;
     Atomic<bool> m_halt_requested;
 
     DeferredCallEntry* m_pending_deferred_calls; // in reverse order
@@ -668,6 +696,7 @@ class Processor {
     static void smp_cleanup_message(ProcessorMessage& msg);
     bool smp_queue_message(ProcessorMessage& msg);
     static void smp_unicast_message(u32 cpu, ProcessorMessage& msg, bool async);
+    static void smp_multicast_message(u32 cpu_mask, ProcessorMessage& msg, bool async);
     static void smp_broadcast_message(ProcessorMessage& msg);
     static void smp_broadcast_wait_sync(ProcessorMessage& msg);
     static void smp_broadcast_halt();
@@ -681,6 +710,10 @@ class Processor {
     void cpu_detect();
     void cpu_setup();
 
+    static u32 smp_processors_using(const PageDirectory*, bool include_all);
+    void handle_tlb_flush(const PageDirectory*, const TLBFlushRange*, size_t range_count, bool flush_all);
+    void handle_page_directory_eviction(FlatPtr cr3, FlatPtr replacement_cr3);
+
     String features_string() const;
 
 public:
@@ -699,6 +732,12 @@ public:
         s_idle_cpu_mask.fetch_and(~(1u << m_cpu), AK::MemoryOrder::memory_order_relaxed);
     }
 
+    ALWAYS_INLINE bool is_in_tickless_idle() const { return m_in_tickless_idle; }
+    ALWAYS_INLINE void set_in_tickless_idle(bool in_tickless_idle) { m_in_tickless_idle = in_tickless_idle; }
+
+    ALWAYS_INLINE const Time& next_scheduler_tick() const { return m_next_scheduler_tick; }
+    ALWAYS_INLINE void set_next_scheduler_tick(const Time& tick) { m_next_scheduler_tick = tick; }
+
     static u32 count()
     {
         // NOTE: because this value never changes once all APs are booted,
@@ -706,10 +745,15 @@ public:
         return g_total_processors;
     }
 
+    ALWAYS_INLINE static void pause()
+    {
+        asm volatile("pause");
+    }
+
     ALWAYS_INLINE static void wait_check()
     {
         Processor::current().smp_process_pending_messages();
-        // TODO: pause
+        pause();
     }
 
     [[noreturn]] static void halt();
@@ -721,6 +765,24 @@ public:
 
     static void flush_tlb_local(VirtualAddress vaddr, size_t page_count);
     static void flush_tlb(const PageDirectory*, VirtualAddress, size_t);
+    static void flush_tlb(const PageDirectory*, const TLBFlushRange*, size_t range_count, bool flush_all);
+    static void evict_page_directory(FlatPtr cr3, FlatPtr replacement_cr3);
+
+    // The page directory that is currently loaded into cr3. This may differ from the
+    // current thread's page directory while a kernel thread borrows the previous one.
+    ALWAYS_INLINE FlatPtr active_cr3() const
+    {
+        return m_active_cr3.load(AK::MemoryOrder::memory_order_relaxed);
+    }
+
+    ALWAYS_INLINE void set_active_cr3(FlatPtr cr3)
+    {
+        m_active_cr3.store(cr3, AK::MemoryOrder::memory_order_relaxed);
+        full_memory_barrier();
+    }
+
+    ALWAYS_INLINE void did_lazy_tlb_switch() { ++m_tlb_statistics.lazy_switches; }
+    ALWAYS_INLINE const TLBShootdownStatistics& tlb_statistics() const { return m_tlb_statistics; }
 
     Descriptor& get_gdt_entry(u16 selector);
     void flush_gdt();
@@ -776,6 +838,21 @@ public:
         return *m_mm_data;
     }
 
+    ALWAYS_INLINE bool has_mm_data() const
+    {
+        return m_mm_data != nullptr;
+    }
+
+    ALWAYS_INLINE void set_kmalloc_data(KmallocPerProcessorData& kmalloc_data)
+    {
+        m_kmalloc_data = &kmalloc_data;
+    }
+
+    ALWAYS_INLINE KmallocPerProcessorData* kmalloc_data() const
+    {
+        return m_kmalloc_data;
+    }
+
     ALWAYS_INLINE Thread* idle_thread() const
     {
         return m_idle_thread;
@@ -945,7 +1022,7 @@ public:
     }
     static void smp_unicast(u32 cpu, void (*callback)(), bool async);
     static void smp_unicast(u32 cpu, void (*callback)(void*), void* data, void (*free_data)(void*), bool async);
-    static void smp_broadcast_flush_tlb(const PageDirectory*, VirtualAddress, size_t);
+    static void smp_flush_tlb(const PageDirectory*, const TLBFlushRange*, size_t range_count, bool flush_all);
     static u32 smp_wake_n_idle_processors(u32 wake_count);
 
     template<typename Callback>
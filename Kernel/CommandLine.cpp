@@ -125,6 +125,16 @@ UNMAP_AFTER_INIT bool CommandLine::is_legacy_time_enabled() const
     return lookup("time").value_or("modern") == "legacy";
 }
 
+UNMAP_AFTER_INIT bool CommandLine::is_tickless_enabled() const
+{
+    return lookup("tickless").value_or("on") == "on";
+}
+
+UNMAP_AFTER_INIT bool CommandLine::is_physical_page_randomization_enabled() const
+{
+    return lookup("physical_page_randomization").value_or("on") == "on";
+}
+
 UNMAP_AFTER_INIT bool CommandLine::is_force_pio() const
 {
     return contains("force_pio");
@@ -178,6 +188,30 @@ UNMAP_AFTER_INIT AHCIResetMode CommandLine::ahci_reset_mode() const
     PANIC("Unknown AHCIResetMode: {}", ahci_reset_mode);
 }
 
+UNMAP_AFTER_INIT size_t CommandLine::e1000_rx_descriptors() const
+{
+    const auto value = lookup("e1000_rx_descriptors").value_or("256");
+    if (auto count = value.to_uint(); count.has_value())
+        return count.value();
+    PANIC("Invalid e1000_rx_descriptors: {}", value);
+}
+
+UNMAP_AFTER_INIT size_t CommandLine::e1000_tx_descriptors() const
+{
+    const auto value = lookup("e1000_tx_descriptors").value_or("64");
+    if (auto count = value.to_uint(); count.has_value())
+        return count.value();
+    PANIC("Invalid e1000_tx_descriptors: {}", value);
+}
+
+UNMAP_AFTER_INIT size_t CommandLine::e1000_interrupt_rate() const
+{
+    const auto value = lookup("e1000_interrupt_rate").value_or("8000");
+    if (auto rate = value.to_uint(); rate.has_value())
+        return rate.value();
+    PANIC("Invalid e1000_interrupt_rate: {}", value);
+}
+
 UNMAP_AFTER_INIT BootMode CommandLine::boot_mode() const
 {
     const auto boot_mode = lookup("boot_mode").value_or("graphical");
@@ -79,6 +79,8 @@ public:
     [[nodiscard]] bool is_vmmouse_enabled() const;
     [[nodiscard]] PCIAccessLevel pci_access_level() const;
     [[nodiscard]] bool is_legacy_time_enabled() const;
+    [[nodiscard]] bool is_tickless_enabled() const;
+    [[nodiscard]] bool is_physical_page_randomization_enabled() const;
     [[nodiscard]] bool is_text_mode() const;
     [[nodiscard]] bool is_force_pio() const;
     [[nodiscard]] AcpiFeatureLevel acpi_feature_level() const;
@@ -87,6 +89,9 @@ public:
     [[nodiscard]] bool disable_physical_storage() const;
     [[nodiscard]] bool disable_ps2_controller() const;
     [[nodiscard]] AHCIResetMode ahci_reset_mode() const;
+    [[nodiscard]] size_t e1000_rx_descriptors() const;
+    [[nodiscard]] size_t e1000_tx_descriptors() const;
+    [[nodiscard]] size_t e1000_interrupt_rate() const;
     [[nodiscard]] String userspace_init() const;
     [[nodiscard]] Vector<String> userspace_init_args() const;
     [[nodiscard]] String root_device() const;
@@ -83,12 +83,24 @@ String Device::absolute_path(const FileDescription&) const
 void Device::process_next_queued_request(Badge<AsyncDeviceRequest>, const AsyncDeviceRequest& completed_request)
 {
     ScopedSpinLock lock(m_requests_lock);
-    VERIFY(!m_requests.is_empty());
-    VERIFY(m_requests.first().ptr() == &completed_request);
-    m_requests.remove(m_requests.begin());
-    if (!m_requests.is_empty()) {
-        auto* next_request = m_requests.first().ptr();
-        next_request->do_start(move(lock));
+    VERIFY(m_requests_in_flight > 0);
+
+    auto it = m_requests.begin();
+    while (it != m_requests.end() && it->ptr() != &completed_request)
+        ++it;
+    VERIFY(it != m_requests.end());
+    m_requests.remove(it);
+    m_requests_in_flight--;
+
+    // Requests are started in order, so the ones in flight always form the
+    // head of the queue, and the first one past them is the next to start.
+    size_t index = 0;
+    for (auto& request : m_requests) {
+        if (index++ == m_requests_in_flight) {
+            m_requests_in_flight++;
+            request->do_start(move(lock));
+            break;
+        }
     }
 
     evaluate_block_conditions();
@@ -73,15 +73,20 @@ public:
     {
         auto request = adopt(*new AsyncRequestType(*this, forward<Args>(args)...));
         ScopedSpinLock lock(m_requests_lock);
-        bool was_empty = m_requests.is_empty();
         m_requests.append(request);
-        if (was_empty)
+        if (m_requests_in_flight < max_requests_in_flight()) {
+            m_requests_in_flight++;
             request->do_start(move(lock));
+        }
         return request;
     }
 
 protected:
     Device(unsigned major, unsigned minor);
+
+    // Requests are started in the order they were made. Drivers that can work on
+    // several of them at once (and complete them in any order) may raise this.
+    virtual size_t max_requests_in_flight() const { return 1; }
     void set_uid(uid_t uid) { m_uid = uid; }
     void set_gid(gid_t gid) { m_gid = gid; }
 
@@ -95,6 +100,7 @@ private:
 
     SpinLock<u8> m_requests_lock;
     DoublyLinkedList<RefPtr<AsyncDeviceRequest>> m_requests;
+    size_t m_requests_in_flight { 0 };
 };
 
 }
@@ -25,9 +25,12 @@
  */
 
 #include <AK/IntrusiveList.h>
+#include <AK/QuickSort.h>
 #include <Kernel/Debug.h>
 #include <Kernel/FileSystem/BlockBasedFileSystem.h>
 #include <Kernel/Process.h>
+#include <Kernel/Tasks/SyncTask.h>
+#include <Kernel/VM/MemoryManager.h>
 
 namespace Kernel {
 
@@ -36,76 +39,113 @@ struct CacheEntry {
     BlockBasedFS::BlockIndex block_index { 0 };
     u8* data { nullptr };
     bool has_data { false };
+    bool is_dirty { false };
+    // Set while the block has been read ahead but not asked for yet.
+    bool was_read_ahead { false };
+    // Set when the block is asked for again after it was filled, cleared when it gets a second chance.
+    bool was_referenced { false };
+};
+
+// The cache is made up of segments that are allocated as the working set
+// grows, and handed back when the system runs low on memory.
+struct CacheSegment {
+    OwnPtr<KBuffer> block_data;
+    OwnPtr<KBuffer> entry_storage;
+
+    CacheEntry* entries() { return (CacheEntry*)entry_storage->data(); }
 };
 
 class DiskCache {
 public:
+    static constexpr size_t entries_per_segment = 256;
+    static constexpr size_t max_read_ahead_blocks = 32;
+
     explicit DiskCache(BlockBasedFS& fs)
         : m_fs(fs)
-        , m_cached_block_data(KBuffer::create_with_size(m_entry_count * m_fs.block_size()))
-        , m_entries(KBuffer::create_with_size(m_entry_count * sizeof(CacheEntry)))
+        , m_read_ahead_buffer(KBuffer::create_with_size(max_read_ahead_blocks * m_fs.block_size(), Region::Access::Read | Region::Access::Write, "DiskCache read-ahead"))
+        , m_writeback_buffer(KBuffer::create_with_size(max_read_ahead_blocks * m_fs.block_size(), Region::Access::Read | Region::Access::Write, "DiskCache writeback"))
     {
-        for (size_t i = 0; i < m_entry_count; ++i) {
-            entries()[i].data = m_cached_block_data.data() + i * m_fs.block_size();
-            m_clean_list.append(entries()[i]);
-        }
+        // We always want at least one segment, so allocating it isn't allowed to fail.
+        bool success = try_grow(true);
+        VERIFY(success);
     }
 
-    ~DiskCache() = default;
+    ~DiskCache()
+    {
+        while (!m_segments.is_empty())
+            release_segment(m_segments.size() - 1);
+    }
 
-    bool is_dirty() const { return m_dirty; }
-    void set_dirty(bool b) { m_dirty = b; }
+    bool is_dirty() const { return m_dirty_count > 0; }
+    size_t dirty_count() const { return m_dirty_count; }
+    size_t entry_count() const { return m_entry_count; }
 
     void mark_all_clean()
     {
-        while (auto* entry = m_dirty_list.first())
+        while (auto* entry = m_dirty_list.first()) {
+            entry->is_dirty = false;
             m_clean_list.prepend(*entry);
-        m_dirty = false;
+        }
+        m_dirty_count = 0;
     }
 
     void mark_dirty(CacheEntry& entry)
     {
+        if (!entry.is_dirty) {
+            entry.is_dirty = true;
+            ++m_dirty_count;
+        }
         m_dirty_list.prepend(entry);
-        m_dirty = true;
+        // Start writing back in the background well before we run out of clean entries.
+        if (m_dirty_count > m_entry_count / 4)
+            SyncTask::request_sync();
     }
 
     void mark_clean(CacheEntry& entry)
     {
+        if (entry.is_dirty) {
+            entry.is_dirty = false;
+            --m_dirty_count;
+        }
         m_clean_list.prepend(entry);
     }
 
-    CacheEntry& get(BlockBasedFS::BlockIndex block_index) const
+    CacheEntry* find(BlockBasedFS::BlockIndex block_index) const
     {
-        if (auto it = m_hash.find(block_index); it != m_hash.end()) {
-            auto& entry = const_cast<CacheEntry&>(*it->value);
-            VERIFY(entry.block_index == block_index);
-            return entry;
-        }
+        if (auto it = m_hash.find(block_index); it != m_hash.end())
+            return it->value;
+        return nullptr;
+    }
 
-        if (m_clean_list.is_empty()) {
-            // Not a single clean entry! Flush writes and try again.
-            // NOTE: We want to make sure we only call FileBackedFS flush here,
-            //       not some FileBackedFS subclass flush!
-            m_fs.flush_writes_impl();
-            return get(block_index);
+    // Returns the entry for the given block, reusing a clean entry if it isn't cached yet.
+    // Returns nullptr if every entry is waiting to be written back; it's up to the caller
+    // whether that's worth waiting for.
+    CacheEntry* try_get(BlockBasedFS::BlockIndex block_index)
+    {
+        if (auto* entry = find(block_index)) {
+            VERIFY(entry->block_index == block_index);
+            return entry;
         }
 
-        VERIFY(m_clean_list.last());
-        auto& new_entry = *m_clean_list.last();
+        auto* victim = take_clean_entry();
+        if (!victim)
+            return nullptr;
+        auto& new_entry = *victim;
         m_clean_list.prepend(new_entry);
 
-        m_hash.remove(new_entry.block_index);
+        // Entries that have never been used don't own a hash slot, even though their block_index is 0.
+        if (auto it = m_hash.find(new_entry.block_index); it != m_hash.end() && it->value == &new_entry)
+            m_hash.remove(it);
         m_hash.set(block_index, &new_entry);
 
         new_entry.block_index = block_index;
         new_entry.has_data = false;
+        new_entry.was_read_ahead = false;
+        new_entry.was_referenced = false;
 
-        return new_entry;
+        return &new_entry;
     }
 
-    const CacheEntry* entries() const { return (const CacheEntry*)m_entries.data(); }
-    CacheEntry* entries() { return (CacheEntry*)m_entries.data(); }
-
     template<typename Callback>
     void for_each_dirty_entry(Callback callback)
     {
@@ -113,15 +153,164 @@ public:
             callback(entry);
     }
 
+    // Returns how many blocks to read from disk, starting at a block we just missed on.
+    size_t read_ahead_count() const
+    {
+        if (m_sequential_run < 2)
+            return 1;
+        return min(max_read_ahead_blocks, (size_t)1 << min(m_sequential_run, (size_t)5));
+    }
+
+    void did_access(CacheEntry& entry, bool hit)
+    {
+        auto block_index = entry.block_index;
+        // Several small reads from the same block don't count as using it again.
+        bool is_repeated_access = block_index == m_last_accessed_block;
+        if (block_index.value() == m_last_accessed_block.value() + 1)
+            ++m_sequential_run;
+        else if (block_index != m_last_accessed_block)
+            m_sequential_run = 0;
+        m_last_accessed_block = block_index;
+
+        if (hit) {
+            ++m_stats.hits;
+            if (entry.was_read_ahead) {
+                // Reading through a file once isn't a reason to keep it around.
+                ++m_stats.read_ahead_hits;
+                entry.was_read_ahead = false;
+            } else if (!is_repeated_access) {
+                entry.was_referenced = true;
+            }
+        } else {
+            ++m_stats.misses;
+        }
+    }
+
+    // Bounce buffers for reading ahead and for merging neighboring dirty blocks into one write.
+    KBuffer& read_ahead_buffer() { return m_read_ahead_buffer; }
+    KBuffer& writeback_buffer() { return m_writeback_buffer; }
+
+    BlockBasedFS::DiskCacheStatistics statistics() const
+    {
+        auto stats = m_stats;
+        stats.entry_count = m_entry_count;
+        stats.dirty_count = m_dirty_count;
+        return stats;
+    }
+
+    BlockBasedFS::DiskCacheStatistics& stats() { return m_stats; }
+
+    void shrink_if_under_memory_pressure()
+    {
+        while (m_segments.size() > 1 && is_under_memory_pressure()) {
+            if (!release_segment(m_segments.size() - 1))
+                break;
+        }
+    }
+
 private:
+    // Picks the clean entry to evict, CLOCK style: entries that were used again since they were
+    // filled go back to the front of the list instead. If most of what we'd evict is still in
+    // use, the working set doesn't fit and we grow, as long as memory allows.
+    CacheEntry* take_clean_entry()
+    {
+        size_t second_chances = 0;
+        while (!m_clean_list.is_empty()) {
+            auto& entry = *m_clean_list.last();
+            if (!entry.has_data || !entry.was_referenced || second_chances >= entries_per_segment)
+                break;
+            entry.was_referenced = false;
+            m_clean_list.prepend(entry);
+            ++second_chances;
+        }
+
+        m_second_chances_in_window += second_chances;
+        if (++m_evictions_in_window >= entries_per_segment) {
+            bool working_set_exceeds_cache = m_second_chances_in_window > m_evictions_in_window;
+            m_evictions_in_window = 0;
+            m_second_chances_in_window = 0;
+            if (working_set_exceeds_cache)
+                try_grow(false);
+        }
+
+        // Everything is dirty, which is pressure too.
+        if (m_clean_list.is_empty())
+            try_grow(false);
+        return m_clean_list.last();
+    }
+
+    static bool is_under_memory_pressure()
+    {
+        // Leave at least a sixteenth of physical memory to everyone else.
+        return MM.user_physical_pages_uncommitted() < MM.user_physical_pages() / 16;
+    }
+
+    size_t max_entry_count() const
+    {
+        // Never let the cache take up more than an eighth of physical memory.
+        size_t max_bytes = (size_t)MM.user_physical_pages() / 8 * PAGE_SIZE;
+        return max(max_bytes / m_fs.block_size(), entries_per_segment);
+    }
+
+    bool try_grow(bool force)
+    {
+        if (!force && (m_entry_count + entries_per_segment > max_entry_count() || is_under_memory_pressure()))
+            return false;
+
+        auto segment = make<CacheSegment>();
+        segment->block_data = KBuffer::try_create_with_size(entries_per_segment * m_fs.block_size(), Region::Access::Read | Region::Access::Write, "DiskCache");
+        segment->entry_storage = KBuffer::try_create_with_size(entries_per_segment * sizeof(CacheEntry), Region::Access::Read | Region::Access::Write, "DiskCache entries");
+        if (!segment->block_data || !segment->entry_storage)
+            return false;
+
+        for (size_t i = 0; i < entries_per_segment; ++i) {
+            auto& entry = *new (&segment->entries()[i]) CacheEntry;
+            entry.data = segment->block_data->data() + i * m_fs.block_size();
+            // New entries go to the back of the clean list so that they get used first.
+            m_clean_list.append(entry);
+        }
+        m_entry_count += entries_per_segment;
+        m_segments.append(move(segment));
+        dbgln_if(BBFS_DEBUG, "DiskCache: Grew to {} entries", m_entry_count);
+        return true;
+    }
+
+    bool release_segment(size_t index)
+    {
+        auto& segment = *m_segments[index];
+        for (size_t i = 0; i < entries_per_segment; ++i) {
+            if (segment.entries()[i].is_dirty)
+                return false;
+        }
+        for (size_t i = 0; i < entries_per_segment; ++i) {
+            auto& entry = segment.entries()[i];
+            if (auto it = m_hash.find(entry.block_index); it != m_hash.end() && it->value == &entry)
+                m_hash.remove(it);
+            if (entry.list_node.is_in_list())
+                m_clean_list.remove(entry);
+            entry.~CacheEntry();
+        }
+        m_entry_count -= entries_per_segment;
+        m_segments.remove(index);
+        dbgln_if(BBFS_DEBUG, "DiskCache: Shrunk to {} entries", m_entry_count);
+        return true;
+    }
+
     BlockBasedFS& m_fs;
-    size_t m_entry_count { 10000 };
-    mutable HashMap<BlockBasedFS::BlockIndex, CacheEntry*> m_hash;
-    mutable IntrusiveList<CacheEntry, &CacheEntry::list_node> m_clean_list;
-    mutable IntrusiveList<CacheEntry, &CacheEntry::list_node> m_dirty_list;
-    KBuffer m_cached_block_data;
-    KBuffer m_entries;
-    bool m_dirty { false };
+    Vector<NonnullOwnPtr<CacheSegment>> m_segments;
+    size_t m_entry_count { 0 };
+    size_t m_dirty_count { 0 };
+    size_t m_evictions_in_window { 0 };
+    size_t m_second_chances_in_window { 0 };
+    HashMap<BlockBasedFS::BlockIndex, CacheEntry*> m_hash;
+    IntrusiveList<CacheEntry, &CacheEntry::list_node> m_clean_list;
+    IntrusiveList<CacheEntry, &CacheEntry::list_node> m_dirty_list;
+    KBuffer m_read_ahead_buffer;
+    KBuffer m_writeback_buffer;
+
+    BlockBasedFS::BlockIndex m_last_accessed_block { 0 };
+    size_t m_sequential_run { 0 };
+    BlockBasedFS::DiskCacheStatistics m_stats;
 };
 
 BlockBasedFS::BlockBasedFS(FileDescription& file_description)
@@ -154,7 +343,18 @@ KResult BlockBasedFS::write_block(BlockIndex index, const UserOrKernelBuffer& da
         return KSuccess;
     }
 
-    auto& entry = cache().get(index);
+    auto* entry_ptr = cache().try_get(index);
+    if (!entry_ptr) {
+        // Every entry is waiting to be written back, so writers got ahead of SyncTask.
+        // Make them wait for the disk here, readers never do.
+        // NOTE: We want to make sure we only call FileBackedFS flush here,
+        //       not some FileBackedFS subclass flush!
+        ++cache().stats().synchronous_flushes;
+        flush_writes_impl();
+        entry_ptr = cache().try_get(index);
+        VERIFY(entry_ptr);
+    }
+    auto& entry = *entry_ptr;
     if (count < block_size()) {
         // Fill the cache first.
         auto result = read_block(index, nullptr, block_size());
@@ -246,25 +446,92 @@ KResult BlockBasedFS::read_block(BlockIndex index, UserOrKernelBuffer* buffer, s
         auto nread = file_description().read(*buffer, count);
         if (nread.is_error())
             return nread.error();
-        VERIFY(nread.value() == count);
+        if (nread.value() != count)
+            return EIO;
         return KSuccess;
     }
 
-    auto& entry = cache().get(index);
-    if (!entry.has_data) {
-        auto base_offset = index.value() * block_size();
-        auto seek_result = file_description().seek(base_offset, SEEK_SET);
+    auto* entry_ptr = cache().try_get(index);
+    if (!entry_ptr) {
+        // Every entry is dirty. Rather than making a reader wait for writeback, read around the cache.
+        // NOTE: Only write_block() passes no buffer, and it has already made room for the block.
+        VERIFY(buffer);
+        ++cache().stats().uncached_reads;
+        auto seek_result = file_description().seek(index.value() * block_size() + offset, SEEK_SET);
         if (seek_result.is_error())
             return seek_result.error();
+        auto nread = file_description().read(*buffer, count);
+        if (nread.is_error())
+            return nread.error();
+        if (nread.value() != count)
+            return EIO;
+        return KSuccess;
+    }
+    auto& entry = *entry_ptr;
+    cache().did_access(entry, entry.has_data);
+    if (entry.has_data) {
+        if (buffer && !buffer->write(entry.data + offset, count))
+            return EFAULT;
+        return KSuccess;
+    }
+
+    // If we're being read sequentially, fetch the blocks after this one in the same request.
+    size_t read_ahead_count = 1;
+    for (size_t i = 1; i < cache().read_ahead_count(); ++i) {
+        if (cache().find(BlockIndex { index.value() + i }))
+            break;
+        ++read_ahead_count;
+    }
+    // Don't read past the last block, the device would fail the whole request.
+    if (total_block_count() != 0 && index.value() < total_block_count())
+        read_ahead_count = min<size_t>(read_ahead_count, total_block_count() - index.value());
+
+    auto base_offset = index.value() * block_size();
+    auto seek_result = file_description().seek(base_offset, SEEK_SET);
+    if (seek_result.is_error())
+        return seek_result.error();
+
+    if (read_ahead_count == 1) {
         auto entry_data_buffer = UserOrKernelBuffer::for_kernel_buffer(entry.data);
         auto nread = file_description().read(entry_data_buffer, block_size());
         if (nread.is_error())
             return nread.error();
-        VERIFY(nread.value() == block_size());
+        if (nread.value() != block_size())
+            return EIO;
         entry.has_data = true;
+        if (buffer && !buffer->write(entry.data + offset, count))
+            return EFAULT;
+        return KSuccess;
     }
+
+    auto& read_ahead_buffer = cache().read_ahead_buffer();
+    auto read_ahead_data = UserOrKernelBuffer::for_kernel_buffer(read_ahead_buffer.data());
+    auto nread = file_description().read(read_ahead_data, read_ahead_count * block_size());
+    if (nread.is_error())
+        return nread.error();
+    // The device may have given us fewer blocks than we asked for, but the one we were asked for must be there.
+    if (nread.value() < block_size())
+        return EIO;
+
+    memcpy(entry.data, read_ahead_buffer.data(), block_size());
+    entry.has_data = true;
     if (buffer && !buffer->write(entry.data + offset, count))
         return EFAULT;
+
+    // NOTE: Getting these entries may evict others, so we must not touch `entry` anymore.
+    size_t blocks_read = nread.value() / block_size();
+    for (size_t i = 1; i < blocks_read; ++i) {
+        auto* ahead_entry_ptr = cache().try_get(BlockIndex { index.value() + i });
+        if (!ahead_entry_ptr)
+            break;
+        auto& ahead_entry = *ahead_entry_ptr;
+        if (ahead_entry.has_data)
+            continue;
+        memcpy(ahead_entry.data, read_ahead_buffer.data() + i * block_size(), block_size());
+        ahead_entry.has_data = true;
+        ahead_entry.was_read_ahead = true;
+        ++cache().stats().read_ahead_blocks;
+    }
     return KSuccess;
 }
 
@@ -315,23 +582,59 @@ void BlockBasedFS::flush_writes_impl()
     LOCKER(m_lock);
     if (!cache().is_dirty())
         return;
-    u32 count = 0;
+
+    // Write the dirty blocks in disk order, merging neighboring blocks into a single write.
+    Vector<CacheEntry*, 32> dirty_entries;
     cache().for_each_dirty_entry([&](CacheEntry& entry) {
-        u32 base_offset = entry.block_index.value() * block_size();
+        dirty_entries.append(&entry);
+    });
+    quick_sort(dirty_entries, [](auto* a, auto* b) { return a->block_index < b->block_index; });
+
+    auto& writeback_buffer = cache().writeback_buffer();
+    size_t write_count = 0;
+    for (size_t i = 0; i < dirty_entries.size();) {
+        size_t run_length = 1;
+        while (i + run_length < dirty_entries.size()
+            && run_length < DiskCache::max_read_ahead_blocks
+            && dirty_entries[i + run_length]->block_index.value() == dirty_entries[i]->block_index.value() + run_length)
+            ++run_length;
+
+        u8* data = dirty_entries[i]->data;
+        if (run_length > 1) {
+            for (size_t j = 0; j < run_length; ++j)
+                memcpy(writeback_buffer.data() + j * block_size(), dirty_entries[i + j]->data, block_size());
+            data = writeback_buffer.data();
+        }
+
+        auto base_offset = dirty_entries[i]->block_index.value() * block_size();
         auto seek_result = file_description().seek(base_offset, SEEK_SET);
         VERIFY(!seek_result.is_error());
         // FIXME: Should this error path be surfaced somehow?
-        auto entry_data_buffer = UserOrKernelBuffer::for_kernel_buffer(entry.data);
-        [[maybe_unused]] auto rc = file_description().write(entry_data_buffer, block_size());
-        ++count;
-    });
+        auto data_buffer = UserOrKernelBuffer::for_kernel_buffer(data);
+        [[maybe_unused]] auto rc = file_description().write(data_buffer, run_length * block_size());
+        ++write_count;
+        i += run_length;
+    }
+
+    cache().stats().blocks_written_back += dirty_entries.size();
     cache().mark_all_clean();
-    dbgln("{}: Flushed {} blocks to disk", class_name(), count);
+    dbgln("{}: Flushed {} blocks to disk in {} writes", class_name(), dirty_entries.size(), write_count);
 }
 
 void BlockBasedFS::flush_writes()
 {
     flush_writes_impl();
+    LOCKER(m_lock);
+    // Now that everything is clean, we can give memory back if the system needs it.
+    cache().shrink_if_under_memory_pressure();
+}
+
+BlockBasedFS::DiskCacheStatistics BlockBasedFS::disk_cache_statistics() const
+{
+    LOCKER(m_lock);
+    if (!m_cache)
+        return {};
+    return m_cache->statistics();
 }
 
 DiskCache& BlockBasedFS::cache() const
@@ -38,9 +38,24 @@ public:
 
     size_t logical_block_size() const { return m_logical_block_size; };
 
+    virtual bool is_block_based() const override { return true; }
+
     virtual void flush_writes() override;
     void flush_writes_impl();
 
+    struct DiskCacheStatistics {
+        u64 hits { 0 };
+        u64 misses { 0 };
+        u64 read_ahead_blocks { 0 };
+        u64 read_ahead_hits { 0 };
+        u64 blocks_written_back { 0 };
+        u64 synchronous_flushes { 0 };
+        u64 uncached_reads { 0 };
+        size_t entry_count { 0 };
+        size_t dirty_count { 0 };
+    };
+    DiskCacheStatistics disk_cache_statistics() const;
+
 protected:
     explicit BlockBasedFS(FileDescription&);
 
@@ -37,7 +37,7 @@ namespace Kernel {
 // FIXME: Custody needs some locking.
 
 class Custody : public RefCounted<Custody> {
-    MAKE_SLAB_ALLOCATED(Custody)
+    MAKE_SLAB_CACHED(Custody)
 public:
     static NonnullRefPtr<Custody> create(Custody* parent, const StringView& name, Inode& inode, int mount_flags)
     {
@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) 2021, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <AK/HashFunctions.h>
+#include <AK/Singleton.h>
+#include <Kernel/FileSystem/Custody.h>
+#include <Kernel/FileSystem/DentryCache.h>
+#include <Kernel/FileSystem/Inode.h>
+
+namespace Kernel {
+
+static AK::Singleton<DentryCache> s_the;
+
+DentryCache& DentryCache::the()
+{
+    return *s_the;
+}
+
+DentryCache::Entry::Entry(InodeIdentifier parent, const StringView& name, unsigned hash, RefPtr<Inode>&& inode, RefPtr<Custody>&& custody)
+    : parent(parent)
+    , name(name)
+    , hash(hash)
+    , inode(move(inode))
+    , custody(move(custody))
+{
+}
+
+DentryCache::Entry::~Entry()
+{
+}
+
+unsigned DentryCache::hash_for(InodeIdentifier parent, const StringView& name)
+{
+    return pair_int_hash(pair_int_hash(parent.fsid(), parent.index().value()), name.hash());
+}
+
+Optional<DentryCache::CachedLookup> DentryCache::lookup(const Custody& parent, const StringView& name, u32& sequence)
+{
+    auto parent_id = parent.inode().identifier();
+    auto hash = hash_for(parent_id, name);
+    auto& bucket = bucket_for(hash);
+
+    ScopedSpinLock lock(bucket.lock);
+    sequence = bucket.sequence;
+    for (auto& entry : bucket.entries) {
+        if (entry.hash != hash || entry.parent != parent_id || entry.name != name)
+            continue;
+        bucket.entries.remove(entry);
+        bucket.entries.prepend(entry);
+
+        CachedLookup result { entry.inode, nullptr };
+        if (entry.custody && entry.custody->parent() == &parent)
+            result.custody = entry.custody;
+        return result;
+    }
+    return {};
+}
+
+void DentryCache::add(const Custody& parent, const StringView& name, RefPtr<Inode> inode, RefPtr<Custody> custody, u32 sequence)
+{
+    auto parent_id = parent.inode().identifier();
+    auto hash = hash_for(parent_id, name);
+    auto& bucket = bucket_for(hash);
+
+    // NOTE: Entries are only ever created and destroyed outside of the bucket
+    //       lock, dropping the last reference to an inode may need to block.
+    auto* new_entry = new Entry(parent_id, name, hash, move(inode), move(custody));
+    Entry* entry_to_delete = nullptr;
+    {
+        ScopedSpinLock lock(bucket.lock);
+        if (bucket.sequence != sequence) {
+            // The directory may have changed since we looked up the name.
+            entry_to_delete = new_entry;
+        } else {
+            for (auto& entry : bucket.entries) {
+                if (entry.hash == hash && entry.parent == parent_id && entry.name == name) {
+                    entry_to_delete = &entry;
+                    break;
+                }
+            }
+            if (!entry_to_delete && bucket.entry_count == max_entries_per_bucket)
+                entry_to_delete = bucket.entries.last();
+            if (entry_to_delete) {
+                bucket.entries.remove(*entry_to_delete);
+                bucket.entry_count--;
+            }
+            bucket.entries.prepend(*new_entry);
+            bucket.entry_count++;
+        }
+    }
+    delete entry_to_delete;
+}
+
+void DentryCache::invalidate(InodeIdentifier parent, const StringView& name)
+{
+    auto hash = hash_for(parent, name);
+    auto& bucket = bucket_for(hash);
+
+    Entry* entry_to_delete = nullptr;
+    {
+        ScopedSpinLock lock(bucket.lock);
+        bucket.sequence++;
+        for (auto& entry : bucket.entries) {
+            if (entry.hash == hash && entry.parent == parent && entry.name == name) {
+                entry_to_delete = &entry;
+                break;
+            }
+        }
+        if (entry_to_delete) {
+            bucket.entries.remove(*entry_to_delete);
+            bucket.entry_count--;
+        }
+    }
+    delete entry_to_delete;
+}
+
+void DentryCache::invalidate_all()
+{
+    for (auto& bucket : m_buckets) {
+        IntrusiveList<Entry, &Entry::list_node> entries_to_delete;
+        {
+            ScopedSpinLock lock(bucket.lock);
+            bucket.sequence++;
+            while (auto* entry = bucket.entries.take_first())
+                entries_to_delete.append(*entry);
+            bucket.entry_count = 0;
+        }
+        while (auto* entry = entries_to_delete.take_first())
+            delete entry;
+    }
+}
+
+}
@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2021, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <AK/IntrusiveList.h>
+#include <AK/Optional.h>
+#include <AK/RefPtr.h>
+#include <AK/String.h>
+#include <Kernel/FileSystem/InodeIdentifier.h>
+#include <Kernel/Forward.h>
+#include <Kernel/Heap/SlabAllocator.h>
+#include <Kernel/SpinLock.h>
+
+namespace Kernel {
+
+// A system-wide cache of path component lookups, keyed by parent directory
+// inode and name. Negative lookups are cached too. Each entry also remembers
+// the last Custody built from it, so that resolving the same path again can
+// reuse whole Custody chains instead of allocating new ones.
+//
+// Only file systems that report every change to their directories (see
+// FS::supports_dentry_cache()) are cached. They invalidate entries through
+// Inode::did_add_child() and Inode::did_remove_child().
+class DentryCache {
+    AK_MAKE_ETERNAL;
+
+public:
+    static DentryCache& the();
+
+    struct CachedLookup {
+        // A null inode is a negative entry: the name doesn't exist.
+        RefPtr<Inode> inode;
+        // Only set if it was built on top of the same parent custody.
+        RefPtr<Custody> custody;
+    };
+
+    // The sequence number has to be passed on to add(). That way a lookup
+    // that raced with a change to the directory doesn't get cached.
+    Optional<CachedLookup> lookup(const Custody& parent, const StringView& name, u32& sequence);
+    void add(const Custody& parent, const StringView& name, RefPtr<Inode>, RefPtr<Custody>, u32 sequence);
+
+    void invalidate(InodeIdentifier parent, const StringView& name);
+    void invalidate_all();
+
+private:
+    struct Entry {
+        MAKE_SLAB_ALLOCATED(Entry)
+    public:
+        Entry(InodeIdentifier parent, const StringView& name, unsigned hash, RefPtr<Inode>&& inode, RefPtr<Custody>&& custody);
+        ~Entry();
+
+        InodeIdentifier parent;
+        String name;
+        unsigned hash { 0 };
+        RefPtr<Inode> inode;
+        RefPtr<Custody> custody;
+        IntrusiveListNode list_node;
+    };
+
+    struct Bucket {
+        SpinLock<u8> lock;
+        // Most recently used first.
+        IntrusiveList<Entry, &Entry::list_node> entries;
+        size_t entry_count { 0 };
+        // Bumped whenever an entry may have become stale.
+        u32 sequence { 0 };
+    };
+
+    static unsigned hash_for(InodeIdentifier parent, const StringView& name);
+    Bucket& bucket_for(unsigned hash) { return m_buckets[hash % bucket_count]; }
+
+    static constexpr size_t bucket_count = 512;
+    static constexpr size_t max_entries_per_bucket = 8;
+
+    Bucket m_buckets[bucket_count];
+};
+
+}
@@ -0,0 +1,249 @@
+/*
+ * Copyright (c) 2021, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <Kernel/FileSystem/EventPoll.h>
+#include <Kernel/FileSystem/FileDescription.h>
+#include <Kernel/Process.h>
+
+namespace Kernel {
+
+using BlockFlags = Thread::FileBlocker::BlockFlags;
+
+NonnullRefPtr<EventPoll> EventPoll::create()
+{
+    return adopt(*new EventPoll);
+}
+
+EventPoll::EventPoll()
+{
+}
+
+EventPoll::~EventPoll()
+{
+    // Every watched description holds a reference to us until we've removed our interest in it.
+    VERIFY(m_interests.is_empty());
+}
+
+KResult EventPoll::close()
+{
+    // The descriptions we watch keep us alive, so drop all interests once our own
+    // description goes away. Otherwise we'd both live until the watched files are closed.
+    LOCKER(m_lock);
+    while (!m_interests.is_empty())
+        remove_interest(*m_interests.begin()->value);
+    return KSuccess;
+}
+
+void EventPoll::observed_description_will_die(FileDescription& description)
+{
+    // Like on Linux, an interest goes away once every fd referring to its description is closed.
+    LOCKER(m_lock);
+    Vector<Interest*, 4> dying_interests;
+    for (auto& it : m_interests) {
+        if (&it.value->description == &description)
+            dying_interests.append(it.value.ptr());
+    }
+    // The description has already dropped its references to us.
+    for (auto* interest : dying_interests)
+        forget_interest(*interest);
+}
+
+BlockFlags EventPoll::block_flags_for(u32 events)
+{
+    auto flags = BlockFlags::None;
+    if (events & EPOLLIN)
+        flags |= BlockFlags::Read;
+    if (events & EPOLLOUT)
+        flags |= BlockFlags::Write;
+    return flags;
+}
+
+bool EventPoll::Watcher::unblock(bool, void* data)
+{
+    VERIFY(data);
+    auto& interest = *static_cast<Interest*>(data);
+    interest.event_poll.did_change_readiness(interest);
+    // Stay registered with the block condition, we want to hear about the next change too.
+    return false;
+}
+
+void EventPoll::did_change_readiness(Interest& interest)
+{
+    // NOTE: This is called with the watched file's block condition locked,
+    //       so we must not take m_lock here.
+    if (interest.description.should_unblock(block_flags_for(interest.events)) == BlockFlags::None)
+        return;
+    {
+        ScopedSpinLock lock(m_ready_lock);
+        if (interest.is_disabled || interest.ready_list_node.is_in_list())
+            return;
+        m_ready_list.append(interest);
+    }
+    evaluate_block_conditions();
+}
+
+void EventPoll::enqueue_if_ready(Interest& interest)
+{
+    VERIFY(m_lock.is_locked());
+    did_change_readiness(interest);
+}
+
+KResult EventPoll::add(int fd, FileDescription& description, const epoll_event& event)
+{
+    if (description.file().is_event_poll())
+        return EINVAL;
+
+    LOCKER(m_lock);
+    if (auto it = m_interests.find(fd); it != m_interests.end()) {
+        if (&it->value->description == &description)
+            return EEXIST;
+        // The descriptor was closed and its number reused without being removed from us first.
+        remove_interest(*it->value);
+    }
+
+    auto interest = make<Interest>(*this, fd, description, event);
+    auto& interest_ref = *interest;
+    m_interests.set(fd, move(interest));
+    description.add_observer(*this);
+    // add_blocker() asks the watcher whether it's ready right away, which queues it if it is.
+    bool was_added = description.block_condition().add_blocker(interest_ref.watcher, &interest_ref);
+    VERIFY(was_added);
+    return KSuccess;
+}
+
+KResult EventPoll::modify(int fd, FileDescription& description, const epoll_event& event)
+{
+    LOCKER(m_lock);
+    auto it = m_interests.find(fd);
+    if (it == m_interests.end() || &it->value->description != &description)
+        return ENOENT;
+
+    auto& interest = *it->value;
+    {
+        ScopedSpinLock lock(m_ready_lock);
+        interest.events = event.events;
+        interest.data = event.data;
+        interest.is_disabled = false;
+        if (interest.ready_list_node.is_in_list())
+            m_ready_list.remove(interest);
+    }
+    enqueue_if_ready(interest);
+    return KSuccess;
+}
+
+KResult EventPoll::remove(int fd, FileDescription& description)
+{
+    LOCKER(m_lock);
+    auto it = m_interests.find(fd);
+    if (it == m_interests.end() || &it->value->description != &description)
+        return ENOENT;
+    remove_interest(*it->value);
+    return KSuccess;
+}
+
+void EventPoll::remove_interest(Interest& interest)
+{
+    VERIFY(m_lock.is_locked());
+    interest.description.remove_observer(*this);
+    forget_interest(interest);
+}
+
+void EventPoll::forget_interest(Interest& interest)
+{
+    VERIFY(m_lock.is_locked());
+    // Once this returns, the watcher can no longer be called.
+    interest.description.block_condition().remove_blocker(interest.watcher, &interest);
+    {
+        ScopedSpinLock lock(m_ready_lock);
+        if (interest.ready_list_node.is_in_list())
+            m_ready_list.remove(interest);
+    }
+    m_interests.remove(interest.fd);
+}
+
+void EventPoll::collect_ready_events(Vector<epoll_event>& events, size_t max_events)
+{
+    // If another thread closes the last fd of a description while we look at it, ours
+    // may be the last reference to it. Let them go only after m_lock, so that its death
+    // can't pull interests out from under us.
+    Vector<NonnullRefPtr<FileDescription>, 32> descriptions;
+    LOCKER(m_lock);
+
+    Vector<Interest*, 32> candidates;
+    {
+        ScopedSpinLock lock(m_ready_lock);
+        while (candidates.size() < max_events && !m_ready_list.is_empty())
+            candidates.append(m_ready_list.take_first());
+    }
+
+    Vector<Interest*, 32> still_ready;
+    for (auto* interest : candidates) {
+        // Like on Linux, the interest belongs to the description rather than to the fd
+        // (which may have been dup'ed and closed, or live in another process's table).
+        // If the description is on its way out, observed_description_will_die() is
+        // about to forget the interest, as soon as we let go of m_lock.
+        if (!interest->description.try_ref())
+            continue;
+        descriptions.append(adopt(interest->description));
+
+        // Readiness may have changed since we were notified, so ask again.
+        // If it went away, the next state change will queue the interest again.
+        auto flags = interest->description.should_unblock(block_flags_for(interest->events));
+        if (flags == BlockFlags::None)
+            continue;
+
+        u32 ready_events = 0;
+        if (has_flag(flags, BlockFlags::Read))
+            ready_events |= EPOLLIN;
+        if (has_flag(flags, BlockFlags::Write))
+            ready_events |= EPOLLOUT;
+        events.append({ ready_events, interest->data });
+
+        if (interest->events & EPOLLONESHOT)
+            interest->is_disabled = true;
+        else if (!(interest->events & EPOLLET))
+            still_ready.append(interest);
+    }
+
+    if (still_ready.is_empty())
+        return;
+
+    // Level-triggered interests go to the back of the queue so that a busy
+    // descriptor can't starve the others when max_events is small.
+    ScopedSpinLock lock(m_ready_lock);
+    for (auto* interest : still_ready) {
+        if (!interest->ready_list_node.is_in_list())
+            m_ready_list.append(*interest);
+    }
+}
+
+bool EventPoll::can_read(const FileDescription&, size_t) const
+{
+    ScopedSpinLock lock(m_ready_lock);
+    return !m_ready_list.is_empty();
+}
+
+}
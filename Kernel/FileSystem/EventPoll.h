@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) 2021, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <AK/HashMap.h>
+#include <AK/IntrusiveList.h>
+#include <AK/NonnullOwnPtr.h>
+#include <AK/Vector.h>
+#include <Kernel/FileSystem/File.h>
+#include <Kernel/Lock.h>
+#include <Kernel/UnixTypes.h>
+
+namespace Kernel {
+
+// EventPoll is the kernel side of epoll(). It keeps a persistent set of
+// file descriptions the process is interested in, and hooks into each of
+// their block conditions so that it finds out when they become ready.
+// Waiting on it only ever looks at descriptions that signalled readiness,
+// instead of scanning every registered descriptor like select() and poll().
+class EventPoll final : public File {
+public:
+    static NonnullRefPtr<EventPoll> create();
+    virtual ~EventPoll() override;
+
+    KResult add(int fd, FileDescription&, const epoll_event&);
+    KResult modify(int fd, FileDescription&, const epoll_event&);
+    KResult remove(int fd, FileDescription&);
+
+    // Moves up to max_events pending events into the given vector.
+    // Level-triggered interests that are still ready stay queued for the next call.
+    void collect_ready_events(Vector<epoll_event>&, size_t max_events);
+
+    virtual bool can_read(const FileDescription&, size_t) const override;
+    virtual bool can_write(const FileDescription&, size_t) const override { return false; }
+    virtual KResultOr<size_t> read(FileDescription&, u64, UserOrKernelBuffer&, size_t) override { return EINVAL; }
+    virtual KResultOr<size_t> write(FileDescription&, u64, const UserOrKernelBuffer&, size_t) override { return EINVAL; }
+    virtual String absolute_path(const FileDescription&) const override { return "epoll"; }
+    virtual const char* class_name() const override { return "EventPoll"; }
+    virtual bool is_event_poll() const override { return true; }
+    virtual KResult close() override;
+    virtual void observed_description_will_die(FileDescription&) override;
+
+private:
+    EventPoll();
+
+    struct Interest;
+
+    // Watchers sit on the block condition of the watched file for as long as the
+    // interest is registered. They never block a thread; unblock() is just our
+    // notification that the file's state changed.
+    class Watcher final : public Thread::FileBlocker {
+    public:
+        virtual const char* state_string() const override { return "EventPoll"; }
+        virtual void not_blocking(bool) override { VERIFY_NOT_REACHED(); }
+        virtual bool unblock(bool, void*) override;
+    };
+
+    struct Interest {
+        Interest(EventPoll& event_poll, int fd, FileDescription& description, const epoll_event& event)
+            : event_poll(event_poll)
+            , fd(fd)
+            , description(description)
+            , events(event.events)
+            , data(event.data)
+        {
+        }
+
+        EventPoll& event_poll;
+        const int fd;
+        // Not a strong reference: the description tells us before it dies, and we
+        // must not keep the file open after userspace has closed every fd to it.
+        FileDescription& description;
+        u32 events { 0 };
+        epoll_data_t data {};
+        bool is_disabled { false };
+        IntrusiveListNode ready_list_node;
+        Watcher watcher;
+    };
+
+    static Thread::FileBlocker::BlockFlags block_flags_for(u32 events);
+    void did_change_readiness(Interest&);
+    void enqueue_if_ready(Interest&);
+    void remove_interest(Interest&);
+    void forget_interest(Interest&);
+
+    Lock m_lock { "EventPoll" };
+    HashMap<int, NonnullOwnPtr<Interest>> m_interests;
+
+    mutable SpinLock<u8> m_ready_lock;
+    IntrusiveList<Interest, &Interest::ready_list_node> m_ready_list;
+};
+
+}
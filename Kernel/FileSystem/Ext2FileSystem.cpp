@@ -24,8 +24,10 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <AK/BitCast.h>
 #include <AK/HashMap.h>
 #include <AK/MemoryStream.h>
+#include <AK/QuickSort.h>
 #include <AK/StdLibExtras.h>
 #include <AK/StringView.h>
 #include <Kernel/Debug.h>
@@ -42,6 +44,8 @@ namespace Kernel {
 static const size_t max_link_count = 65535;
 static const size_t max_block_size = 4096;
 static const ssize_t max_inline_symlink_length = 60;
+static const size_t max_cached_block_runs = 4096;
+static const unsigned max_extent_tree_depth = 5;
 
 struct Ext2FSDirectoryEntry {
     String name;
@@ -73,6 +77,176 @@ static unsigned divide_rounded_up(unsigned a, unsigned b)
     return (a / b) + (a % b != 0);
 }
 
+static constexpr size_t htree_root_info_offset = 24;
+static constexpr size_t htree_node_entries_offset = 8;
+static constexpr u8 htree_max_indirect_levels = 2;
+
+// The directory hash functions below must produce exactly the same values as ext3/ext4.
+
+static void directory_name_to_hash_buffer(const StringView& name, bool is_signed, u32* buffer, int count)
+{
+    u32 padding = (u32)name.length() | ((u32)name.length() << 8);
+    padding |= padding << 16;
+
+    u32 value = padding;
+    size_t length = min(name.length(), (size_t)count * 4);
+    for (size_t i = 0; i < length; ++i) {
+        int c = is_signed ? (int)(signed char)name[i] : (int)(unsigned char)name[i];
+        value = c + (value << 8);
+        if ((i % 4) == 3) {
+            *buffer++ = value;
+            value = padding;
+            --count;
+        }
+    }
+    if (--count >= 0)
+        *buffer++ = value;
+    while (--count >= 0)
+        *buffer++ = padding;
+}
+
+static u32 legacy_directory_hash(const StringView& name, bool is_signed)
+{
+    u32 hash0 = 0x12a3fe2d;
+    u32 hash1 = 0x37abe8f9;
+    for (size_t i = 0; i < name.length(); ++i) {
+        int c = is_signed ? (int)(signed char)name[i] : (int)(unsigned char)name[i];
+        u32 hash = hash1 + (hash0 ^ (u32)(c * 7152373));
+        if (hash & 0x80000000)
+            hash -= 0x7fffffff;
+        hash1 = hash0;
+        hash0 = hash;
+    }
+    return hash0 << 1;
+}
+
+static void half_md4_transform(u32 buffer[4], const u32 in[8])
+{
+    auto rotate_left = [](u32 value, unsigned shift) { return (value << shift) | (value >> (32 - shift)); };
+    auto f = [](u32 x, u32 y, u32 z) { return z ^ (x & (y ^ z)); };
+    auto g = [](u32 x, u32 y, u32 z) { return (x & y) + ((x ^ y) & z); };
+    auto h = [](u32 x, u32 y, u32 z) { return x ^ y ^ z; };
+    constexpr u32 k1 = 0;
+    constexpr u32 k2 = 013240474631;
+    constexpr u32 k3 = 015666365641;
+
+    u32 a = buffer[0], b = buffer[1], c = buffer[2], d = buffer[3];
+
+#define HALF_MD4_ROUND(fn, a, b, c, d, x, s) a = rotate_left(a + fn(b, c, d) + (x), s)
+    HALF_MD4_ROUND(f, a, b, c, d, in[0] + k1, 3);
+    HALF_MD4_ROUND(f, d, a, b, c, in[1] + k1, 7);
+    HALF_MD4_ROUND(f, c, d, a, b, in[2] + k1, 11);
+    HALF_MD4_ROUND(f, b, c, d, a, in[3] + k1, 19);
+    HALF_MD4_ROUND(f, a, b, c, d, in[4] + k1, 3);
+    HALF_MD4_ROUND(f, d, a, b, c, in[5] + k1, 7);
+    HALF_MD4_ROUND(f, c, d, a, b, in[6] + k1, 11);
+    HALF_MD4_ROUND(f, b, c, d, a, in[7] + k1, 19);
+
+    HALF_MD4_ROUND(g, a, b, c, d, in[1] + k2, 3);
+    HALF_MD4_ROUND(g, d, a, b, c, in[3] + k2, 5);
+    HALF_MD4_ROUND(g, c, d, a, b, in[5] + k2, 9);
+    HALF_MD4_ROUND(g, b, c, d, a, in[7] + k2, 13);
+    HALF_MD4_ROUND(g, a, b, c, d, in[0] + k2, 3);
+    HALF_MD4_ROUND(g, d, a, b, c, in[2] + k2, 5);
+    HALF_MD4_ROUND(g, c, d, a, b, in[4] + k2, 9);
+    HALF_MD4_ROUND(g, b, c, d, a, in[6] + k2, 13);
+
+    HALF_MD4_ROUND(h, a, b, c, d, in[3] + k3, 3);
+    HALF_MD4_ROUND(h, d, a, b, c, in[7] + k3, 9);
+    HALF_MD4_ROUND(h, c, d, a, b, in[2] + k3, 11);
+    HALF_MD4_ROUND(h, b, c, d, a, in[6] + k3, 15);
+    HALF_MD4_ROUND(h, a, b, c, d, in[1] + k3, 3);
+    HALF_MD4_ROUND(h, d, a, b, c, in[5] + k3, 9);
+    HALF_MD4_ROUND(h, c, d, a, b, in[0] + k3, 11);
+    HALF_MD4_ROUND(h, b, c, d, a, in[4] + k3, 15);
+#undef HALF_MD4_ROUND
+
+    buffer[0] += a;
+    buffer[1] += b;
+    buffer[2] += c;
+    buffer[3] += d;
+}
+
+static void tea_transform(u32 buffer[4], const u32 in[4])
+{
+    u32 sum = 0;
+    u32 b0 = buffer[0], b1 = buffer[1];
+    u32 a = in[0], b = in[1], c = in[2], d = in[3];
+    for (int n = 0; n < 16; ++n) {
+        sum += 0x9E3779B9;
+        b0 += ((b1 << 4) + a) ^ (b1 + sum) ^ ((b1 >> 5) + b);
+        b1 += ((b0 << 4) + c) ^ (b0 + sum) ^ ((b0 >> 5) + d);
+    }
+    buffer[0] += b0;
+    buffer[1] += b1;
+}
+
+static bool is_valid_directory_record(const ByteBuffer& block, size_t offset)
+{
+    if (offset + 8 > block.size())
+        return false;
+    auto& entry = *reinterpret_cast<const ext2_dir_entry_2*>(block.data() + offset);
+    return entry.rec_len >= 8 && (entry.rec_len % 4) == 0 && offset + entry.rec_len <= block.size() && (size_t)entry.name_len + 8 <= entry.rec_len;
+}
+
+static ext2_dir_entry_2& directory_record_at(ByteBuffer& block, size_t offset)
+{
+    return *reinterpret_cast<ext2_dir_entry_2*>(block.data() + offset);
+}
+
+static void fill_directory_record(ext2_dir_entry_2& entry, const StringView& name, InodeIndex inode_index, u8 file_type)
+{
+    entry.inode = inode_index.value();
+    entry.name_len = name.length();
+    entry.file_type = file_type;
+    memcpy(entry.name, name.characters_without_null_termination(), name.length());
+}
+
+// Puts a new entry into the first gap that is large enough, splitting the record that owns the gap.
+static bool insert_into_directory_block(ByteBuffer& block, const StringView& name, InodeIndex inode_index, u8 file_type)
+{
+    size_t needed_length = EXT2_DIR_REC_LEN(name.length());
+    for (size_t offset = 0; offset < block.size();) {
+        if (!is_valid_directory_record(block, offset))
+            return false;
+        auto& entry = directory_record_at(block, offset);
+        size_t used_length = entry.inode ? EXT2_DIR_REC_LEN(entry.name_len) : 0;
+        if (entry.rec_len - used_length >= needed_length) {
+            if (used_length == 0) {
+                fill_directory_record(entry, name, inode_index, file_type);
+                return true;
+            }
+            auto& new_entry = directory_record_at(block, offset + used_length);
+            new_entry.rec_len = entry.rec_len - used_length;
+            entry.rec_len = used_length;
+            fill_directory_record(new_entry, name, inode_index, file_type);
+            return true;
+        }
+        offset += entry.rec_len;
+    }
+    return false;
+}
+
+// Packs the entries into a single directory block, the last record owning the remaining space.
+static ByteBuffer serialize_directory_block(const Vector<Ext2FSDirectoryEntry>& entries, size_t block_size)
+{
+    auto block = ByteBuffer::create_zeroed(block_size);
+    if (entries.is_empty()) {
+        directory_record_at(block, 0).rec_len = block_size;
+        return block;
+    }
+    size_t offset = 0;
+    for (size_t i = 0; i < entries.size(); ++i) {
+        auto& entry = directory_record_at(block, offset);
+        size_t record_length = EXT2_DIR_REC_LEN(entries[i].name.length());
+        VERIFY(offset + record_length <= block_size);
+        entry.rec_len = i == entries.size() - 1 ? block_size - offset : record_length;
+        fill_directory_record(entry, entries[i].name, entries[i].inode_index, entries[i].file_type);
+        offset += record_length;
+    }
+    return block;
+}
+
 NonnullRefPtr<Ext2FS> Ext2FS::create(FileDescription& file_description)
 {
     return adopt(*new Ext2FS(file_description));
@@ -544,6 +718,24 @@ Vector<Ext2FS::BlockIndex> Ext2FSInode::compute_block_list_with_meta_blocks() co
 
 Vector<Ext2FS::BlockIndex> Ext2FSInode::compute_block_list_impl(bool include_block_list_blocks) const
 {
+    if (uses_extents()) {
+        Vector<Extent> extents;
+        Vector<Ext2FS::BlockIndex> tree_blocks;
+        if (auto result = read_extent_tree(extents, tree_blocks); result.is_error()) {
+            // FIXME: Propagate this error.
+            dbgln("Ext2FSInode[{}]::compute_block_list_impl(): Error: {}", identifier(), result.error());
+            return {};
+        }
+        Vector<Ext2FS::BlockIndex> list;
+        for (auto& extent : extents) {
+            for (u32 i = 0; i < extent.length; ++i)
+                list.append(extent.physical_start.value() + i);
+        }
+        if (include_block_list_blocks)
+            list.append(move(tree_blocks));
+        return list;
+    }
+
     // FIXME: This is really awkwardly factored.. foo_impl_internal :|
     auto block_list = compute_block_list_impl_internal(m_raw_inode, include_block_list_blocks);
     while (!block_list.is_empty() && block_list.last() == 0)
@@ -646,6 +838,400 @@ Vector<Ext2FS::BlockIndex> Ext2FSInode::compute_block_list_impl_internal(const e
     return list;
 }
 
+KResultOr<Ext2FS::BlockIndex> Ext2FSInode::block_index_for(u32 logical_block) const
+{
+    VERIFY(m_lock.is_locked());
+
+    // After a resize we're holding on to the whole list anyway.
+    if (!m_block_list.is_empty()) {
+        if (logical_block >= m_block_list.size())
+            return Ext2FS::BlockIndex { 0 };
+        return m_block_list[logical_block];
+    }
+
+    auto block_in_run = [&](const BlockRun& run) {
+        if (!run.physical_start.value())
+            return Ext2FS::BlockIndex { 0 };
+        return Ext2FS::BlockIndex { run.physical_start.value() + (logical_block - run.logical_start) };
+    };
+
+    if (auto* run = find_cached_block_run(logical_block))
+        return block_in_run(*run);
+
+    // Resolving adds at most one node's worth of runs, so this keeps the map bounded.
+    if (m_block_map.size() >= max_cached_block_runs)
+        m_block_map.clear();
+
+    auto result = uses_extents() ? resolve_extent_block_run(logical_block) : resolve_indirect_block_run(logical_block);
+    if (result.is_error())
+        return result;
+
+    if (auto* run = find_cached_block_run(logical_block))
+        return block_in_run(*run);
+
+    // Nothing maps this block, so it's a hole.
+    return Ext2FS::BlockIndex { 0 };
+}
+
+// Returns the index of the first run that starts after logical_block.
+template<typename BlockMap>
+static size_t upper_bound_of_block_run(const BlockMap& block_map, u32 logical_block)
+{
+    size_t low = 0;
+    size_t high = block_map.size();
+    while (low < high) {
+        size_t middle = (low + high) / 2;
+        if (block_map[middle].logical_start <= logical_block)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return low;
+}
+
+const Ext2FSInode::BlockRun* Ext2FSInode::find_cached_block_run(u32 logical_block) const
+{
+    size_t index = upper_bound_of_block_run(m_block_map, logical_block);
+    if (index == 0)
+        return nullptr;
+    auto& run = m_block_map[index - 1];
+    return run.contains(logical_block) ? &run : nullptr;
+}
+
+void Ext2FSInode::cache_block_run(const BlockRun& run) const
+{
+    if (!run.length)
+        return;
+
+    size_t index = upper_bound_of_block_run(m_block_map, run.logical_start);
+
+    // Runs never overlap, so if we already know about any of these blocks we know about all of them.
+    if (index > 0 && m_block_map[index - 1].logical_end() > run.logical_start)
+        return;
+    if (index < m_block_map.size() && run.logical_end() > m_block_map[index].logical_start)
+        return;
+
+    if (index > 0) {
+        auto& previous = m_block_map[index - 1];
+        bool continues_previous = previous.logical_end() == run.logical_start
+            && (previous.physical_start.value() ? run.physical_start.value() == previous.physical_start.value() + previous.length : !run.physical_start.value());
+        if (continues_previous) {
+            previous.length += run.length;
+            return;
+        }
+    }
+    m_block_map.insert(index, run);
+}
+
+KResultOr<Ext2FS::BlockIndex> Ext2FSInode::read_block_pointer(Ext2FS::BlockIndex array_block, u32 index) const
+{
+    if (!array_block.value())
+        return Ext2FS::BlockIndex { 0 };
+    u32 pointer;
+    auto buffer = UserOrKernelBuffer::for_kernel_buffer((u8*)&pointer);
+    if (auto result = fs().read_block(array_block, &buffer, sizeof(pointer), index * sizeof(pointer)); result.is_error())
+        return result;
+    return Ext2FS::BlockIndex { pointer };
+}
+
+KResult Ext2FSInode::resolve_indirect_block_run(u32 logical_block) const
+{
+    const u64 entries_per_block = EXT2_ADDR_PER_BLOCK(&fs().super_block());
+    u64 block_count = ceil_div(size(), static_cast<u64>(fs().block_size()));
+    if (::is_symlink(m_raw_inode.i_mode) && m_raw_inode.i_blocks == 0)
+        block_count = 0;
+    if (logical_block >= block_count)
+        return KSuccess;
+
+    if (logical_block < EXT2_NDIR_BLOCKS) {
+        for (u32 i = 0; i < min(block_count, static_cast<u64>(EXT2_NDIR_BLOCKS)); ++i)
+            cache_block_run({ i, m_raw_inode.i_block[i], 1 });
+        return KSuccess;
+    }
+
+    // Find the one array of block pointers that maps this block, only reading the pointers on the way there.
+    u64 index = logical_block - EXT2_NDIR_BLOCKS;
+    u64 first_logical_block = EXT2_NDIR_BLOCKS;
+    Ext2FS::BlockIndex array_block = m_raw_inode.i_block[EXT2_IND_BLOCK];
+    if (index >= entries_per_block) {
+        index -= entries_per_block;
+        first_logical_block += entries_per_block;
+        if (index < entries_per_block * entries_per_block) {
+            auto block_or_error = read_block_pointer(m_raw_inode.i_block[EXT2_DIND_BLOCK], index / entries_per_block);
+            if (block_or_error.is_error())
+                return block_or_error.error();
+            array_block = block_or_error.value();
+        } else {
+            index -= entries_per_block * entries_per_block;
+            first_logical_block += entries_per_block * entries_per_block;
+            auto doubly_indirect_block_or_error = read_block_pointer(m_raw_inode.i_block[EXT2_TIND_BLOCK], index / (entries_per_block * entries_per_block));
+            if (doubly_indirect_block_or_error.is_error())
+                return doubly_indirect_block_or_error.error();
+            auto block_or_error = read_block_pointer(doubly_indirect_block_or_error.value(), (index / entries_per_block) % entries_per_block);
+            if (block_or_error.is_error())
+                return block_or_error.error();
+            array_block = block_or_error.value();
+        }
+        first_logical_block += index / entries_per_block * entries_per_block;
+    }
+
+    u32 count = min(entries_per_block, block_count - first_logical_block);
+    if (!array_block.value()) {
+        cache_block_run({ static_cast<u32>(first_logical_block), 0, count });
+        return KSuccess;
+    }
+
+    auto array_storage = ByteBuffer::create_uninitialized(count * sizeof(u32));
+    auto* array = (u32*)array_storage.data();
+    auto buffer = UserOrKernelBuffer::for_kernel_buffer((u8*)array);
+    if (auto result = fs().read_block(array_block, &buffer, count * sizeof(u32), 0); result.is_error())
+        return result;
+    for (u32 i = 0; i < count; ++i)
+        cache_block_run({ static_cast<u32>(first_logical_block) + i, array[i], 1 });
+    return KSuccess;
+}
+
+static bool is_valid_extent_node(const u8* node, size_t node_size)
+{
+    auto& header = *(const ext4_extent_header*)node;
+    return header.eh_magic == EXT4_EXT_MAGIC
+        && header.eh_depth <= max_extent_tree_depth
+        && sizeof(ext4_extent_header) + header.eh_entries * sizeof(ext4_extent) <= node_size;
+}
+
+Ext2FSInode::Extent Ext2FSInode::extent_from_raw(const ext4_extent& raw_extent)
+{
+    bool uninitialized = raw_extent.ee_len > EXT4_EXT_INIT_MAX_LEN;
+    return {
+        raw_extent.ee_block,
+        uninitialized ? raw_extent.ee_len - EXT4_EXT_INIT_MAX_LEN : raw_extent.ee_len,
+        (static_cast<u64>(raw_extent.ee_start_hi) << 32) | raw_extent.ee_start_lo,
+        uninitialized,
+    };
+}
+
+KResult Ext2FSInode::resolve_extent_block_run(u32 logical_block) const
+{
+    // Walk down from the root one node per level, then remember everything in the leaf we end up in.
+    auto node_storage = ByteBuffer::create_uninitialized(fs().block_size());
+    memcpy(node_storage.data(), m_raw_inode.i_block, sizeof(m_raw_inode.i_block));
+    size_t node_size = sizeof(m_raw_inode.i_block);
+    Optional<unsigned> expected_depth;
+
+    for (;;) {
+        auto& header = *(const ext4_extent_header*)node_storage.data();
+        if (!is_valid_extent_node(node_storage.data(), node_size) || (expected_depth.has_value() && header.eh_depth != expected_depth.value())) {
+            dbgln("Ext2FSInode[{}]::resolve_extent_block_run(): Corrupt extent tree", identifier());
+            return EIO;
+        }
+
+        if (header.eh_depth == 0) {
+            auto* raw_extents = (const ext4_extent*)(node_storage.data() + sizeof(ext4_extent_header));
+            for (size_t i = 0; i < header.eh_entries; ++i) {
+                auto extent = extent_from_raw(raw_extents[i]);
+                // Uninitialized extents have their blocks allocated, but must read back as zeroes.
+                cache_block_run({ extent.logical_start, extent.uninitialized ? 0 : extent.physical_start, extent.length });
+            }
+            return KSuccess;
+        }
+
+        auto* indices = (const ext4_extent_idx*)(node_storage.data() + sizeof(ext4_extent_header));
+        const ext4_extent_idx* child = nullptr;
+        for (size_t i = 0; i < header.eh_entries && indices[i].ei_block <= logical_block; ++i)
+            child = &indices[i];
+        if (!child)
+            return KSuccess;
+
+        expected_depth = header.eh_depth - 1;
+        Ext2FS::BlockIndex child_block = (static_cast<u64>(child->ei_leaf_hi) << 32) | child->ei_leaf_lo;
+        auto buffer = UserOrKernelBuffer::for_kernel_buffer(node_storage.data());
+        if (auto result = fs().read_block(child_block, &buffer, fs().block_size()); result.is_error())
+            return result;
+        node_size = fs().block_size();
+    }
+}
+
+KResult Ext2FSInode::read_extent_tree(Vector<Extent>& extents, Vector<Ext2FS::BlockIndex>& tree_blocks) const
+{
+    auto* root = (const u8*)m_raw_inode.i_block;
+    if (!is_valid_extent_node(root, sizeof(m_raw_inode.i_block)))
+        return EIO;
+    return read_extent_node(root, sizeof(m_raw_inode.i_block), extents, tree_blocks, ((const ext4_extent_header*)root)->eh_depth);
+}
+
+KResult Ext2FSInode::read_extent_node(const u8* node, size_t node_size, Vector<Extent>& extents, Vector<Ext2FS::BlockIndex>& tree_blocks, unsigned expected_depth) const
+{
+    auto& header = *(const ext4_extent_header*)node;
+    if (!is_valid_extent_node(node, node_size) || header.eh_depth != expected_depth) {
+        dbgln("Ext2FSInode[{}]::read_extent_node(): Corrupt extent tree", identifier());
+        return EIO;
+    }
+
+    if (header.eh_depth == 0) {
+        auto* raw_extents = (const ext4_extent*)(node + sizeof(ext4_extent_header));
+        for (size_t i = 0; i < header.eh_entries; ++i)
+            extents.append(extent_from_raw(raw_extents[i]));
+        return KSuccess;
+    }
+
+    auto* indices = (const ext4_extent_idx*)(node + sizeof(ext4_extent_header));
+    auto child_storage = ByteBuffer::create_uninitialized(fs().block_size());
+    for (size_t i = 0; i < header.eh_entries; ++i) {
+        Ext2FS::BlockIndex child_block = (static_cast<u64>(indices[i].ei_leaf_hi) << 32) | indices[i].ei_leaf_lo;
+        tree_blocks.append(child_block);
+        auto buffer = UserOrKernelBuffer::for_kernel_buffer(child_storage.data());
+        if (auto result = fs().read_block(child_block, &buffer, fs().block_size()); result.is_error())
+            return result;
+        if (auto result = read_extent_node(child_storage.data(), fs().block_size(), extents, tree_blocks, expected_depth - 1); result.is_error())
+            return result;
+    }
+    return KSuccess;
+}
+
+static void write_extent_header(u8* node, size_t entry_count, size_t capacity, u16 depth)
+{
+    auto& header = *(ext4_extent_header*)node;
+    header.eh_magic = EXT4_EXT_MAGIC;
+    header.eh_entries = entry_count;
+    header.eh_max = capacity;
+    header.eh_depth = depth;
+    header.eh_generation = 0;
+}
+
+KResult Ext2FSInode::write_extent_tree(const Vector<Extent>& extents, Vector<Ext2FS::BlockIndex>& tree_blocks)
+{
+    static_assert(sizeof(ext4_extent) == sizeof(ext4_extent_idx));
+    const size_t block_size = fs().block_size();
+    const size_t entries_per_root = (sizeof(m_raw_inode.i_block) - sizeof(ext4_extent_header)) / sizeof(ext4_extent);
+    const size_t entries_per_node = (block_size - sizeof(ext4_extent_header)) / sizeof(ext4_extent);
+
+    // We rebuild the tree with as few levels as it takes to fit the root in the inode.
+    size_t tree_block_count = 0;
+    for (size_t entry_count = extents.size(); entry_count > entries_per_root;) {
+        entry_count = ceil_div(entry_count, entries_per_node);
+        tree_block_count += entry_count;
+    }
+
+    const size_t old_tree_block_count = tree_blocks.size();
+    if (tree_block_count > tree_blocks.size()) {
+        auto blocks_or_error = fs().allocate_blocks(fs().group_index_from_inode(index()), tree_block_count - tree_blocks.size());
+        if (blocks_or_error.is_error())
+            return blocks_or_error.error();
+        tree_blocks.append(blocks_or_error.release_value());
+    }
+    while (tree_blocks.size() > tree_block_count) {
+        if (auto result = fs().set_block_allocation_state(tree_blocks.take_last(), false); result.is_error())
+            return result;
+    }
+    if (tree_block_count > old_tree_block_count)
+        m_raw_inode.i_blocks += (tree_block_count - old_tree_block_count) * (block_size / 512);
+    else
+        m_raw_inode.i_blocks -= (old_tree_block_count - tree_block_count) * (block_size / 512);
+
+    Vector<ext4_extent> entries;
+    entries.ensure_capacity(extents.size());
+    for (auto& extent : extents) {
+        ext4_extent raw_extent {};
+        raw_extent.ee_block = extent.logical_start;
+        raw_extent.ee_len = extent.uninitialized ? extent.length + EXT4_EXT_INIT_MAX_LEN : extent.length;
+        raw_extent.ee_start_hi = extent.physical_start.value() >> 32;
+        raw_extent.ee_start_lo = extent.physical_start.value() & 0xffffffff;
+        entries.append(raw_extent);
+    }
+
+    auto node = ByteBuffer::create_uninitialized(block_size);
+    size_t next_tree_block = 0;
+    u16 depth = 0;
+    while (entries.size() > entries_per_root) {
+        Vector<ext4_extent> parent_entries;
+        for (size_t first = 0; first < entries.size(); first += entries_per_node) {
+            size_t count = min(entries_per_node, entries.size() - first);
+            memset(node.data(), 0, block_size);
+            write_extent_header(node.data(), count, entries_per_node, depth);
+            memcpy(node.data() + sizeof(ext4_extent_header), &entries[first], count * sizeof(ext4_extent));
+
+            auto tree_block = tree_blocks[next_tree_block++];
+            auto buffer = UserOrKernelBuffer::for_kernel_buffer(node.data());
+            if (auto result = fs().write_block(tree_block, buffer, block_size); result.is_error())
+                return result;
+
+            ext4_extent_idx index_entry {};
+            // NOTE: ee_block and ei_block are both the first logical block covered.
+            index_entry.ei_block = entries[first].ee_block;
+            index_entry.ei_leaf_lo = tree_block.value() & 0xffffffff;
+            index_entry.ei_leaf_hi = tree_block.value() >> 32;
+            parent_entries.append(bit_cast<ext4_extent>(index_entry));
+        }
+        entries = move(parent_entries);
+        ++depth;
+    }
+    VERIFY(next_tree_block == tree_blocks.size());
+
+    auto* root = (u8*)m_raw_inode.i_block;
+    memset(root, 0, sizeof(m_raw_inode.i_block));
+    write_extent_header(root, entries.size(), entries_per_root, depth);
+    memcpy(root + sizeof(ext4_extent_header), entries.data(), entries.size() * sizeof(ext4_extent));
+    set_metadata_dirty(true);
+    return KSuccess;
+}
+
+KResult Ext2FSInode::resize_extents(u64 blocks_before, u64 blocks_after)
+{
+    Vector<Extent> extents;
+    Vector<Ext2FS::BlockIndex> tree_blocks;
+    if (auto result = read_extent_tree(extents, tree_blocks); result.is_error())
+        return result;
+
+    const u32 sectors_per_block = fs().block_size() / 512;
+
+    // Drop everything at or past the new end, including preallocated extents past the old end.
+    auto trim_to = [&](u64 block_count) -> KResult {
+        while (!extents.is_empty()) {
+            auto& extent = extents.last();
+            if (extent.logical_start + extent.length <= block_count)
+                break;
+            u32 blocks_to_keep = extent.logical_start >= block_count ? 0 : block_count - extent.logical_start;
+            for (u32 i = blocks_to_keep; i < extent.length; ++i) {
+                if (auto result = fs().set_block_allocation_state(extent.physical_start.value() + i, false); result.is_error())
+                    return result;
+                m_raw_inode.i_blocks -= sectors_per_block;
+            }
+            if (blocks_to_keep) {
+                extent.length = blocks_to_keep;
+                break;
+            }
+            extents.take_last();
+        }
+        return KSuccess;
+    };
+
+    if (auto result = trim_to(min(blocks_before, blocks_after)); result.is_error())
+        return result;
+
+    if (blocks_after > blocks_before) {
+        auto blocks_or_error = fs().allocate_blocks(fs().group_index_from_inode(index()), blocks_after - blocks_before);
+        if (blocks_or_error.is_error())
+            return blocks_or_error.error();
+        u32 logical_block = blocks_before;
+        for (auto block_index : blocks_or_error.value()) {
+            bool continues_last_extent = !extents.is_empty()
+                && !extents.last().uninitialized
+                && extents.last().length < EXT4_EXT_INIT_MAX_LEN
+                && extents.last().logical_start + extents.last().length == logical_block
+                && extents.last().physical_start.value() + extents.last().length == block_index.value();
+            if (continues_last_extent)
+                ++extents.last().length;
+            else
+                extents.append({ logical_block, 1, block_index, false });
+            ++logical_block;
+        }
+        m_raw_inode.i_blocks += blocks_or_error.value().size() * sectors_per_block;
+    }
+
+    invalidate_block_map();
+    return write_extent_tree(extents, tree_blocks);
+}
+
 void Ext2FS::free_inode(Ext2FSInode& inode)
 {
     LOCKER(m_lock);
@@ -782,13 +1368,9 @@ void Ext2FSInode::flush_metadata()
     LOCKER(m_lock);
     dbgln_if(EXT2_DEBUG, "Ext2FSInode[{}]::flush_metadata(): Flushing inode", identifier());
     fs().write_ext2_inode(index(), m_raw_inode);
-    if (is_directory()) {
-        // Unless we're about to go away permanently, invalidate the lookup cache.
-        if (m_raw_inode.i_links_count != 0) {
-            // FIXME: This invalidation is way too hardcore. It's sad to throw away the whole cache.
-            m_lookup_cache.clear();
-        }
-    }
+    // The full block list is only worth keeping while the file is growing.
+    // From here on, the block map resolves blocks lazily as they're needed.
+    m_block_list.clear();
     set_metadata_dirty(false);
 }
 
@@ -847,22 +1429,36 @@ ssize_t Ext2FSInode::read_bytes(off_t offset, ssize_t count, UserOrKernelBuffer&
         return nread;
     }
 
-    if (m_block_list.is_empty())
-        m_block_list = compute_block_list();
+    bool allow_cache = !description || !description->is_direct();
+    if (allow_cache && uses_page_cache())
+        return read_bytes_through_page_cache(offset, count, buffer);
+    return read_bytes_from_blocks(offset, count, buffer, allow_cache);
+}
 
-    if (m_block_list.is_empty()) {
-        dmesgln("Ext2FSInode[{}]::read_bytes(): Empty block list", identifier());
-        return -EIO;
-    }
+ssize_t Ext2FSInode::read_bytes_for_page_cache(off_t offset, ssize_t count, UserOrKernelBuffer& buffer) const
+{
+    Locker inode_locker(m_lock);
+    // NOTE: The file may have been truncated since this page was last looked at.
+    if (static_cast<u64>(offset) >= size())
+        return 0;
+    return read_bytes_from_blocks(offset, count, buffer, true);
+}
 
-    bool allow_cache = !description || !description->is_direct();
+ssize_t Ext2FSInode::read_bytes_from_blocks(off_t offset, ssize_t count, UserOrKernelBuffer& buffer, bool allow_cache) const
+{
+    VERIFY(m_lock.is_locked());
 
     const int block_size = fs().block_size();
+    const u64 block_count = ceil_div(size(), static_cast<u64>(block_size));
+    if (block_count == 0) {
+        dmesgln("Ext2FSInode[{}]::read_bytes(): Empty block list", identifier());
+        return -EIO;
+    }
 
     BlockBasedFS::BlockIndex first_block_logical_index = offset / block_size;
     BlockBasedFS::BlockIndex last_block_logical_index = (offset + count) / block_size;
-    if (last_block_logical_index >= m_block_list.size())
-        last_block_logical_index = m_block_list.size() - 1;
+    if (last_block_logical_index >= block_count)
+        last_block_logical_index = block_count - 1;
 
     int offset_into_first_block = offset % block_size;
 
@@ -872,7 +1468,10 @@ ssize_t Ext2FSInode::read_bytes(off_t offset, ssize_t count, UserOrKernelBuffer&
     dbgln_if(EXT2_VERY_DEBUG, "Ext2FSInode[{}]::read_bytes(): Reading up to {} bytes, {} bytes into inode to {}", identifier(), count, offset, buffer.user_or_kernel_ptr());
 
     for (auto bi = first_block_logical_index; remaining_count && bi <= last_block_logical_index; bi = bi.value() + 1) {
-        auto block_index = m_block_list[bi.value()];
+        auto block_index_or_error = block_index_for(bi.value());
+        if (block_index_or_error.is_error())
+            return block_index_or_error.error();
+        auto block_index = block_index_or_error.value();
         size_t offset_into_block = (bi == first_block_logical_index) ? offset_into_first_block : 0;
         size_t num_bytes_to_copy = min((off_t)block_size - offset_into_block, remaining_count);
         auto buffer_offset = buffer.offset(nread);
@@ -917,34 +1516,40 @@ KResult Ext2FSInode::resize(u64 new_size)
             return ENOSPC;
     }
 
-    if (m_block_list.is_empty())
-        m_block_list = this->compute_block_list();
-
-    if (blocks_needed_after > blocks_needed_before) {
-        auto blocks_or_error = fs().allocate_blocks(fs().group_index_from_inode(index()), blocks_needed_after - blocks_needed_before);
-        if (blocks_or_error.is_error())
-            return blocks_or_error.error();
-        m_block_list.append(blocks_or_error.release_value());
-    } else if (blocks_needed_after < blocks_needed_before) {
-        if constexpr (EXT2_VERY_DEBUG) {
-            dbgln("Ext2FSInode[{}]::resize(): Shrinking inode, old block list is {} entries:", identifier(), m_block_list.size());
-            for (auto block_index : m_block_list) {
-                dbgln("    # {}", block_index);
+    if (uses_extents()) {
+        if (auto result = resize_extents(blocks_needed_before, blocks_needed_after); result.is_error())
+            return result;
+    } else {
+        if (m_block_list.is_empty())
+            m_block_list = this->compute_block_list();
+
+        if (blocks_needed_after > blocks_needed_before) {
+            auto blocks_or_error = fs().allocate_blocks(fs().group_index_from_inode(index()), blocks_needed_after - blocks_needed_before);
+            if (blocks_or_error.is_error())
+                return blocks_or_error.error();
+            m_block_list.append(blocks_or_error.release_value());
+        } else if (blocks_needed_after < blocks_needed_before) {
+            if constexpr (EXT2_VERY_DEBUG) {
+                dbgln("Ext2FSInode[{}]::resize(): Shrinking inode, old block list is {} entries:", identifier(), m_block_list.size());
+                for (auto block_index : m_block_list) {
+                    dbgln("    # {}", block_index);
+                }
             }
-        }
-        while (m_block_list.size() != blocks_needed_after) {
-            auto block_index = m_block_list.take_last();
-            if (block_index.value()) {
-                if (auto result = fs().set_block_allocation_state(block_index, false); result.is_error()) {
-                    dbgln("Ext2FSInode[{}]::resize(): Failed to free block {}: {}", identifier(), block_index, result.error());
-                    return result;
+            while (m_block_list.size() != blocks_needed_after) {
+                auto block_index = m_block_list.take_last();
+                if (block_index.value()) {
+                    if (auto result = fs().set_block_allocation_state(block_index, false); result.is_error()) {
+                        dbgln("Ext2FSInode[{}]::resize(): Failed to free block {}: {}", identifier(), block_index, result.error());
+                        return result;
+                    }
                 }
             }
         }
-    }
 
-    if (auto result = flush_block_list(); result.is_error())
-        return result;
+        if (auto result = flush_block_list(); result.is_error())
+            return result;
+        invalidate_block_map();
+    }
 
     m_raw_inode.i_size = new_size;
     if (Kernel::is_regular_file(m_raw_inode.i_mode))
@@ -952,6 +1557,9 @@ KResult Ext2FSInode::resize(u64 new_size)
 
     set_metadata_dirty(true);
 
+    if (new_size < old_size)
+        truncate_page_cache(new_size);
+
     if (new_size > old_size) {
         // If we're growing the inode, make sure we zero out all the new space.
         // FIXME: There are definitely more efficient ways to achieve this.
@@ -1002,18 +1610,16 @@ ssize_t Ext2FSInode::write_bytes(off_t offset, ssize_t count, const UserOrKernel
     if (auto result = resize(new_size); result.is_error())
         return result;
 
-    if (m_block_list.is_empty())
-        m_block_list = compute_block_list();
-
-    if (m_block_list.is_empty()) {
+    const u64 block_count = ceil_div(new_size, static_cast<u64>(block_size));
+    if (block_count == 0) {
         dbgln("Ext2FSInode[{}]::write_bytes(): Empty block list", identifier());
         return -EIO;
     }
 
     BlockBasedFS::BlockIndex first_block_logical_index = offset / block_size;
     BlockBasedFS::BlockIndex last_block_logical_index = (offset + count) / block_size;
-    if (last_block_logical_index >= m_block_list.size())
-        last_block_logical_index = m_block_list.size() - 1;
+    if (last_block_logical_index >= block_count)
+        last_block_logical_index = block_count - 1;
 
     size_t offset_into_first_block = offset % block_size;
 
@@ -1025,15 +1631,32 @@ ssize_t Ext2FSInode::write_bytes(off_t offset, ssize_t count, const UserOrKernel
     for (auto bi = first_block_logical_index; remaining_count && bi <= last_block_logical_index; bi = bi.value() + 1) {
         size_t offset_into_block = (bi == first_block_logical_index) ? offset_into_first_block : 0;
         size_t num_bytes_to_copy = min((off_t)block_size - offset_into_block, remaining_count);
-        dbgln_if(EXT2_DEBUG, "Ext2FSInode[{}]::write_bytes(): Writing block {} (offset_into_block: {})", identifier(), m_block_list[bi.value()], offset_into_block);
-        if (auto result = fs().write_block(m_block_list[bi.value()], data.offset(nwritten), num_bytes_to_copy, offset_into_block, allow_cache); result.is_error()) {
-            dbgln("Ext2FSInode[{}]::write_bytes(): Failed to write block {} (index {})", identifier(), m_block_list[bi.value()], bi);
+        auto block_index_or_error = block_index_for(bi.value());
+        if (block_index_or_error.is_error())
+            return block_index_or_error.error();
+        auto block_index = block_index_or_error.value();
+        if (!block_index.value()) {
+            // FIXME: Allocate blocks for holes and uninitialized extents when they're written to.
+            dbgln("Ext2FSInode[{}]::write_bytes(): Can't write into a hole (index {})", identifier(), bi);
+            return -EIO;
+        }
+        dbgln_if(EXT2_DEBUG, "Ext2FSInode[{}]::write_bytes(): Writing block {} (offset_into_block: {})", identifier(), block_index, offset_into_block);
+        if (auto result = fs().write_block(block_index, data.offset(nwritten), num_bytes_to_copy, offset_into_block, allow_cache); result.is_error()) {
+            dbgln("Ext2FSInode[{}]::write_bytes(): Failed to write block {} (index {})", identifier(), block_index, bi);
+            // Keep the page cache in sync with whatever did make it to the file system.
+            if (uses_page_cache())
+                (void)update_page_cache(offset, nwritten, data);
             return result;
         }
         remaining_count -= num_bytes_to_copy;
         nwritten += num_bytes_to_copy;
     }
 
+    if (uses_page_cache()) {
+        if (auto result = update_page_cache(offset, nwritten, data); result.is_error())
+            return result;
+    }
+
     dbgln_if(EXT2_VERY_DEBUG, "Ext2FSInode[{}]::write_bytes(): After write, i_size={}, i_blocks={} ({} blocks in list)", identifier(), size(), m_raw_inode.i_blocks, m_block_list.size());
     return nwritten;
 }
@@ -1158,36 +1781,38 @@ KResult Ext2FSInode::add_child(Inode& child, const StringView& name, mode_t mode
 
     dbgln_if(EXT2_DEBUG, "Ext2FSInode[{}]::add_child(): Adding inode {} with name '{}' and mode {:o} to directory {}", identifier(), child.index(), name, mode, index());
 
-    Vector<Ext2FSDirectoryEntry> entries;
     bool name_already_exists = false;
-    KResult result = traverse_as_directory([&](auto& entry) {
-        if (name == entry.name) {
+    if (is_indexed_directory()) {
+        auto location_or_error = find_directory_entry(name);
+        if (!location_or_error.is_error())
             name_already_exists = true;
-            return false;
-        }
-        entries.append({ entry.name, entry.inode.index(), entry.file_type });
-        return true;
-    });
-
-    if (result.is_error())
-        return result;
+        else if (location_or_error.error() != ENOENT)
+            return location_or_error.error();
+    } else {
+        if (!populate_lookup_cache())
+            return EIO;
+        name_already_exists = m_lookup_cache.find(name.hash(), [&](auto& entry) { return entry.key == name; }) != m_lookup_cache.end();
+    }
 
     if (name_already_exists) {
         dbgln("Ext2FSInode[{}]::add_child(): Name '{}' already exists", identifier(), name);
         return EEXIST;
     }
 
-    result = child.increment_link_count();
+    auto result = child.increment_link_count();
     if (result.is_error())
         return result;
 
-    entries.empend(name, child.index(), to_ext2_file_type(mode));
-    result = write_directory(entries);
-    if (result.is_error())
+    result = add_directory_entry(name, child.index(), to_ext2_file_type(mode));
+    if (result.is_error()) {
+        // Nothing refers to the child under this name after all.
+        [[maybe_unused]] auto rc = child.decrement_link_count();
         return result;
+    }
 
-    m_lookup_cache.set(name, child.index());
-    did_add_child(child.identifier());
+    if (!m_lookup_cache.is_empty())
+        m_lookup_cache.set(name, child.index());
+    did_add_child(child.identifier(), name);
     return KSuccess;
 }
 
@@ -1197,23 +1822,14 @@ KResult Ext2FSInode::remove_child(const StringView& name)
     dbgln_if(EXT2_DEBUG, "Ext2FSInode[{}]::remove_child(): Removing '{}'", identifier(), name);
     VERIFY(is_directory());
 
-    auto it = m_lookup_cache.find(name);
-    if (it == m_lookup_cache.end())
-        return ENOENT;
-    auto child_inode_index = (*it).value;
+    auto location_or_error = find_directory_entry(name);
+    if (location_or_error.is_error())
+        return location_or_error.error();
+    auto& location = location_or_error.value();
 
-    InodeIdentifier child_id { fsid(), child_inode_index };
+    InodeIdentifier child_id { fsid(), location.inode_index };
 
-    Vector<Ext2FSDirectoryEntry> entries;
-    KResult result = traverse_as_directory([&](auto& entry) {
-        if (name != entry.name)
-            entries.append({ entry.name, entry.inode.index(), entry.file_type });
-        return true;
-    });
-    if (result.is_error())
-        return result;
-
-    result = write_directory(entries);
+    auto result = remove_directory_entry(location);
     if (result.is_error())
         return result;
 
@@ -1224,7 +1840,461 @@ KResult Ext2FSInode::remove_child(const StringView& name)
     if (result.is_error())
         return result;
 
-    did_remove_child(child_id);
+    did_remove_child(child_id, name);
+    return KSuccess;
+}
+
+u32 Ext2FSInode::directory_block_count() const
+{
+    return size() / fs().block_size();
+}
+
+KResult Ext2FSInode::read_directory_block(u32 logical_block, ByteBuffer& block) const
+{
+    VERIFY(m_lock.is_locked());
+    auto block_size = fs().block_size();
+    if (logical_block >= directory_block_count())
+        return EIO;
+    block = ByteBuffer::create_uninitialized(block_size);
+    auto buffer = UserOrKernelBuffer::for_kernel_buffer(block.data());
+    ssize_t nread = read_bytes_from_blocks((off_t)logical_block * block_size, block_size, buffer, true);
+    if (nread < 0)
+        return KResult((ErrnoCode)-nread);
+    if ((size_t)nread != block_size)
+        return EIO;
+    return KSuccess;
+}
+
+KResult Ext2FSInode::write_directory_block(u32 logical_block, const ByteBuffer& block)
+{
+    VERIFY(block.size() == fs().block_size());
+    auto buffer = UserOrKernelBuffer::for_kernel_buffer(const_cast<u8*>(block.data()));
+    ssize_t nwritten = write_bytes((off_t)logical_block * block.size(), block.size(), buffer, nullptr);
+    if (nwritten < 0)
+        return KResult((ErrnoCode)-nwritten);
+    if ((size_t)nwritten != block.size())
+        return EIO;
+    return KSuccess;
+}
+
+KResultOr<u32> Ext2FSInode::append_directory_block(const ByteBuffer& block)
+{
+    u32 logical_block = directory_block_count();
+    if (auto result = write_directory_block(logical_block, block); result.is_error())
+        return result;
+    set_metadata_dirty(true);
+    return logical_block;
+}
+
+static KResultOr<size_t> find_in_directory_block(const ByteBuffer& block, const StringView& name, Optional<size_t>& previous_offset)
+{
+    previous_offset = {};
+    for (size_t offset = 0; offset < block.size();) {
+        if (!is_valid_directory_record(block, offset))
+            return EIO;
+        auto& entry = *reinterpret_cast<const ext2_dir_entry_2*>(block.data() + offset);
+        if (entry.inode != 0 && entry.name_len == name.length() && !memcmp(entry.name, name.characters_without_null_termination(), name.length()))
+            return offset;
+        previous_offset = offset;
+        offset += entry.rec_len;
+    }
+    return ENOENT;
+}
+
+KResultOr<Ext2FSInode::DirectoryEntryLocation> Ext2FSInode::find_directory_entry(const StringView& name) const
+{
+    VERIFY(m_lock.is_locked());
+    if (is_indexed_directory())
+        return htree_find_entry(name);
+
+    ByteBuffer block;
+    for (u32 logical_block = 0; logical_block < directory_block_count(); ++logical_block) {
+        if (auto result = read_directory_block(logical_block, block); result.is_error())
+            return result;
+        DirectoryEntryLocation location { logical_block };
+        auto offset_or_error = find_in_directory_block(block, name, location.previous_offset);
+        if (offset_or_error.is_error()) {
+            if (offset_or_error.error() == ENOENT)
+                continue;
+            return offset_or_error.error();
+        }
+        location.offset = offset_or_error.value();
+        location.inode_index = directory_record_at(block, location.offset).inode;
+        return location;
+    }
+    return ENOENT;
+}
+
+KResult Ext2FSInode::add_directory_entry(const StringView& name, InodeIndex inode_index, u8 file_type)
+{
+    VERIFY(m_lock.is_locked());
+    if (is_indexed_directory())
+        return htree_add_entry(name, inode_index, file_type);
+
+    // Like Linux' ext2 driver, we don't maintain an index we don't know about, so drop the flag
+    // before touching a directory that was indexed on a file system without the feature.
+    if (m_raw_inode.i_flags & EXT2_INDEX_FL) {
+        m_raw_inode.i_flags &= ~EXT2_INDEX_FL;
+        set_metadata_dirty(true);
+    }
+
+    ByteBuffer block;
+    u32 block_count = directory_block_count();
+    for (u32 logical_block = 0; logical_block < block_count; ++logical_block) {
+        if (auto result = read_directory_block(logical_block, block); result.is_error())
+            return result;
+        if (insert_into_directory_block(block, name, inode_index, file_type))
+            return write_directory_block(logical_block, block);
+    }
+
+    // Index the directory as soon as it outgrows its first block, just like ext3/ext4.
+    if (block_count == 1 && fs().can_create_directory_index()) {
+        if (auto result = convert_to_indexed_directory(); result.is_error())
+            return result;
+        return htree_add_entry(name, inode_index, file_type);
+    }
+
+    Vector<Ext2FSDirectoryEntry> entries;
+    entries.empend(name, inode_index, file_type);
+    auto result = append_directory_block(serialize_directory_block(entries, fs().block_size()));
+    if (result.is_error())
+        return result.error();
+    return KSuccess;
+}
+
+KResult Ext2FSInode::remove_directory_entry(const DirectoryEntryLocation& location)
+{
+    VERIFY(m_lock.is_locked());
+    ByteBuffer block;
+    if (auto result = read_directory_block(location.logical_block, block); result.is_error())
+        return result;
+
+    // Merge the record into its predecessor, or mark it unused if it's the first one in the block.
+    auto& entry = directory_record_at(block, location.offset);
+    if (location.previous_offset.has_value())
+        directory_record_at(block, location.previous_offset.value()).rec_len += entry.rec_len;
+    else
+        entry.inode = 0;
+    return write_directory_block(location.logical_block, block);
+}
+
+bool Ext2FSInode::is_indexed_directory() const
+{
+    return (m_raw_inode.i_flags & EXT2_INDEX_FL) && fs().supports_directory_index();
+}
+
+KResultOr<Ext2FSInode::HTreePath> Ext2FSInode::htree_probe(const StringView& name) const
+{
+    VERIFY(m_lock.is_locked());
+    HTreePath path;
+    HTreeFrame root;
+    if (auto result = read_directory_block(0, root.data); result.is_error())
+        return result;
+
+    auto& info = *reinterpret_cast<const ext2_dx_root_info*>(root.data.data() + htree_root_info_offset);
+    if (info.reserved_zero != 0 || info.info_length != 8 || info.indirect_levels > htree_max_indirect_levels || info.hash_version > EXT2_HASH_TEA || (info.unused_flags & EXT2_HASH_FLAG_INCOMPAT)) {
+        dmesgln("Ext2FSInode[{}]::htree_probe(): Unsupported or corrupt directory index", identifier());
+        return EIO;
+    }
+    path.hash_version = info.hash_version;
+    path.hash = fs().directory_name_hash(name, info.hash_version);
+    root.entries_offset = htree_root_info_offset + info.info_length;
+
+    HTreeFrame frame = move(root);
+    for (u8 level = 0;; ++level) {
+        auto& countlimit = frame.countlimit();
+        if (countlimit.count == 0 || countlimit.count > countlimit.limit || frame.entries_offset + countlimit.limit * sizeof(ext2_dx_entry) > frame.data.size()) {
+            dmesgln("Ext2FSInode[{}]::htree_probe(): Corrupt directory index node in block {}", identifier(), frame.logical_block);
+            return EIO;
+        }
+
+        // Find the last entry whose hash isn't larger than ours. The first entry covers all hashes below the second one.
+        auto* entries = frame.entries();
+        size_t low = 1;
+        size_t high = countlimit.count;
+        while (low < high) {
+            size_t middle = low + (high - low) / 2;
+            if (entries[middle].hash > path.hash)
+                high = middle;
+            else
+                low = middle + 1;
+        }
+        frame.position = low - 1;
+
+        u32 child_block = frame.child_block();
+        path.frames.append(move(frame));
+        if (level == info.indirect_levels)
+            break;
+
+        frame = {};
+        frame.logical_block = child_block;
+        frame.entries_offset = htree_node_entries_offset;
+        if (auto result = read_directory_block(child_block, frame.data); result.is_error())
+            return result;
+    }
+    return path;
+}
+
+// Steps to the next leaf if it may still contain entries with our hash (the continuation bit is ignored, like Linux does).
+KResultOr<bool> Ext2FSInode::htree_next_leaf(HTreePath& path) const
+{
+    ssize_t level = path.frames.size() - 1;
+    while (level >= 0 && path.frames[level].position + 1 >= path.frames[level].countlimit().count)
+        --level;
+    if (level < 0)
+        return false;
+
+    auto& frame = path.frames[level];
+    ++frame.position;
+    if ((frame.entries()[frame.position].hash & ~1u) != path.hash)
+        return false;
+
+    for (size_t i = level + 1; i < path.frames.size(); ++i) {
+        auto& child = path.frames[i];
+        child.logical_block = path.frames[i - 1].child_block();
+        child.position = 0;
+        if (auto result = read_directory_block(child.logical_block, child.data); result.is_error())
+            return result;
+    }
+    return true;
+}
+
+KResultOr<Ext2FSInode::DirectoryEntryLocation> Ext2FSInode::htree_find_entry(const StringView& name) const
+{
+    auto path_or_error = htree_probe(name);
+    if (path_or_error.is_error())
+        return path_or_error.error();
+    auto& path = path_or_error.value();
+
+    ByteBuffer block;
+    for (;;) {
+        DirectoryEntryLocation location { path.frames.last().child_block() };
+        if (auto result = read_directory_block(location.logical_block, block); result.is_error())
+            return result;
+        auto offset_or_error = find_in_directory_block(block, name, location.previous_offset);
+        if (!offset_or_error.is_error()) {
+            location.offset = offset_or_error.value();
+            location.inode_index = directory_record_at(block, location.offset).inode;
+            return location;
+        }
+        if (offset_or_error.error() != ENOENT)
+            return offset_or_error.error();
+
+        auto has_next_leaf = htree_next_leaf(path);
+        if (has_next_leaf.is_error())
+            return has_next_leaf.error();
+        if (!has_next_leaf.value())
+            return ENOENT;
+    }
+}
+
+KResult Ext2FSInode::htree_add_entry(const StringView& name, InodeIndex inode_index, u8 file_type)
+{
+    auto path_or_error = htree_probe(name);
+    if (path_or_error.is_error())
+        return path_or_error.error();
+    auto& path = path_or_error.value();
+
+    u32 leaf_block = path.frames.last().child_block();
+    ByteBuffer leaf;
+    if (auto result = read_directory_block(leaf_block, leaf); result.is_error())
+        return result;
+    if (insert_into_directory_block(leaf, name, inode_index, file_type))
+        return write_directory_block(leaf_block, leaf);
+
+    // The leaf is full, so split it in two halves by hash and add the upper half to the index.
+    struct HashedEntry {
+        u32 hash;
+        Ext2FSDirectoryEntry entry;
+    };
+    Vector<HashedEntry> entries;
+    for (size_t offset = 0; offset < leaf.size();) {
+        if (!is_valid_directory_record(leaf, offset))
+            return EIO;
+        auto& record = directory_record_at(leaf, offset);
+        if (record.inode != 0) {
+            StringView record_name { record.name, record.name_len };
+            entries.append({ fs().directory_name_hash(record_name, path.hash_version), { record_name, record.inode, record.file_type } });
+        }
+        offset += record.rec_len;
+    }
+    if (entries.size() < 2)
+        return ENOSPC;
+    quick_sort(entries, [](auto& a, auto& b) { return a.hash < b.hash; });
+
+    size_t split = entries.size() / 2;
+    u32 split_hash = entries[split].hash;
+    // Entries with the same hash end up in both halves, so mark the new leaf as a continuation.
+    bool continued = split_hash == entries[split - 1].hash;
+
+    Vector<Ext2FSDirectoryEntry> lower_entries;
+    Vector<Ext2FSDirectoryEntry> upper_entries;
+    for (size_t i = 0; i < entries.size(); ++i)
+        (i < split ? lower_entries : upper_entries).append(move(entries[i].entry));
+    auto lower = serialize_directory_block(lower_entries, fs().block_size());
+    auto upper = serialize_directory_block(upper_entries, fs().block_size());
+
+    bool insert_into_upper = path.hash >= split_hash;
+    if (!insert_into_directory_block(insert_into_upper ? upper : lower, name, inode_index, file_type))
+        return ENOSPC;
+
+    // Only touch the index on disk once we know the split is going to work out.
+    if (auto result = htree_make_room_in_index(path); result.is_error())
+        return result;
+
+    auto upper_block_or_error = append_directory_block(upper);
+    if (upper_block_or_error.is_error())
+        return upper_block_or_error.error();
+    if (auto result = write_directory_block(leaf_block, lower); result.is_error())
+        return result;
+
+    auto& frame = path.frames.last();
+    auto& countlimit = frame.countlimit();
+    VERIFY(countlimit.count < countlimit.limit);
+    auto* entries_in_node = frame.entries();
+    memmove(&entries_in_node[frame.position + 2], &entries_in_node[frame.position + 1], (countlimit.count - frame.position - 1) * sizeof(ext2_dx_entry));
+    entries_in_node[frame.position + 1] = { split_hash | (continued ? 1u : 0u), upper_block_or_error.value() };
+    ++countlimit.count;
+    return write_directory_block(frame.logical_block, frame.data);
+}
+
+// Makes sure the lowest index node in the path has room for one more entry, growing the tree if needed.
+KResult Ext2FSInode::htree_make_room_in_index(HTreePath& path)
+{
+    auto block_size = fs().block_size();
+    auto& bottom = path.frames.last();
+    if (bottom.countlimit().count < bottom.countlimit().limit)
+        return KSuccess;
+
+    auto new_node = ByteBuffer::create_zeroed(block_size);
+    directory_record_at(new_node, 0).rec_len = block_size;
+    HTreeFrame new_frame { 0, new_node, htree_node_entries_offset, 0 };
+    u16 node_limit = (block_size - htree_node_entries_offset) / sizeof(ext2_dx_entry);
+
+    if (path.frames.size() == 1) {
+        // The root is full, move all of its entries into a new node below it.
+        auto& root = path.frames[0];
+        u16 count = root.countlimit().count;
+        memcpy(new_frame.entries(), root.entries(), count * sizeof(ext2_dx_entry));
+        new_frame.countlimit() = { node_limit, count };
+        new_frame.position = root.position;
+        auto new_block_or_error = append_directory_block(new_frame.data);
+        if (new_block_or_error.is_error())
+            return new_block_or_error.error();
+        new_frame.logical_block = new_block_or_error.value();
+
+        root.countlimit().count = 1;
+        root.entries()[0].block = new_frame.logical_block;
+        root.position = 0;
+        reinterpret_cast<ext2_dx_root_info*>(root.data.data() + htree_root_info_offset)->indirect_levels = 1;
+        if (auto result = write_directory_block(root.logical_block, root.data); result.is_error())
+            return result;
+        path.frames.append(move(new_frame));
+        return KSuccess;
+    }
+
+    // Only grow the tree to one level of index nodes below the root, like ext3/ext4 without large directories.
+    auto& parent = path.frames[path.frames.size() - 2];
+    if (path.frames.size() > 2 || parent.countlimit().count >= parent.countlimit().limit) {
+        dmesgln("Ext2FSInode[{}]::htree_make_room_in_index(): Directory index is full", identifier());
+        return ENOSPC;
+    }
+
+    // Split the full node, moving its upper half into a new node.
+    u16 count = bottom.countlimit().count;
+    u16 split = count / 2;
+    u32 split_hash = bottom.entries()[split].hash;
+    memcpy(new_frame.entries(), bottom.entries() + split, (count - split) * sizeof(ext2_dx_entry));
+    new_frame.countlimit() = { node_limit, (u16)(count - split) };
+    bottom.countlimit().count = split;
+
+    auto new_block_or_error = append_directory_block(new_frame.data);
+    if (new_block_or_error.is_error())
+        return new_block_or_error.error();
+    new_frame.logical_block = new_block_or_error.value();
+    if (auto result = write_directory_block(bottom.logical_block, bottom.data); result.is_error())
+        return result;
+
+    auto& parent_countlimit = parent.countlimit();
+    auto* parent_entries = parent.entries();
+    memmove(&parent_entries[parent.position + 2], &parent_entries[parent.position + 1], (parent_countlimit.count - parent.position - 1) * sizeof(ext2_dx_entry));
+    parent_entries[parent.position + 1] = { split_hash, new_frame.logical_block };
+    ++parent_countlimit.count;
+    if (auto result = write_directory_block(parent.logical_block, parent.data); result.is_error())
+        return result;
+
+    if (bottom.position >= split) {
+        new_frame.position = bottom.position - split;
+        ++parent.position;
+        bottom = move(new_frame);
+    }
+    return KSuccess;
+}
+
+// Turns a directory with a single full block into an index root with one leaf, like ext3/ext4 do.
+KResult Ext2FSInode::convert_to_indexed_directory()
+{
+    VERIFY(m_lock.is_locked());
+    auto block_size = fs().block_size();
+    ByteBuffer block;
+    if (auto result = read_directory_block(0, block); result.is_error())
+        return result;
+
+    Vector<Ext2FSDirectoryEntry> entries;
+    InodeIndex parent_index = 0;
+    size_t record_index = 0;
+    for (size_t offset = 0; offset < block.size(); ++record_index) {
+        if (!is_valid_directory_record(block, offset))
+            return EIO;
+        auto& record = directory_record_at(block, offset);
+        StringView record_name { record.name, record.name_len };
+        offset += record.rec_len;
+        if (record_index == 0) {
+            if (record_name != ".")
+                return EIO;
+            continue;
+        }
+        if (record_index == 1) {
+            if (record_name != "..")
+                return EIO;
+            parent_index = record.inode;
+            continue;
+        }
+        if (record.inode != 0)
+            entries.empend(record_name, record.inode, record.file_type);
+    }
+    if (record_index < 2)
+        return EIO;
+
+    auto leaf_block_or_error = append_directory_block(serialize_directory_block(entries, block_size));
+    if (leaf_block_or_error.is_error())
+        return leaf_block_or_error.error();
+
+    auto root = ByteBuffer::create_zeroed(block_size);
+    auto& dot = directory_record_at(root, 0);
+    fill_directory_record(dot, ".", index(), EXT2_FT_DIR);
+    dot.rec_len = 12;
+    auto& dot_dot = directory_record_at(root, 12);
+    fill_directory_record(dot_dot, "..", parent_index, EXT2_FT_DIR);
+    dot_dot.rec_len = block_size - 12;
+
+    u8 hash_version = fs().super_block().s_def_hash_version;
+    if (hash_version > EXT2_HASH_TEA)
+        hash_version = EXT2_HASH_HALF_MD4;
+    auto& info = *reinterpret_cast<ext2_dx_root_info*>(root.data() + htree_root_info_offset);
+    info = { 0, hash_version, 8, 0, 0 };
+
+    HTreeFrame frame { 0, root, htree_root_info_offset + info.info_length, 0 };
+    frame.countlimit() = { (u16)((block_size - frame.entries_offset) / sizeof(ext2_dx_entry)), 1 };
+    frame.entries()[0].block = leaf_block_or_error.value();
+    if (auto result = write_directory_block(0, root); result.is_error())
+        return result;
+
+    m_raw_inode.i_flags |= EXT2_INDEX_FL;
+    set_metadata_dirty(true);
+    // Lookups go through the index from now on.
+    m_lookup_cache.clear();
+    dbgln_if(EXT2_DEBUG, "Ext2FSInode[{}]::convert_to_indexed_directory(): Indexed {} entries", identifier(), entries.size());
     return KSuccess;
 }
 
@@ -1391,6 +2461,53 @@ Ext2FS::GroupIndex Ext2FS::group_index_from_block_index(BlockIndex block_index)
     return (block_index.value() - 1) / blocks_per_group() + 1;
 }
 
+u32 Ext2FS::directory_name_hash(const StringView& name, u8 hash_version) const
+{
+    if (hash_version <= EXT2_HASH_TEA && (m_super_block.s_flags & EXT2_FLAGS_UNSIGNED_HASH))
+        hash_version += EXT2_HASH_LEGACY_UNSIGNED;
+
+    u32 buffer[4] = { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476 };
+    for (size_t i = 0; i < 4; ++i) {
+        if (m_super_block.s_hash_seed[i]) {
+            memcpy(buffer, m_super_block.s_hash_seed, sizeof(buffer));
+            break;
+        }
+    }
+
+    u32 hash = 0;
+    u32 in[8];
+    switch (hash_version) {
+    case EXT2_HASH_LEGACY:
+    case EXT2_HASH_LEGACY_UNSIGNED:
+        hash = legacy_directory_hash(name, hash_version == EXT2_HASH_LEGACY);
+        break;
+    case EXT2_HASH_HALF_MD4:
+    case EXT2_HASH_HALF_MD4_UNSIGNED:
+        for (size_t offset = 0; offset < name.length(); offset += 32) {
+            directory_name_to_hash_buffer(name.substring_view(offset), hash_version == EXT2_HASH_HALF_MD4, in, 8);
+            half_md4_transform(buffer, in);
+        }
+        hash = buffer[1];
+        break;
+    case EXT2_HASH_TEA:
+    case EXT2_HASH_TEA_UNSIGNED:
+        for (size_t offset = 0; offset < name.length(); offset += 16) {
+            directory_name_to_hash_buffer(name.substring_view(offset), hash_version == EXT2_HASH_TEA, in, 4);
+            tea_transform(buffer, in);
+        }
+        hash = buffer[0];
+        break;
+    default:
+        VERIFY_NOT_REACHED();
+    }
+
+    hash &= ~1u;
+    // The largest hash value is reserved to mark the end of a directory.
+    if (hash == (0x7fffffffu << 1))
+        hash = (0x7fffffffu - 1) << 1;
+    return hash;
+}
+
 auto Ext2FS::group_index_from_inode(InodeIndex inode) const -> GroupIndex
 {
     if (!inode)
@@ -1539,6 +2656,13 @@ KResultOr<NonnullRefPtr<Inode>> Ext2FS::create_inode(Ext2FSInode& parent_inode,
     e2inode.i_dtime = 0;
     e2inode.i_flags = 0;
 
+    if (supports_extents() && (is_regular_file(mode) || is_directory(mode))) {
+        e2inode.i_flags |= EXT4_EXTENTS_FL;
+        auto& header = *(ext4_extent_header*)e2inode.i_block;
+        header.eh_magic = EXT4_EXT_MAGIC;
+        header.eh_max = (sizeof(e2inode.i_block) - sizeof(ext4_extent_header)) / sizeof(ext4_extent);
+    }
+
     // For directories, add +1 link count for the "." entry in self.
     e2inode.i_links_count = is_directory(mode);
 
@@ -1589,9 +2713,17 @@ RefPtr<Inode> Ext2FSInode::lookup(StringView name)
 {
     VERIFY(is_directory());
     dbgln_if(EXT2_DEBUG, "Ext2FSInode[{}]:lookup(): Looking up '{}'", identifier(), name);
+    LOCKER(m_lock);
+    if (is_indexed_directory()) {
+        auto location_or_error = find_directory_entry(name);
+        if (location_or_error.is_error()) {
+            dbgln_if(EXT2_DEBUG, "Ext2FSInode[{}]:lookup(): '{}' not found", identifier(), name);
+            return {};
+        }
+        return fs().get_inode({ fsid(), location_or_error.value().inode_index });
+    }
     if (!populate_lookup_cache())
         return {};
-    LOCKER(m_lock);
     auto it = m_lookup_cache.find(name.hash(), [&](auto& entry) { return entry.key == name; });
     if (it != m_lookup_cache.end())
         return fs().get_inode({ fsid(), (*it).value });
@@ -1669,6 +2801,17 @@ KResultOr<size_t> Ext2FSInode::directory_entry_count() const
 {
     VERIFY(is_directory());
     LOCKER(m_lock);
+    if (is_indexed_directory()) {
+        // Don't pull a potentially huge directory into the lookup cache just to count it.
+        size_t count = 0;
+        auto result = traverse_as_directory([&](auto&) {
+            ++count;
+            return true;
+        });
+        if (result.is_error())
+            return result;
+        return count;
+    }
     populate_lookup_cache();
     return m_lookup_cache.size();
 }
@@ -1709,13 +2852,13 @@ KResultOr<int> Ext2FSInode::get_block_address(int index)
 {
     LOCKER(m_lock);
 
-    if (m_block_list.is_empty())
-        m_block_list = compute_block_list();
-
-    if (index < 0 || (size_t)index >= m_block_list.size())
+    if (index < 0 || (u64)index >= ceil_div(size(), static_cast<u64>(fs().block_size())))
         return 0;
 
-    return m_block_list[index].value();
+    auto block_index_or_error = block_index_for(index);
+    if (block_index_or_error.is_error())
+        return block_index_or_error.error();
+    return block_index_or_error.value().value();
 }
 
 unsigned Ext2FS::total_block_count() const
@@ -77,9 +77,52 @@ private:
     virtual KResult chown(uid_t, gid_t) override;
     virtual KResult truncate(u64) override;
     virtual KResultOr<int> get_block_address(int) override;
+    virtual bool uses_page_cache() const override { return Kernel::is_regular_file(m_raw_inode.i_mode); }
+    virtual ssize_t read_bytes_for_page_cache(off_t, ssize_t, UserOrKernelBuffer&) const override;
+
+    ssize_t read_bytes_from_blocks(off_t, ssize_t, UserOrKernelBuffer&, bool allow_cache) const;
 
     KResult write_directory(const Vector<Ext2FSDirectoryEntry>&);
     bool populate_lookup_cache() const;
+
+    // Directory entries are added and removed in place, one block at a time.
+    struct DirectoryEntryLocation {
+        u32 logical_block { 0 };
+        size_t offset { 0 };
+        Optional<size_t> previous_offset;
+        InodeIndex inode_index { 0 };
+    };
+    u32 directory_block_count() const;
+    KResult read_directory_block(u32 logical_block, ByteBuffer&) const;
+    KResult write_directory_block(u32 logical_block, const ByteBuffer&);
+    KResultOr<u32> append_directory_block(const ByteBuffer&);
+    KResultOr<DirectoryEntryLocation> find_directory_entry(const StringView& name) const;
+    KResult add_directory_entry(const StringView& name, InodeIndex, u8 file_type);
+    KResult remove_directory_entry(const DirectoryEntryLocation&);
+
+    // Hash-indexed ("htree") directories, compatible with ext3/ext4.
+    struct HTreeFrame {
+        u32 logical_block { 0 };
+        ByteBuffer data;
+        size_t entries_offset { 0 };
+        size_t position { 0 };
+
+        ext2_dx_countlimit& countlimit() { return *reinterpret_cast<ext2_dx_countlimit*>(data.data() + entries_offset); }
+        ext2_dx_entry* entries() { return reinterpret_cast<ext2_dx_entry*>(data.data() + entries_offset); }
+        u32 child_block() { return entries()[position].block & 0x00ffffff; }
+    };
+    struct HTreePath {
+        Vector<HTreeFrame, 3> frames;
+        u8 hash_version { 0 };
+        u32 hash { 0 };
+    };
+    bool is_indexed_directory() const;
+    KResultOr<HTreePath> htree_probe(const StringView& name) const;
+    KResultOr<bool> htree_next_leaf(HTreePath&) const;
+    KResultOr<DirectoryEntryLocation> htree_find_entry(const StringView& name) const;
+    KResult htree_add_entry(const StringView& name, InodeIndex, u8 file_type);
+    KResult htree_make_room_in_index(HTreePath&);
+    KResult convert_to_indexed_directory();
     KResult resize(u64);
     KResult write_indirect_block(BlockBasedFS::BlockIndex, Span<BlockBasedFS::BlockIndex>);
     KResult grow_doubly_indirect_block(BlockBasedFS::BlockIndex, size_t, Span<BlockBasedFS::BlockIndex>, Vector<BlockBasedFS::BlockIndex>&, unsigned&);
@@ -87,6 +130,37 @@ private:
     KResult grow_triply_indirect_block(BlockBasedFS::BlockIndex, size_t, Span<BlockBasedFS::BlockIndex>, Vector<BlockBasedFS::BlockIndex>&, unsigned&);
     KResult shrink_triply_indirect_block(BlockBasedFS::BlockIndex, size_t, size_t, unsigned&);
     KResult flush_block_list();
+
+    // A run of logical blocks that are stored back to back on disk. A physical_start of 0 means the run is a hole.
+    struct BlockRun {
+        u32 logical_start { 0 };
+        BlockBasedFS::BlockIndex physical_start { 0 };
+        u32 length { 0 };
+
+        u32 logical_end() const { return logical_start + length; }
+        bool contains(u32 logical_block) const { return logical_block >= logical_start && logical_block < logical_end(); }
+    };
+    KResultOr<BlockBasedFS::BlockIndex> block_index_for(u32 logical_block) const;
+    KResult resolve_indirect_block_run(u32 logical_block) const;
+    KResult resolve_extent_block_run(u32 logical_block) const;
+    KResultOr<BlockBasedFS::BlockIndex> read_block_pointer(BlockBasedFS::BlockIndex array_block, u32 index) const;
+    void cache_block_run(const BlockRun&) const;
+    const BlockRun* find_cached_block_run(u32 logical_block) const;
+    void invalidate_block_map() const { m_block_map.clear(); }
+
+    struct Extent {
+        u32 logical_start { 0 };
+        u32 length { 0 };
+        BlockBasedFS::BlockIndex physical_start { 0 };
+        bool uninitialized { false };
+    };
+    bool uses_extents() const { return m_raw_inode.i_flags & EXT4_EXTENTS_FL; }
+    static Extent extent_from_raw(const ext4_extent&);
+    KResult read_extent_tree(Vector<Extent>&, Vector<BlockBasedFS::BlockIndex>& tree_blocks) const;
+    KResult read_extent_node(const u8* node, size_t node_size, Vector<Extent>&, Vector<BlockBasedFS::BlockIndex>& tree_blocks, unsigned expected_depth) const;
+    KResult write_extent_tree(const Vector<Extent>&, Vector<BlockBasedFS::BlockIndex>& tree_blocks);
+    KResult resize_extents(u64 blocks_before, u64 blocks_after);
+
     Vector<BlockBasedFS::BlockIndex> compute_block_list() const;
     Vector<BlockBasedFS::BlockIndex> compute_block_list_with_meta_blocks() const;
     Vector<BlockBasedFS::BlockIndex> compute_block_list_impl(bool include_block_list_blocks) const;
@@ -97,6 +171,7 @@ private:
     Ext2FSInode(Ext2FS&, InodeIndex);
 
     mutable Vector<BlockBasedFS::BlockIndex> m_block_list;
+    mutable Vector<BlockRun> m_block_map;
     mutable HashMap<String, InodeIndex> m_lookup_cache;
     ext2_inode m_raw_inode;
 };
@@ -123,10 +198,15 @@ public:
     virtual KResult prepare_to_unmount() const override;
 
     virtual bool supports_watchers() const override { return true; }
+    virtual bool supports_dentry_cache() const override { return true; }
 
     virtual u8 internal_file_type_to_directory_entry_type(const DirectoryEntryView& entry) const override;
 
     FeaturesReadOnly get_features_readonly() const;
+    bool supports_extents() const { return m_super_block.s_feature_incompat & EXT3_FEATURE_INCOMPAT_EXTENTS; }
+    bool supports_directory_index() const { return m_super_block.s_feature_compat & EXT2_FEATURE_COMPAT_DIR_INDEX; }
+    // We don't maintain directory block checksums, so only index directories on file systems that don't expect them.
+    bool can_create_directory_index() const { return supports_directory_index() && !(m_super_block.s_feature_ro_compat & EXT4_FEATURE_RO_COMPAT_METADATA_CSUM); }
 
 private:
     TYPEDEF_DISTINCT_ORDERED_ID(unsigned, GroupIndex);
@@ -161,6 +241,8 @@ private:
     GroupIndex group_index_from_inode(InodeIndex) const;
     GroupIndex group_index_from_block_index(BlockIndex) const;
 
+    u32 directory_name_hash(const StringView& name, u8 hash_version) const;
+
     KResultOr<bool> get_inode_allocation_state(InodeIndex) const;
     KResult set_inode_allocation_state(InodeIndex, bool);
     KResult set_block_allocation_state(BlockIndex, bool);
@@ -26,9 +26,9 @@
 
 #pragma once
 
-#include <Kernel/DoubleBuffer.h>
 #include <Kernel/FileSystem/File.h>
 #include <Kernel/Lock.h>
+#include <Kernel/PipeBuffer.h>
 #include <Kernel/UnixTypes.h>
 #include <Kernel/WaitQueue.h>
 
@@ -70,7 +70,7 @@ private:
 
     unsigned m_writers { 0 };
     unsigned m_readers { 0 };
-    DoubleBuffer m_buffer;
+    PipeBuffer m_buffer;
 
     uid_t m_uid { 0 };
 
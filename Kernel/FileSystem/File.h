@@ -117,6 +117,10 @@ public:
     virtual KResult chown(FileDescription&, uid_t, gid_t) { return EBADF; }
     virtual KResult chmod(FileDescription&, mode_t) { return EBADF; }
 
+    // Called on files that observe a description (see FileDescription::add_observer())
+    // when that description is going away.
+    virtual void observed_description_will_die(FileDescription&) { }
+
     virtual const char* class_name() const = 0;
 
     virtual bool is_seekable() const { return false; }
@@ -129,6 +133,8 @@ public:
     virtual bool is_block_device() const { return false; }
     virtual bool is_character_device() const { return false; }
     virtual bool is_socket() const { return false; }
+    virtual bool is_event_poll() const { return false; }
+    virtual bool is_io_ring() const { return false; }
 
     virtual FileBlockCondition& block_condition() { return m_block_condition; }
 
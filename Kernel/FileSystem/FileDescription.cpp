@@ -77,6 +77,14 @@ FileDescription::FileDescription(File& file)
 
 FileDescription::~FileDescription()
 {
+    Vector<NonnullRefPtr<File>> observers;
+    {
+        ScopedSpinLock lock(m_observers_lock);
+        observers = move(m_observers);
+    }
+    for (auto& observer : observers)
+        observer->observed_description_will_die(*this);
+
     m_file->detach(*this);
     if (is_fifo())
         static_cast<FIFO*>(m_file.ptr())->detach(m_fifo_direction);
@@ -86,6 +94,27 @@ FileDescription::~FileDescription()
         m_inode->detach(*this);
 }
 
+void FileDescription::add_observer(File& observer)
+{
+    ScopedSpinLock lock(m_observers_lock);
+    m_observers.append(observer);
+}
+
+void FileDescription::remove_observer(File& observer)
+{
+    RefPtr<File> removed_observer;
+    {
+        ScopedSpinLock lock(m_observers_lock);
+        for (size_t i = 0; i < m_observers.size(); ++i) {
+            if (m_observers[i].ptr() == &observer) {
+                removed_observer = m_observers.take(i);
+                break;
+            }
+        }
+    }
+    // NOTE: removed_observer may hold the last reference, so let it go outside the lock.
+}
+
 KResult FileDescription::attach()
 {
     if (m_inode) {
@@ -193,6 +222,36 @@ KResultOr<size_t> FileDescription::write(const UserOrKernelBuffer& data, size_t
     return nwritten_or_error;
 }
 
+KResultOr<size_t> FileDescription::read_at(UserOrKernelBuffer& buffer, off_t offset, size_t count)
+{
+    LOCKER(m_lock);
+    if (!m_file->is_seekable())
+        return ESPIPE;
+    if (offset < 0)
+        return EINVAL;
+    if (Checked<off_t>::addition_would_overflow(offset, count))
+        return EOVERFLOW;
+    auto nread_or_error = m_file->read(*this, offset, buffer, count);
+    if (!nread_or_error.is_error())
+        evaluate_block_conditions();
+    return nread_or_error;
+}
+
+KResultOr<size_t> FileDescription::write_at(off_t offset, const UserOrKernelBuffer& data, size_t size)
+{
+    LOCKER(m_lock);
+    if (!m_file->is_seekable())
+        return ESPIPE;
+    if (offset < 0)
+        return EINVAL;
+    if (Checked<off_t>::addition_would_overflow(offset, size))
+        return EOVERFLOW;
+    auto nwritten_or_error = m_file->write(*this, offset, data, size);
+    if (!nwritten_or_error.is_error())
+        evaluate_block_conditions();
+    return nwritten_or_error;
+}
+
 bool FileDescription::can_write() const
 {
     return m_file->can_write(*this, offset());
@@ -33,6 +33,7 @@
 #include <Kernel/FileSystem/Inode.h>
 #include <Kernel/FileSystem/InodeMetadata.h>
 #include <Kernel/FileSystem/VirtualFileSystem.h>
+#include <Kernel/Heap/SlabAllocator.h>
 #include <Kernel/KBuffer.h>
 #include <Kernel/VirtualAddress.h>
 
@@ -44,7 +45,7 @@ public:
 };
 
 class FileDescription : public RefCounted<FileDescription> {
-    MAKE_SLAB_ALLOCATED(FileDescription)
+    MAKE_SLAB_CACHED(FileDescription)
 public:
     static KResultOr<NonnullRefPtr<FileDescription>> create(Custody&);
     static KResultOr<NonnullRefPtr<FileDescription>> create(File&);
@@ -69,6 +70,9 @@ public:
     KResultOr<off_t> seek(off_t, int whence);
     KResultOr<size_t> read(UserOrKernelBuffer&, size_t);
     KResultOr<size_t> write(const UserOrKernelBuffer& data, size_t);
+    // Like read()/write(), but at an explicit offset, leaving the current offset untouched.
+    KResultOr<size_t> read_at(UserOrKernelBuffer&, off_t, size_t);
+    KResultOr<size_t> write_at(off_t, const UserOrKernelBuffer& data, size_t);
     KResult stat(::stat&);
 
     KResult chmod(mode_t);
@@ -139,6 +143,12 @@ public:
 
     FileBlockCondition& block_condition();
 
+    // Files like EventPoll and IORing refer to descriptions without keeping them alive,
+    // so that closing the last fd still closes the underlying file. They register here
+    // to be told when the description dies, and must forget about it at that point.
+    void add_observer(File&);
+    void remove_observer(File&);
+
 private:
     friend class VFS;
     explicit FileDescription(File&);
@@ -169,6 +179,9 @@ private:
     FIFO::Direction m_fifo_direction { FIFO::Direction::Neither };
 
     Lock m_lock { "FileDescription" };
+
+    SpinLock<u8> m_observers_lock;
+    Vector<NonnullRefPtr<File>> m_observers;
 };
 
 }
@@ -60,6 +60,9 @@ public:
     virtual const char* class_name() const = 0;
     virtual NonnullRefPtr<Inode> root_inode() const = 0;
     virtual bool supports_watchers() const { return false; }
+    // Whether every directory change is reported through Inode::did_add_child()
+    // and Inode::did_remove_child(), so lookups can be kept in the DentryCache.
+    virtual bool supports_dentry_cache() const { return false; }
 
     bool is_readonly() const { return m_readonly; }
 
@@ -83,6 +86,7 @@ public:
     size_t block_size() const { return m_block_size; }
 
     virtual bool is_file_backed() const { return false; }
+    virtual bool is_block_based() const { return false; }
 
     // Converts file types that are used internally by the filesystem to DT_* types
     virtual u8 internal_file_type_to_directory_entry_type(const DirectoryEntryView& entry) const { return entry.file_type; }
@@ -0,0 +1,409 @@
+/*
+ * Copyright (c) 2021, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <AK/NumericLimits.h>
+#include <Kernel/FileSystem/FileDescription.h>
+#include <Kernel/FileSystem/IORing.h>
+#include <Kernel/FileSystem/Inode.h>
+#include <Kernel/Net/Socket.h>
+#include <Kernel/Process.h>
+#include <Kernel/VM/MemoryManager.h>
+
+namespace Kernel {
+
+using BlockFlags = Thread::FileBlocker::BlockFlags;
+
+KResultOr<NonnullRefPtr<IORing>> IORing::create(Process& process, u32 entries)
+{
+    if (entries == 0 || entries > IO_RING_MAX_ENTRIES)
+        return EINVAL;
+
+    u32 sq_entries = 1;
+    while (sq_entries < entries)
+        sq_entries <<= 1;
+
+    // Twice as many completion slots as submission slots, so that a full submission
+    // queue can be handed over while the previous batch is still being reaped.
+    IORingHeader header {};
+    header.sq_entries = sq_entries;
+    header.cq_entries = sq_entries * 2;
+    header.sq_offset = round_up_to_power_of_two(sizeof(IORingHeader), 64);
+    header.cq_offset = round_up_to_power_of_two(header.sq_offset + header.sq_entries * sizeof(IORingSubmission), 64);
+    header.size = page_round_up(header.cq_offset + header.cq_entries * sizeof(IORingCompletion));
+
+    auto vmobject = AnonymousVMObject::create_with_size(header.size, AllocationStrategy::AllocateNow);
+    if (!vmobject)
+        return ENOMEM;
+    auto region = MM.allocate_kernel_region_with_vmobject(*vmobject, header.size, "IORing", Region::Access::Read | Region::Access::Write);
+    if (!region)
+        return ENOMEM;
+
+    *reinterpret_cast<IORingHeader*>(region->vaddr().as_ptr()) = header;
+    return adopt(*new IORing(process.pid(), vmobject.release_nonnull(), region.release_nonnull(), header));
+}
+
+IORing::IORing(ProcessID owner, NonnullRefPtr<AnonymousVMObject> vmobject, NonnullOwnPtr<Region> region, const IORingHeader& header)
+    : m_owner(owner)
+    , m_vmobject(move(vmobject))
+    , m_region(move(region))
+    , m_header(header)
+{
+}
+
+IORing::~IORing()
+{
+    // Parked operations keep us alive through their descriptions.
+    VERIFY(m_parked_operations.is_empty());
+}
+
+KResult IORing::close()
+{
+    // Nobody is left to reap completions, so just drop whatever is still parked.
+    LOCKER(m_lock);
+    while (!m_parked_operations.is_empty()) {
+        auto& operation = *m_parked_operations.begin()->value;
+        operation.description.remove_observer(*this);
+        forget_operation(operation);
+    }
+    return KSuccess;
+}
+
+void IORing::observed_description_will_die(FileDescription& description)
+{
+    LOCKER(m_lock);
+    Vector<Operation*, 4> cancelled_operations;
+    for (auto& it : m_parked_operations) {
+        if (&it.value->description == &description)
+            cancelled_operations.append(it.key);
+    }
+    if (cancelled_operations.is_empty())
+        return;
+
+    // The description has already dropped its references to us.
+    for (auto* operation : cancelled_operations) {
+        auto user_data = operation->submission.user_data;
+        forget_operation(*operation);
+        complete(user_data, -EBADF);
+    }
+    // Let a waiting io_ring_enter() see the new completions.
+    m_ready_wait_queue.wake_all();
+    evaluate_block_conditions();
+}
+
+KResultOr<Region*> IORing::mmap(Process& process, FileDescription&, const Range& range, u64 offset, int prot, bool shared)
+{
+    if (offset != 0 || !shared)
+        return EINVAL;
+
+    if (range.size() != m_vmobject->size())
+        return EINVAL;
+
+    return process.space().allocate_region_with_vmobject(range, m_vmobject, offset, {}, prot, shared);
+}
+
+BlockFlags IORing::block_flags_for(u8 opcode)
+{
+    switch (opcode) {
+    case IO_RING_OP_READ:
+        return BlockFlags::Read;
+    case IO_RING_OP_WRITE:
+        return BlockFlags::Write;
+    case IO_RING_OP_ACCEPT:
+        return BlockFlags::Accept;
+    default:
+        VERIFY_NOT_REACHED();
+    }
+}
+
+bool IORing::Watcher::unblock(bool, void* data)
+{
+    VERIFY(data);
+    auto& operation = *static_cast<Operation*>(data);
+    operation.ring.did_change_readiness(operation);
+    // Stay registered until the operation completes, it may not get to run on this change.
+    return false;
+}
+
+void IORing::did_change_readiness(Operation& operation)
+{
+    // NOTE: This is called with the watched file's block condition locked,
+    //       so we must not take m_lock here.
+    if (operation.description.should_unblock(block_flags_for(operation.submission.opcode)) == BlockFlags::None)
+        return;
+    {
+        ScopedSpinLock lock(m_ready_lock);
+        if (operation.ready_list_node.is_in_list())
+            return;
+        m_ready_list.append(operation);
+    }
+    m_ready_wait_queue.wake_all();
+    evaluate_block_conditions();
+}
+
+u32 IORing::unreaped_completions() const
+{
+    u32 cq_head = AK::atomic_load(&shared_header().cq_head, AK::memory_order_acquire);
+    // Don't let a bogus cq_head make us think there's room that isn't there.
+    return min(m_cq_tail - cq_head, m_header.cq_entries);
+}
+
+bool IORing::has_room_for_operation() const
+{
+    return m_parked_operations.size() + unreaped_completions() < m_header.cq_entries;
+}
+
+void IORing::complete(u64 user_data, i32 result)
+{
+    auto& completion = completions()[m_cq_tail & (m_header.cq_entries - 1)];
+    completion.user_data = user_data;
+    completion.result = result;
+    completion.flags = 0;
+    ++m_cq_tail;
+    AK::atomic_store(&shared_header().cq_tail, m_cq_tail, AK::memory_order_release);
+}
+
+static i32 result_from(KResultOr<size_t> result)
+{
+    if (result.is_error())
+        return result.error().error();
+    return static_cast<i32>(result.value());
+}
+
+Optional<i32> IORing::try_run(Process& process, Operation& operation)
+{
+    auto& submission = operation.submission;
+    auto& description = operation.description;
+
+    switch (submission.opcode) {
+    case IO_RING_OP_READ:
+    case IO_RING_OP_WRITE: {
+        bool is_read = submission.opcode == IO_RING_OP_READ;
+        if (is_read ? !description.is_readable() : !description.is_writable())
+            return -EBADF;
+        if (description.is_directory())
+            return -EISDIR;
+        if (submission.length > static_cast<u32>(NumericLimits<i32>::max()))
+            return -EINVAL;
+        if (submission.address > NumericLimits<FlatPtr>::max())
+            return -EFAULT;
+        if (is_read ? !description.can_read() : !description.can_write())
+            return {};
+        auto buffer = UserOrKernelBuffer::for_user_buffer(reinterpret_cast<u8*>(static_cast<FlatPtr>(submission.address)), submission.length);
+        if (!buffer.has_value())
+            return -EFAULT;
+        if (is_read) {
+            if (submission.offset >= 0)
+                return result_from(description.read_at(buffer.value(), submission.offset, submission.length));
+            return result_from(description.read(buffer.value(), submission.length));
+        }
+        if (submission.offset >= 0)
+            return result_from(description.write_at(submission.offset, buffer.value(), submission.length));
+        return result_from(description.write(buffer.value(), submission.length));
+    }
+    case IO_RING_OP_ACCEPT: {
+        if (!description.is_socket())
+            return -ENOTSOCK;
+        // The accepted socket is installed into the fd table next to the listening one,
+        // so make sure the descriptor number still refers to what was submitted.
+        if (process.file_description(submission.fd) != &description)
+            return -EBADF;
+        if (process.has_promises() && !process.has_promised(Pledge::accept))
+            return -EPERM;
+        // Never wait for a connection here, we're holding m_lock.
+        auto result = process.accept(submission.fd, {}, {}, false);
+        if (result.is_error()) {
+            if (result.error().error() == -EAGAIN)
+                return {};
+            return result.error().error();
+        }
+        return result.value();
+    }
+    case IO_RING_OP_FSYNC: {
+        auto* inode = description.inode();
+        if (!inode)
+            return -EINVAL;
+        if (inode->is_metadata_dirty())
+            inode->flush_metadata();
+        inode->fs().flush_writes();
+        return 0;
+    }
+    default:
+        VERIFY_NOT_REACHED();
+    }
+}
+
+void IORing::submit(Process& process, const IORingSubmission& submission)
+{
+    if (submission.opcode == IO_RING_OP_NOP) {
+        complete(submission.user_data, 0);
+        return;
+    }
+    if (submission.opcode > IO_RING_OP_FSYNC) {
+        complete(submission.user_data, -EINVAL);
+        return;
+    }
+
+    auto description = process.file_description(submission.fd);
+    if (!description) {
+        complete(submission.user_data, -EBADF);
+        return;
+    }
+    if (description->file().is_io_ring()) {
+        complete(submission.user_data, -EINVAL);
+        return;
+    }
+
+    auto operation = make<Operation>(*this, submission, *description);
+    auto result = try_run(process, *operation);
+    if (result.has_value()) {
+        complete(submission.user_data, result.value());
+        return;
+    }
+    park(move(operation));
+}
+
+void IORing::park(NonnullOwnPtr<Operation> operation)
+{
+    VERIFY(m_lock.is_locked());
+    auto& operation_ref = *operation;
+    m_parked_operations.set(&operation_ref, move(operation));
+    operation_ref.description.add_observer(*this);
+    // add_blocker() asks the watcher whether it's ready right away, which queues it if it is.
+    bool was_added = operation_ref.description.block_condition().add_blocker(operation_ref.watcher, &operation_ref);
+    VERIFY(was_added);
+}
+
+void IORing::unpark_and_complete(Operation& operation, i32 result)
+{
+    VERIFY(m_lock.is_locked());
+    auto user_data = operation.submission.user_data;
+    operation.description.remove_observer(*this);
+    forget_operation(operation);
+    complete(user_data, result);
+}
+
+void IORing::forget_operation(Operation& operation)
+{
+    VERIFY(m_lock.is_locked());
+    // Once this returns, the watcher can no longer be called.
+    operation.description.block_condition().remove_blocker(operation.watcher, &operation);
+    {
+        ScopedSpinLock lock(m_ready_lock);
+        if (operation.ready_list_node.is_in_list())
+            m_ready_list.remove(operation);
+    }
+    m_parked_operations.remove(&operation);
+}
+
+void IORing::run_ready_operations(Process& process)
+{
+    VERIFY(m_lock.is_locked());
+    for (;;) {
+        Operation* operation;
+        {
+            ScopedSpinLock lock(m_ready_lock);
+            if (m_ready_list.is_empty())
+                return;
+            operation = m_ready_list.take_first();
+        }
+        // If the description is on its way out, observed_description_will_die() is
+        // about to cancel the operation, as soon as we let go of m_lock.
+        if (!operation->description.try_ref())
+            continue;
+        auto description = adopt(operation->description);
+
+        // If the operation can't make progress after all, the next state change
+        // of its file will queue it again.
+        auto result = try_run(process, *operation);
+        if (result.has_value())
+            unpark_and_complete(*operation, result.value());
+    }
+}
+
+KResultOr<u32> IORing::enter(Process& process, u32 to_submit, u32 min_complete)
+{
+    if (process.pid() != m_owner)
+        return EPERM;
+    if (min_complete > m_header.cq_entries)
+        return EINVAL;
+
+    LOCKER(m_lock);
+    u32 cq_tail_before = m_cq_tail;
+    run_ready_operations(process);
+
+    u32 sq_tail = AK::atomic_load(&shared_header().sq_tail, AK::memory_order_acquire);
+    u32 pending = sq_tail - m_sq_head;
+    if (pending > m_header.sq_entries)
+        return EINVAL;
+
+    u32 submitted = 0;
+    while (submitted < min(to_submit, pending) && has_room_for_operation()) {
+        // Take a copy, userspace is free to scribble over the slot from now on.
+        IORingSubmission submission = submissions()[m_sq_head & (m_header.sq_entries - 1)];
+        ++m_sq_head;
+        AK::atomic_store(&shared_header().sq_head, m_sq_head, AK::memory_order_release);
+        ++submitted;
+        submit(process, submission);
+    }
+
+    while (unreaped_completions() < min_complete && !m_parked_operations.is_empty()) {
+        bool has_ready_operations;
+        {
+            ScopedSpinLock lock(m_ready_lock);
+            has_ready_operations = !m_ready_list.is_empty();
+        }
+        if (!has_ready_operations) {
+            // NOTE: If an operation becomes ready before we get to wait, wake_all()
+            //       makes sure that wait_on() returns right away.
+            locker.unlock();
+            auto block_result = m_ready_wait_queue.wait_on({}, "IORing");
+            locker.lock();
+            if (block_result.was_interrupted()) {
+                if (submitted == 0 && m_cq_tail == cq_tail_before)
+                    return EINTR;
+                break;
+            }
+        }
+        run_ready_operations(process);
+    }
+
+    if (m_cq_tail != cq_tail_before)
+        evaluate_block_conditions();
+    return submitted;
+}
+
+bool IORing::can_read(const FileDescription&, size_t) const
+{
+    {
+        ScopedSpinLock lock(m_ready_lock);
+        if (!m_ready_list.is_empty())
+            return true;
+    }
+    auto& header = shared_header();
+    return AK::atomic_load(&header.cq_tail, AK::memory_order_relaxed) != AK::atomic_load(&header.cq_head, AK::memory_order_relaxed);
+}
+
+}
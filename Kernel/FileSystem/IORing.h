@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) 2021, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <AK/HashMap.h>
+#include <AK/IntrusiveList.h>
+#include <AK/NonnullOwnPtr.h>
+#include <Kernel/API/IORing.h>
+#include <Kernel/FileSystem/File.h>
+#include <Kernel/Lock.h>
+#include <Kernel/VM/AnonymousVMObject.h>
+#include <Kernel/VM/Region.h>
+#include <Kernel/WaitQueue.h>
+
+namespace Kernel {
+
+// IORing is the kernel side of io_ring_create() and io_ring_enter(). Submissions
+// and completions live in memory shared with the owning process, so a process
+// can queue many operations and reap their results with a single system call.
+//
+// Operations on files that can block indefinitely (sockets, pipes, TTYs) never
+// block the ring. Until they can make progress they are parked on the block
+// condition of their file, just like EventPoll interests, and they get run by
+// the next io_ring_enter() after they became ready. Everything else, like
+// regular file I/O, runs to completion right away.
+//
+// Parked operations don't keep their file open. Once the last descriptor
+// referring to it is closed, they complete with EBADF.
+class IORing final : public File {
+public:
+    static KResultOr<NonnullRefPtr<IORing>> create(Process&, u32 entries);
+    virtual ~IORing() override;
+
+    size_t mapping_size() const { return m_header.size; }
+
+    // Consumes up to to_submit submissions, runs everything that is ready and then waits until
+    // at least min_complete completions are available. Returns the number of submissions consumed.
+    KResultOr<u32> enter(Process&, u32 to_submit, u32 min_complete);
+
+    virtual KResult close() override;
+    virtual KResultOr<Region*> mmap(Process&, FileDescription&, const Range&, u64 offset, int prot, bool shared) override;
+    virtual bool can_read(const FileDescription&, size_t) const override;
+    virtual bool can_write(const FileDescription&, size_t) const override { return false; }
+    virtual KResultOr<size_t> read(FileDescription&, u64, UserOrKernelBuffer&, size_t) override { return EINVAL; }
+    virtual KResultOr<size_t> write(FileDescription&, u64, const UserOrKernelBuffer&, size_t) override { return EINVAL; }
+    virtual String absolute_path(const FileDescription&) const override { return "io_ring"; }
+    virtual const char* class_name() const override { return "IORing"; }
+    virtual bool is_io_ring() const override { return true; }
+
+    virtual void observed_description_will_die(FileDescription&) override;
+
+private:
+    IORing(ProcessID owner, NonnullRefPtr<AnonymousVMObject>, NonnullOwnPtr<Region>, const IORingHeader&);
+
+    static Thread::FileBlocker::BlockFlags block_flags_for(u8 opcode);
+
+    struct Operation;
+
+    // Sits on the block condition of the file an operation is waiting for. It never blocks
+    // a thread; unblock() is our notification that the file's state changed.
+    class Watcher final : public Thread::FileBlocker {
+    public:
+        virtual const char* state_string() const override { return "IORing"; }
+        virtual void not_blocking(bool) override { VERIFY_NOT_REACHED(); }
+        virtual bool unblock(bool, void*) override;
+    };
+
+    struct Operation {
+        Operation(IORing& ring, const IORingSubmission& submission, FileDescription& description)
+            : ring(ring)
+            , submission(submission)
+            , description(description)
+        {
+        }
+
+        IORing& ring;
+        const IORingSubmission submission;
+        // Only valid while the operation is parked, see observed_description_will_die().
+        FileDescription& description;
+        IntrusiveListNode ready_list_node;
+        Watcher watcher;
+    };
+
+    IORingSubmission* submissions() { return reinterpret_cast<IORingSubmission*>(m_region->vaddr().offset(m_header.sq_offset).as_ptr()); }
+    IORingCompletion* completions() { return reinterpret_cast<IORingCompletion*>(m_region->vaddr().offset(m_header.cq_offset).as_ptr()); }
+    IORingHeader& shared_header() { return *reinterpret_cast<IORingHeader*>(m_region->vaddr().as_ptr()); }
+    const IORingHeader& shared_header() const { return *reinterpret_cast<const IORingHeader*>(m_region->vaddr().as_ptr()); }
+
+    u32 unreaped_completions() const;
+    bool has_room_for_operation() const;
+    void submit(Process&, const IORingSubmission&);
+    void run_ready_operations(Process&);
+    // Returns an empty Optional if the operation would have to block.
+    Optional<i32> try_run(Process&, Operation&);
+    void park(NonnullOwnPtr<Operation>);
+    void unpark_and_complete(Operation&, i32 result);
+    void forget_operation(Operation&);
+    void complete(u64 user_data, i32 result);
+    void did_change_readiness(Operation&);
+
+    const ProcessID m_owner;
+    NonnullRefPtr<AnonymousVMObject> m_vmobject;
+    NonnullOwnPtr<Region> m_region;
+    // Our own copy of everything the process must not be able to change under us.
+    const IORingHeader m_header;
+    u32 m_sq_head { 0 };
+    u32 m_cq_tail { 0 };
+
+    Lock m_lock { "IORing" };
+    // Operations waiting for their file to become ready. Each of them has a completion
+    // queue slot reserved, so their completions can never be lost.
+    HashMap<Operation*, NonnullOwnPtr<Operation>> m_parked_operations;
+    mutable SpinLock<u8> m_ready_lock;
+    IntrusiveList<Operation, &Operation::ready_list_node> m_ready_list;
+    WaitQueue m_ready_wait_queue;
+};
+
+}
@@ -30,11 +30,13 @@
 #include <AK/StringView.h>
 #include <Kernel/API/InodeWatcherEvent.h>
 #include <Kernel/FileSystem/Custody.h>
+#include <Kernel/FileSystem/DentryCache.h>
 #include <Kernel/FileSystem/Inode.h>
 #include <Kernel/FileSystem/InodeWatcher.h>
 #include <Kernel/FileSystem/VirtualFileSystem.h>
 #include <Kernel/KBufferBuilder.h>
 #include <Kernel/Net/LocalSocket.h>
+#include <Kernel/VM/MemoryManager.h>
 #include <Kernel/VM/SharedInodeVMObject.h>
 
 namespace Kernel {
@@ -235,16 +237,21 @@ void Inode::set_metadata_dirty(bool metadata_dirty)
     }
 }
 
-void Inode::did_add_child(const InodeIdentifier& child_id)
+void Inode::did_add_child(const InodeIdentifier& child_id, const StringView& name)
 {
+    // This drops any negative entry for the name.
+    if (fs().supports_dentry_cache())
+        DentryCache::the().invalidate(identifier(), name);
     LOCKER(m_lock);
     for (auto& watcher : m_watchers) {
         watcher->notify_child_added({}, child_id);
     }
 }
 
-void Inode::did_remove_child(const InodeIdentifier& child_id)
+void Inode::did_remove_child(const InodeIdentifier& child_id, const StringView& name)
 {
+    if (fs().supports_dentry_cache())
+        DentryCache::the().invalidate(identifier(), name);
     LOCKER(m_lock);
     for (auto& watcher : m_watchers) {
         watcher->notify_child_removed({}, child_id);
@@ -278,4 +285,156 @@ bool Inode::is_shared_vmobject(const SharedInodeVMObject& other) const
     return m_shared_vmobject.unsafe_ptr() == &other;
 }
 
+static bool is_under_memory_pressure()
+{
+    return MM.user_physical_pages_uncommitted() < MM.user_physical_pages() / 16;
+}
+
+KResultOr<NonnullRefPtr<PhysicalPage>> Inode::page_cache_page(size_t page_index) const
+{
+    LOCKER(m_lock);
+    VERIFY(uses_page_cache());
+    if (auto it = m_page_cache.find(page_index); it != m_page_cache.end())
+        return it->value;
+
+    // Make room by dropping our own pages first, rather than eating into what everyone else needs.
+    if (is_under_memory_pressure())
+        const_cast<Inode&>(*this).release_unmapped_cached_pages();
+
+    // NOTE: This buffer is on the heap since we may be deep inside a page fault or read() already.
+    auto page_buffer = ByteBuffer::create_uninitialized(PAGE_SIZE);
+    auto buffer = UserOrKernelBuffer::for_kernel_buffer(page_buffer.data());
+    auto nread = read_bytes_for_page_cache(page_index * PAGE_SIZE, PAGE_SIZE, buffer);
+    if (nread < 0)
+        return KResult((ErrnoCode)-nread);
+    // Anything past the end of the file must read as zeroes, both here and in mappings.
+    memset(page_buffer.data() + nread, 0, PAGE_SIZE - nread);
+
+    auto page = MM.allocate_user_physical_page(MemoryManager::ShouldZeroFill::No);
+    if (!page)
+        return ENOMEM;
+    MM.copy_to_physical_page(*page, 0, page_buffer.data(), PAGE_SIZE);
+    m_page_cache.set(page_index, *page);
+    return page.release_nonnull();
+}
+
+RefPtr<PhysicalPage> Inode::cached_page(size_t page_index) const
+{
+    LOCKER(m_lock);
+    VERIFY(uses_page_cache());
+    if (auto it = m_page_cache.find(page_index); it != m_page_cache.end())
+        return it->value;
+    return nullptr;
+}
+
+size_t Inode::page_cache_size() const
+{
+    LOCKER(m_lock);
+    return m_page_cache.size() * PAGE_SIZE;
+}
+
+size_t Inode::release_unmapped_cached_pages()
+{
+    LOCKER(m_lock);
+    // Pages that are mapped somewhere may have been written to through the mapping,
+    // and dropping them here would make read() go back to stale data on disk.
+    Vector<size_t> unmapped_pages;
+    for (auto& it : m_page_cache) {
+        if (it.value->ref_count() == 1)
+            unmapped_pages.append(it.key);
+    }
+    for (auto page_index : unmapped_pages)
+        m_page_cache.remove(page_index);
+    return unmapped_pages.size();
+}
+
+size_t Inode::release_all_unmapped_cached_pages()
+{
+    NonnullRefPtrVector<Inode, 32> inodes;
+    {
+        ScopedSpinLock all_inodes_lock(s_all_inodes_lock);
+        for (auto& inode : all_with_lock()) {
+            if (inode.uses_page_cache())
+                inodes.append(inode);
+        }
+    }
+
+    size_t count = 0;
+    for (auto& inode : inodes)
+        count += inode.release_unmapped_cached_pages();
+    return count;
+}
+
+ssize_t Inode::read_bytes_through_page_cache(off_t offset, ssize_t count, UserOrKernelBuffer& buffer) const
+{
+    LOCKER(m_lock);
+    VERIFY(offset >= 0);
+    auto file_size = size();
+    if (static_cast<u64>(offset) >= file_size)
+        return 0;
+    count = min((u64)count, file_size - (u64)offset);
+
+    // The page can only be quickmapped with interrupts disabled, so it's copied to the
+    // (possibly user) buffer through a bounce buffer.
+    auto page_buffer = ByteBuffer::create_uninitialized(PAGE_SIZE);
+    ssize_t nread = 0;
+    while (nread < count) {
+        size_t page_index = (offset + nread) / PAGE_SIZE;
+        size_t offset_in_page = (offset + nread) % PAGE_SIZE;
+        size_t chunk_size = min((size_t)(count - nread), PAGE_SIZE - offset_in_page);
+        auto page_or_error = page_cache_page(page_index);
+        if (page_or_error.is_error())
+            return page_or_error.error();
+        MM.copy_from_physical_page(*page_or_error.value(), offset_in_page, page_buffer.data(), chunk_size);
+        if (!buffer.write(page_buffer.data(), nread, chunk_size))
+            return -EFAULT;
+        nread += chunk_size;
+    }
+    return nread;
+}
+
+KResult Inode::update_page_cache(off_t offset, size_t count, const UserOrKernelBuffer& data)
+{
+    LOCKER(m_lock);
+    VERIFY(offset >= 0);
+    if (m_page_cache.is_empty())
+        return KSuccess;
+
+    // Pages that aren't cached yet will be read from the file system when needed,
+    // so we only have to bring the ones we already have up to date.
+    auto page_buffer = ByteBuffer::create_uninitialized(PAGE_SIZE);
+    size_t nupdated = 0;
+    while (nupdated < count) {
+        size_t page_index = (offset + nupdated) / PAGE_SIZE;
+        size_t offset_in_page = (offset + nupdated) % PAGE_SIZE;
+        size_t chunk_size = min(count - nupdated, PAGE_SIZE - offset_in_page);
+        if (auto it = m_page_cache.find(page_index); it != m_page_cache.end()) {
+            if (!data.read(page_buffer.data(), nupdated, chunk_size))
+                return EFAULT;
+            MM.copy_to_physical_page(*it->value, offset_in_page, page_buffer.data(), chunk_size);
+        }
+        nupdated += chunk_size;
+    }
+    return KSuccess;
+}
+
+void Inode::truncate_page_cache(u64 new_size)
+{
+    LOCKER(m_lock);
+    size_t first_page_to_drop = ceil_div(new_size, (u64)PAGE_SIZE);
+    Vector<size_t> pages_to_drop;
+    for (auto& it : m_page_cache) {
+        if (it.key >= first_page_to_drop)
+            pages_to_drop.append(it.key);
+    }
+    for (auto page_index : pages_to_drop)
+        m_page_cache.remove(page_index);
+
+    // The tail of the new last page must read as zeroes if the file grows again.
+    if (size_t offset_in_page = new_size % PAGE_SIZE) {
+        if (auto it = m_page_cache.find(new_size / PAGE_SIZE); it != m_page_cache.end())
+            MM.zero_physical_page_range(*it->value, offset_in_page, PAGE_SIZE - offset_in_page);
+    }
+}
+
 }
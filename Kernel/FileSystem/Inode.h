@@ -27,6 +27,7 @@
 #pragma once
 
 #include <AK/Function.h>
+#include <AK/HashMap.h>
 #include <AK/HashTable.h>
 #include <AK/InlineLinkedList.h>
 #include <AK/RefCounted.h>
@@ -39,6 +40,7 @@
 #include <Kernel/Forward.h>
 #include <Kernel/KResult.h>
 #include <Kernel/Lock.h>
+#include <Kernel/VM/PhysicalPage.h>
 
 namespace Kernel {
 
@@ -110,8 +112,17 @@ public:
     RefPtr<SharedInodeVMObject> shared_vmobject() const;
     bool is_shared_vmobject(const SharedInodeVMObject&) const;
 
+    // The page cache keeps file data in physical pages that are also mapped by
+    // SharedInodeVMObjects, so read(), write() and page faults all see one copy.
+    virtual bool uses_page_cache() const { return false; }
+    KResultOr<NonnullRefPtr<PhysicalPage>> page_cache_page(size_t page_index) const;
+    RefPtr<PhysicalPage> cached_page(size_t page_index) const;
+    size_t page_cache_size() const;
+    size_t release_unmapped_cached_pages();
+
     static InlineLinkedList<Inode>& all_with_lock();
     static void sync();
+    static size_t release_all_unmapped_cached_pages();
 
     bool has_watchers() const { return !m_watchers.is_empty(); }
 
@@ -131,8 +142,14 @@ protected:
     void set_metadata_dirty(bool);
     KResult prepare_to_write_data();
 
-    void did_add_child(const InodeIdentifier&);
-    void did_remove_child(const InodeIdentifier&);
+    void did_add_child(const InodeIdentifier&, const StringView& name);
+    void did_remove_child(const InodeIdentifier&, const StringView& name);
+
+    // Reads file data straight from the file system, for filling the page cache.
+    virtual ssize_t read_bytes_for_page_cache(off_t, ssize_t, UserOrKernelBuffer&) const { VERIFY_NOT_REACHED(); }
+    ssize_t read_bytes_through_page_cache(off_t, ssize_t, UserOrKernelBuffer&) const;
+    KResult update_page_cache(off_t, size_t, const UserOrKernelBuffer&);
+    void truncate_page_cache(u64 new_size);
 
     mutable Lock m_lock { "Inode" };
 
@@ -144,6 +161,7 @@ private:
     HashTable<InodeWatcher*> m_watchers;
     bool m_metadata_dirty { false };
     RefPtr<FIFO> m_fifo;
+    mutable HashMap<size_t, NonnullRefPtr<PhysicalPage>> m_page_cache;
 };
 
 }
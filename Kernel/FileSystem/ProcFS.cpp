@@ -37,6 +37,7 @@
 #include <Kernel/Debug.h>
 #include <Kernel/Devices/BlockDevice.h>
 #include <Kernel/Devices/HID/HIDManagement.h>
+#include <Kernel/FileSystem/BlockBasedFileSystem.h>
 #include <Kernel/FileSystem/Custody.h>
 #include <Kernel/FileSystem/FileBackedFileSystem.h>
 #include <Kernel/FileSystem/FileDescription.h>
@@ -86,6 +87,8 @@ enum ProcFileType {
     FI_Root_df,
     FI_Root_all,
     FI_Root_memstat,
+    FI_Root_slabinfo,
+    FI_Root_locks,
     FI_Root_cpuinfo,
     FI_Root_dmesg,
     FI_Root_interrupts,
@@ -319,6 +322,8 @@ static bool procfs$pid_vm(InodeIdentifier identifier, KBufferBuilder& builder)
         return false;
     JsonArraySerializer array { builder };
     {
+        // Looking at the page directory for large pages needs the MM lock, which has to be taken first.
+        ScopedSpinLock mm_lock(s_mm_lock);
         ScopedSpinLock lock(process->space().get_lock());
         for (auto& region : process->space().regions()) {
             if (!region.is_user() && !Process::current()->is_superuser())
@@ -340,6 +345,7 @@ static bool procfs$pid_vm(InodeIdentifier identifier, KBufferBuilder& builder)
             region_object.add("amount_resident", region.amount_resident());
             region_object.add("amount_dirty", region.amount_dirty());
             region_object.add("cow_pages", region.cow_pages());
+            region_object.add("large_pages", region.large_page_count());
             region_object.add("name", region.name());
             region_object.add("vmobject", region.vmobject().class_name());
 
@@ -513,6 +519,12 @@ static bool procfs$net_adapters(InodeIdentifier, KBufferBuilder& builder)
         obj.add("bytes_in", adapter.bytes_in());
         obj.add("packets_out", adapter.packets_out());
         obj.add("bytes_out", adapter.bytes_out());
+        obj.add("packets_in_per_second", adapter.packets_in_per_second());
+        obj.add("bytes_in_per_second", adapter.bytes_in_per_second());
+        obj.add("packets_out_per_second", adapter.packets_out_per_second());
+        obj.add("bytes_out_per_second", adapter.bytes_out_per_second());
+        obj.add("interrupts", adapter.interrupts());
+        obj.add("receive_polls", adapter.receive_polls());
         obj.add("link_up", adapter.link_up());
         obj.add("mtu", adapter.mtu());
     });
@@ -549,6 +561,14 @@ static bool procfs$net_tcp(InodeIdentifier, KBufferBuilder& builder)
         obj.add("bytes_in", socket.bytes_in());
         obj.add("packets_out", socket.packets_out());
         obj.add("bytes_out", socket.bytes_out());
+        obj.add("send_window", socket.send_window());
+        obj.add("congestion_window", socket.congestion_window());
+        obj.add("slow_start_threshold", socket.slow_start_threshold());
+        obj.add("maximum_segment_size", socket.maximum_segment_size());
+        obj.add("smoothed_rtt_us", socket.smoothed_round_trip_time().to_microseconds());
+        obj.add("retransmission_timeout_ms", socket.retransmission_timeout().to_milliseconds());
+        obj.add("retransmissions", socket.retransmissions());
+        obj.add("fast_retransmissions", socket.fast_retransmissions());
     });
     array.finish();
     return true;
@@ -695,6 +715,20 @@ static bool procfs$df(InodeIdentifier, KBufferBuilder& builder)
             fs_object.add("source", static_cast<const FileBackedFS&>(fs).file_description().absolute_path());
         else
             fs_object.add("source", "none");
+
+        if (fs.is_block_based()) {
+            auto stats = static_cast<const BlockBasedFS&>(fs).disk_cache_statistics();
+            fs_object.add("cache_entries", static_cast<u64>(stats.entry_count));
+            fs_object.add("cache_size", static_cast<u64>(stats.entry_count) * fs.block_size());
+            fs_object.add("cache_dirty_entries", static_cast<u64>(stats.dirty_count));
+            fs_object.add("cache_hits", stats.hits);
+            fs_object.add("cache_misses", stats.misses);
+            fs_object.add("cache_read_ahead_blocks", stats.read_ahead_blocks);
+            fs_object.add("cache_read_ahead_hits", stats.read_ahead_hits);
+            fs_object.add("cache_blocks_written_back", stats.blocks_written_back);
+            fs_object.add("cache_synchronous_flushes", stats.synchronous_flushes);
+            fs_object.add("cache_uncached_reads", stats.uncached_reads);
+        }
     });
     array.finish();
     return true;
@@ -718,6 +752,13 @@ static bool procfs$cpuinfo(InodeIdentifier, KBufferBuilder& builder)
             obj.add("stepping", info.stepping());
             obj.add("type", info.type());
             obj.add("brandstr", info.brandstr());
+            auto& tlb_stats = proc.tlb_statistics();
+            obj.add("tlb_shootdowns", tlb_stats.shootdowns);
+            obj.add("tlb_shootdown_ipis_sent", tlb_stats.ipis_sent);
+            obj.add("tlb_shootdown_processors_skipped", tlb_stats.processors_skipped);
+            obj.add("tlb_pages_flushed", tlb_stats.pages_flushed);
+            obj.add("tlb_full_flushes", tlb_stats.full_flushes);
+            obj.add("tlb_lazy_switches", tlb_stats.lazy_switches);
             return IterationDecision::Continue;
         });
     array.finish();
@@ -751,8 +792,14 @@ static bool procfs$memstat(InodeIdentifier, KBufferBuilder& builder)
     json.add("user_physical_uncommitted", user_physical_pages_uncommitted);
     json.add("super_physical_allocated", super_physical_used);
     json.add("super_physical_available", super_physical_total - super_physical_used);
+    json.add("large_pages_allocated", MM.large_pages_allocated());
+    json.add("large_pages_split", MM.large_pages_split());
+    json.add("fault_around_pages", MM.fault_around_pages());
     json.add("kmalloc_call_count", stats.kmalloc_call_count);
     json.add("kfree_call_count", stats.kfree_call_count);
+    json.add("kmalloc_per_cpu_cached", stats.bytes_in_per_cpu_caches);
+    json.add("kmalloc_per_cpu_cache_hits", stats.per_cpu_cache_hits);
+    json.add("kmalloc_per_cpu_cache_misses", stats.per_cpu_cache_misses);
     slab_alloc_stats([&json](size_t slab_size, size_t num_allocated, size_t num_free) {
         auto prefix = String::formatted("slab_{}", slab_size);
         json.add(String::formatted("{}_num_allocated", prefix), num_allocated);
@@ -762,6 +809,42 @@ static bool procfs$memstat(InodeIdentifier, KBufferBuilder& builder)
     return true;
 }
 
+static bool procfs$slabinfo(InodeIdentifier, KBufferBuilder& builder)
+{
+    JsonArraySerializer array { builder };
+    for_each_slab_cache([&array](const SlabCache& cache) {
+        auto statistics = cache.statistics();
+        auto obj = array.add_object();
+        obj.add("name", cache.name());
+        obj.add("object_size", statistics.object_size);
+        obj.add("objects_per_slab", statistics.objects_per_slab);
+        obj.add("slabs", statistics.slab_count);
+        obj.add("objects_allocated", statistics.objects_allocated);
+        obj.add("objects_free", statistics.objects_free);
+        obj.add("allocations", statistics.allocation_count);
+        obj.add("fallback_allocations", statistics.fallback_allocation_count);
+        obj.add("slabs_released", statistics.slabs_released);
+    });
+    array.finish();
+    return true;
+}
+
+static bool procfs$locks(InodeIdentifier, KBufferBuilder& builder)
+{
+    JsonArraySerializer array { builder };
+    for (auto& statistics : Lock::statistics()) {
+        auto obj = array.add_object();
+        obj.add("name", statistics.name);
+        obj.add("acquisitions", statistics.acquisitions);
+        obj.add("contentions", statistics.contentions);
+        obj.add("spin_acquisitions", statistics.spin_acquisitions);
+        obj.add("total_wait_ns", statistics.total_wait_ns);
+        obj.add("max_wait_ns", statistics.max_wait_ns);
+    }
+    array.finish();
+    return true;
+}
+
 static bool procfs$all(InodeIdentifier, KBufferBuilder& builder)
 {
     JsonArraySerializer array { builder };
@@ -1702,6 +1785,8 @@ ProcFS::ProcFS()
     m_entries[FI_Root_df] = { "df", FI_Root_df, false, procfs$df };
     m_entries[FI_Root_all] = { "all", FI_Root_all, false, procfs$all };
     m_entries[FI_Root_memstat] = { "memstat", FI_Root_memstat, false, procfs$memstat };
+    m_entries[FI_Root_slabinfo] = { "slabinfo", FI_Root_slabinfo, false, procfs$slabinfo };
+    m_entries[FI_Root_locks] = { "locks", FI_Root_locks, false, procfs$locks };
     m_entries[FI_Root_cpuinfo] = { "cpuinfo", FI_Root_cpuinfo, false, procfs$cpuinfo };
     m_entries[FI_Root_dmesg] = { "dmesg", FI_Root_dmesg, true, procfs$dmesg };
     m_entries[FI_Root_self] = { "self", FI_Root_self, false, procfs$self };
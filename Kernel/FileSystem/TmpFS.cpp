@@ -304,7 +304,7 @@ KResult TmpFSInode::add_child(Inode& child, const StringView& name, mode_t)
         return ENAMETOOLONG;
 
     m_children.set(name, { name, static_cast<TmpFSInode&>(child) });
-    did_add_child(child.identifier());
+    did_add_child(child.identifier(), name);
     return KSuccess;
 }
 
@@ -321,7 +321,7 @@ KResult TmpFSInode::remove_child(const StringView& name)
         return ENOENT;
     auto child_id = it->value.inode->identifier();
     m_children.remove(it);
-    did_remove_child(child_id);
+    did_remove_child(child_id, name);
     return KSuccess;
 }
 
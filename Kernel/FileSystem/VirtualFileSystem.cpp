@@ -30,6 +30,7 @@
 #include <Kernel/Debug.h>
 #include <Kernel/Devices/BlockDevice.h>
 #include <Kernel/FileSystem/Custody.h>
+#include <Kernel/FileSystem/DentryCache.h>
 #include <Kernel/FileSystem/FileBackedFileSystem.h>
 #include <Kernel/FileSystem/FileDescription.h>
 #include <Kernel/FileSystem/FileSystem.h>
@@ -81,6 +82,7 @@ KResult VFS::mount(FS& file_system, Custody& mount_point, int flags)
     // FIXME: check that this is not already a mount point
     Mount mount { file_system, &mount_point, flags };
     m_mounts.append(move(mount));
+    DentryCache::the().invalidate_all();
     return KSuccess;
 }
 
@@ -92,6 +94,7 @@ KResult VFS::bind_mount(Custody& source, Custody& mount_point, int flags)
     // FIXME: check that this is not already a mount point
     Mount mount { source.inode(), mount_point, flags };
     m_mounts.append(move(mount));
+    DentryCache::the().invalidate_all();
     return KSuccess;
 }
 
@@ -106,6 +109,7 @@ KResult VFS::remount(Custody& mount_point, int new_flags)
         return ENODEV;
 
     mount->set_flags(new_flags);
+    DentryCache::the().invalidate_all();
     return KSuccess;
 }
 
@@ -117,6 +121,9 @@ KResult VFS::unmount(Inode& guest_inode)
     for (size_t i = 0; i < m_mounts.size(); ++i) {
         auto& mount = m_mounts.at(i);
         if (&mount.guest() == &guest_inode) {
+            // The dentry cache holds references to inodes and custodies,
+            // drop them so they don't keep the file system busy.
+            DentryCache::the().invalidate_all();
             if (auto result = mount.guest_fs().prepare_to_unmount(); result.is_error()) {
                 dbgln("VFS: Failed to unmount!");
                 return result;
@@ -984,7 +991,23 @@ KResultOr<NonnullRefPtr<Custody>> VFS::resolve_path_without_veil(StringView path
         }
 
         // Okay, let's look up this part.
-        auto child_inode = parent.inode().lookup(part);
+        RefPtr<Inode> child_inode;
+        RefPtr<Custody> child_custody;
+        bool use_dentry_cache = parent.inode().fs().supports_dentry_cache();
+        u32 dentry_sequence = 0;
+        bool found_in_dentry_cache = false;
+        if (use_dentry_cache) {
+            if (auto cached = DentryCache::the().lookup(parent, part, dentry_sequence); cached.has_value()) {
+                child_inode = move(cached.value().inode);
+                child_custody = move(cached.value().custody);
+                found_in_dentry_cache = true;
+            }
+        }
+        if (!found_in_dentry_cache) {
+            child_inode = parent.inode().lookup(part);
+            if (!child_inode && use_dentry_cache)
+                DentryCache::the().add(parent, part, nullptr, nullptr, dentry_sequence);
+        }
         if (!child_inode) {
             if (out_parent) {
                 // ENOENT with a non-null parent custody signals to caller that
@@ -995,17 +1018,25 @@ KResultOr<NonnullRefPtr<Custody>> VFS::resolve_path_without_veil(StringView path
             return ENOENT;
         }
 
-        int mount_flags_for_child = parent.mount_flags();
+        if (child_custody) {
+            custody = child_custody.release_nonnull();
+            child_inode = custody->inode();
+        } else {
+            int mount_flags_for_child = parent.mount_flags();
+            auto host_inode = child_inode;
+
+            // See if there's something mounted on the child; in that case
+            // we would need to return the guest inode, not the host inode.
+            if (auto mount = find_mount_for_host(*child_inode)) {
+                child_inode = mount->guest();
+                mount_flags_for_child = mount->flags();
+            }
 
-        // See if there's something mounted on the child; in that case
-        // we would need to return the guest inode, not the host inode.
-        if (auto mount = find_mount_for_host(*child_inode)) {
-            child_inode = mount->guest();
-            mount_flags_for_child = mount->flags();
+            custody = Custody::create(&parent, part, *child_inode, mount_flags_for_child);
+            if (use_dentry_cache)
+                DentryCache::the().add(parent, part, move(host_inode), custody, dentry_sequence);
         }
 
-        custody = Custody::create(&parent, part, *child_inode, mount_flags_for_child);
-
         if (child_inode->metadata().is_symlink()) {
             if (!have_more_parts) {
                 if (options & O_NOFOLLOW)
@@ -621,6 +621,7 @@ struct ext2_super_block {
 #define EXT4_FEATURE_RO_COMPAT_GDT_CSUM 0x0010
 #define EXT4_FEATURE_RO_COMPAT_DIR_NLINK 0x0020
 #define EXT4_FEATURE_RO_COMPAT_EXTRA_ISIZE 0x0040
+#define EXT4_FEATURE_RO_COMPAT_METADATA_CSUM 0x0400
 
 #define EXT2_FEATURE_INCOMPAT_COMPRESSION 0x0001
 #define EXT2_FEATURE_INCOMPAT_FILETYPE 0x0002
@@ -730,4 +731,34 @@ struct mmp_struct {
  */
 #define EXT2_MMP_DEF_INTERVAL 5
 
+/*
+ * ext4 extent trees. With EXT4_EXTENTS_FL set, i_block holds the root node of
+ * a tree whose leaves map runs of logical blocks to runs of physical blocks.
+ */
+#define EXT4_EXT_MAGIC 0xf30a
+#define EXT4_EXT_INIT_MAX_LEN (1 << 15)
+#define EXT4_EXT_UNINIT_MAX_LEN (EXT4_EXT_INIT_MAX_LEN - 1)
+
+struct ext4_extent_header {
+    __u16 eh_magic;      /* EXT4_EXT_MAGIC */
+    __u16 eh_entries;    /* Number of valid entries */
+    __u16 eh_max;        /* Capacity of the node in entries */
+    __u16 eh_depth;      /* 0 if the entries are extents */
+    __u32 eh_generation; /* Generation of the tree */
+};
+
+struct ext4_extent {
+    __u32 ee_block;    /* First logical block the extent covers */
+    __u16 ee_len;      /* Number of blocks, above EXT4_EXT_INIT_MAX_LEN if uninitialized */
+    __u16 ee_start_hi; /* High 16 bits of the physical block */
+    __u32 ee_start_lo; /* Low 32 bits of the physical block */
+};
+
+struct ext4_extent_idx {
+    __u32 ei_block;   /* First logical block the subtree covers */
+    __u32 ei_leaf_lo; /* Low 32 bits of the child node's block */
+    __u16 ei_leaf_hi; /* High 16 bits of the child node's block */
+    __u16 ei_unused;
+};
+
 #endif /* _LINUX_EXT2_FS_H */
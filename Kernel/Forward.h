@@ -35,9 +35,11 @@ class Custody;
 class Device;
 class DiskCache;
 class DoubleBuffer;
+class EventPoll;
 class File;
 class FileDescription;
 class FutexQueue;
+class IORing;
 class IPv4Socket;
 class Inode;
 class InodeIdentifier;
@@ -69,6 +71,7 @@ class RecursiveSpinLock;
 template<typename LockType>
 class ScopedSpinLock;
 class TCPSocket;
+class TLBFlushBatch;
 class TTY;
 class Thread;
 class UDPSocket;
@@ -26,164 +26,379 @@
 
 #include <AK/Assertions.h>
 #include <AK/Memory.h>
+#include <AK/StdLibExtras.h>
+#include <Kernel/FileSystem/Custody.h>
+#include <Kernel/FileSystem/FileDescription.h>
 #include <Kernel/Heap/SlabAllocator.h>
 #include <Kernel/Heap/kmalloc.h>
 #include <Kernel/SpinLock.h>
+#include <Kernel/Thread.h>
+#include <Kernel/VM/PhysicalPage.h>
 #include <Kernel/VM/Region.h>
 
 #define SANITIZE_SLABS
 
 namespace Kernel {
 
-template<size_t templated_slab_size>
-class SlabAllocator {
-public:
-    SlabAllocator() = default;
+static constexpr size_t slab_object_alignment = 2 * sizeof(void*);
+static constexpr size_t min_objects_per_slab = 16;
+static constexpr size_t max_slab_size = 64 * KiB;
+// Keep one empty slab around, so that a cache hovering around a slab boundary
+// doesn't keep allocating and freeing the same slab.
+static constexpr size_t max_empty_slabs = 1;
 
-    void init(size_t size)
+SlabCache::SlabCache(const char* name, size_t object_size)
+    : m_name(name)
+    , m_object_size(round_up_to_power_of_two(max(object_size, sizeof(FreeObject)), slab_object_alignment))
+{
+    m_slab_size = clamp(page_round_up(sizeof(Slab) + slab_object_alignment + min_objects_per_slab * m_object_size), (size_t)PAGE_SIZE, max_slab_size);
+    m_objects_per_slab = (m_slab_size - sizeof(Slab) - slab_object_alignment) / m_object_size;
+    VERIFY(m_objects_per_slab > 0);
+}
+
+void* SlabCache::allocate()
+{
+    FreeObject* object = nullptr;
+    bool should_grow = false;
     {
-        m_base = kmalloc_eternal(size);
-        m_end = (u8*)m_base + size;
-        FreeSlab* slabs = (FreeSlab*)m_base;
-        m_slab_count = size / templated_slab_size;
-        for (size_t i = 1; i < m_slab_count; ++i) {
-            slabs[i].next = &slabs[i - 1];
+        ScopedSpinLock lock(m_lock);
+        m_allocation_count++;
+        object = take_free_object();
+        // Growing allocates from kmalloc, which may itself need an object from
+        // this very cache (a Region when the kmalloc heap expands, for example).
+        // So only one caller grows the cache, and the others fall back to kmalloc.
+        if (!object && !m_growing) {
+            m_growing = true;
+            should_grow = true;
         }
-        slabs[0].next = nullptr;
-        m_freelist = &slabs[m_slab_count - 1];
-        m_num_allocated = 0;
     }
 
-    constexpr size_t slab_size() const { return templated_slab_size; }
-    size_t slab_count() const { return m_slab_count; }
+    if (should_grow) {
+        grow();
+        ScopedSpinLock lock(m_lock);
+        object = take_free_object();
+    }
 
-    void* alloc()
-    {
-        FreeSlab* free_slab;
+    if (!object) {
         {
-            // We want to avoid being swapped out in the middle of this
-            ScopedCritical critical;
-            FreeSlab* next_free;
-            free_slab = m_freelist.load(AK::memory_order_consume);
-            do {
-                if (!free_slab)
-                    return kmalloc(slab_size());
-                // It's possible another processor is doing the same thing at
-                // the same time, so next_free *can* be a bogus pointer. However,
-                // in that case compare_exchange_strong would fail and we would
-                // try again.
-                next_free = free_slab->next;
-            } while (!m_freelist.compare_exchange_strong(free_slab, next_free, AK::memory_order_acq_rel));
-
-            m_num_allocated++;
+            ScopedSpinLock lock(m_lock);
+            m_fallback_allocation_count++;
         }
+        return kmalloc(m_object_size);
+    }
 
 #ifdef SANITIZE_SLABS
-        memset(free_slab, SLAB_ALLOC_SCRUB_BYTE, slab_size());
+    memset(object, SLAB_ALLOC_SCRUB_BYTE, m_object_size);
 #endif
-        return free_slab;
-    }
+    return object;
+}
 
-    void dealloc(void* ptr)
+void SlabCache::deallocate(void* ptr)
+{
+    VERIFY(ptr);
+#ifdef SANITIZE_SLABS
+    if (m_object_size > sizeof(FreeObject))
+        memset((u8*)ptr + sizeof(FreeObject), SLAB_DEALLOC_SCRUB_BYTE, m_object_size - sizeof(FreeObject));
+#endif
+
+    Slab* slab_to_release = nullptr;
     {
-        VERIFY(ptr);
-        if (ptr < m_base || ptr >= m_end) {
+        ScopedSpinLock lock(m_lock);
+        auto* slab = slab_containing(ptr);
+        if (!slab) {
+            // This was allocated by kmalloc() while the cache couldn't grow.
+            lock.unlock();
             kfree(ptr);
             return;
         }
-        FreeSlab* free_slab = (FreeSlab*)ptr;
-#ifdef SANITIZE_SLABS
-        if (slab_size() > sizeof(FreeSlab*))
-            memset(free_slab->padding, SLAB_DEALLOC_SCRUB_BYTE, sizeof(FreeSlab::padding));
-#endif
 
-        // We want to avoid being swapped out in the middle of this
-        ScopedCritical critical;
-        FreeSlab* next_free = m_freelist.load(AK::memory_order_consume);
-        do {
-            free_slab->next = next_free;
-        } while (!m_freelist.compare_exchange_strong(next_free, free_slab, AK::memory_order_acq_rel));
+        VERIFY(((u8*)ptr - slab->objects_start) % m_object_size == 0);
+        VERIFY(slab->objects_in_use > 0);
+        auto* object = (FreeObject*)ptr;
+        if (!slab->freelist)
+            prepend_available_slab(*slab);
+        object->next = slab->freelist;
+        slab->freelist = object;
+        m_objects_allocated--;
 
-        m_num_allocated--;
+        if (--slab->objects_in_use == 0) {
+            remove_available_slab(*slab);
+            if (m_empty_slab_count >= max_empty_slabs) {
+                remove_slab(*slab);
+                m_slabs_released++;
+                slab_to_release = slab;
+            } else {
+                append_available_slab(*slab);
+                m_empty_slab_count++;
+            }
+        }
     }
 
-    size_t num_allocated() const { return m_num_allocated; }
-    size_t num_free() const { return m_slab_count - m_num_allocated; }
+    kfree(slab_to_release);
+}
 
-private:
-    struct FreeSlab {
-        FreeSlab* next;
-        char padding[templated_slab_size - sizeof(FreeSlab*)];
-    };
+size_t SlabCache::release_empty_slabs()
+{
+    Slab* released_slabs = nullptr;
+    size_t released_count = 0;
+    {
+        ScopedSpinLock lock(m_lock);
+        auto* slab = m_available_slabs_head;
+        while (slab) {
+            auto* next = slab->next;
+            if (slab->objects_in_use == 0) {
+                remove_available_slab(*slab);
+                remove_slab(*slab);
+                m_empty_slab_count--;
+                m_slabs_released++;
+                slab->next = released_slabs;
+                released_slabs = slab;
+                released_count++;
+            }
+            slab = next;
+        }
+    }
 
-    Atomic<FreeSlab*> m_freelist { nullptr };
-    Atomic<ssize_t, AK::MemoryOrder::memory_order_relaxed> m_num_allocated;
-    size_t m_slab_count;
-    void* m_base { nullptr };
-    void* m_end { nullptr };
+    while (released_slabs) {
+        auto* next = released_slabs->next;
+        kfree(released_slabs);
+        released_slabs = next;
+    }
+    return released_count * m_slab_size;
+}
 
-    static_assert(sizeof(FreeSlab) == templated_slab_size);
-};
+auto SlabCache::statistics() const -> Statistics
+{
+    ScopedSpinLock lock(m_lock);
+    Statistics statistics;
+    statistics.object_size = m_object_size;
+    statistics.objects_per_slab = m_objects_per_slab;
+    statistics.slab_count = m_slab_count;
+    statistics.objects_allocated = m_objects_allocated;
+    statistics.objects_free = m_slab_count * m_objects_per_slab - m_objects_allocated;
+    statistics.allocation_count = m_allocation_count;
+    statistics.fallback_allocation_count = m_fallback_allocation_count;
+    statistics.slabs_released = m_slabs_released;
+    return statistics;
+}
 
-static SlabAllocator<16> s_slab_allocator_16;
-static SlabAllocator<32> s_slab_allocator_32;
-static SlabAllocator<64> s_slab_allocator_64;
-static SlabAllocator<128> s_slab_allocator_128;
+auto SlabCache::take_free_object() -> FreeObject*
+{
+    VERIFY(m_lock.is_locked());
+    auto* slab = m_available_slabs_head;
+    if (!slab)
+        return nullptr;
+    auto* object = slab->freelist;
+    VERIFY(object);
+    slab->freelist = object->next;
+    if (slab->objects_in_use++ == 0) {
+        // Start using the empty slab from the front of the list.
+        VERIFY(m_empty_slab_count > 0);
+        m_empty_slab_count--;
+    }
+    if (!slab->freelist)
+        remove_available_slab(*slab);
+    m_objects_allocated++;
+    return object;
+}
 
-#if ARCH(I386)
-static_assert(sizeof(Region) <= s_slab_allocator_128.slab_size());
-#endif
+void SlabCache::grow()
+{
+    VERIFY(m_growing);
+    // Nobody else changes the capacity while m_growing is set.
+    size_t new_capacity = 0;
+    {
+        ScopedSpinLock lock(m_lock);
+        if (m_slab_count == m_slab_capacity)
+            new_capacity = max(m_slab_capacity * 2, (size_t)8);
+    }
+
+    auto* slab_memory = (u8*)kmalloc(m_slab_size);
+    auto** new_slabs = new_capacity ? (Slab**)kmalloc(new_capacity * sizeof(Slab*)) : nullptr;
+
+    Slab** old_slabs = nullptr;
+    {
+        ScopedSpinLock lock(m_lock);
+        if (new_slabs) {
+            if (m_slab_count)
+                memcpy(new_slabs, m_slabs, m_slab_count * sizeof(Slab*));
+            old_slabs = m_slabs;
+            m_slabs = new_slabs;
+            m_slab_capacity = new_capacity;
+        }
 
-template<typename Callback>
-void for_each_allocator(Callback callback)
+        auto* slab = new (slab_memory) Slab;
+        slab->objects_start = (u8*)round_up_to_power_of_two((FlatPtr)(slab_memory + sizeof(Slab)), slab_object_alignment);
+        slab->objects_end = slab->objects_start + m_objects_per_slab * m_object_size;
+        VERIFY(slab->objects_end <= slab_memory + m_slab_size);
+        for (size_t i = m_objects_per_slab; i > 0; i--) {
+            auto* object = (FreeObject*)(slab->objects_start + (i - 1) * m_object_size);
+            object->next = slab->freelist;
+            slab->freelist = object;
+        }
+
+        insert_slab(*slab);
+        append_available_slab(*slab);
+        m_empty_slab_count++;
+        m_growing = false;
+    }
+
+    kfree(old_slabs);
+}
+
+auto SlabCache::slab_containing(void* ptr) const -> Slab*
+{
+    VERIFY(m_lock.is_locked());
+    // Find the last slab that starts at or below ptr.
+    size_t low = 0;
+    size_t high = m_slab_count;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if ((FlatPtr)m_slabs[middle] <= (FlatPtr)ptr)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    if (low == 0)
+        return nullptr;
+    auto* slab = m_slabs[low - 1];
+    if ((u8*)ptr < slab->objects_start || (u8*)ptr >= slab->objects_end)
+        return nullptr;
+    return slab;
+}
+
+void SlabCache::insert_slab(Slab& slab)
+{
+    VERIFY(m_lock.is_locked());
+    VERIFY(m_slab_count < m_slab_capacity);
+    size_t index = 0;
+    while (index < m_slab_count && (FlatPtr)m_slabs[index] < (FlatPtr)&slab)
+        index++;
+    memmove(m_slabs + index + 1, m_slabs + index, (m_slab_count - index) * sizeof(Slab*));
+    m_slabs[index] = &slab;
+    m_slab_count++;
+}
+
+void SlabCache::remove_slab(Slab& slab)
+{
+    VERIFY(m_lock.is_locked());
+    size_t index = 0;
+    while (index < m_slab_count && m_slabs[index] != &slab)
+        index++;
+    VERIFY(index < m_slab_count);
+    memmove(m_slabs + index, m_slabs + index + 1, (m_slab_count - index - 1) * sizeof(Slab*));
+    m_slab_count--;
+}
+
+void SlabCache::prepend_available_slab(Slab& slab)
+{
+    slab.prev = nullptr;
+    slab.next = m_available_slabs_head;
+    if (m_available_slabs_head)
+        m_available_slabs_head->prev = &slab;
+    else
+        m_available_slabs_tail = &slab;
+    m_available_slabs_head = &slab;
+}
+
+void SlabCache::append_available_slab(Slab& slab)
+{
+    slab.next = nullptr;
+    slab.prev = m_available_slabs_tail;
+    if (m_available_slabs_tail)
+        m_available_slabs_tail->next = &slab;
+    else
+        m_available_slabs_head = &slab;
+    m_available_slabs_tail = &slab;
+}
+
+void SlabCache::remove_available_slab(Slab& slab)
 {
-    callback(s_slab_allocator_16);
-    callback(s_slab_allocator_32);
-    callback(s_slab_allocator_64);
-    callback(s_slab_allocator_128);
+    if (slab.prev)
+        slab.prev->next = slab.next;
+    else
+        m_available_slabs_head = slab.next;
+    if (slab.next)
+        slab.next->prev = slab.prev;
+    else
+        m_available_slabs_tail = slab.prev;
+    slab.next = nullptr;
+    slab.prev = nullptr;
 }
 
+static constexpr size_t general_slab_sizes[] = { 16, 32, 64, 128 };
+static constexpr const char* general_slab_cache_names[] = { "slab-16", "slab-32", "slab-64", "slab-128" };
+static constexpr size_t general_slab_cache_count = sizeof(general_slab_sizes) / sizeof(general_slab_sizes[0]);
+
+READONLY_AFTER_INIT static SlabCache* s_general_slab_caches[general_slab_cache_count];
+READONLY_AFTER_INIT static SlabCache* s_slab_caches[(size_t)SlabCacheID::__Count];
+
 UNMAP_AFTER_INIT void slab_alloc_init()
 {
-    s_slab_allocator_16.init(128 * KiB);
-    s_slab_allocator_32.init(128 * KiB);
-    s_slab_allocator_64.init(512 * KiB);
-    s_slab_allocator_128.init(512 * KiB);
+    for (size_t i = 0; i < general_slab_cache_count; i++)
+        s_general_slab_caches[i] = new (kmalloc_eternal(sizeof(SlabCache))) SlabCache(general_slab_cache_names[i], general_slab_sizes[i]);
+
+#define __ENUMERATE_SLAB_CACHE(type) \
+    s_slab_caches[(size_t)SlabCacheID::type] = new (kmalloc_eternal(sizeof(SlabCache))) SlabCache(#type, sizeof(type));
+    ENUMERATE_SLAB_CACHES
+#undef __ENUMERATE_SLAB_CACHE
+}
+
+static SlabCache& general_slab_cache_for(size_t slab_size)
+{
+    for (size_t i = 0; i < general_slab_cache_count; i++) {
+        if (slab_size <= general_slab_sizes[i])
+            return *s_general_slab_caches[i];
+    }
+    VERIFY_NOT_REACHED();
 }
 
 void* slab_alloc(size_t slab_size)
 {
-    if (slab_size <= 16)
-        return s_slab_allocator_16.alloc();
-    if (slab_size <= 32)
-        return s_slab_allocator_32.alloc();
-    if (slab_size <= 64)
-        return s_slab_allocator_64.alloc();
-    if (slab_size <= 128)
-        return s_slab_allocator_128.alloc();
-    VERIFY_NOT_REACHED();
+    return general_slab_cache_for(slab_size).allocate();
 }
 
 void slab_dealloc(void* ptr, size_t slab_size)
 {
-    if (slab_size <= 16)
-        return s_slab_allocator_16.dealloc(ptr);
-    if (slab_size <= 32)
-        return s_slab_allocator_32.dealloc(ptr);
-    if (slab_size <= 64)
-        return s_slab_allocator_64.dealloc(ptr);
-    if (slab_size <= 128)
-        return s_slab_allocator_128.dealloc(ptr);
-    VERIFY_NOT_REACHED();
+    general_slab_cache_for(slab_size).deallocate(ptr);
+}
+
+void* slab_cache_alloc(SlabCacheID id, size_t object_size)
+{
+    auto& cache = *s_slab_caches[(size_t)id];
+    VERIFY(object_size <= cache.object_size());
+    return cache.allocate();
+}
+
+void slab_cache_dealloc(SlabCacheID id, void* ptr)
+{
+    s_slab_caches[(size_t)id]->deallocate(ptr);
 }
 
 void slab_alloc_stats(Function<void(size_t slab_size, size_t allocated, size_t free)> callback)
 {
-    for_each_allocator([&](auto& allocator) {
-        auto num_allocated = allocator.num_allocated();
-        auto num_free = allocator.slab_count() - num_allocated;
-        callback(allocator.slab_size(), num_allocated, num_free);
-    });
+    for (size_t i = 0; i < general_slab_cache_count; i++) {
+        auto statistics = s_general_slab_caches[i]->statistics();
+        callback(general_slab_sizes[i], statistics.objects_allocated, statistics.objects_free);
+    }
+}
+
+void for_each_slab_cache(Function<void(const SlabCache&)> callback)
+{
+    for (auto* cache : s_general_slab_caches)
+        callback(*cache);
+    for (auto* cache : s_slab_caches)
+        callback(*cache);
+}
+
+size_t slab_alloc_release_empty_slabs()
+{
+    size_t released_bytes = 0;
+    for (auto* cache : s_general_slab_caches)
+        released_bytes += cache->release_empty_slabs();
+    for (auto* cache : s_slab_caches)
+        released_bytes += cache->release_empty_slabs();
+    return released_bytes;
 }
 
 }
@@ -27,18 +27,121 @@
 #pragma once
 
 #include <AK/Function.h>
+#include <AK/Noncopyable.h>
 #include <AK/Types.h>
+#include <Kernel/SpinLock.h>
 
 namespace Kernel {
 
 #define SLAB_ALLOC_SCRUB_BYTE 0xab
 #define SLAB_DEALLOC_SCRUB_BYTE 0xbc
 
+// A SlabCache hands out objects of a single size. It carves them out of slabs
+// that it allocates from kmalloc as it grows, and gives slabs back once all of
+// their objects have been freed again.
+class SlabCache {
+    AK_MAKE_NONCOPYABLE(SlabCache);
+    AK_MAKE_NONMOVABLE(SlabCache);
+
+public:
+    struct Statistics {
+        size_t object_size { 0 };
+        size_t objects_per_slab { 0 };
+        size_t slab_count { 0 };
+        size_t objects_allocated { 0 };
+        size_t objects_free { 0 };
+        size_t allocation_count { 0 };
+        size_t fallback_allocation_count { 0 };
+        size_t slabs_released { 0 };
+    };
+
+    SlabCache(const char* name, size_t object_size);
+
+    const char* name() const { return m_name; }
+    size_t object_size() const { return m_object_size; }
+
+    void* allocate();
+    void deallocate(void*);
+
+    // Returns the number of bytes given back to kmalloc.
+    size_t release_empty_slabs();
+
+    Statistics statistics() const;
+
+private:
+    struct FreeObject {
+        FreeObject* next;
+    };
+
+    struct Slab {
+        Slab* next { nullptr };
+        Slab* prev { nullptr };
+        FreeObject* freelist { nullptr };
+        size_t objects_in_use { 0 };
+        u8* objects_start { nullptr };
+        u8* objects_end { nullptr };
+    };
+
+    FreeObject* take_free_object();
+    void grow();
+    Slab* slab_containing(void*) const;
+    void insert_slab(Slab&);
+    void remove_slab(Slab&);
+
+    void prepend_available_slab(Slab&);
+    void append_available_slab(Slab&);
+    void remove_available_slab(Slab&);
+
+    const char* m_name { nullptr };
+    size_t m_object_size { 0 };
+    size_t m_slab_size { 0 };
+    size_t m_objects_per_slab { 0 };
+
+    // Slabs with at least one free object, partially used ones first, so that
+    // the empty ones at the end get a chance to be released.
+    Slab* m_available_slabs_head { nullptr };
+    Slab* m_available_slabs_tail { nullptr };
+    size_t m_empty_slab_count { 0 };
+
+    // All slabs sorted by address, to find the slab an object belongs to.
+    // This is a plain array, because we must not call into kmalloc while
+    // holding m_lock: growing the kmalloc heap may need an object from us.
+    Slab** m_slabs { nullptr };
+    size_t m_slab_count { 0 };
+    size_t m_slab_capacity { 0 };
+
+    bool m_growing { false };
+    size_t m_objects_allocated { 0 };
+    size_t m_allocation_count { 0 };
+    size_t m_fallback_allocation_count { 0 };
+    size_t m_slabs_released { 0 };
+    mutable SpinLock<u8> m_lock;
+};
+
+#define ENUMERATE_SLAB_CACHES              \
+    __ENUMERATE_SLAB_CACHE(Custody)         \
+    __ENUMERATE_SLAB_CACHE(FileDescription) \
+    __ENUMERATE_SLAB_CACHE(PhysicalPage)    \
+    __ENUMERATE_SLAB_CACHE(Region)          \
+    __ENUMERATE_SLAB_CACHE(Thread)
+
+enum class SlabCacheID {
+#define __ENUMERATE_SLAB_CACHE(type) type,
+    ENUMERATE_SLAB_CACHES
+#undef __ENUMERATE_SLAB_CACHE
+        __Count
+};
+
 void* slab_alloc(size_t slab_size);
 void slab_dealloc(void*, size_t slab_size);
+void* slab_cache_alloc(SlabCacheID, size_t object_size);
+void slab_cache_dealloc(SlabCacheID, void*);
 void slab_alloc_init();
 void slab_alloc_stats(Function<void(size_t slab_size, size_t allocated, size_t free)>);
+void for_each_slab_cache(Function<void(const SlabCache&)>);
+size_t slab_alloc_release_empty_slabs();
 
+// For small objects of any type, served from the general purpose caches by size.
 #define MAKE_SLAB_ALLOCATED(type)                                        \
 public:                                                                  \
     void* operator new(size_t) { return slab_alloc(sizeof(type)); }      \
@@ -46,4 +149,12 @@ public:                                                                  \
                                                                          \
 private:
 
+// For hot types listed in ENUMERATE_SLAB_CACHES, which get a cache of their own.
+#define MAKE_SLAB_CACHED(type)                                                                \
+public:                                                                                       \
+    void* operator new(size_t size) { return slab_cache_alloc(SlabCacheID::type, size); }     \
+    void operator delete(void* ptr) { slab_cache_dealloc(SlabCacheID::type, ptr); }           \
+                                                                                              \
+private:
+
 }
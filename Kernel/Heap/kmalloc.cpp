@@ -48,6 +48,13 @@
 #define POOL_SIZE (2 * MiB)
 #define ETERNAL_RANGE_SIZE (2 * MiB)
 
+// Allocations of up to KMALLOC_MAGAZINE_MAX_CHUNKS chunks are recycled through
+// small per-CPU magazines, so that most kmalloc()/kfree() pairs don't have to
+// take s_lock at all. Magazines are refilled and drained in batches.
+#define KMALLOC_MAGAZINE_MAX_CHUNKS 8
+#define KMALLOC_MAGAZINE_SIZE 32
+#define KMALLOC_MAGAZINE_BATCH (KMALLOC_MAGAZINE_SIZE / 2)
+
 static RecursiveSpinLock s_lock; // needs to be recursive because of dump_backtrace()
 
 static void kmalloc_allocate_backup_memory();
@@ -199,6 +206,23 @@ struct KmallocGlobalHeap {
     }
 };
 
+namespace Kernel {
+
+struct KmallocMagazine {
+    size_t count { 0 };
+    void* objects[KMALLOC_MAGAZINE_SIZE];
+};
+
+struct KmallocPerProcessorData {
+    KmallocMagazine magazines[KMALLOC_MAGAZINE_MAX_CHUNKS];
+    size_t kmalloc_call_count { 0 };
+    size_t kfree_call_count { 0 };
+    size_t magazine_hits { 0 };
+    size_t magazine_misses { 0 };
+};
+
+}
+
 READONLY_AFTER_INIT static KmallocGlobalHeap* g_kmalloc_global;
 static u8 g_kmalloc_global_heap[sizeof(KmallocGlobalHeap)];
 
@@ -213,6 +237,7 @@ bool g_dump_kmalloc_stacks;
 
 static u8* s_next_eternal_ptr;
 READONLY_AFTER_INIT static u8* s_end_of_eternal_range;
+READONLY_AFTER_INIT static bool s_kmalloc_magazines_enabled;
 
 static void kmalloc_allocate_backup_memory()
 {
@@ -235,6 +260,8 @@ UNMAP_AFTER_INIT void kmalloc_init()
 
     s_next_eternal_ptr = kmalloc_eternal_heap;
     s_end_of_eternal_range = s_next_eternal_ptr + sizeof(kmalloc_pool_heap);
+
+    s_kmalloc_magazines_enabled = true;
 }
 
 void* kmalloc_eternal(size_t size)
@@ -249,8 +276,74 @@ void* kmalloc_eternal(size_t size)
     return ptr;
 }
 
+// Must be called with interrupts disabled, so that we stay on this processor.
+static KmallocPerProcessorData* kmalloc_per_processor_data()
+{
+    if (!s_kmalloc_magazines_enabled || g_dump_kmalloc_stacks || !Processor::is_initialized())
+        return nullptr;
+    auto& processor = Processor::current();
+    auto* data = processor.kmalloc_data();
+    if (!data) {
+        data = new (kmalloc_eternal(sizeof(KmallocPerProcessorData))) KmallocPerProcessorData;
+        processor.set_kmalloc_data(*data);
+    }
+    return data;
+}
+
+static void kmalloc_refill_magazine(KmallocMagazine& magazine, size_t chunks)
+{
+    ScopedSpinLock lock(s_lock);
+    size_t size = KmallocGlobalHeap::HeapType::HeapType::usable_size_for_chunks(chunks);
+    for (size_t i = 0; i < KMALLOC_MAGAZINE_BATCH; i++) {
+        void* ptr = g_kmalloc_global->m_heap.allocate(size);
+        if (!ptr)
+            return;
+        // Expanding the heap may have recycled allocations through this very magazine.
+        if (magazine.count == KMALLOC_MAGAZINE_SIZE) {
+            g_kmalloc_global->m_heap.deallocate(ptr);
+            return;
+        }
+        magazine.objects[magazine.count++] = ptr;
+    }
+}
+
+static void kmalloc_drain_magazine(KmallocMagazine& magazine)
+{
+    // Give back the objects that have been sitting in the magazine the longest,
+    // and keep the recently freed (and likely still cache hot) ones.
+    void* objects[KMALLOC_MAGAZINE_BATCH];
+    size_t count = min(magazine.count, (size_t)KMALLOC_MAGAZINE_BATCH);
+    memcpy(objects, magazine.objects, count * sizeof(void*));
+    memmove(magazine.objects, magazine.objects + count, (magazine.count - count) * sizeof(void*));
+    magazine.count -= count;
+
+    ScopedSpinLock lock(s_lock);
+    for (size_t i = 0; i < count; i++)
+        g_kmalloc_global->m_heap.deallocate(objects[i]);
+}
+
 void* kmalloc(size_t size)
 {
+    size_t chunks = KmallocGlobalHeap::HeapType::HeapType::chunks_needed_for(size);
+    if (chunks <= KMALLOC_MAGAZINE_MAX_CHUNKS) {
+        InterruptDisabler disabler;
+        if (auto* data = kmalloc_per_processor_data()) {
+            auto& magazine = data->magazines[chunks - 1];
+            if (magazine.count > 0) {
+                ++data->magazine_hits;
+            } else {
+                ++data->magazine_misses;
+                kmalloc_refill_magazine(magazine, chunks);
+            }
+            if (magazine.count > 0) {
+                ++data->kmalloc_call_count;
+                void* ptr = magazine.objects[--magazine.count];
+                memset(ptr, KMALLOC_SCRUB_BYTE, KmallocGlobalHeap::HeapType::HeapType::usable_size_for_chunks(chunks));
+                return ptr;
+            }
+        }
+    }
+
     ScopedSpinLock lock(s_lock);
     ++g_kmalloc_call_count;
 
@@ -272,6 +365,20 @@ void kfree(void* ptr)
     if (!ptr)
         return;
 
+    size_t chunks = KmallocGlobalHeap::HeapType::HeapType::allocation_size_in_chunks(ptr);
+    if (chunks <= KMALLOC_MAGAZINE_MAX_CHUNKS) {
+        InterruptDisabler disabler;
+        if (auto* data = kmalloc_per_processor_data()) {
+            ++data->kfree_call_count;
+            auto& magazine = data->magazines[chunks - 1];
+            if (magazine.count == KMALLOC_MAGAZINE_SIZE)
+                kmalloc_drain_magazine(magazine);
+            memset(ptr, KFREE_SCRUB_BYTE, KmallocGlobalHeap::HeapType::HeapType::usable_size_for_chunks(chunks));
+            magazine.objects[magazine.count++] = ptr;
+            return;
+        }
+    }
+
     ScopedSpinLock lock(s_lock);
     ++g_kfree_call_count;
 
@@ -302,4 +409,25 @@ void get_kmalloc_stats(kmalloc_stats& stats)
     stats.bytes_eternal = g_kmalloc_bytes_eternal;
     stats.kmalloc_call_count = g_kmalloc_call_count;
     stats.kfree_call_count = g_kfree_call_count;
+    stats.bytes_in_per_cpu_caches = 0;
+    stats.per_cpu_cache_hits = 0;
+    stats.per_cpu_cache_misses = 0;
+
+    // Objects sitting in the magazines are allocated as far as the heap is
+    // concerned, but they are free to be handed out. This is only a snapshot,
+    // the other processors keep using their magazines while we look.
+    Processor::for_each([&](Processor& processor) {
+        auto* data = processor.kmalloc_data();
+        if (!data)
+            return IterationDecision::Continue;
+        for (size_t i = 0; i < KMALLOC_MAGAZINE_MAX_CHUNKS; i++)
+            stats.bytes_in_per_cpu_caches += data->magazines[i].count * (i + 1) * CHUNK_SIZE;
+        stats.kmalloc_call_count += data->kmalloc_call_count;
+        stats.kfree_call_count += data->kfree_call_count;
+        stats.per_cpu_cache_hits += data->magazine_hits;
+        stats.per_cpu_cache_misses += data->magazine_misses;
+        return IterationDecision::Continue;
+    });
+    stats.bytes_allocated -= stats.bytes_in_per_cpu_caches;
+    stats.bytes_free += stats.bytes_in_per_cpu_caches;
 }
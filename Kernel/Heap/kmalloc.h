@@ -52,6 +52,9 @@ struct kmalloc_stats {
     size_t bytes_eternal;
     size_t kmalloc_call_count;
     size_t kfree_call_count;
+    size_t bytes_in_per_cpu_caches;
+    size_t per_cpu_cache_hits;
+    size_t per_cpu_cache_misses;
 };
 void get_kmalloc_stats(kmalloc_stats&);
 
@@ -562,7 +562,7 @@ void APIC::setup_local_timer(u32 ticks, TimerMode timer_mode, bool enable)
     }
     write_register(APIC_REG_TIMER_CONFIGURATION, config);
 
-    if (timer_mode == TimerMode::Periodic)
+    if (timer_mode != TimerMode::TSCDeadline)
         write_register(APIC_REG_TIMER_INITIAL_COUNT, ticks / get_timer_divisor());
 }
 
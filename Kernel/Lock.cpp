@@ -24,14 +24,113 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <AK/StringView.h>
 #include <AK/TemporaryChange.h>
 #include <Kernel/Debug.h>
 #include <Kernel/KSyms.h>
 #include <Kernel/Lock.h>
+#include <Kernel/SpinLock.h>
 #include <Kernel/Thread.h>
+#include <Kernel/Time/TimeManagement.h>
 
 namespace Kernel {
 
+static constexpr size_t max_lock_statistics = 256;
+static LockStatistics s_lock_statistics[max_lock_statistics];
+static size_t s_lock_statistics_count;
+static SpinLock<u8> s_lock_statistics_lock;
+
+static LockStatistics* statistics_for(const char* name)
+{
+    VERIFY(s_lock_statistics_lock.is_locked());
+    StringView name_view { name };
+    for (size_t i = 0; i < s_lock_statistics_count; ++i) {
+        auto& statistics = s_lock_statistics[i];
+        if (statistics.name == name || name_view == statistics.name)
+            return &statistics;
+    }
+    if (s_lock_statistics_count == max_lock_statistics)
+        return nullptr;
+    auto& statistics = s_lock_statistics[s_lock_statistics_count++];
+    statistics.name = name;
+    return &statistics;
+}
+
+static u64 lock_wait_timestamp()
+{
+    if (!TimeManagement::initialized())
+        return 0;
+    return TimeManagement::the().monotonic_time(TimePrecision::Precise).to_nanoseconds();
+}
+
+Vector<LockStatistics> Lock::statistics()
+{
+    Vector<LockStatistics> statistics;
+    statistics.ensure_capacity(max_lock_statistics);
+    ScopedSpinLock lock(s_lock_statistics_lock);
+    for (size_t i = 0; i < s_lock_statistics_count; ++i)
+        statistics.unchecked_append(s_lock_statistics[i]);
+    return statistics;
+}
+
+Lock::~Lock()
+{
+    if (m_unreported_acquisitions > 0)
+        report_statistics(m_unreported_acquisitions, false, false, 0);
+}
+
+void Lock::report_statistics(u32 acquisitions, bool contended, bool acquired_by_spinning, u64 wait_ns)
+{
+    if (!m_name)
+        return;
+    ScopedSpinLock lock(s_lock_statistics_lock);
+    if (!m_statistics) {
+        m_statistics = statistics_for(m_name);
+        if (!m_statistics)
+            return;
+    }
+    m_statistics->acquisitions += acquisitions;
+    if (contended) {
+        m_statistics->contentions++;
+        m_statistics->total_wait_ns += wait_ns;
+        if (wait_ns > m_statistics->max_wait_ns)
+            m_statistics->max_wait_ns = wait_ns;
+    }
+    if (acquired_by_spinning)
+        m_statistics->spin_acquisitions++;
+}
+
+void Lock::lock_internal_state()
+{
+    // Whoever holds "m_lock" only does so for a few instructions, so spin
+    // for a bit before yielding.
+    u32 spins = 0;
+    while (m_lock.exchange(true, AK::memory_order_acq_rel) != false) {
+        if (++spins < max_spin_iterations) {
+            Processor::wait_check();
+            continue;
+        }
+        spins = 0;
+        Scheduler::yield_from_critical();
+    }
+}
+
+bool Lock::spin_while_held_by(Thread& holder)
+{
+    // Spinning only makes sense if the holder is running on another
+    // processor and is therefore likely to release the lock soon.
+    if (Processor::count() <= 1)
+        return false;
+    for (u32 i = 0; i < max_spin_iterations; ++i) {
+        if (m_mode == Mode::Unlocked)
+            return true;
+        if (!holder.is_active())
+            return false;
+        Processor::wait_check();
+    }
+    return false;
+}
+
 #if LOCK_DEBUG
 void Lock::lock(Mode mode)
 {
@@ -49,41 +148,44 @@ void Lock::lock(Mode mode)
     VERIFY(mode != Mode::Unlocked);
     auto current_thread = Thread::current();
     ScopedCritical critical; // in case we're not in a critical section already
+    bool contended = false;
+    bool acquired_by_spinning = false;
+    u64 wait_start = 0;
     for (;;) {
-        if (m_lock.exchange(true, AK::memory_order_acq_rel) != false) {
-            // I don't know *who* is using "m_lock", so just yield.
-            Scheduler::yield_from_critical();
-            continue;
-        }
+        lock_internal_state();
 
         // FIXME: Do not add new readers if writers are queued.
+        bool acquired = false;
         Mode current_mode = m_mode;
         switch (current_mode) {
         case Mode::Unlocked: {
             dbgln_if(LOCK_TRACE_DEBUG, "Lock::lock @ ({}) {}: acquire {}, currently unlocked", this, m_name, mode_to_string(mode));
             m_mode = mode;
             VERIFY(!m_holder);
+#if LOCK_DEBUG
             VERIFY(m_shared_holders.is_empty());
+#endif
             if (mode == Mode::Exclusive) {
                 m_holder = current_thread;
             } else {
                 VERIFY(mode == Mode::Shared);
+#if LOCK_DEBUG
                 m_shared_holders.set(current_thread, 1);
+#endif
             }
             VERIFY(m_times_locked == 0);
             m_times_locked++;
-#if LOCK_DEBUG
-            current_thread->holding_lock(*this, 1, file, line);
-#endif
             m_queue.should_block(true);
-            m_lock.store(false, AK::memory_order_release);
-            return;
+            acquired = true;
+            break;
         }
         case Mode::Exclusive: {
             VERIFY(m_holder);
             if (m_holder != current_thread)
                 break;
+#if LOCK_DEBUG
             VERIFY(m_shared_holders.is_empty());
+#endif
 
             if constexpr (LOCK_TRACE_DEBUG) {
                 if (mode == Mode::Exclusive)
@@ -95,11 +197,8 @@ void Lock::lock(Mode mode)
             VERIFY(mode == Mode::Exclusive || mode == Mode::Shared);
             VERIFY(m_times_locked > 0);
             m_times_locked++;
-#if LOCK_DEBUG
-            current_thread->holding_lock(*this, 1, file, line);
-#endif
-            m_lock.store(false, AK::memory_order_release);
-            return;
+            acquired = true;
+            break;
         }
         case Mode::Shared: {
             VERIFY(!m_holder);
@@ -110,22 +209,52 @@ void Lock::lock(Mode mode)
 
             VERIFY(m_times_locked > 0);
             m_times_locked++;
+#if LOCK_DEBUG
             VERIFY(!m_shared_holders.is_empty());
             auto it = m_shared_holders.find(current_thread);
             if (it != m_shared_holders.end())
                 it->value++;
             else
                 m_shared_holders.set(current_thread, 1);
+#endif
+            acquired = true;
+            break;
+        }
+        default:
+            VERIFY_NOT_REACHED();
+        }
+
+        if (acquired) {
 #if LOCK_DEBUG
             current_thread->holding_lock(*this, 1, file, line);
 #endif
-            m_lock.store(false, AK::memory_order_release);
+            u32 acquisitions_to_report = 0;
+            if (++m_unreported_acquisitions >= acquisitions_per_report || contended)
+                acquisitions_to_report = exchange(m_unreported_acquisitions, 0);
+            unlock_internal_state();
+            if (acquisitions_to_report > 0) {
+                u64 wait_ns = contended && wait_start ? lock_wait_timestamp() - wait_start : 0;
+                report_statistics(acquisitions_to_report, contended, acquired_by_spinning, wait_ns);
+            }
             return;
         }
-        default:
-            VERIFY_NOT_REACHED();
+
+        if (!contended) {
+            contended = true;
+            wait_start = lock_wait_timestamp();
+        }
+
+        // If the lock is held exclusively by a thread that is currently
+        // running, it is likely to be released before we could even finish
+        // blocking, so spin for a while first.
+        RefPtr<Thread> holder = m_holder;
+        unlock_internal_state();
+        if (holder && spin_while_held_by(*holder)) {
+            acquired_by_spinning = true;
+            continue;
         }
-        m_lock.store(false, AK::memory_order_release);
+        acquired_by_spinning = false;
+
         dbgln_if(LOCK_TRACE_DEBUG, "Lock::lock @ {} ({}) waiting...", this, m_name);
         m_queue.wait_forever(m_name);
         dbgln_if(LOCK_TRACE_DEBUG, "Lock::lock @ {} ({}) waited", this, m_name);
@@ -139,64 +268,66 @@ void Lock::unlock()
     VERIFY(!Processor::current().in_irq());
     auto current_thread = Thread::current();
     ScopedCritical critical; // in case we're not in a critical section already
-    for (;;) {
-        if (m_lock.exchange(true, AK::memory_order_acq_rel) == false) {
-            Mode current_mode = m_mode;
-            if constexpr (LOCK_TRACE_DEBUG) {
-                if (current_mode == Mode::Shared)
-                    dbgln("Lock::unlock @ {} ({}): release {}, locks held: {}", this, m_name, mode_to_string(current_mode), m_times_locked);
-                else
-                    dbgln("Lock::unlock @ {} ({}): release {}, holding: {}", this, m_name, mode_to_string(current_mode), m_times_locked);
-            }
+    lock_internal_state();
 
-            VERIFY(current_mode != Mode::Unlocked);
+    Mode current_mode = m_mode;
+    if constexpr (LOCK_TRACE_DEBUG) {
+        if (current_mode == Mode::Shared)
+            dbgln("Lock::unlock @ {} ({}): release {}, locks held: {}", this, m_name, mode_to_string(current_mode), m_times_locked);
+        else
+            dbgln("Lock::unlock @ {} ({}): release {}, holding: {}", this, m_name, mode_to_string(current_mode), m_times_locked);
+    }
 
-            VERIFY(m_times_locked > 0);
-            m_times_locked--;
-
-            switch (current_mode) {
-            case Mode::Exclusive:
-                VERIFY(m_holder == current_thread);
-                VERIFY(m_shared_holders.is_empty());
-                if (m_times_locked == 0)
-                    m_holder = nullptr;
-                break;
-            case Mode::Shared: {
-                VERIFY(!m_holder);
-                auto it = m_shared_holders.find(current_thread);
-                VERIFY(it != m_shared_holders.end());
-                if (it->value > 1) {
-                    it->value--;
-                } else {
-                    VERIFY(it->value > 0);
-                    m_shared_holders.remove(it);
-                }
-                break;
-            }
-            default:
-                VERIFY_NOT_REACHED();
-            }
+    VERIFY(current_mode != Mode::Unlocked);
 
-            bool unlocked_last = (m_times_locked == 0);
-            if (unlocked_last) {
-                VERIFY(current_mode == Mode::Exclusive ? !m_holder : m_shared_holders.is_empty());
-                m_mode = Mode::Unlocked;
-                m_queue.should_block(false);
-            }
+    VERIFY(m_times_locked > 0);
+    m_times_locked--;
 
+    switch (current_mode) {
+    case Mode::Exclusive:
+        VERIFY(m_holder == current_thread);
 #if LOCK_DEBUG
-            current_thread->holding_lock(*this, -1);
+        VERIFY(m_shared_holders.is_empty());
 #endif
-
-            m_lock.store(false, AK::memory_order_release);
-            if (unlocked_last) {
-                u32 did_wake = m_queue.wake_one();
-                dbgln_if(LOCK_TRACE_DEBUG, "Lock::unlock @ {} ({})  wake one ({})", this, m_name, did_wake);
-            }
-            return;
+        if (m_times_locked == 0)
+            m_holder = nullptr;
+        break;
+    case Mode::Shared: {
+        VERIFY(!m_holder);
+#if LOCK_DEBUG
+        auto it = m_shared_holders.find(current_thread);
+        VERIFY(it != m_shared_holders.end());
+        if (it->value > 1) {
+            it->value--;
+        } else {
+            VERIFY(it->value > 0);
+            m_shared_holders.remove(it);
         }
-        // I don't know *who* is using "m_lock", so just yield.
-        Scheduler::yield_from_critical();
+#endif
+        break;
+    }
+    default:
+        VERIFY_NOT_REACHED();
+    }
+
+    bool unlocked_last = (m_times_locked == 0);
+    if (unlocked_last) {
+        VERIFY(!m_holder);
+#if LOCK_DEBUG
+        VERIFY(m_shared_holders.is_empty());
+#endif
+        m_mode = Mode::Unlocked;
+        m_queue.should_block(false);
+    }
+
+#if LOCK_DEBUG
+    current_thread->holding_lock(*this, -1);
+#endif
+
+    unlock_internal_state();
+    if (unlocked_last) {
+        u32 did_wake = m_queue.wake_one();
+        dbgln_if(LOCK_TRACE_DEBUG, "Lock::unlock @ {} ({})  wake one ({})", this, m_name, did_wake);
     }
 }
 
@@ -207,76 +338,78 @@ auto Lock::force_unlock_if_locked(u32& lock_count_to_restore) -> Mode
     VERIFY(!Processor::current().in_irq());
     auto current_thread = Thread::current();
     ScopedCritical critical; // in case we're not in a critical section already
-    for (;;) {
-        if (m_lock.exchange(true, AK::memory_order_acq_rel) == false) {
-            Mode previous_mode;
-            auto current_mode = m_mode.load(AK::MemoryOrder::memory_order_relaxed);
-            switch (current_mode) {
-            case Mode::Exclusive: {
-                if (m_holder != current_thread) {
-                    m_lock.store(false, AK::MemoryOrder::memory_order_release);
-                    lock_count_to_restore = 0;
-                    return Mode::Unlocked;
-                }
-
-                dbgln_if(LOCK_RESTORE_DEBUG, "Lock::force_unlock_if_locked @ {}: unlocking exclusive with lock count: {}", this, m_times_locked);
+    lock_internal_state();
+
+    Mode previous_mode;
+    auto current_mode = m_mode.load(AK::MemoryOrder::memory_order_relaxed);
+    switch (current_mode) {
+    case Mode::Exclusive: {
+        if (m_holder != current_thread) {
+            unlock_internal_state();
+            lock_count_to_restore = 0;
+            return Mode::Unlocked;
+        }
+
+        dbgln_if(LOCK_RESTORE_DEBUG, "Lock::force_unlock_if_locked @ {}: unlocking exclusive with lock count: {}", this, m_times_locked);
 #if LOCK_DEBUG
-                m_holder->holding_lock(*this, -(int)lock_count_to_restore);
+        m_holder->holding_lock(*this, -(int)m_times_locked);
 #endif
-                m_holder = nullptr;
-                VERIFY(m_times_locked > 0);
-                lock_count_to_restore = m_times_locked;
-                m_times_locked = 0;
-                m_mode = Mode::Unlocked;
-                m_queue.should_block(false);
-                m_lock.store(false, AK::memory_order_release);
-                previous_mode = Mode::Exclusive;
-                break;
-            }
-            case Mode::Shared: {
-                VERIFY(!m_holder);
-                auto it = m_shared_holders.find(current_thread);
-                if (it == m_shared_holders.end()) {
-                    m_lock.store(false, AK::MemoryOrder::memory_order_release);
-                    lock_count_to_restore = 0;
-                    return Mode::Unlocked;
-                }
-
-                dbgln_if(LOCK_RESTORE_DEBUG, "Lock::force_unlock_if_locked @ {}: unlocking exclusive with lock count: {}, total locks: {}",
-                    this, it->value, m_times_locked);
-
-                VERIFY(it->value > 0);
-                lock_count_to_restore = it->value;
-                VERIFY(lock_count_to_restore > 0);
+        m_holder = nullptr;
+        VERIFY(m_times_locked > 0);
+        lock_count_to_restore = m_times_locked;
+        m_times_locked = 0;
+        m_mode = Mode::Unlocked;
+        m_queue.should_block(false);
+        unlock_internal_state();
+        previous_mode = Mode::Exclusive;
+        break;
+    }
+    case Mode::Shared: {
+        VERIFY(!m_holder);
 #if LOCK_DEBUG
-                m_holder->holding_lock(*this, -(int)lock_count_to_restore);
-#endif
-                m_shared_holders.remove(it);
-                VERIFY(m_times_locked >= lock_count_to_restore);
-                m_times_locked -= lock_count_to_restore;
-                if (m_times_locked == 0) {
-                    m_mode = Mode::Unlocked;
-                    m_queue.should_block(false);
-                }
-                m_lock.store(false, AK::memory_order_release);
-                previous_mode = Mode::Shared;
-                break;
-            }
-            case Mode::Unlocked: {
-                m_lock.store(false, AK::memory_order_relaxed);
-                lock_count_to_restore = 0;
-                previous_mode = Mode::Unlocked;
-                break;
-            }
-            default:
-                VERIFY_NOT_REACHED();
-            }
-            m_queue.wake_one();
-            return previous_mode;
+        auto it = m_shared_holders.find(current_thread);
+        if (it == m_shared_holders.end()) {
+            unlock_internal_state();
+            lock_count_to_restore = 0;
+            return Mode::Unlocked;
         }
-        // I don't know *who* is using "m_lock", so just yield.
-        Scheduler::yield_from_critical();
+
+        dbgln_if(LOCK_RESTORE_DEBUG, "Lock::force_unlock_if_locked @ {}: unlocking shared with lock count: {}, total locks: {}",
+            this, it->value, m_times_locked);
+
+        VERIFY(it->value > 0);
+        lock_count_to_restore = it->value;
+        current_thread->holding_lock(*this, -(int)lock_count_to_restore);
+        m_shared_holders.remove(it);
+        VERIFY(m_times_locked >= lock_count_to_restore);
+        m_times_locked -= lock_count_to_restore;
+        if (m_times_locked == 0) {
+            m_mode = Mode::Unlocked;
+            m_queue.should_block(false);
+        }
+        unlock_internal_state();
+        previous_mode = Mode::Shared;
+        break;
+#else
+        // NOTE: Without LOCK_DEBUG we don't know which threads hold the lock
+        //       in shared mode. This is only used for the big lock, which is
+        //       never taken shared, so treat it as not held by us.
+        unlock_internal_state();
+        lock_count_to_restore = 0;
+        return Mode::Unlocked;
+#endif
+    }
+    case Mode::Unlocked: {
+        unlock_internal_state();
+        lock_count_to_restore = 0;
+        previous_mode = Mode::Unlocked;
+        break;
     }
+    default:
+        VERIFY_NOT_REACHED();
+    }
+    m_queue.wake_one();
+    return previous_mode;
 }
 
 #if LOCK_DEBUG
@@ -296,56 +429,59 @@ void Lock::restore_lock(Mode mode, u32 lock_count)
     auto current_thread = Thread::current();
     ScopedCritical critical; // in case we're not in a critical section already
     for (;;) {
-        if (m_lock.exchange(true, AK::memory_order_acq_rel) == false) {
-            switch (mode) {
-            case Mode::Exclusive: {
-                auto expected_mode = Mode::Unlocked;
-                if (!m_mode.compare_exchange_strong(expected_mode, Mode::Exclusive))
-                    break;
-
-                dbgln_if(LOCK_RESTORE_DEBUG, "Lock::restore_lock @ {}: restoring {} with lock count {}, was unlocked", this, mode_to_string(mode), lock_count);
-
-                VERIFY(m_times_locked == 0);
-                m_times_locked = lock_count;
-                VERIFY(!m_holder);
-                VERIFY(m_shared_holders.is_empty());
-                m_holder = current_thread;
-                m_queue.should_block(true);
-                m_lock.store(false, AK::memory_order_release);
+        lock_internal_state();
+        switch (mode) {
+        case Mode::Exclusive: {
+            auto expected_mode = Mode::Unlocked;
+            if (!m_mode.compare_exchange_strong(expected_mode, Mode::Exclusive))
+                break;
+
+            dbgln_if(LOCK_RESTORE_DEBUG, "Lock::restore_lock @ {}: restoring {} with lock count {}, was unlocked", this, mode_to_string(mode), lock_count);
+
+            VERIFY(m_times_locked == 0);
+            m_times_locked = lock_count;
+            VERIFY(!m_holder);
 #if LOCK_DEBUG
-                m_holder->holding_lock(*this, (int)lock_count, file, line);
+            VERIFY(m_shared_holders.is_empty());
 #endif
-                return;
-            }
-            case Mode::Shared: {
-                auto expected_mode = Mode::Unlocked;
-                if (!m_mode.compare_exchange_strong(expected_mode, Mode::Shared) && expected_mode != Mode::Shared)
-                    break;
-
-                dbgln_if(LOCK_RESTORE_DEBUG, "Lock::restore_lock @ {}: restoring {} with lock count {}, was {}",
-                    this, mode_to_string(mode), lock_count, mode_to_string(expected_mode));
-
-                VERIFY(expected_mode == Mode::Shared || m_times_locked == 0);
-                m_times_locked += lock_count;
-                VERIFY(!m_holder);
-                VERIFY((expected_mode == Mode::Unlocked) == m_shared_holders.is_empty());
-                auto set_result = m_shared_holders.set(current_thread, lock_count);
-                // There may be other shared lock holders already, but we should not have an entry yet
-                VERIFY(set_result == AK::HashSetResult::InsertedNewEntry);
-                m_queue.should_block(true);
-                m_lock.store(false, AK::memory_order_release);
+            m_holder = current_thread;
+            m_queue.should_block(true);
+            unlock_internal_state();
 #if LOCK_DEBUG
-                m_holder->holding_lock(*this, (int)lock_count, file, line);
+            m_holder->holding_lock(*this, (int)lock_count, file, line);
 #endif
-                return;
-            }
-            default:
-                VERIFY_NOT_REACHED();
-            }
+            return;
+        }
+        case Mode::Shared: {
+            auto expected_mode = Mode::Unlocked;
+            if (!m_mode.compare_exchange_strong(expected_mode, Mode::Shared) && expected_mode != Mode::Shared)
+                break;
 
-            m_lock.store(false, AK::memory_order_relaxed);
+            dbgln_if(LOCK_RESTORE_DEBUG, "Lock::restore_lock @ {}: restoring {} with lock count {}, was {}",
+                this, mode_to_string(mode), lock_count, mode_to_string(expected_mode));
+
+            VERIFY(expected_mode == Mode::Shared || m_times_locked == 0);
+            m_times_locked += lock_count;
+            VERIFY(!m_holder);
+#if LOCK_DEBUG
+            VERIFY((expected_mode == Mode::Unlocked) == m_shared_holders.is_empty());
+            auto set_result = m_shared_holders.set(current_thread, lock_count);
+            // There may be other shared lock holders already, but we should not have an entry yet
+            VERIFY(set_result == AK::HashSetResult::InsertedNewEntry);
+#endif
+            m_queue.should_block(true);
+            unlock_internal_state();
+#if LOCK_DEBUG
+            current_thread->holding_lock(*this, (int)lock_count, file, line);
+#endif
+            return;
         }
-        // I don't know *who* is using "m_lock", so just yield.
+        default:
+            VERIFY_NOT_REACHED();
+        }
+
+        unlock_internal_state();
+        // The lock is held by someone else, so wait for our turn.
         Scheduler::yield_from_critical();
     }
 }
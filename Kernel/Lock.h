@@ -37,6 +37,16 @@
 
 namespace Kernel {
 
+// Contention statistics, aggregated over all locks with the same name.
+struct LockStatistics {
+    const char* name { nullptr };
+    u64 acquisitions { 0 };
+    u64 contentions { 0 };
+    u64 spin_acquisitions { 0 };
+    u64 total_wait_ns { 0 };
+    u64 max_wait_ns { 0 };
+};
+
 class Lock {
     AK_MAKE_NONCOPYABLE(Lock);
     AK_MAKE_NONMOVABLE(Lock);
@@ -48,7 +58,7 @@ public:
         : m_name(name)
     {
     }
-    ~Lock() = default;
+    ~Lock();
 
     void lock(Mode = Mode::Exclusive);
 #if LOCK_DEBUG
@@ -63,6 +73,8 @@ public:
 
     [[nodiscard]] const char* name() const { return m_name; }
 
+    static Vector<LockStatistics> statistics();
+
     static const char* mode_to_string(Mode mode)
     {
         switch (mode) {
@@ -78,6 +90,16 @@ public:
     }
 
 private:
+    // How many times we check whether a running lock holder is done before we go to sleep.
+    static constexpr u32 max_spin_iterations = 1000;
+    // Acquisitions are counted locally and added to the statistics in batches of this size.
+    static constexpr u32 acquisitions_per_report = 64;
+
+    void lock_internal_state();
+    void unlock_internal_state() { m_lock.store(false, AK::memory_order_release); }
+    bool spin_while_held_by(Thread&);
+    void report_statistics(u32 acquisitions, bool contended, bool acquired_by_spinning, u64 wait_ns);
+
     Atomic<bool> m_lock { false };
     const char* m_name { nullptr };
     WaitQueue m_queue;
@@ -87,13 +109,17 @@ private:
     // lock it again. When locked in shared mode, any thread can do that.
     u32 m_times_locked { 0 };
 
-    // One of the threads that hold this lock, or nullptr. When locked in shared
-    // mode, this is stored on best effort basis: nullptr value does *not* mean
-    // the lock is unlocked, it just means we don't know which threads hold it.
-    // When locked exclusively, this is always the one thread that holds the
-    // lock.
+    // The thread that holds this lock exclusively, or nullptr.
     RefPtr<Thread> m_holder;
+
+    // Shared holders are only tracked individually to catch bugs. Otherwise,
+    // the number of times the lock is held is all we need to know.
+#if LOCK_DEBUG
     HashMap<Thread*, u32> m_shared_holders;
+#endif
+
+    LockStatistics* m_statistics { nullptr };
+    u32 m_unreported_acquisitions { 0 };
 };
 
 class Locker {
@@ -25,8 +25,11 @@
  */
 
 #include <AK/MACAddress.h>
+#include <Kernel/CommandLine.h>
 #include <Kernel/Debug.h>
 #include <Kernel/Net/E1000NetworkAdapter.h>
+#include <Kernel/Process.h>
+#include <Kernel/VM/PhysicalZone.h>
 
 namespace Kernel {
 
@@ -137,6 +140,13 @@ namespace Kernel {
 #define INTERRUPT_TXD_LOW (1 << 15)
 #define INTERRUPT_SRPD (1 << 16)
 
+#define RECEIVE_INTERRUPTS (INTERRUPT_RXDMT0 | INTERRUPT_RXO | INTERRUPT_RXT0)
+
+// Receive Descriptor Status
+
+#define RSTA_DD (1 << 0)  // Descriptor Done
+#define RSTA_EOP (1 << 1) // End of Packet
+
 // https://www.intel.com/content/dam/doc/manual/pci-pci-x-family-gbe-controllers-software-dev-manual.pdf Section 5.2
 static bool is_valid_device_id(u16 device_id)
 {
@@ -175,6 +185,15 @@ static bool is_valid_device_id(u16 device_id)
     }
 }
 
+// The descriptor ring length has to be a multiple of 128 bytes, and the buffers
+// for all descriptors have to fit into a single contiguous physical allocation.
+static size_t descriptor_count(size_t requested_count, size_t buffer_size)
+{
+    constexpr size_t max_contiguous_size = PAGE_SIZE << PhysicalZone::max_order;
+    auto max_count = min((size_t)4096, max_contiguous_size / buffer_size);
+    return clamp((size_t)round_up_to_power_of_two(requested_count, 8), (size_t)8, max_count);
+}
+
 UNMAP_AFTER_INIT void E1000NetworkAdapter::detect()
 {
     PCI::enumerate([&](const PCI::Address& address, PCI::ID id) {
@@ -191,9 +210,11 @@ UNMAP_AFTER_INIT void E1000NetworkAdapter::detect()
 
 UNMAP_AFTER_INIT E1000NetworkAdapter::E1000NetworkAdapter(PCI::Address address, u8 irq)
     : PCI::Device(address, irq)
+    , m_number_of_rx_descriptors(descriptor_count(kernel_command_line().e1000_rx_descriptors(), rx_buffer_size))
+    , m_number_of_tx_descriptors(descriptor_count(kernel_command_line().e1000_tx_descriptors(), tx_buffer_size))
     , m_io_base(PCI::get_BAR1(pci_address()) & ~1)
-    , m_rx_descriptors_region(MM.allocate_contiguous_kernel_region(page_round_up(sizeof(e1000_rx_desc) * number_of_rx_descriptors + 16), "E1000 RX", Region::Access::Read | Region::Access::Write))
-    , m_tx_descriptors_region(MM.allocate_contiguous_kernel_region(page_round_up(sizeof(e1000_tx_desc) * number_of_tx_descriptors + 16), "E1000 TX", Region::Access::Read | Region::Access::Write))
+    , m_rx_descriptors_region(MM.allocate_contiguous_kernel_region(page_round_up(sizeof(e1000_rx_desc) * m_number_of_rx_descriptors + 16), "E1000 RX", Region::Access::Read | Region::Access::Write))
+    , m_tx_descriptors_region(MM.allocate_contiguous_kernel_region(page_round_up(sizeof(e1000_tx_desc) * m_number_of_tx_descriptors + 16), "E1000 TX", Region::Access::Read | Region::Access::Write))
 {
     set_interface_name("e1k");
 
@@ -210,6 +231,7 @@ UNMAP_AFTER_INIT E1000NetworkAdapter::E1000NetworkAdapter(PCI::Address address,
     dmesgln("E1000: MMIO base: {}", PhysicalAddress(PCI::get_BAR0(pci_address()) & 0xfffffffc));
     dmesgln("E1000: MMIO base size: {} bytes", mmio_base_size);
     dmesgln("E1000: Interrupt line: {}", m_interrupt_line);
+    dmesgln("E1000: {} RX and {} TX descriptors", m_number_of_rx_descriptors, m_number_of_tx_descriptors);
     detect_eeprom();
     dmesgln("E1000: Has EEPROM? {}", m_has_eeprom);
     read_mac_address();
@@ -219,13 +241,22 @@ UNMAP_AFTER_INIT E1000NetworkAdapter::E1000NetworkAdapter(PCI::Address address,
     u32 flags = in32(REG_CTRL);
     out32(REG_CTRL, flags | ECTRL_SLU);
 
-    out32(REG_INTERRUPT_RATE, 6000); // Interrupt rate of 1.536 milliseconds
+    // The interrupt throttling register counts in units of 256ns. While the
+    // NetworkTask polls the receive ring it keeps the receive interrupt
+    // masked anyway, so this mostly limits interrupts at moderate rates.
+    auto interrupt_rate = kernel_command_line().e1000_interrupt_rate();
+    u32 interrupt_interval = interrupt_rate ? min(1'000'000'000 / (interrupt_rate * 256), (size_t)0xffff) : 0;
+    out32(REG_INTERRUPT_RATE, interrupt_interval);
+    // Don't delay receive interrupts any further, the throttling takes care of that.
+    out32(REG_RDTR, 0);
+    out32(REG_RADV, 0);
+    dmesgln("E1000: Interrupt throttling interval: {} ns", interrupt_interval * 256);
 
     initialize_rx_descriptors();
     initialize_tx_descriptors();
 
-    out32(REG_INTERRUPT_MASK_SET, 0x1f6dc);
-    out32(REG_INTERRUPT_MASK_SET, INTERRUPT_LSC | INTERRUPT_RXT0);
+    out32(REG_INTERRUPT_MASK_CLEAR, 0xffffffff);
+    out32(REG_INTERRUPT_MASK_SET, INTERRUPT_LSC | RECEIVE_INTERRUPTS);
     in32(REG_INTERRUPT_CAUSE_READ);
 
     enable_irq();
@@ -237,26 +268,39 @@ UNMAP_AFTER_INIT E1000NetworkAdapter::~E1000NetworkAdapter()
 
 void E1000NetworkAdapter::handle_irq(const RegisterState&)
 {
-    out32(REG_INTERRUPT_MASK_CLEAR, 0xffffffff);
-
+    // NOTE: Reading the interrupt cause register clears it.
     u32 status = in32(REG_INTERRUPT_CAUSE_READ);
+    if (!status)
+        return;
 
+    did_interrupt();
     m_entropy_source.add_random_event(status);
 
-    if (status & 4) {
+    if (status & INTERRUPT_LSC) {
         u32 flags = in32(REG_CTRL);
         out32(REG_CTRL, flags | ECTRL_SLU);
     }
-    if (status & 0x80) {
-        receive();
+    if (status & RECEIVE_INTERRUPTS) {
+        // Leave the packets in the ring and let the NetworkTask pick them up.
+        // We won't hear about new ones until it has drained the ring.
+        disable_receive_interrupts();
+        schedule_receive_poll();
     }
-    if (status & 0x10) {
-        // Threshold OK?
+    if (status & INTERRUPT_TXDW) {
+        // Someone is waiting for transmit descriptors to free up.
+        out32(REG_INTERRUPT_MASK_CLEAR, INTERRUPT_TXDW);
+        m_wait_queue.wake_all();
     }
+}
 
-    m_wait_queue.wake_all();
+void E1000NetworkAdapter::enable_receive_interrupts()
+{
+    out32(REG_INTERRUPT_MASK_SET, RECEIVE_INTERRUPTS);
+}
 
-    out32(REG_INTERRUPT_MASK_SET, INTERRUPT_LSC | INTERRUPT_RXT0 | INTERRUPT_RXO);
+void E1000NetworkAdapter::disable_receive_interrupts()
+{
+    out32(REG_INTERRUPT_MASK_CLEAR, RECEIVE_INTERRUPTS);
 }
 
 UNMAP_AFTER_INIT void E1000NetworkAdapter::detect_eeprom()
@@ -315,40 +359,44 @@ bool E1000NetworkAdapter::link_up()
 
 UNMAP_AFTER_INIT void E1000NetworkAdapter::initialize_rx_descriptors()
 {
-    auto* rx_descriptors = (e1000_tx_desc*)m_rx_descriptors_region->vaddr().as_ptr();
-    for (size_t i = 0; i < number_of_rx_descriptors; ++i) {
+    auto* rx_descriptors = (e1000_rx_desc*)m_rx_descriptors_region->vaddr().as_ptr();
+    // Long packets aren't enabled, so the largest frame we receive is 1522 bytes.
+    m_rx_buffers_region = MM.allocate_contiguous_kernel_region(page_round_up(rx_buffer_size * m_number_of_rx_descriptors), "E1000 RX buffers", Region::Access::Read | Region::Access::Write);
+    VERIFY(m_rx_buffers_region);
+    auto rx_buffers_base = m_rx_buffers_region->physical_page(0)->paddr();
+    for (size_t i = 0; i < m_number_of_rx_descriptors; ++i) {
         auto& descriptor = rx_descriptors[i];
-        auto region = MM.allocate_contiguous_kernel_region(8192, "E1000 RX buffer", Region::Access::Read | Region::Access::Write);
-        VERIFY(region);
-        m_rx_buffers_regions.append(region.release_nonnull());
-        descriptor.addr = m_rx_buffers_regions[i].physical_page(0)->paddr().get();
+        descriptor.addr = rx_buffers_base.offset(i * rx_buffer_size).get();
         descriptor.status = 0;
     }
+    m_rx_current = 0;
 
     out32(REG_RXDESCLO, m_rx_descriptors_region->physical_page(0)->paddr().get());
     out32(REG_RXDESCHI, 0);
-    out32(REG_RXDESCLEN, number_of_rx_descriptors * sizeof(e1000_rx_desc));
+    out32(REG_RXDESCLEN, m_number_of_rx_descriptors * sizeof(e1000_rx_desc));
     out32(REG_RXDESCHEAD, 0);
-    out32(REG_RXDESCTAIL, number_of_rx_descriptors - 1);
+    out32(REG_RXDESCTAIL, m_number_of_rx_descriptors - 1);
 
-    out32(REG_RCTRL, RCTL_EN | RCTL_SBP | RCTL_UPE | RCTL_MPE | RCTL_LBM_NONE | RTCL_RDMTS_HALF | RCTL_BAM | RCTL_SECRC | RCTL_BSIZE_8192);
+    out32(REG_RCTRL, RCTL_EN | RCTL_SBP | RCTL_UPE | RCTL_MPE | RCTL_LBM_NONE | RTCL_RDMTS_HALF | RCTL_BAM | RCTL_SECRC | RCTL_BSIZE_2048);
 }
 
 UNMAP_AFTER_INIT void E1000NetworkAdapter::initialize_tx_descriptors()
 {
     auto* tx_descriptors = (e1000_tx_desc*)m_tx_descriptors_region->vaddr().as_ptr();
-    for (size_t i = 0; i < number_of_tx_descriptors; ++i) {
+    m_tx_buffers_region = MM.allocate_contiguous_kernel_region(page_round_up(tx_buffer_size * m_number_of_tx_descriptors), "E1000 TX buffers", Region::Access::Read | Region::Access::Write);
+    VERIFY(m_tx_buffers_region);
+    auto tx_buffers_base = m_tx_buffers_region->physical_page(0)->paddr();
+    for (size_t i = 0; i < m_number_of_tx_descriptors; ++i) {
         auto& descriptor = tx_descriptors[i];
-        auto region = MM.allocate_contiguous_kernel_region(8192, "E1000 TX buffer", Region::Access::Read | Region::Access::Write);
-        VERIFY(region);
-        m_tx_buffers_regions.append(region.release_nonnull());
-        descriptor.addr = m_tx_buffers_regions[i].physical_page(0)->paddr().get();
+        descriptor.addr = tx_buffers_base.offset(i * tx_buffer_size).get();
         descriptor.cmd = 0;
     }
+    m_tx_tail = 0;
+    m_tx_clean = 0;
 
     out32(REG_TXDESCLO, m_tx_descriptors_region->physical_page(0)->paddr().get());
     out32(REG_TXDESCHI, 0);
-    out32(REG_TXDESCLEN, number_of_tx_descriptors * sizeof(e1000_tx_desc));
+    out32(REG_TXDESCLEN, m_number_of_tx_descriptors * sizeof(e1000_tx_desc));
     out32(REG_TXDESCHEAD, 0);
     out32(REG_TXDESCTAIL, 0);
 
@@ -415,50 +463,95 @@ u32 E1000NetworkAdapter::in32(u16 address)
 
 void E1000NetworkAdapter::send_raw(ReadonlyBytes payload)
 {
-    disable_irq();
-    size_t tx_current = in32(REG_TXDESCTAIL) % number_of_tx_descriptors;
-    dbgln_if(E1000_DEBUG, "E1000: Sending packet ({} bytes)", payload.size());
+    VERIFY(payload.size() <= tx_buffer_size);
+    LOCKER(m_tx_lock);
+
+    // Wait for the hardware to be done with the oldest descriptor if we're out of them.
+    while (!reclaim_tx_descriptors()) {
+        // The hardware can't make progress on descriptors it doesn't know about yet.
+        flush_transmit();
+        out32(REG_INTERRUPT_MASK_SET, INTERRUPT_TXDW);
+        if (reclaim_tx_descriptors())
+            break;
+        dbgln_if(E1000_DEBUG, "E1000: Out of tx descriptors, waiting");
+        m_wait_queue.wait_forever("E1000NetworkAdapter");
+    }
+
+    auto tx_current = m_tx_tail;
+    dbgln_if(E1000_DEBUG, "E1000: Sending packet ({} bytes) using tx descriptor {}", payload.size(), tx_current);
     auto* tx_descriptors = (e1000_tx_desc*)m_tx_descriptors_region->vaddr().as_ptr();
     auto& descriptor = tx_descriptors[tx_current];
-    VERIFY(payload.size() <= 8192);
-    auto* vptr = (void*)m_tx_buffers_regions[tx_current].vaddr().as_ptr();
+    auto* vptr = m_tx_buffers_region->vaddr().offset(tx_current * tx_buffer_size).as_ptr();
     memcpy(vptr, payload.data(), payload.size());
     descriptor.length = payload.size();
     descriptor.status = 0;
     descriptor.cmd = CMD_EOP | CMD_IFCS | CMD_RS;
-    dbgln_if(E1000_DEBUG, "E1000: Using tx descriptor {} (head is at {})", tx_current, in32(REG_TXDESCHEAD));
-    tx_current = (tx_current + 1) % number_of_tx_descriptors;
-    cli();
-    enable_irq();
-    out32(REG_TXDESCTAIL, tx_current);
-    for (;;) {
-        if (descriptor.status) {
-            sti();
-            break;
-        }
-        m_wait_queue.wait_forever("E1000NetworkAdapter");
-    }
-    dbgln_if(E1000_DEBUG, "E1000: Sent packet, status is now {:#02x}!", (u8)descriptor.status);
+    m_tx_tail = (tx_current + 1) % m_number_of_tx_descriptors;
+
+    // Writing the tail register is expensive, so we only do it once per batch.
+    m_tx_tail_dirty = true;
+    if (!is_batching_transmits())
+        flush_transmit();
 }
 
-void E1000NetworkAdapter::receive()
+void E1000NetworkAdapter::flush_transmit()
 {
-    auto* rx_descriptors = (e1000_tx_desc*)m_rx_descriptors_region->vaddr().as_ptr();
-    u32 rx_current;
+    LOCKER(m_tx_lock);
+    if (!m_tx_tail_dirty)
+        return;
+    m_tx_tail_dirty = false;
+    full_memory_barrier();
+    out32(REG_TXDESCTAIL, m_tx_tail);
+}
+
+bool E1000NetworkAdapter::reclaim_tx_descriptors()
+{
+    VERIFY(m_tx_lock.is_locked());
+    auto* tx_descriptors = (e1000_tx_desc*)m_tx_descriptors_region->vaddr().as_ptr();
+    while (m_tx_clean != m_tx_tail && (tx_descriptors[m_tx_clean].status & TSTA_DD))
+        m_tx_clean = (m_tx_clean + 1) % m_number_of_tx_descriptors;
+    // One descriptor always stays unused, otherwise a full ring would look empty.
+    return (m_tx_tail + 1) % m_number_of_tx_descriptors != m_tx_clean;
+}
+
+size_t E1000NetworkAdapter::receive_batch(size_t budget, ReceiveCallback& callback)
+{
+    auto* rx_descriptors = (e1000_rx_desc*)m_rx_descriptors_region->vaddr().as_ptr();
+    auto timestamp = kgettimeofday();
+    size_t received = 0;
     for (;;) {
-        rx_current = in32(REG_RXDESCTAIL) % number_of_rx_descriptors;
-        if (rx_current == (in32(REG_RXDESCHEAD) % number_of_rx_descriptors))
-            return;
-        rx_current = (rx_current + 1) % number_of_rx_descriptors;
-        if (!(rx_descriptors[rx_current].status & 1))
-            break;
-        auto* buffer = m_rx_buffers_regions[rx_current].vaddr().as_ptr();
-        u16 length = rx_descriptors[rx_current].length;
-        VERIFY(length <= 8192);
-        dbgln_if(E1000_DEBUG, "E1000: Received 1 packet @ {:p} ({} bytes)", buffer, length);
-        did_receive({ buffer, length });
-        rx_descriptors[rx_current].status = 0;
-        out32(REG_RXDESCTAIL, rx_current);
+        size_t received_before = received;
+        while (received < budget) {
+            auto& descriptor = rx_descriptors[m_rx_current];
+            if (!(descriptor.status & RSTA_DD))
+                break;
+            auto* buffer = m_rx_buffers_region->vaddr().offset(m_rx_current * rx_buffer_size).as_ptr();
+            u16 length = descriptor.length;
+            VERIFY(length <= rx_buffer_size);
+            // Frames never span multiple buffers since long packets are disabled.
+            if ((descriptor.status & RSTA_EOP) && !descriptor.errors) {
+                dbgln_if(E1000_DEBUG, "E1000: Received 1 packet @ {:p} ({} bytes)", buffer, length);
+                did_receive_polled(length);
+                callback({ buffer, length }, timestamp);
+            }
+            descriptor.status = 0;
+            m_rx_current = (m_rx_current + 1) % m_number_of_rx_descriptors;
+            ++received;
+        }
+
+        // Hand all the descriptors we're done with back to the hardware at once.
+        if (received != received_before)
+            out32(REG_RXDESCTAIL, (m_rx_current + m_number_of_rx_descriptors - 1) % m_number_of_rx_descriptors);
+
+        if (received == budget)
+            return received;
+
+        // We drained the ring, so go back to waiting for the interrupt. A packet
+        // may have arrived right before we unmasked it, so check once more.
+        enable_receive_interrupts();
+        if (!(rx_descriptors[m_rx_current].status & RSTA_DD))
+            return received;
+        disable_receive_interrupts();
     }
 }
 
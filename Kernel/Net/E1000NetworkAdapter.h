@@ -26,10 +26,10 @@
 
 #pragma once
 
-#include <AK/NonnullOwnPtrVector.h>
 #include <AK/OwnPtr.h>
 #include <Kernel/IO.h>
 #include <Kernel/Interrupts/IRQHandler.h>
+#include <Kernel/Lock.h>
 #include <Kernel/Net/NetworkAdapter.h>
 #include <Kernel/PCI/Access.h>
 #include <Kernel/PCI/Device.h>
@@ -53,6 +53,8 @@ public:
 private:
     virtual void handle_irq(const RegisterState&) override;
     virtual const char* class_name() const override { return "E1000NetworkAdapter"; }
+    virtual size_t receive_batch(size_t budget, ReceiveCallback&) override;
+    virtual void flush_transmit() override;
 
     struct [[gnu::packed]] e1000_rx_desc {
         volatile uint64_t addr { 0 };
@@ -90,22 +92,37 @@ private:
     u16 in16(u16 address);
     u32 in32(u16 address);
 
-    void receive();
+    void enable_receive_interrupts();
+    void disable_receive_interrupts();
+    bool reclaim_tx_descriptors();
+
+    static constexpr size_t rx_buffer_size = 2048;
+    // Large enough for a full Ethernet frame.
+    static constexpr size_t tx_buffer_size = 2048;
+
+    size_t m_number_of_rx_descriptors { 0 };
+    size_t m_number_of_tx_descriptors { 0 };
 
     IOAddress m_io_base;
     VirtualAddress m_mmio_base;
     OwnPtr<Region> m_rx_descriptors_region;
     OwnPtr<Region> m_tx_descriptors_region;
-    NonnullOwnPtrVector<Region> m_rx_buffers_regions;
-    NonnullOwnPtrVector<Region> m_tx_buffers_regions;
+    OwnPtr<Region> m_rx_buffers_region;
+    OwnPtr<Region> m_tx_buffers_region;
     OwnPtr<Region> m_mmio_region;
     u8 m_interrupt_line { 0 };
     bool m_has_eeprom { false };
     bool m_use_mmio { false };
     EntropySource m_entropy_source;
 
-    static const size_t number_of_rx_descriptors = 32;
-    static const size_t number_of_tx_descriptors = 8;
+    // The next descriptor the hardware will hand back to us.
+    size_t m_rx_current { 0 };
+
+    // Descriptors from m_tx_clean up to m_tx_tail are owned by the hardware.
+    Lock m_tx_lock { "E1000 TX" };
+    size_t m_tx_tail { 0 };
+    size_t m_tx_clean { 0 };
+    bool m_tx_tail_dirty { false };
 
     WaitQueue m_wait_queue;
 };
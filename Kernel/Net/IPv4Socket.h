@@ -99,12 +99,15 @@ protected:
     virtual KResult protocol_connect(FileDescription&, ShouldBlock) { return KSuccess; }
     virtual int protocol_allocate_local_port() { return 0; }
     virtual bool protocol_is_disconnected() const { return false; }
+    virtual void protocol_did_read_from_receive_buffer() { }
 
     virtual void shut_down_for_reading() override;
 
     void set_local_address(IPv4Address address) { m_local_address = address; }
     void set_peer_address(IPv4Address address) { m_peer_address = address; }
 
+    size_t receive_buffer_space() const { return m_receive_buffer.space_for_writing(); }
+
 private:
     virtual bool is_ipv4() const override { return true; }
 
@@ -39,6 +39,9 @@ namespace Kernel {
 
 static AK::Singleton<Lockable<InlineLinkedList<LocalSocket>>> s_list;
 
+// IPC messages (e.g. bitmaps sent to WindowServer) can be large, so give local sockets more room than pipes.
+static constexpr size_t local_socket_buffer_capacity = 256 * KiB;
+
 Lockable<InlineLinkedList<LocalSocket>>& LocalSocket::all_sockets()
 {
     return *s_list;
@@ -58,6 +61,8 @@ KResultOr<NonnullRefPtr<Socket>> LocalSocket::create(int type)
 
 LocalSocket::LocalSocket(int type)
     : Socket(AF_LOCAL, type, 0)
+    , m_for_client(local_socket_buffer_capacity)
+    , m_for_server(local_socket_buffer_capacity)
 {
     LOCKER(all_sockets().lock());
     all_sockets().resource().append(this);
@@ -287,7 +292,7 @@ KResultOr<size_t> LocalSocket::sendto(FileDescription& description, const UserOr
     return nwritten;
 }
 
-DoubleBuffer* LocalSocket::receive_buffer_for(FileDescription& description)
+PipeBuffer* LocalSocket::receive_buffer_for(FileDescription& description)
 {
     auto role = this->role(description);
     if (role == Role::Accepted)
@@ -297,7 +302,7 @@ DoubleBuffer* LocalSocket::receive_buffer_for(FileDescription& description)
     return nullptr;
 }
 
-DoubleBuffer* LocalSocket::send_buffer_for(FileDescription& description)
+PipeBuffer* LocalSocket::send_buffer_for(FileDescription& description)
 {
     auto role = this->role(description);
     if (role == Role::Connected)
@@ -375,9 +380,18 @@ KResult LocalSocket::getsockopt(FileDescription& description, int level, int opt
 
     switch (option) {
     case SO_SNDBUF:
-        TODO();
-    case SO_RCVBUF:
-        TODO();
+    case SO_RCVBUF: {
+        if (size < sizeof(int))
+            return EINVAL;
+        auto* buffer = option == SO_SNDBUF ? send_buffer_for(description) : receive_buffer_for(description);
+        int capacity = buffer ? buffer->capacity() : local_socket_buffer_capacity;
+        if (!copy_to_user(static_ptr_cast<int*>(value), &capacity))
+            return EFAULT;
+        size = sizeof(int);
+        if (!copy_to_user(value_size, &size))
+            return EFAULT;
+        return KSuccess;
+    }
     case SO_PEERCRED: {
         if (size < sizeof(ucred))
             return EINVAL;
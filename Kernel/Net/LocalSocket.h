@@ -27,8 +27,8 @@
 #pragma once
 
 #include <AK/InlineLinkedList.h>
-#include <Kernel/DoubleBuffer.h>
 #include <Kernel/Net/Socket.h>
+#include <Kernel/PipeBuffer.h>
 
 namespace Kernel {
 
@@ -72,8 +72,8 @@ private:
     virtual bool is_local() const override { return true; }
     bool has_attached_peer(const FileDescription&) const;
     static Lockable<InlineLinkedList<LocalSocket>>& all_sockets();
-    DoubleBuffer* receive_buffer_for(FileDescription&);
-    DoubleBuffer* send_buffer_for(FileDescription&);
+    PipeBuffer* receive_buffer_for(FileDescription&);
+    PipeBuffer* send_buffer_for(FileDescription&);
     NonnullRefPtrVector<FileDescription>& sendfd_queue_for(const FileDescription&);
     NonnullRefPtrVector<FileDescription>& recvfd_queue_for(const FileDescription&);
 
@@ -110,8 +110,8 @@ private:
     bool m_accept_side_fd_open { false };
     sockaddr_un m_address { 0, { 0 } };
 
-    DoubleBuffer m_for_client;
-    DoubleBuffer m_for_server;
+    PipeBuffer m_for_client;
+    PipeBuffer m_for_server;
 
     NonnullRefPtrVector<FileDescription> m_fds_for_client;
     NonnullRefPtrVector<FileDescription> m_fds_for_server;
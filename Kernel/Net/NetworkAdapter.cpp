@@ -199,6 +199,57 @@ void NetworkAdapter::did_receive(ReadonlyBytes payload)
         on_receive();
 }
 
+void NetworkAdapter::schedule_receive_poll()
+{
+    if (m_receive_poll_scheduled.exchange(true, AK::MemoryOrder::memory_order_acq_rel))
+        return;
+    if (on_receive_poll_scheduled)
+        on_receive_poll_scheduled();
+}
+
+size_t NetworkAdapter::poll_receive(size_t budget, ReceiveCallback& callback)
+{
+    VERIFY(budget > 0);
+    m_receive_poll_scheduled.store(false, AK::MemoryOrder::memory_order_release);
+    m_receive_polls++;
+
+    // Replies to whatever we receive go out in one batch as well.
+    begin_transmit_batch();
+    auto received = receive_batch(budget, callback);
+    end_transmit_batch();
+
+    // The adapter only turns its receive interrupt back on once it's drained,
+    // so we have to come back for the rest.
+    if (received == budget)
+        m_receive_poll_scheduled.store(true, AK::MemoryOrder::memory_order_release);
+    return received;
+}
+
+void NetworkAdapter::end_transmit_batch()
+{
+    auto previous_depth = m_transmit_batch_depth.fetch_sub(1, AK::MemoryOrder::memory_order_acq_rel);
+    VERIFY(previous_depth > 0);
+    if (previous_depth == 1)
+        flush_transmit();
+}
+
+void NetworkAdapter::update_rate_statistics(const Time& now)
+{
+    RateSample sample { now, m_packets_in, m_bytes_in, m_packets_out, m_bytes_out };
+    auto elapsed_ms = (now - m_last_rate_sample.timestamp).to_milliseconds();
+    if (m_last_rate_sample.timestamp != Time() && elapsed_ms > 0) {
+        // NOTE: The counters may wrap around, unsigned subtraction takes care of that.
+        auto per_second = [&](u32 current, u32 previous) {
+            return (u32)((u64)(current - previous) * 1000 / elapsed_ms);
+        };
+        m_packets_in_per_second = per_second(sample.packets_in, m_last_rate_sample.packets_in);
+        m_bytes_in_per_second = per_second(sample.bytes_in, m_last_rate_sample.bytes_in);
+        m_packets_out_per_second = per_second(sample.packets_out, m_last_rate_sample.packets_out);
+        m_bytes_out_per_second = per_second(sample.bytes_out, m_last_rate_sample.bytes_out);
+    }
+    m_last_rate_sample = sample;
+}
+
 size_t NetworkAdapter::dequeue_packet(u8* buffer, size_t buffer_size, Time& packet_timestamp)
 {
     InterruptDisabler disabler;
@@ -26,6 +26,7 @@
 
 #pragma once
 
+#include <AK/Atomic.h>
 #include <AK/ByteBuffer.h>
 #include <AK/Function.h>
 #include <AK/MACAddress.h>
@@ -45,6 +46,8 @@ class NetworkAdapter;
 
 class NetworkAdapter : public RefCounted<NetworkAdapter> {
 public:
+    using ReceiveCallback = Function<void(ReadonlyBytes, const Time&)>;
+
     static void for_each(Function<void(NetworkAdapter&)>);
     static RefPtr<NetworkAdapter> from_ipv4_address(const IPv4Address&);
     static RefPtr<NetworkAdapter> lookup_by_name(const StringView&);
@@ -71,6 +74,18 @@ public:
 
     bool has_queued_packets() const { return !m_packet_queue.is_empty(); }
 
+    // Adapters that support polling don't queue received packets from their
+    // interrupt handler. They mask their receive interrupt and schedule a poll
+    // instead, and the NetworkTask then hands up to `budget` packets at a time
+    // straight from the receive ring to the callback.
+    bool is_receive_poll_scheduled() const { return m_receive_poll_scheduled.load(AK::MemoryOrder::memory_order_acquire); }
+    size_t poll_receive(size_t budget, ReceiveCallback&);
+
+    // While batching, adapters may defer telling the hardware about packets
+    // queued for transmission until the batch ends.
+    void begin_transmit_batch() { m_transmit_batch_depth.fetch_add(1, AK::MemoryOrder::memory_order_acq_rel); }
+    void end_transmit_batch();
+
     u32 mtu() const { return m_mtu; }
     void set_mtu(u32 mtu) { m_mtu = mtu; }
 
@@ -78,8 +93,17 @@ public:
     u32 bytes_in() const { return m_bytes_in; }
     u32 packets_out() const { return m_packets_out; }
     u32 bytes_out() const { return m_bytes_out; }
+    u32 interrupts() const { return m_interrupts; }
+    u32 receive_polls() const { return m_receive_polls; }
+
+    u32 packets_in_per_second() const { return m_packets_in_per_second; }
+    u32 bytes_in_per_second() const { return m_bytes_in_per_second; }
+    u32 packets_out_per_second() const { return m_packets_out_per_second; }
+    u32 bytes_out_per_second() const { return m_bytes_out_per_second; }
+    void update_rate_statistics(const Time& now);
 
     Function<void()> on_receive;
+    Function<void()> on_receive_poll_scheduled;
 
 protected:
     NetworkAdapter();
@@ -88,6 +112,18 @@ protected:
     virtual void send_raw(ReadonlyBytes) = 0;
     void did_receive(ReadonlyBytes);
 
+    void did_interrupt() { m_interrupts++; }
+    void schedule_receive_poll();
+    virtual size_t receive_batch(size_t, ReceiveCallback&) { return 0; }
+    void did_receive_polled(size_t size)
+    {
+        m_packets_in++;
+        m_bytes_in += size;
+    }
+
+    bool is_batching_transmits() const { return m_transmit_batch_depth.load(AK::MemoryOrder::memory_order_acquire) > 0; }
+    virtual void flush_transmit() { }
+
 private:
     MACAddress m_mac_address;
     IPv4Address m_ipv4_address;
@@ -107,7 +143,25 @@ private:
     u32 m_bytes_in { 0 };
     u32 m_packets_out { 0 };
     u32 m_bytes_out { 0 };
+    u32 m_interrupts { 0 };
+    u32 m_receive_polls { 0 };
     u32 m_mtu { 1500 };
+
+    Atomic<bool> m_receive_poll_scheduled { false };
+    Atomic<u32> m_transmit_batch_depth { 0 };
+
+    struct RateSample {
+        Time timestamp;
+        u32 packets_in { 0 };
+        u32 bytes_in { 0 };
+        u32 packets_out { 0 };
+        u32 bytes_out { 0 };
+    };
+    RateSample m_last_rate_sample;
+    u32 m_packets_in_per_second { 0 };
+    u32 m_bytes_in_per_second { 0 };
+    u32 m_packets_out_per_second { 0 };
+    u32 m_bytes_out_per_second { 0 };
 };
 
 }
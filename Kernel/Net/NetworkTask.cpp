@@ -43,6 +43,7 @@
 
 namespace Kernel {
 
+static void handle_packet(ReadonlyBytes, const Time& packet_timestamp);
 static void handle_arp(const EthernetFrameHeader&, size_t frame_size);
 static void handle_ipv4(const EthernetFrameHeader&, size_t frame_size, const Time& packet_timestamp);
 static void handle_icmp(const EthernetFrameHeader&, const IPv4Packet&, const Time& packet_timestamp);
@@ -74,6 +75,9 @@ void NetworkTask_main(void*)
             pending_packets++;
             packet_wait_queue.wake_all();
         };
+        adapter.on_receive_poll_scheduled = [&]() {
+            packet_wait_queue.wake_all();
+        };
     });
 
     auto dequeue_packet = [&pending_packets](u8* buffer, size_t buffer_size, Time& packet_timestamp) -> size_t {
@@ -95,35 +99,77 @@ void NetworkTask_main(void*)
     auto buffer = (u8*)buffer_region->vaddr().get();
     Time packet_timestamp;
 
+    // How many packets we take from an adapter's receive ring before moving on
+    // to the next one, so that a busy adapter can't starve the others.
+    constexpr size_t receive_budget = 64;
+    NetworkAdapter::ReceiveCallback receive_callback = handle_packet;
+    Vector<NonnullRefPtr<NetworkAdapter>, 4> adapters_to_poll;
+
+    // How often we check for TCP segments whose retransmission timer has expired.
+    auto retransmit_interval = Time::from_milliseconds(100);
+    auto last_retransmit_check = TimeManagement::the().monotonic_time();
+
+    auto rate_statistics_interval = Time::from_seconds(1);
+    auto last_rate_statistics_update = last_retransmit_check;
+
     for (;;) {
-        size_t packet_size = dequeue_packet(buffer, buffer_size, packet_timestamp);
-        if (!packet_size) {
-            packet_wait_queue.wait_forever("NetworkTask");
-            continue;
+        auto now = TimeManagement::the().monotonic_time();
+        if (now - last_retransmit_check >= retransmit_interval) {
+            last_retransmit_check = now;
+            TCPSocket::retransmit_packets_for_all_sockets();
+        }
+        if (now - last_rate_statistics_update >= rate_statistics_interval) {
+            last_rate_statistics_update = now;
+            NetworkAdapter::for_each([&](auto& adapter) {
+                adapter.update_rate_statistics(now);
+            });
+        }
+
+        adapters_to_poll.clear_with_capacity();
+        NetworkAdapter::for_each([&](auto& adapter) {
+            if (adapter.is_receive_poll_scheduled())
+                adapters_to_poll.append(adapter);
+        });
+        for (auto& adapter : adapters_to_poll) {
+            [[maybe_unused]] auto received = adapter->poll_receive(receive_budget, receive_callback);
+            dbgln_if(NETWORK_TASK_DEBUG, "NetworkTask: Polled {} packets from {}", received, adapter->name());
         }
-        if (packet_size < sizeof(EthernetFrameHeader)) {
-            dbgln("NetworkTask: Packet is too small to be an Ethernet packet! ({})", packet_size);
+
+        size_t packet_size = dequeue_packet(buffer, buffer_size, packet_timestamp);
+        if (packet_size) {
+            handle_packet({ buffer, packet_size }, packet_timestamp);
             continue;
         }
-        auto& eth = *(const EthernetFrameHeader*)buffer;
-        dbgln_if(ETHERNET_DEBUG, "NetworkTask: From {} to {}, ether_type={:#04x}, packet_size={}", eth.source().to_string(), eth.destination().to_string(), eth.ether_type(), packet_size);
-
-        switch (eth.ether_type()) {
-        case EtherType::ARP:
-            handle_arp(eth, packet_size);
-            break;
-        case EtherType::IPv4:
-            handle_ipv4(eth, packet_size, packet_timestamp);
-            break;
-        case EtherType::IPv6:
-            // ignore
-            break;
-        default:
-            dbgln("NetworkTask: Unknown ethernet type {:#04x}", eth.ether_type());
+        if (adapters_to_poll.is_empty()) {
+            [[maybe_unused]] auto result = packet_wait_queue.wait_on(Thread::BlockTimeout(false, &retransmit_interval), "NetworkTask");
         }
     }
 }
 
+void handle_packet(ReadonlyBytes packet, const Time& packet_timestamp)
+{
+    if (packet.size() < sizeof(EthernetFrameHeader)) {
+        dbgln("NetworkTask: Packet is too small to be an Ethernet packet! ({})", packet.size());
+        return;
+    }
+    auto& eth = *(const EthernetFrameHeader*)packet.data();
+    dbgln_if(ETHERNET_DEBUG, "NetworkTask: From {} to {}, ether_type={:#04x}, packet_size={}", eth.source().to_string(), eth.destination().to_string(), eth.ether_type(), packet.size());
+
+    switch (eth.ether_type()) {
+    case EtherType::ARP:
+        handle_arp(eth, packet.size());
+        break;
+    case EtherType::IPv4:
+        handle_ipv4(eth, packet.size(), packet_timestamp);
+        break;
+    case EtherType::IPv6:
+        // ignore
+        break;
+    default:
+        dbgln("NetworkTask: Unknown ethernet type {:#04x}", eth.ether_type());
+    }
+}
+
 void handle_arp(const EthernetFrameHeader& eth, size_t frame_size)
 {
     constexpr size_t minimum_arp_frame_size = sizeof(EthernetFrameHeader) + sizeof(ARPPacket);
@@ -383,6 +429,8 @@ void handle_tcp(const IPv4Packet& ipv4_packet, const Time& packet_timestamp)
             }
             LOCKER(client->lock());
             dbgln_if(TCP_DEBUG, "handle_tcp: created new client socket with tuple {}", client->tuple().to_string());
+            // Let the new socket pick up the peer's window and MSS from the SYN.
+            client->receive_tcp_packet(tcp_packet, ipv4_packet.payload_size());
             client->set_sequence_number(1000);
             client->set_ack_number(tcp_packet.sequence_number() + payload_size + 1);
             [[maybe_unused]] auto rc2 = client->send_tcp_packet(TCPFlags::SYN | TCPFlags::ACK);
@@ -531,6 +579,14 @@ void handle_tcp(const IPv4Packet& ipv4_packet, const Time& packet_timestamp)
             return;
         }
     case TCPSocket::State::Established:
+        if ((payload_size || tcp_packet.has_fin()) && !socket->is_in_order(tcp_packet)) {
+            // We don't keep out-of-order segments around. Send a duplicate ACK so the peer
+            // can detect the hole and retransmit (RFC 5681, section 4.2).
+            dbgln_if(TCP_DEBUG, "handle_tcp: Out-of-order segment seq_no={}, expected {}", tcp_packet.sequence_number(), socket->ack_number());
+            unused_rc = socket->send_tcp_packet(TCPFlags::ACK);
+            return;
+        }
+
         if (tcp_packet.has_fin()) {
             if (payload_size != 0)
                 socket->did_receive(ipv4_packet.source(), tcp_packet.source_port(), KBuffer::copy(&ipv4_packet, sizeof(IPv4Packet) + ipv4_packet.payload_size()), packet_timestamp);
@@ -542,14 +598,16 @@ void handle_tcp(const IPv4Packet& ipv4_packet, const Time& packet_timestamp)
             return;
         }
 
-        socket->set_ack_number(tcp_packet.sequence_number() + payload_size);
-
-        dbgln_if(TCP_DEBUG, "Got packet with ack_no={}, seq_no={}, payload_size={}, acking it with new ack_no={}, seq_no={}",
-            tcp_packet.ack_number(), tcp_packet.sequence_number(), payload_size, socket->ack_number(), socket->sequence_number());
-
         if (payload_size) {
+            // Only acknowledge what actually made it into the receive buffer. If it didn't fit,
+            // the ACK below repeats our current ack_no and the (small) window we have left.
             if (socket->did_receive(ipv4_packet.source(), tcp_packet.source_port(), KBuffer::copy(&ipv4_packet, sizeof(IPv4Packet) + ipv4_packet.payload_size()), packet_timestamp))
-                unused_rc = socket->send_tcp_packet(TCPFlags::ACK);
+                socket->set_ack_number(tcp_packet.sequence_number() + payload_size);
+
+            dbgln_if(TCP_DEBUG, "Got packet with ack_no={}, seq_no={}, payload_size={}, acking it with new ack_no={}, seq_no={}",
+                tcp_packet.ack_number(), tcp_packet.sequence_number(), payload_size, socket->ack_number(), socket->sequence_number());
+
+            unused_rc = socket->send_tcp_packet(TCPFlags::ACK);
         }
     }
 }
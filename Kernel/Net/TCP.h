@@ -41,6 +41,31 @@ struct TCPFlags {
     };
 };
 
+enum class TCPOptionKind : u8 {
+    End = 0,
+    NoOperation = 1,
+    MaximumSegmentSize = 2,
+};
+
+class [[gnu::packed]] TCPOptionMSS {
+public:
+    TCPOptionMSS(u16 value)
+        : m_value(value)
+    {
+    }
+
+    TCPOptionKind kind() const { return m_kind; }
+    u8 length() const { return m_length; }
+    u16 value() const { return m_value; }
+
+private:
+    TCPOptionKind m_kind { TCPOptionKind::MaximumSegmentSize };
+    u8 m_length { 4 };
+    NetworkOrdered<u16> m_value;
+};
+
+static_assert(sizeof(TCPOptionMSS) == 4);
+
 class [[gnu::packed]] TCPPacket {
 public:
     TCPPacket() = default;
@@ -80,6 +105,10 @@ public:
     u16 urgent() const { return m_urgent; }
     void set_urgent(u16 urgent) { m_urgent = urgent; }
 
+    const u8* options() const { return ((const u8*)this) + sizeof(TCPPacket); }
+    u8* options() { return ((u8*)this) + sizeof(TCPPacket); }
+    size_t options_size() const { return header_size() - sizeof(TCPPacket); }
+
     const void* payload() const { return ((const u8*)this) + header_size(); }
     void* payload() { return ((u8*)this) + header_size(); }
 
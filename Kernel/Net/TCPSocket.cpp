@@ -29,12 +29,14 @@
 #include <Kernel/Debug.h>
 #include <Kernel/Devices/RandomDevice.h>
 #include <Kernel/FileSystem/FileDescription.h>
+#include <Kernel/Net/EthernetFrameHeader.h>
 #include <Kernel/Net/NetworkAdapter.h>
 #include <Kernel/Net/Routing.h>
 #include <Kernel/Net/TCP.h>
 #include <Kernel/Net/TCPSocket.h>
 #include <Kernel/Process.h>
 #include <Kernel/Random.h>
+#include <Kernel/Time/TimeManagement.h>
 
 namespace Kernel {
 
@@ -176,46 +178,98 @@ KResultOr<size_t> TCPSocket::protocol_receive(ReadonlyBytes raw_ipv4_packet, Use
 
 KResultOr<size_t> TCPSocket::protocol_send(const UserOrKernelBuffer& data, size_t data_length)
 {
-    int err = send_tcp_packet(TCPFlags::PUSH | TCPFlags::ACK, &data, data_length);
-    if (err < 0)
-        return KResult((ErrnoCode)-err);
-    return data_length;
+    size_t send_buffer_space;
+    {
+        LOCKER(m_not_acked_lock, Lock::Mode::Shared);
+        send_buffer_space = send_buffer_size - min(m_not_acked_bytes, send_buffer_size);
+    }
+    if (send_buffer_space == 0)
+        return EAGAIN;
+
+    // NOTE: We may accept less than we were given here; do_write() will block until
+    //       the send buffer drains and then hand us the rest.
+    size_t nsent = 0;
+    size_t bytes_to_send = min(data_length, send_buffer_space);
+    while (nsent < bytes_to_send) {
+        size_t segment_size = min(bytes_to_send - nsent, (size_t)m_maximum_segment_size);
+        auto segment = data.offset(nsent);
+        auto result = send_tcp_packet(TCPFlags::PUSH | TCPFlags::ACK, &segment, segment_size);
+        if (result.is_error()) {
+            if (nsent > 0)
+                break;
+            return result;
+        }
+        nsent += segment_size;
+    }
+    return nsent;
+}
+
+bool TCPSocket::can_write(const FileDescription& description, size_t size) const
+{
+    if (!IPv4Socket::can_write(description, size))
+        return false;
+    return m_not_acked_bytes < send_buffer_size;
+}
+
+u16 TCPSocket::receive_window_to_advertise() const
+{
+    // FIXME: Implement window scaling (RFC 7323) so we can advertise more than 64 KiB.
+    return min(receive_buffer_space(), (size_t)NumericLimits<u16>::max());
+}
+
+u32 TCPSocket::local_maximum_segment_size() const
+{
+    u32 mtu = NumericLimits<u32>::max();
+    auto routing_decision = route_to(peer_address(), local_address(), bound_interface());
+    if (!routing_decision.is_zero())
+        mtu = routing_decision.adapter->mtu() - sizeof(EthernetFrameHeader);
+    return min(mtu - sizeof(IPv4Packet) - sizeof(TCPPacket), maximum_segment_size_limit);
 }
 
 KResult TCPSocket::send_tcp_packet(u16 flags, const UserOrKernelBuffer* payload, size_t payload_size)
 {
-    const size_t buffer_size = sizeof(TCPPacket) + payload_size;
+    const size_t options_size = (flags & TCPFlags::SYN) ? sizeof(TCPOptionMSS) : 0;
+    const size_t header_size = sizeof(TCPPacket) + options_size;
+    const size_t buffer_size = header_size + payload_size;
     auto buffer = ByteBuffer::create_zeroed(buffer_size);
     auto& tcp_packet = *(TCPPacket*)(buffer.data());
     VERIFY(local_port());
     tcp_packet.set_source_port(local_port());
     tcp_packet.set_destination_port(peer_port());
-    tcp_packet.set_window_size(1024);
+    m_last_advertised_window = receive_window_to_advertise();
+    tcp_packet.set_window_size(m_last_advertised_window);
     tcp_packet.set_sequence_number(m_sequence_number);
-    tcp_packet.set_data_offset(sizeof(TCPPacket) / sizeof(u32));
+    tcp_packet.set_data_offset(header_size / sizeof(u32));
     tcp_packet.set_flags(flags);
 
     if (flags & TCPFlags::ACK)
         tcp_packet.set_ack_number(m_ack_number);
 
+    if (flags & TCPFlags::SYN)
+        new (tcp_packet.options()) TCPOptionMSS(local_maximum_segment_size());
+
     if (payload && !payload->read(tcp_packet.payload(), payload_size))
         return EFAULT;
 
-    if (flags & TCPFlags::SYN) {
-        ++m_sequence_number;
-    } else {
-        m_sequence_number += payload_size;
-    }
-
-    tcp_packet.set_checksum(compute_tcp_checksum(local_address(), peer_address(), tcp_packet, payload_size));
-
     if (tcp_packet.has_syn() || payload_size > 0) {
         LOCKER(m_not_acked_lock);
-        m_not_acked.append({ m_sequence_number, move(buffer) });
+        if (tcp_packet.has_syn()) {
+            // The SYN starts a fresh send sequence space.
+            m_send_unacknowledged = m_sequence_number;
+            m_send_next = m_sequence_number;
+            ++m_sequence_number;
+        } else {
+            m_sequence_number += payload_size;
+        }
+        // NOTE: The checksum is filled in by transmit(), since the ack number and window may change before then.
+        m_not_acked.append({ m_sequence_number, move(buffer), 0, TimeManagement::the().monotonic_time(), tcp_packet.sequence_number() });
+        m_not_acked_bytes += payload_size;
         send_outgoing_packets();
         return KSuccess;
     }
 
+    tcp_packet.set_checksum(compute_tcp_checksum(local_address(), peer_address(), tcp_packet, payload_size));
+
     auto routing_decision = route_to(peer_address(), local_address(), bound_interface());
     VERIFY(!routing_decision.is_zero());
 
@@ -231,88 +285,347 @@ KResult TCPSocket::send_tcp_packet(u16 flags, const UserOrKernelBuffer* payload,
     return KSuccess;
 }
 
-void TCPSocket::send_outgoing_packets()
+// Sequence numbers wrap around, so they have to be compared using serial number arithmetic (RFC 1982).
+static inline bool sequence_number_less_than(u32 a, u32 b)
+{
+    return (i32)(a - b) < 0;
+}
+
+static inline bool sequence_number_less_than_or_equal(u32 a, u32 b)
 {
+    return (i32)(a - b) <= 0;
+}
+
+void TCPSocket::transmit(OutgoingPacket& packet, const Time& now)
+{
+    VERIFY(m_not_acked_lock.is_locked());
+
+    auto& tcp_packet = *(TCPPacket*)(packet.buffer.data());
+    size_t payload_size = packet.buffer.size() - tcp_packet.header_size();
+
+    // Always carry the latest acknowledgement and receive window, even on retransmissions.
+    if (tcp_packet.has_ack())
+        tcp_packet.set_ack_number(m_ack_number);
+    m_last_advertised_window = receive_window_to_advertise();
+    tcp_packet.set_window_size(m_last_advertised_window);
+    tcp_packet.set_checksum(0);
+    tcp_packet.set_checksum(compute_tcp_checksum(local_address(), peer_address(), tcp_packet, payload_size));
+
+    if (packet.tx_counter > 0)
+        m_retransmissions++;
+    packet.tx_time = now;
+    packet.tx_counter++;
+
+    if (sequence_number_less_than(m_send_next, packet.ack_number))
+        m_send_next = packet.ack_number;
+
+    if constexpr (TCP_SOCKET_DEBUG) {
+        dbgln("Sending TCP packet from {}:{} to {}:{} with ({}{}{}{}) seq_no={}, ack_no={}, tx_counter={}",
+            local_address(), local_port(),
+            peer_address(), peer_port(),
+            (tcp_packet.has_syn() ? "SYN " : ""),
+            (tcp_packet.has_ack() ? "ACK " : ""),
+            (tcp_packet.has_fin() ? "FIN " : ""),
+            (tcp_packet.has_rst() ? "RST " : ""),
+            tcp_packet.sequence_number(),
+            tcp_packet.ack_number(),
+            packet.tx_counter);
+    }
+
     auto routing_decision = route_to(peer_address(), local_address(), bound_interface());
     VERIFY(!routing_decision.is_zero());
 
-    auto now = kgettimeofday();
+    auto packet_buffer = UserOrKernelBuffer::for_kernel_buffer(packet.buffer.data());
+    int err = routing_decision.adapter->send_ipv4(
+        routing_decision.next_hop, peer_address(), IPv4Protocol::TCP,
+        packet_buffer, packet.buffer.size(), ttl());
+    if (err < 0) {
+        dmesgln("Error ({}) sending TCP packet from {}:{} to {}:{} with ({}{}{}{}) seq_no={}, ack_no={}, tx_counter={}",
+            err,
+            local_address(),
+            local_port(),
+            peer_address(),
+            peer_port(),
+            (tcp_packet.has_syn() ? "SYN " : ""),
+            (tcp_packet.has_ack() ? "ACK " : ""),
+            (tcp_packet.has_fin() ? "FIN " : ""),
+            (tcp_packet.has_rst() ? "RST " : ""),
+            tcp_packet.sequence_number(),
+            tcp_packet.ack_number(),
+            packet.tx_counter);
+    } else {
+        m_packets_out++;
+        m_bytes_out += packet.buffer.size();
+    }
+}
+
+void TCPSocket::send_outgoing_packets()
+{
+    auto now = TimeManagement::the().monotonic_time();
 
-    LOCKER(m_not_acked_lock, Lock::Mode::Shared);
+    LOCKER(m_not_acked_lock);
+    // We may have as much data in flight as both the peer (send window) and the network (congestion window) allow.
+    u32 usable_window = min(m_send_window, m_congestion_window);
     for (auto& packet : m_not_acked) {
-        auto diff = now - packet.tx_time;
-        if (diff <= Time::from_nanoseconds(500'000'000))
+        if (sequence_number_less_than(packet.sequence_number, m_send_next))
             continue;
-        packet.tx_time = now;
-        packet.tx_counter++;
-
-        if constexpr (TCP_SOCKET_DEBUG) {
-            auto& tcp_packet = *(const TCPPacket*)(packet.buffer.data());
-            dbgln("Sending TCP packet from {}:{} to {}:{} with ({}{}{}{}) seq_no={}, ack_no={}, tx_counter={}",
-                local_address(), local_port(),
-                peer_address(), peer_port(),
-                (tcp_packet.has_syn() ? "SYN " : ""),
-                (tcp_packet.has_ack() ? "ACK " : ""),
-                (tcp_packet.has_fin() ? "FIN " : ""),
-                (tcp_packet.has_rst() ? "RST " : ""),
-                tcp_packet.sequence_number(),
-                tcp_packet.ack_number(),
-                packet.tx_counter);
+        auto& tcp_packet = *(const TCPPacket*)(packet.buffer.data());
+        u32 sequence_length = packet.ack_number - packet.sequence_number;
+        if (!tcp_packet.has_syn() && bytes_in_flight() + sequence_length > usable_window)
+            break;
+        transmit(packet, now);
+    }
+}
+
+void TCPSocket::send_window_probe(const Time& now)
+{
+    VERIFY(m_not_acked_lock.is_locked());
+
+    // The peer's window is too small for our next segment and nothing is in flight that
+    // would trigger a window update, so push the segment out anyway (RFC 1122, 4.2.2.17).
+    // If it doesn't fit, the peer drops it and answers with its current window.
+    for (auto& packet : m_not_acked) {
+        if (sequence_number_less_than(packet.sequence_number, m_send_next))
+            continue;
+        dbgln_if(TCP_SOCKET_DEBUG, "TCPSocket({}): Sending window probe, send window is {}", this, m_send_window);
+        transmit(packet, now);
+        return;
+    }
+}
+
+void TCPSocket::update_round_trip_time(const Time& sample)
+{
+    // RFC 6298, section 2
+    i64 sample_us = max(sample.to_microseconds(), (i64)1);
+    if (m_smoothed_rtt_us == 0) {
+        m_smoothed_rtt_us = sample_us;
+        m_rtt_variance_us = sample_us / 2;
+    } else {
+        i64 delta = m_smoothed_rtt_us - sample_us;
+        if (delta < 0)
+            delta = -delta;
+        m_rtt_variance_us = (3 * m_rtt_variance_us + delta) / 4;
+        m_smoothed_rtt_us = (7 * m_smoothed_rtt_us + sample_us) / 8;
+    }
+    auto timeout = Time::from_microseconds(m_smoothed_rtt_us + max(4 * m_rtt_variance_us, (i64)1000));
+    m_retransmission_timeout = clamp(timeout, minimum_retransmission_timeout, maximum_retransmission_timeout);
+}
+
+void TCPSocket::process_acknowledgement(const TCPPacket& packet, size_t payload_size)
+{
+    auto now = TimeManagement::the().monotonic_time();
+    u32 ack_number = packet.ack_number();
+
+    LOCKER(m_not_acked_lock);
+
+    if (sequence_number_less_than(ack_number, m_send_unacknowledged)) {
+        dbgln_if(TCP_SOCKET_DEBUG, "TCPSocket: Ignoring old ack_no={}, snd_una={}", ack_number, m_send_unacknowledged);
+        return;
+    }
+
+    u32 previous_send_window = m_send_window;
+    m_send_window = packet.window_size();
+
+    if (ack_number == m_send_unacknowledged) {
+        // RFC 5681, section 2: only a pure ACK that doesn't change the window while we
+        // have data outstanding counts as a duplicate.
+        if (payload_size != 0 || packet.has_syn() || packet.has_fin() || m_send_window != previous_send_window || bytes_in_flight() == 0) {
+            send_outgoing_packets();
+            return;
+        }
+
+        m_duplicate_ack_count++;
+        if (m_duplicate_ack_count == 3 && !m_in_fast_recovery && !m_not_acked.is_empty()) {
+            // RFC 6582, section 3.2: Fast retransmit and enter fast recovery.
+            m_slow_start_threshold = max(bytes_in_flight() / 2, 2 * m_maximum_segment_size);
+            m_congestion_window = m_slow_start_threshold + 3 * m_maximum_segment_size;
+            m_recovery_point = m_send_next;
+            m_in_fast_recovery = true;
+            m_fast_retransmissions++;
+            transmit(m_not_acked.first(), now);
+        } else if (m_in_fast_recovery) {
+            // Every further duplicate means another segment has left the network.
+            m_congestion_window += m_maximum_segment_size;
         }
+        send_outgoing_packets();
+        return;
+    }
+
+    // This acknowledges new data. The peer may also acknowledge a FIN we never queued,
+    // so don't let SND.NXT fall behind.
+    u32 bytes_acknowledged = ack_number - m_send_unacknowledged;
+    m_send_unacknowledged = ack_number;
+    if (sequence_number_less_than(m_send_next, ack_number))
+        m_send_next = ack_number;
+    m_duplicate_ack_count = 0;
+
+    Optional<Time> round_trip_time_sample;
+    int removed = 0;
+    while (!m_not_acked.is_empty()) {
+        auto& outgoing_packet = m_not_acked.first();
+        dbgln_if(TCP_SOCKET_DEBUG, "TCPSocket: iterate: {}", outgoing_packet.ack_number);
+        if (!sequence_number_less_than_or_equal(outgoing_packet.ack_number, ack_number))
+            break;
+        // Karn's algorithm: never sample the round-trip time of retransmitted segments.
+        if (outgoing_packet.tx_counter == 1)
+            round_trip_time_sample = now - outgoing_packet.tx_time;
+        auto& tcp_packet = *(const TCPPacket*)(outgoing_packet.buffer.data());
+        m_not_acked_bytes -= outgoing_packet.buffer.size() - tcp_packet.header_size();
+        m_not_acked.take_first();
+        removed++;
+    }
+    dbgln_if(TCP_SOCKET_DEBUG, "TCPSocket: receive_tcp_packet acknowledged {} packets", removed);
+
+    if (round_trip_time_sample.has_value()) {
+        update_round_trip_time(round_trip_time_sample.value());
+    } else if (removed > 0) {
+        // Forward progress after retransmissions, so undo the exponential backoff.
+        m_retransmission_timeout = clamp(Time::from_microseconds(m_smoothed_rtt_us + 4 * m_rtt_variance_us), minimum_retransmission_timeout, maximum_retransmission_timeout);
+    }
 
-        auto packet_buffer = UserOrKernelBuffer::for_kernel_buffer(packet.buffer.data());
-        int err = routing_decision.adapter->send_ipv4(
-            routing_decision.next_hop, peer_address(), IPv4Protocol::TCP,
-            packet_buffer, packet.buffer.size(), ttl());
-        if (err < 0) {
-            auto& tcp_packet = *(const TCPPacket*)(packet.buffer.data());
-            dmesgln("Error ({}) sending TCP packet from {}:{} to {}:{} with ({}{}{}{}) seq_no={}, ack_no={}, tx_counter={}",
-                err,
-                local_address(),
-                local_port(),
-                peer_address(),
-                peer_port(),
-                (tcp_packet.has_syn() ? "SYN " : ""),
-                (tcp_packet.has_ack() ? "ACK " : ""),
-                (tcp_packet.has_fin() ? "FIN " : ""),
-                (tcp_packet.has_rst() ? "RST " : ""),
-                tcp_packet.sequence_number(),
-                tcp_packet.ack_number(),
-                packet.tx_counter);
+    if (m_in_fast_recovery) {
+        if (sequence_number_less_than(ack_number, m_recovery_point)) {
+            // Partial acknowledgement: the next hole is right at SND.UNA, retransmit it
+            // immediately and deflate the window by the amount of new data acknowledged.
+            if (!m_not_acked.is_empty())
+                transmit(m_not_acked.first(), now);
+            m_congestion_window -= min(bytes_acknowledged, m_congestion_window);
+            m_congestion_window += m_maximum_segment_size;
         } else {
-            m_packets_out++;
-            m_bytes_out += packet.buffer.size();
+            m_in_fast_recovery = false;
+            m_congestion_window = m_slow_start_threshold;
         }
+    } else if (m_congestion_window < m_slow_start_threshold) {
+        // Slow start
+        m_congestion_window += min(bytes_acknowledged, m_maximum_segment_size);
+    } else {
+        // Congestion avoidance
+        m_congestion_window += max(m_maximum_segment_size * m_maximum_segment_size / m_congestion_window, 1u);
     }
+    // There's no point in growing the window beyond what we could ever have in flight.
+    m_congestion_window = min(m_congestion_window, (u32)send_buffer_size);
+
+    send_outgoing_packets();
+
+    if (removed > 0)
+        evaluate_block_conditions();
 }
 
-void TCPSocket::receive_tcp_packet(const TCPPacket& packet, u16 size)
+void TCPSocket::retransmit_packets()
 {
-    if (packet.has_ack()) {
-        u32 ack_number = packet.ack_number();
+    auto now = TimeManagement::the().monotonic_time();
 
-        dbgln_if(TCP_SOCKET_DEBUG, "TCPSocket: receive_tcp_packet: {}", ack_number);
+    LOCKER(m_not_acked_lock);
+    if (m_not_acked.is_empty())
+        return;
 
-        int removed = 0;
-        LOCKER(m_not_acked_lock);
-        while (!m_not_acked.is_empty()) {
-            auto& packet = m_not_acked.first();
+    if (bytes_in_flight() == 0) {
+        auto& first_unsent_packet = m_not_acked.first();
+        if (now - first_unsent_packet.tx_time >= m_retransmission_timeout)
+            send_window_probe(now);
+        return;
+    }
 
-            dbgln_if(TCP_SOCKET_DEBUG, "TCPSocket: iterate: {}", packet.ack_number);
+    auto& oldest_packet = m_not_acked.first();
+    if (now - oldest_packet.tx_time < m_retransmission_timeout)
+        return;
 
-            if (packet.ack_number <= ack_number) {
-                m_not_acked.take_first();
-                removed++;
-            } else {
-                break;
-            }
+    dbgln_if(TCP_SOCKET_DEBUG, "TCPSocket({}): Retransmission timeout ({} ms) expired, snd_una={}", this, m_retransmission_timeout.to_milliseconds(), m_send_unacknowledged);
+
+    // RFC 5681, section 3.1: Fall back to slow start from a single segment and
+    // resend everything that was in flight (go-back-N).
+    m_slow_start_threshold = max(bytes_in_flight() / 2, 2 * m_maximum_segment_size);
+    m_congestion_window = m_maximum_segment_size;
+    m_in_fast_recovery = false;
+    m_duplicate_ack_count = 0;
+    m_send_next = m_send_unacknowledged;
+
+    // RFC 6298, section 5.5: Back off the timer.
+    m_retransmission_timeout = min(m_retransmission_timeout + m_retransmission_timeout, maximum_retransmission_timeout);
+
+    if (m_send_window == 0)
+        send_window_probe(now);
+    else
+        send_outgoing_packets();
+}
+
+void TCPSocket::retransmit_packets_for_all_sockets()
+{
+    NonnullRefPtrVector<TCPSocket> sockets;
+    {
+        LOCKER(sockets_by_tuple().lock(), Lock::Mode::Shared);
+        for (auto& it : sockets_by_tuple().resource())
+            sockets.append(*it.value);
+    }
+
+    for (auto& socket : sockets) {
+        LOCKER(socket.lock());
+        socket.retransmit_packets();
+    }
+}
+
+void TCPSocket::parse_options(const TCPPacket& packet)
+{
+    u32 peer_maximum_segment_size = default_maximum_segment_size;
+
+    auto* options = packet.options();
+    size_t options_size = packet.options_size();
+    for (size_t i = 0; i < options_size;) {
+        auto kind = (TCPOptionKind)options[i];
+        if (kind == TCPOptionKind::End)
+            break;
+        if (kind == TCPOptionKind::NoOperation) {
+            ++i;
+            continue;
         }
+        if (i + 1 >= options_size)
+            break;
+        u8 length = options[i + 1];
+        if (length < 2 || i + length > options_size)
+            break;
+        if (kind == TCPOptionKind::MaximumSegmentSize && length == sizeof(TCPOptionMSS))
+            peer_maximum_segment_size = max(reinterpret_cast<const TCPOptionMSS*>(&options[i])->value(), (u16)64);
+        i += length;
+    }
+
+    // The MSS is only exchanged on SYN segments, and so is the initial congestion window (RFC 5681, section 3.1).
+    m_maximum_segment_size = min(peer_maximum_segment_size, local_maximum_segment_size());
+    m_congestion_window = initial_congestion_window_segments * m_maximum_segment_size;
+    dbgln_if(TCP_SOCKET_DEBUG, "TCPSocket({}): Using MSS {}, initial congestion window {}", this, m_maximum_segment_size, m_congestion_window);
+}
+
+void TCPSocket::receive_tcp_packet(const TCPPacket& packet, u16 size)
+{
+    size_t payload_size = size - packet.header_size();
 
-        dbgln_if(TCP_SOCKET_DEBUG, "TCPSocket: receive_tcp_packet acknowledged {} packets", removed);
+    if (packet.has_syn())
+        parse_options(packet);
+
+    if (packet.has_ack()) {
+        dbgln_if(TCP_SOCKET_DEBUG, "TCPSocket: receive_tcp_packet: {}", packet.ack_number());
+        process_acknowledgement(packet, payload_size);
     }
 
     m_packets_in++;
-    m_bytes_in += packet.header_size() + size;
+    m_bytes_in += size;
+}
+
+bool TCPSocket::is_in_order(const TCPPacket& packet) const
+{
+    return packet.sequence_number() == m_ack_number;
+}
+
+void TCPSocket::protocol_did_read_from_receive_buffer()
+{
+    if (state() != State::Established && state() != State::FinWait1 && state() != State::FinWait2)
+        return;
+
+    // The peer may be sitting on data because our last window was too small for it,
+    // so let it know once there's room for a full segment again.
+    if (m_last_advertised_window < m_maximum_segment_size && receive_window_to_advertise() >= m_maximum_segment_size) {
+        dbgln_if(TCP_SOCKET_DEBUG, "TCPSocket({}): Sending window update, new window is {}", this, receive_window_to_advertise());
+        [[maybe_unused]] auto rc = send_tcp_packet(TCPFlags::ACK);
+    }
 }
 
 NetworkOrdered<u16> TCPSocket::compute_tcp_checksum(const IPv4Address& source, const IPv4Address& destination, const TCPPacket& packet, u16 payload_size)
@@ -325,7 +638,7 @@ NetworkOrdered<u16> TCPSocket::compute_tcp_checksum(const IPv4Address& source, c
         NetworkOrdered<u16> payload_size;
     };
 
-    PseudoHeader pseudo_header { source, destination, 0, (u8)IPv4Protocol::TCP, sizeof(TCPPacket) + payload_size };
+    PseudoHeader pseudo_header { source, destination, 0, (u8)IPv4Protocol::TCP, packet.header_size() + payload_size };
 
     u32 checksum = 0;
     auto* w = (const NetworkOrdered<u16>*)&pseudo_header;
@@ -335,12 +648,11 @@ NetworkOrdered<u16> TCPSocket::compute_tcp_checksum(const IPv4Address& source, c
             checksum = (checksum >> 16) + (checksum & 0xffff);
     }
     w = (const NetworkOrdered<u16>*)&packet;
-    for (size_t i = 0; i < sizeof(packet) / sizeof(u16); ++i) {
+    for (size_t i = 0; i < packet.header_size() / sizeof(u16); ++i) {
         checksum += w[i];
         if (checksum > 0xffff)
             checksum = (checksum >> 16) + (checksum & 0xffff);
     }
-    VERIFY(packet.data_offset() * 4 == sizeof(TCPPacket));
     w = (const NetworkOrdered<u16>*)packet.payload();
     for (size_t i = 0; i < payload_size / sizeof(u16); ++i) {
         checksum += w[i];
@@ -28,7 +28,9 @@
 
 #include <AK/Function.h>
 #include <AK/HashMap.h>
+#include <AK/NumericLimits.h>
 #include <AK/SinglyLinkedList.h>
+#include <AK/Time.h>
 #include <AK/WeakPtr.h>
 #include <Kernel/Net/IPv4Socket.h>
 
@@ -147,11 +149,25 @@ public:
     u32 bytes_in() const { return m_bytes_in; }
     u32 packets_out() const { return m_packets_out; }
     u32 bytes_out() const { return m_bytes_out; }
+    u32 send_window() const { return m_send_window; }
+    u32 congestion_window() const { return m_congestion_window; }
+    u32 slow_start_threshold() const { return m_slow_start_threshold; }
+    u32 maximum_segment_size() const { return m_maximum_segment_size; }
+    Time smoothed_round_trip_time() const { return Time::from_microseconds(m_smoothed_rtt_us); }
+    Time retransmission_timeout() const { return m_retransmission_timeout; }
+    u32 retransmissions() const { return m_retransmissions; }
+    u32 fast_retransmissions() const { return m_fast_retransmissions; }
+
+    // Returns whether the next expected sequence number is the one in the packet,
+    // i.e. whether its payload can be appended to the receive buffer.
+    bool is_in_order(const TCPPacket&) const;
 
     KResult send_tcp_packet(u16 flags, const UserOrKernelBuffer* = nullptr, size_t = 0);
     void send_outgoing_packets();
     void receive_tcp_packet(const TCPPacket&, u16 size);
 
+    static void retransmit_packets_for_all_sockets();
+
     static Lockable<HashMap<IPv4SocketTuple, TCPSocket*>>& sockets_by_tuple();
     static RefPtr<TCPSocket> from_tuple(const IPv4SocketTuple& tuple);
     static RefPtr<TCPSocket> from_endpoints(const IPv4Address& local_address, u16 local_port, const IPv4Address& peer_address, u16 peer_port);
@@ -165,6 +181,7 @@ public:
     void release_for_accept(RefPtr<TCPSocket>);
 
     virtual KResult close() override;
+    virtual bool can_write(const FileDescription&, size_t) const override;
 
 protected:
     void set_direction(Direction direction) { m_direction = direction; }
@@ -184,6 +201,19 @@ private:
     virtual bool protocol_is_disconnected() const override;
     virtual KResult protocol_bind() override;
     virtual KResult protocol_listen() override;
+    virtual void protocol_did_read_from_receive_buffer() override;
+
+    struct OutgoingPacket;
+
+    u16 receive_window_to_advertise() const;
+    u32 local_maximum_segment_size() const;
+    void parse_options(const TCPPacket&);
+    void process_acknowledgement(const TCPPacket&, size_t payload_size);
+    void update_round_trip_time(const Time& sample);
+    void transmit(OutgoingPacket&, const Time& now);
+    void retransmit_packets();
+    void send_window_probe(const Time& now);
+    u32 bytes_in_flight() const { return m_send_next - m_send_unacknowledged; }
 
     WeakPtr<TCPSocket> m_originator;
     HashMap<IPv4SocketTuple, NonnullRefPtr<TCPSocket>> m_pending_release_for_accept;
@@ -203,10 +233,41 @@ private:
         ByteBuffer buffer;
         int tx_counter { 0 };
         Time tx_time {};
+        u32 sequence_number { 0 };
     };
 
+    // Everything below is protected by m_not_acked_lock.
     Lock m_not_acked_lock { "TCPSocket unacked packets" };
     SinglyLinkedList<OutgoingPacket> m_not_acked;
+    size_t m_not_acked_bytes { 0 };
+
+    // Send sequence space (RFC 793): SND.UNA, SND.NXT and SND.WND
+    u32 m_send_unacknowledged { 0 };
+    u32 m_send_next { 0 };
+    u32 m_send_window { 0 };
+    u16 m_last_advertised_window { 0 };
+    u32 m_maximum_segment_size { default_maximum_segment_size };
+
+    // NewReno congestion control (RFC 5681, RFC 6582)
+    u32 m_congestion_window { initial_congestion_window_segments * default_maximum_segment_size };
+    u32 m_slow_start_threshold { NumericLimits<u32>::max() };
+    u32 m_duplicate_ack_count { 0 };
+    u32 m_recovery_point { 0 };
+    bool m_in_fast_recovery { false };
+
+    // Round-trip time estimation (RFC 6298)
+    i64 m_smoothed_rtt_us { 0 };
+    i64 m_rtt_variance_us { 0 };
+    Time m_retransmission_timeout { Time::from_seconds(1) };
+    u32 m_retransmissions { 0 };
+    u32 m_fast_retransmissions { 0 };
+
+    static constexpr u32 default_maximum_segment_size = 536;
+    static constexpr u32 maximum_segment_size_limit = 16 * KiB;
+    static constexpr u32 initial_congestion_window_segments = 4;
+    static constexpr Time minimum_retransmission_timeout = Time::from_milliseconds(200);
+    static constexpr Time maximum_retransmission_timeout = Time::from_seconds(60);
+    static constexpr size_t send_buffer_size = 256 * KiB;
 };
 
 }
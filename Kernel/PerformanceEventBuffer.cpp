@@ -32,12 +32,27 @@
 #include <Kernel/KBufferBuilder.h>
 #include <Kernel/PerformanceEventBuffer.h>
 #include <Kernel/Process.h>
+#include <Kernel/UserOrKernelBuffer.h>
 
 namespace Kernel {
 
-PerformanceEventBuffer::PerformanceEventBuffer(NonnullOwnPtr<KBuffer> buffer)
+PerformanceEventBuffer::PerformanceEventBuffer(NonnullOwnPtr<KBuffer> buffer, Mode mode)
     : m_buffer(move(buffer))
+    , m_mode(mode)
 {
+    size_t ring_count = Processor::count();
+    size_t events_per_ring = m_buffer->size() / sizeof(PerformanceEvent) / ring_count;
+    VERIFY(events_per_ring > 0);
+    u32 ring_capacity = 1u << (31 - __builtin_clz(static_cast<u32>(min(events_per_ring, (size_t)NumericLimits<i32>::max()))));
+
+    auto* events = reinterpret_cast<PerformanceEvent*>(m_buffer->data());
+    m_rings.ensure_capacity(ring_count);
+    for (size_t i = 0; i < ring_count; ++i) {
+        auto ring = make<Ring>();
+        ring->events = events + i * ring_capacity;
+        ring->capacity = ring_capacity;
+        m_rings.append(move(ring));
+    }
 }
 
 KResult PerformanceEventBuffer::append(int type, FlatPtr arg1, FlatPtr arg2)
@@ -75,9 +90,6 @@ static Vector<FlatPtr, PerformanceEvent::max_stack_frame_count> raw_backtrace(Fl
 
 KResult PerformanceEventBuffer::append_with_eip_and_ebp(u32 eip, u32 ebp, int type, FlatPtr arg1, FlatPtr arg2)
 {
-    if (count() >= capacity())
-        return ENOBUFS;
-
     PerformanceEvent event;
     event.type = type;
 
@@ -101,23 +113,163 @@ KResult PerformanceEventBuffer::append_with_eip_and_ebp(u32 eip, u32 ebp, int ty
 
     event.tid = Thread::current()->tid().value();
     event.timestamp = TimeManagement::the().uptime_ms();
-    at(m_count++) = event;
+
+    // Samples are appended from the timer interrupt, so keep it from
+    // interleaving with us on this processor's ring.
+    InterruptDisabler disabler;
+    auto processor_id = Processor::id();
+    if (processor_id >= m_rings.size())
+        return ENOBUFS;
+    auto& ring = m_rings[processor_id];
+
+    u32 head = ring.head.load(AK::MemoryOrder::memory_order_relaxed);
+    if (m_mode == Mode::StopWhenFull && head - ring.tail.load(AK::MemoryOrder::memory_order_acquire) >= ring.capacity) {
+        ring.lost.fetch_add(1, AK::MemoryOrder::memory_order_relaxed);
+        return ENOBUFS;
+    }
+
+    // Let readers know that this slot is about to change before touching it.
+    ring.claimed.store(head + 1, AK::MemoryOrder::memory_order_relaxed);
+    full_memory_barrier();
+    ring.slot(head) = event;
+    ring.head.store(head + 1, AK::MemoryOrder::memory_order_release);
     return KSuccess;
 }
 
-PerformanceEvent& PerformanceEventBuffer::at(size_t index)
+bool PerformanceEventBuffer::Ring::read(u32 sequence, PerformanceEvent& event)
 {
-    VERIFY(index < capacity());
-    auto* events = reinterpret_cast<PerformanceEvent*>(m_buffer->data());
-    return events[index];
+    event = slot(sequence);
+    full_memory_barrier();
+    // If the producer has started writing an event that wraps around onto
+    // this slot, what we just copied may be torn.
+    return claimed.load(AK::MemoryOrder::memory_order_relaxed) - sequence <= capacity;
+}
+
+template<typename Callback>
+void PerformanceEventBuffer::for_each_pending_event(bool consume, Callback callback)
+{
+    // Events are merged from all rings in timestamp order.
+    struct Cursor {
+        u32 sequence { 0 };
+        u32 head { 0 };
+        bool has_event { false };
+        PerformanceEvent event;
+    };
+
+    Vector<Cursor> cursors;
+    cursors.resize(m_rings.size());
+
+    auto advance = [&](size_t ring_index) {
+        auto& ring = m_rings[ring_index];
+        auto& cursor = cursors[ring_index];
+        cursor.has_event = false;
+        while (cursor.sequence != cursor.head) {
+            if (ring.read(cursor.sequence, cursor.event)) {
+                cursor.has_event = true;
+                return;
+            }
+            // We fell behind an overwriting producer, skip ahead to what's still there.
+            u32 oldest = ring.oldest_available(cursor.sequence, ring.head.load(AK::MemoryOrder::memory_order_acquire) + 1);
+            if (consume)
+                ring.lost.fetch_add(oldest - cursor.sequence, AK::MemoryOrder::memory_order_relaxed);
+            cursor.sequence = oldest;
+            if (cursor.head - cursor.sequence > ring.capacity)
+                cursor.head = cursor.sequence;
+        }
+    };
+
+    for (size_t i = 0; i < m_rings.size(); ++i) {
+        auto& ring = m_rings[i];
+        auto& cursor = cursors[i];
+        cursor.head = ring.head.load(AK::MemoryOrder::memory_order_acquire);
+        u32 tail = ring.tail.load(AK::MemoryOrder::memory_order_relaxed);
+        cursor.sequence = ring.oldest_available(tail, cursor.head);
+        if (consume && cursor.sequence != tail)
+            ring.lost.fetch_add(cursor.sequence - tail, AK::MemoryOrder::memory_order_relaxed);
+        advance(i);
+    }
+
+    for (;;) {
+        Optional<size_t> next;
+        for (size_t i = 0; i < cursors.size(); ++i) {
+            if (cursors[i].has_event && (!next.has_value() || cursors[i].event.timestamp < cursors[next.value()].event.timestamp))
+                next = i;
+        }
+        if (!next.has_value())
+            break;
+        auto& cursor = cursors[next.value()];
+        if (callback(cursor.event) == IterationDecision::Break)
+            break;
+        ++cursor.sequence;
+        advance(next.value());
+    }
+
+    if (!consume)
+        return;
+    for (size_t i = 0; i < m_rings.size(); ++i)
+        m_rings[i].tail.store(cursors[i].sequence, AK::MemoryOrder::memory_order_release);
+}
+
+void PerformanceEventBuffer::clear()
+{
+    LOCKER(m_read_lock);
+    for (auto& ring : m_rings)
+        ring.tail.store(ring.head.load(AK::MemoryOrder::memory_order_acquire), AK::MemoryOrder::memory_order_release);
+}
+
+size_t PerformanceEventBuffer::capacity() const
+{
+    size_t capacity = 0;
+    for (auto& ring : m_rings)
+        capacity += ring.capacity;
+    return capacity;
+}
+
+size_t PerformanceEventBuffer::count() const
+{
+    size_t count = 0;
+    for (auto& ring : m_rings) {
+        u32 head = ring.head.load(AK::MemoryOrder::memory_order_acquire);
+        count += head - ring.oldest_available(ring.tail.load(AK::MemoryOrder::memory_order_relaxed), head);
+    }
+    return count;
+}
+
+u64 PerformanceEventBuffer::lost_event_count() const
+{
+    u64 lost = 0;
+    for (auto& ring : m_rings)
+        lost += ring.lost.load(AK::MemoryOrder::memory_order_relaxed);
+    return lost;
+}
+
+KResultOr<size_t> PerformanceEventBuffer::drain(UserOrKernelBuffer& buffer, size_t buffer_size)
+{
+    LOCKER(m_read_lock);
+    size_t nwritten = 0;
+    bool faulted = false;
+    for_each_pending_event(true, [&](const PerformanceEvent& event) {
+        if (buffer_size - nwritten < sizeof(PerformanceEvent))
+            return IterationDecision::Break;
+        if (!buffer.write(&event, nwritten, sizeof(PerformanceEvent))) {
+            faulted = true;
+            return IterationDecision::Break;
+        }
+        nwritten += sizeof(PerformanceEvent);
+        return IterationDecision::Continue;
+    });
+    if (faulted && nwritten == 0)
+        return EFAULT;
+    return nwritten;
 }
 
 template<typename Serializer>
 bool PerformanceEventBuffer::to_json_impl(Serializer& object) const
 {
+    object.add("lost_events", lost_event_count());
     auto array = object.add_array("events");
-    for (size_t i = 0; i < m_count; ++i) {
-        auto& event = at(i);
+    LOCKER(m_read_lock);
+    const_cast<PerformanceEventBuffer&>(*this).for_each_pending_event(false, [&](const PerformanceEvent& event) {
         auto event_object = array.add_object();
         switch (event.type) {
         case PERF_EVENT_SAMPLE:
@@ -141,7 +293,8 @@ bool PerformanceEventBuffer::to_json_impl(Serializer& object) const
         }
         stack_array.finish();
         event_object.finish();
-    }
+        return IterationDecision::Continue;
+    });
     array.finish();
     object.finish();
     return true;
@@ -152,6 +305,7 @@ bool PerformanceEventBuffer::to_json(KBufferBuilder& builder) const
     JsonObjectSerializer object(builder);
 
     auto processes_array = object.add_array("processes");
+    ScopedSpinLock lock(m_processes_lock);
     for (auto& it : m_processes) {
         auto& process = *it.value;
         auto process_object = processes_array.add_object();
@@ -168,16 +322,17 @@ bool PerformanceEventBuffer::to_json(KBufferBuilder& builder) const
     }
 
     processes_array.finish();
+    lock.unlock();
 
     return to_json_impl(object);
 }
 
-OwnPtr<PerformanceEventBuffer> PerformanceEventBuffer::try_create_with_size(size_t buffer_size)
+OwnPtr<PerformanceEventBuffer> PerformanceEventBuffer::try_create_with_size(size_t buffer_size, Mode mode)
 {
     auto buffer = KBuffer::try_create_with_size(buffer_size, Region::Access::Read | Region::Access::Write, "Performance events", AllocationStrategy::AllocateNow);
     if (!buffer)
         return {};
-    return adopt_own(*new PerformanceEventBuffer(buffer.release_nonnull()));
+    return adopt_own(*new PerformanceEventBuffer(buffer.release_nonnull(), mode));
 }
 
 void PerformanceEventBuffer::add_process(const Process& process)
@@ -208,6 +363,7 @@ void PerformanceEventBuffer::add_process(const Process& process)
         });
     }
 
+    ScopedSpinLock processes_lock(m_processes_lock);
     m_processes.set(process.pid(), move(sampled_process));
 }
 
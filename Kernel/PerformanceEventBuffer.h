@@ -26,61 +26,56 @@
 
 #pragma once
 
+#include <AK/HashMap.h>
+#include <AK/NonnullOwnPtrVector.h>
+#include <Kernel/API/PerformanceEvent.h>
 #include <Kernel/KBuffer.h>
 #include <Kernel/KResult.h>
+#include <Kernel/Lock.h>
+#include <Kernel/SpinLock.h>
 
 namespace Kernel {
 
 class KBufferBuilder;
 
-struct [[gnu::packed]] MallocPerformanceEvent {
-    size_t size;
-    FlatPtr ptr;
-};
-
-struct [[gnu::packed]] FreePerformanceEvent {
-    size_t size;
-    FlatPtr ptr;
-};
-
-struct [[gnu::packed]] PerformanceEvent {
-    u8 type { 0 };
-    u8 stack_size { 0 };
-    u32 tid { 0 };
-    u64 timestamp;
-    union {
-        MallocPerformanceEvent malloc;
-        FreePerformanceEvent free;
-    } data;
-    static constexpr size_t max_stack_frame_count = 32;
-    FlatPtr stack[max_stack_frame_count];
-};
-
+// Events are recorded into one ring per processor. Each ring only ever has
+// one producer (its processor, with interrupts disabled), so appending never
+// takes a lock. Readers are serialized with each other and detect events
+// that were overwritten while they were copying them.
 class PerformanceEventBuffer {
 public:
-    static OwnPtr<PerformanceEventBuffer> try_create_with_size(size_t buffer_size);
+    enum class Mode {
+        // Drop new events once the buffer is full.
+        StopWhenFull,
+        // Overwrite the oldest events once the buffer is full, so that the
+        // buffer always holds the most recent history ("flight recorder").
+        Overwrite,
+    };
+
+    static OwnPtr<PerformanceEventBuffer> try_create_with_size(size_t buffer_size, Mode = Mode::StopWhenFull);
 
     KResult append(int type, FlatPtr arg1, FlatPtr arg2);
     KResult append_with_eip_and_ebp(u32 eip, u32 ebp, int type, FlatPtr arg1, FlatPtr arg2);
 
-    void clear()
-    {
-        m_count = 0;
-    }
+    void clear();
+
+    Mode mode() const { return m_mode; }
+    void set_mode(Mode mode) { m_mode = mode; }
 
-    size_t capacity() const { return m_buffer->size() / sizeof(PerformanceEvent); }
-    size_t count() const { return m_count; }
-    const PerformanceEvent& at(size_t index) const
-    {
-        return const_cast<PerformanceEventBuffer&>(*this).at(index);
-    }
+    size_t capacity() const;
+    size_t count() const;
+    u64 lost_event_count() const;
 
     bool to_json(KBufferBuilder&) const;
 
+    // Moves up to buffer_size bytes worth of pending events into the buffer,
+    // oldest first, and returns the number of bytes written.
+    KResultOr<size_t> drain(UserOrKernelBuffer&, size_t buffer_size);
+
     void add_process(const Process&);
 
 private:
-    explicit PerformanceEventBuffer(NonnullOwnPtr<KBuffer>);
+    explicit PerformanceEventBuffer(NonnullOwnPtr<KBuffer>, Mode);
 
     struct SampledProcess {
         ProcessID pid;
@@ -94,14 +89,35 @@ private:
         Vector<Region> regions;
     };
 
+    struct Ring {
+        PerformanceEvent* events { nullptr };
+        // Always a power of two, so that the sequence numbers below can wrap.
+        u32 capacity { 0 };
+        // Sequence number of the next event to be published.
+        Atomic<u32> head { 0 };
+        // Sequence number of the event that is currently being written, plus one.
+        Atomic<u32> claimed { 0 };
+        // Sequence number of the oldest event that hasn't been drained yet.
+        Atomic<u32> tail { 0 };
+        Atomic<u32> lost { 0 };
+
+        PerformanceEvent& slot(u32 sequence) { return events[sequence & (capacity - 1)]; }
+        u32 oldest_available(u32 tail, u32 head) const { return head - tail > capacity ? head - capacity : tail; }
+        bool read(u32 sequence, PerformanceEvent&);
+    };
+
+    template<typename Callback>
+    void for_each_pending_event(bool consume, Callback);
+
     template<typename Serializer>
     bool to_json_impl(Serializer&) const;
 
-    PerformanceEvent& at(size_t index);
-
-    size_t m_count { 0 };
     NonnullOwnPtr<KBuffer> m_buffer;
+    NonnullOwnPtrVector<Ring> m_rings;
+    Atomic<Mode, AK::MemoryOrder::memory_order_relaxed> m_mode { Mode::StopWhenFull };
+    mutable Lock m_read_lock { "PerformanceEventBuffer" };
 
+    mutable SpinLock<u8> m_processes_lock;
     HashMap<ProcessID, NonnullOwnPtr<SampledProcess>> m_processes;
 };
 
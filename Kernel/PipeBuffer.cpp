@@ -0,0 +1,158 @@
+/*
+ * Copyright (c) 2021, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <Kernel/PipeBuffer.h>
+#include <Kernel/VM/MemoryManager.h>
+
+namespace Kernel {
+
+PipeBuffer::PipeBuffer(size_t capacity)
+    : m_capacity(capacity)
+{
+    VERIFY(capacity > 0);
+}
+
+PipeBuffer::~PipeBuffer()
+{
+    while (auto* chunk = m_chunks.take_first())
+        delete chunk;
+    delete m_spare_chunk;
+}
+
+PipeBuffer::Chunk* PipeBuffer::allocate_chunk()
+{
+    auto region = MM.allocate_kernel_region(chunk_size, "PipeBuffer", Region::Access::Read | Region::Access::Write, AllocationStrategy::AllocateNow);
+    if (!region)
+        return nullptr;
+    return new Chunk(region.release_nonnull());
+}
+
+ssize_t PipeBuffer::write(const UserOrKernelBuffer& data, size_t size)
+{
+    if (!size)
+        return 0;
+    LOCKER(m_write_lock);
+
+    size_t nwritten = 0;
+    while (nwritten < size) {
+        Chunk* chunk = nullptr;
+        size_t bytes_to_write = 0;
+        {
+            ScopedSpinLock lock(m_chunks_lock);
+            size_t space = m_capacity - m_size.load(AK::MemoryOrder::memory_order_relaxed);
+            if (space == 0)
+                break;
+            chunk = m_chunks.last();
+            if (!chunk || chunk->write_offset == chunk_size) {
+                chunk = exchange(m_spare_chunk, nullptr);
+                if (!chunk) {
+                    lock.unlock();
+                    chunk = allocate_chunk();
+                    if (!chunk) {
+                        if (nwritten == 0)
+                            return -ENOMEM;
+                        break;
+                    }
+                    lock.lock();
+                }
+                m_chunks.append(*chunk);
+            }
+            bytes_to_write = min(min(size - nwritten, chunk_size - chunk->write_offset), space);
+        }
+
+        // Only this writer touches the chunk past its write offset, and readers never look beyond it.
+        if (!data.read(chunk->data() + chunk->write_offset, nwritten, bytes_to_write)) {
+            if (nwritten == 0)
+                return -EFAULT;
+            break;
+        }
+
+        {
+            ScopedSpinLock lock(m_chunks_lock);
+            chunk->write_offset += bytes_to_write;
+            m_size.fetch_add(bytes_to_write, AK::MemoryOrder::memory_order_relaxed);
+        }
+        nwritten += bytes_to_write;
+    }
+
+    if (nwritten > 0 && m_unblock_callback)
+        m_unblock_callback();
+    return (ssize_t)nwritten;
+}
+
+ssize_t PipeBuffer::read(UserOrKernelBuffer& data, size_t size)
+{
+    if (!size)
+        return 0;
+    LOCKER(m_read_lock);
+
+    size_t nread = 0;
+    while (nread < size) {
+        Chunk* chunk = nullptr;
+        size_t bytes_to_read = 0;
+        {
+            ScopedSpinLock lock(m_chunks_lock);
+            chunk = m_chunks.first();
+            if (!chunk)
+                break;
+            bytes_to_read = min(size - nread, chunk->write_offset - chunk->read_offset);
+            if (bytes_to_read == 0)
+                break;
+        }
+
+        // Only this reader touches the chunk below its write offset.
+        if (!data.write(chunk->data() + chunk->read_offset, nread, bytes_to_read)) {
+            if (nread == 0)
+                return -EFAULT;
+            break;
+        }
+
+        Chunk* chunk_to_free = nullptr;
+        {
+            ScopedSpinLock lock(m_chunks_lock);
+            chunk->read_offset += bytes_to_read;
+            m_size.fetch_sub(bytes_to_read, AK::MemoryOrder::memory_order_relaxed);
+            if (chunk->read_offset == chunk_size) {
+                // A full chunk that has been drained is never written to again.
+                m_chunks.remove(*chunk);
+                chunk->read_offset = 0;
+                chunk->write_offset = 0;
+                if (m_spare_chunk)
+                    chunk_to_free = chunk;
+                else
+                    m_spare_chunk = chunk;
+            }
+        }
+        delete chunk_to_free;
+        nread += bytes_to_read;
+    }
+
+    if (nread > 0 && m_unblock_callback)
+        m_unblock_callback();
+    return (ssize_t)nread;
+}
+
+}
@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2021, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <AK/Atomic.h>
+#include <AK/Function.h>
+#include <AK/IntrusiveList.h>
+#include <AK/OwnPtr.h>
+#include <AK/Types.h>
+#include <Kernel/Lock.h>
+#include <Kernel/SpinLock.h>
+#include <Kernel/UserOrKernelBuffer.h>
+#include <Kernel/VM/Region.h>
+
+namespace Kernel {
+
+// PipeBuffer: A byte stream buffer for pipes and local sockets.
+//
+// The data lives in a queue of page-backed chunks that is only as long as the
+// amount of data that is currently buffered, so idle pipes hardly use any
+// memory while busy ones can buffer up to their capacity.
+//
+// Readers and writers are serialized among themselves, but not against each
+// other: data is copied in and out of the chunks without holding any lock
+// that is shared between the two sides. Only the bookkeeping afterwards takes
+// a short spinlock.
+class PipeBuffer {
+    AK_MAKE_NONCOPYABLE(PipeBuffer);
+    AK_MAKE_NONMOVABLE(PipeBuffer);
+
+public:
+    static constexpr size_t chunk_size = 16 * KiB;
+
+    explicit PipeBuffer(size_t capacity = 64 * KiB);
+    ~PipeBuffer();
+
+    [[nodiscard]] ssize_t write(const UserOrKernelBuffer&, size_t);
+    [[nodiscard]] ssize_t write(const u8* data, size_t size)
+    {
+        return write(UserOrKernelBuffer::for_kernel_buffer(const_cast<u8*>(data)), size);
+    }
+    [[nodiscard]] ssize_t read(UserOrKernelBuffer&, size_t);
+    [[nodiscard]] ssize_t read(u8* data, size_t size)
+    {
+        auto buffer = UserOrKernelBuffer::for_kernel_buffer(data);
+        return read(buffer, size);
+    }
+
+    bool is_empty() const { return m_size.load(AK::MemoryOrder::memory_order_relaxed) == 0; }
+    size_t size() const { return m_size.load(AK::MemoryOrder::memory_order_relaxed); }
+    size_t capacity() const { return m_capacity; }
+    size_t space_for_writing() const { return m_capacity - size(); }
+
+    void set_unblock_callback(Function<void()> callback)
+    {
+        VERIFY(!m_unblock_callback);
+        m_unblock_callback = move(callback);
+    }
+
+private:
+    struct Chunk {
+        explicit Chunk(NonnullOwnPtr<Region>&& region)
+            : region(move(region))
+        {
+        }
+
+        u8* data() { return region->vaddr().as_ptr(); }
+
+        NonnullOwnPtr<Region> region;
+        size_t read_offset { 0 };
+        size_t write_offset { 0 };
+        IntrusiveListNode list_node;
+    };
+
+    static Chunk* allocate_chunk();
+
+    IntrusiveList<Chunk, &Chunk::list_node> m_chunks;
+    // The most recently drained chunk is kept around so that a steady stream of data doesn't
+    // have to allocate and map fresh memory every chunk_size bytes.
+    Chunk* m_spare_chunk { nullptr };
+    SpinLock<u8> m_chunks_lock;
+
+    Function<void()> m_unblock_callback;
+    size_t m_capacity { 0 };
+    Atomic<size_t> m_size { 0 };
+
+    Lock m_write_lock { "PipeBuffer write" };
+    Lock m_read_lock { "PipeBuffer read" };
+};
+
+}
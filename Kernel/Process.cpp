@@ -50,6 +50,7 @@
 #include <Kernel/VM/PageDirectory.h>
 #include <Kernel/VM/PrivateInodeVMObject.h>
 #include <Kernel/VM/SharedInodeVMObject.h>
+#include <Kernel/VM/TLBFlushBatch.h>
 #include <LibC/errno_numbers.h>
 #include <LibC/limits.h>
 
@@ -59,6 +60,7 @@ static void create_signal_trampoline();
 
 RecursiveSpinLock g_processes_lock;
 static Atomic<pid_t> next_pid;
+Atomic<u32> Process::s_statistics_generation { 1 };
 READONLY_AFTER_INIT InlineLinkedList<Process>* g_processes;
 READONLY_AFTER_INIT String* g_hostname;
 READONLY_AFTER_INIT Lock* g_hostname_lock;
@@ -232,6 +234,7 @@ Process::Process(RefPtr<Thread>& first_thread, const String& name, uid_t uid, gi
 
     m_pid = allocate_pid();
     m_ppid = ppid;
+    did_change_statistics();
     m_uid = uid;
     m_gid = gid;
     m_euid = uid;
@@ -525,7 +528,10 @@ void Process::finalize()
 
     unblock_waiters(Thread::WaitBlocker::UnblockFlags::Terminated);
 
-    m_space->remove_all_regions({});
+    {
+        TLBFlushBatch tlb_batch(m_space->page_directory());
+        m_space->remove_all_regions({});
+    }
 
     VERIFY(ref_count() > 0);
     // WaitBlockCondition::finalize will be in charge of dropping the last
@@ -695,7 +701,8 @@ bool Process::create_perf_events_buffer_if_needed()
 {
     if (!m_perf_event_buffer) {
         m_perf_event_buffer = PerformanceEventBuffer::try_create_with_size(4 * MiB);
-        m_perf_event_buffer->add_process(*this);
+        if (m_perf_event_buffer)
+            m_perf_event_buffer->add_process(*this);
     }
     return !!m_perf_event_buffer;
 }
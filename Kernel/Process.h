@@ -204,6 +204,11 @@ public:
 
     bool is_profiling() const { return m_profiling; }
     void set_profiling(bool profiling) { m_profiling = profiling; }
+
+    // Marks this process as changed in the current statistics generation,
+    // see sys$get_process_statistics().
+    void did_change_statistics() { m_statistics_generation = s_statistics_generation.load(AK::MemoryOrder::memory_order_relaxed); }
+    u32 statistics_generation() const { return m_statistics_generation; }
     bool should_core_dump() const { return m_should_dump_core; }
     void set_dump_core(bool dump_core) { m_should_dump_core = dump_core; }
 
@@ -314,6 +319,13 @@ public:
     KResultOr<int> sys$purge(int mode);
     KResultOr<int> sys$select(Userspace<const Syscall::SC_select_params*>);
     KResultOr<int> sys$poll(Userspace<const Syscall::SC_poll_params*>);
+    KResultOr<int> sys$epoll_create1(int flags);
+    KResultOr<int> sys$epoll_ctl(Userspace<const Syscall::SC_epoll_ctl_params*>);
+    KResultOr<int> sys$epoll_wait(Userspace<const Syscall::SC_epoll_wait_params*>);
+    KResultOr<int> sys$io_ring_create(u32 entries, Userspace<size_t*> mapping_size);
+    KResultOr<int> sys$io_ring_enter(int fd, u32 to_submit, u32 min_complete);
+    KResultOr<ssize_t> sys$sendfile(Userspace<const Syscall::SC_sendfile_params*>);
+    KResultOr<ssize_t> sys$splice(Userspace<const Syscall::SC_splice_params*>);
     KResultOr<ssize_t> sys$get_dir_entries(int fd, Userspace<void*>, ssize_t);
     KResultOr<int> sys$getcwd(Userspace<char*>, size_t);
     KResultOr<int> sys$chdir(Userspace<const char*>, size_t);
@@ -331,6 +343,7 @@ public:
     KResultOr<int> sys$ptsname(int fd, Userspace<char*>, size_t);
     KResultOr<pid_t> sys$fork(RegisterState&);
     KResultOr<int> sys$execve(Userspace<const Syscall::SC_execve_params*>);
+    KResultOr<pid_t> sys$posix_spawn(Userspace<const Syscall::SC_posix_spawn_params*>);
     KResultOr<int> sys$dup2(int old_fd, int new_fd);
     KResultOr<int> sys$sigaction(int signum, Userspace<const sigaction*> act, Userspace<sigaction*> old_act);
     KResultOr<int> sys$sigprocmask(int how, Userspace<const sigset_t*> set, Userspace<sigset_t*> old_set);
@@ -392,8 +405,10 @@ public:
     KResultOr<int> sys$setkeymap(Userspace<const Syscall::SC_setkeymap_params*>);
     KResultOr<int> sys$module_load(Userspace<const char*> path, size_t path_length);
     KResultOr<int> sys$module_unload(Userspace<const char*> name, size_t name_length);
-    KResultOr<int> sys$profiling_enable(pid_t);
+    KResultOr<int> sys$profiling_enable(pid_t, unsigned flags);
     KResultOr<int> sys$profiling_disable(pid_t);
+    KResultOr<ssize_t> sys$profiling_drain(pid_t, Userspace<void*>, size_t);
+    KResultOr<ssize_t> sys$get_process_statistics(Userspace<const Syscall::SC_get_process_statistics_params*>);
     KResultOr<int> sys$futex(Userspace<const Syscall::SC_futex_params*>);
     KResultOr<int> sys$chroot(Userspace<const char*> path, size_t path_length, int mount_flags);
     KResultOr<int> sys$pledge(Userspace<const Syscall::SC_pledge_params*>);
@@ -443,6 +458,9 @@ public:
 
     KResult exec(String path, Vector<String> arguments, Vector<String> environment, int recusion_depth = 0);
 
+    // Does the work of sys$accept(). Only waits for a connection if may_block is set and the socket is blocking.
+    KResultOr<int> accept(int accepting_socket_fd, Userspace<sockaddr*>, Userspace<socklen_t*>, bool may_block);
+
     KResultOr<LoadResult> load(NonnullRefPtr<FileDescription> main_program_description, RefPtr<FileDescription> interpreter_description, const Elf32_Ehdr& main_program_header);
 
     bool is_superuser() const { return euid() == 0; }
@@ -524,6 +542,7 @@ private:
 
     KResult do_exec(NonnullRefPtr<FileDescription> main_program_description, Vector<String> arguments, Vector<String> environment, RefPtr<FileDescription> interpreter_description, Thread*& new_main_thread, u32& prev_flags, const Elf32_Ehdr& main_program_header);
     KResultOr<ssize_t> do_write(FileDescription&, const UserOrKernelBuffer&, size_t);
+    KResultOr<ssize_t> do_transfer(FileDescription& in, Optional<off_t>& in_offset, FileDescription& out, Optional<off_t>& out_offset, size_t count, bool nonblocking);
 
     KResultOr<RefPtr<FileDescription>> find_elf_interpreter_for_executable(const String& path, const Elf32_Ehdr& elf_header, int nread, size_t file_size);
 
@@ -547,6 +566,11 @@ private:
 
     void clear_futex_queues_on_exec();
 
+    void copy_inherited_state_to(Process& child) const;
+    static bool copy_user_strings(const Syscall::StringListArgument&, Vector<String>&);
+    KResult apply_spawn_file_action(const Syscall::SC_posix_spawn_file_action&, const String& path);
+    KResult apply_spawn_attributes(const Syscall::SC_posix_spawn_params&, Thread& first_thread);
+
     Process* m_prev { nullptr };
     Process* m_next { nullptr };
 
@@ -587,6 +611,8 @@ private:
     const bool m_is_kernel_process;
     bool m_dead { false };
     bool m_profiling { false };
+    Atomic<u32, AK::MemoryOrder::memory_order_relaxed> m_statistics_generation { 0 };
+    static Atomic<u32> s_statistics_generation;
     Atomic<bool, AK::MemoryOrder::memory_order_relaxed> m_is_stopped { false };
     bool m_should_dump_core { false };
 
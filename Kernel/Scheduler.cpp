@@ -75,10 +75,24 @@ READONLY_AFTER_INIT static Process* s_colonel_process;
 struct ThreadReadyQueue {
     IntrusiveList<Thread, &Thread::m_ready_queue_node> thread_list;
 };
-static SpinLock<u8> g_ready_queues_lock;
-static u32 g_ready_queues_mask;
-static constexpr u32 g_ready_queue_buckets = sizeof(g_ready_queues_mask) * 8;
-READONLY_AFTER_INIT static ThreadReadyQueue* g_ready_queues; // g_ready_queue_buckets entries
+
+static constexpr u32 g_ready_queue_buckets = sizeof(u32) * 8;
+
+// Each processor owns one set of ready queues. Threads are queued on the
+// processor they last ran on (if their affinity allows it) to keep their
+// working set cache-hot. A processor that runs out of work steals from the
+// processor that has the most urgent runnable thread it is allowed to run.
+struct ProcessorReadyQueues {
+    SpinLock<u8> lock;
+    u32 mask { 0 };
+    Atomic<u32, AK::MemoryOrder::memory_order_relaxed> thread_count { 0 };
+    ThreadReadyQueue queues[g_ready_queue_buckets];
+};
+
+// Thread affinities and the idle processor mask are 32 bit masks, so we can
+// never schedule on more processors than that.
+static constexpr u32 g_max_ready_queue_processors = sizeof(u32) * 8;
+READONLY_AFTER_INIT static ProcessorReadyQueues* g_ready_queues; // g_max_ready_queue_processors entries
 
 static inline u32 thread_priority_to_priority_index(u32 thread_priority)
 {
@@ -92,16 +106,33 @@ static inline u32 thread_priority_to_priority_index(u32 thread_priority)
     return priority_bucket;
 }
 
-Thread& Scheduler::pull_next_runnable_thread()
+static u32 select_processor_for(const Thread& thread)
 {
-    auto affinity_mask = 1u << Processor::current().id();
+    auto affinity = thread.affinity();
+    auto processor_count = min(Processor::count(), g_max_ready_queue_processors);
+
+    // Prefer the processor the thread last ran on, its caches are most likely still warm
+    auto last_cpu = thread.cpu();
+    if (last_cpu < processor_count && (affinity & (1u << last_cpu)))
+        return last_cpu;
+
+    auto current_cpu = Processor::id();
+    if (affinity & (1u << current_cpu))
+        return current_cpu;
+
+    // The thread is pinned elsewhere, e.g. to a processor that hasn't finished booting yet
+    VERIFY(affinity != 0);
+    return __builtin_ffsl(affinity) - 1;
+}
 
-    ScopedSpinLock lock(g_ready_queues_lock);
-    auto priority_mask = g_ready_queues_mask;
+Thread* Scheduler::pull_runnable_thread_from(ProcessorReadyQueues& ready_queues, u32 affinity_mask)
+{
+    ScopedSpinLock lock(ready_queues.lock);
+    auto priority_mask = ready_queues.mask;
     while (priority_mask != 0) {
         auto priority = __builtin_ffsl(priority_mask);
         VERIFY(priority > 0);
-        auto& ready_queue = g_ready_queues[--priority];
+        auto& ready_queue = ready_queues.queues[--priority];
         for (auto& thread : ready_queue.thread_list) {
             VERIFY(thread.m_runnable_priority == (int)priority);
             if (thread.is_active())
@@ -110,8 +141,9 @@ Thread& Scheduler::pull_next_runnable_thread()
                 continue;
             thread.m_runnable_priority = -1;
             ready_queue.thread_list.remove(thread);
+            ready_queues.thread_count--;
             if (ready_queue.thread_list.is_empty())
-                g_ready_queues_mask &= ~(1u << priority);
+                ready_queues.mask &= ~(1u << priority);
             // Mark it as active because we are using this thread. This is similar
             // to comparing it with Processor::current_thread, but when there are
             // multiple processors there's no easy way to check whether the thread
@@ -123,10 +155,58 @@ Thread& Scheduler::pull_next_runnable_thread()
             // switching to it.
             // FIXME: Figure out a better way maybe?
             thread.set_active(true);
-            return thread;
+            return &thread;
         }
         priority_mask &= ~(1u << priority);
     }
+    return nullptr;
+}
+
+Thread& Scheduler::pull_next_runnable_thread()
+{
+    auto current_cpu = Processor::id();
+    auto affinity_mask = 1u << current_cpu;
+
+    if (auto* thread = pull_runnable_thread_from(g_ready_queues[current_cpu], affinity_mask))
+        return *thread;
+
+    // Our own queues are empty, try to steal work from another processor.
+    // We pick the victim with the most urgent work, and among those the one
+    // with the most threads waiting. The masks are only peeked at without
+    // taking the locks, pull_runnable_thread_from will re-check under the lock.
+    auto processor_count = min(Processor::count(), g_max_ready_queue_processors);
+    u32 candidates = ((processor_count < 32) ? (1u << processor_count) - 1 : 0xffffffff) & ~affinity_mask;
+    while (candidates != 0) {
+        u32 victim_cpu = 0;
+        u32 victim_lowest_bucket = 0;
+        u32 victim_thread_count = 0;
+        for (auto remaining = candidates; remaining != 0;) {
+            u32 cpu = __builtin_ffsl(remaining) - 1;
+            remaining &= ~(1u << cpu);
+            auto& ready_queues = g_ready_queues[cpu];
+            auto mask = AK::atomic_load(&ready_queues.mask, AK::MemoryOrder::memory_order_relaxed);
+            if (mask == 0) {
+                candidates &= ~(1u << cpu);
+                continue;
+            }
+            auto lowest_bucket = mask & -mask;
+            auto thread_count = ready_queues.thread_count.load();
+            if (victim_lowest_bucket == 0 || lowest_bucket < victim_lowest_bucket
+                || (lowest_bucket == victim_lowest_bucket && thread_count > victim_thread_count)) {
+                victim_cpu = cpu;
+                victim_lowest_bucket = lowest_bucket;
+                victim_thread_count = thread_count;
+            }
+        }
+        if (victim_lowest_bucket == 0)
+            break;
+        if (auto* thread = pull_runnable_thread_from(g_ready_queues[victim_cpu], affinity_mask)) {
+            dbgln_if(SCHEDULER_DEBUG, "Scheduler[{}]: Stole thread {} from processor {}", current_cpu, *thread, victim_cpu);
+            return *thread;
+        }
+        // Nothing on the victim we are allowed to run, try the next one
+        candidates &= ~(1u << victim_cpu);
+    }
     return *Processor::current().idle_thread();
 }
 
@@ -134,9 +214,7 @@ bool Scheduler::dequeue_runnable_thread(Thread& thread, bool check_affinity)
 {
     if (&thread == Processor::current().idle_thread())
         return true;
-    ScopedSpinLock lock(g_ready_queues_lock);
-    auto priority = thread.m_runnable_priority;
-    if (priority < 0) {
+    if (thread.m_runnable_priority < 0) {
         VERIFY(!thread.m_ready_queue_node.is_in_list());
         return false;
     }
@@ -144,12 +222,22 @@ bool Scheduler::dequeue_runnable_thread(Thread& thread, bool check_affinity)
     if (check_affinity && !(thread.affinity() & (1 << Processor::current().id())))
         return false;
 
-    VERIFY(g_ready_queues_mask & (1u << priority));
-    auto& ready_queue = g_ready_queues[priority];
+    // NOTE: m_runnable_cpu only changes while holding g_scheduler_lock, which we own
+    auto& ready_queues = g_ready_queues[thread.m_runnable_cpu];
+    ScopedSpinLock lock(ready_queues.lock);
+    auto priority = thread.m_runnable_priority;
+    if (priority < 0) {
+        VERIFY(!thread.m_ready_queue_node.is_in_list());
+        return false;
+    }
+
+    VERIFY(ready_queues.mask & (1u << priority));
+    auto& ready_queue = ready_queues.queues[priority];
     thread.m_runnable_priority = -1;
     ready_queue.thread_list.remove(thread);
+    ready_queues.thread_count--;
     if (ready_queue.thread_list.is_empty())
-        g_ready_queues_mask &= ~(1u << priority);
+        ready_queues.mask &= ~(1u << priority);
     return true;
 }
 
@@ -159,16 +247,20 @@ void Scheduler::queue_runnable_thread(Thread& thread)
     if (&thread == Processor::current().idle_thread())
         return;
     auto priority = thread_priority_to_priority_index(thread.priority());
+    auto cpu = select_processor_for(thread);
 
-    ScopedSpinLock lock(g_ready_queues_lock);
+    auto& ready_queues = g_ready_queues[cpu];
+    ScopedSpinLock lock(ready_queues.lock);
     VERIFY(thread.m_runnable_priority < 0);
     thread.m_runnable_priority = (int)priority;
+    thread.m_runnable_cpu = cpu;
     VERIFY(!thread.m_ready_queue_node.is_in_list());
-    auto& ready_queue = g_ready_queues[priority];
+    auto& ready_queue = ready_queues.queues[priority];
     bool was_empty = ready_queue.thread_list.is_empty();
     ready_queue.thread_list.append(thread);
+    ready_queues.thread_count++;
     if (was_empty)
-        g_ready_queues_mask |= (1u << priority);
+        ready_queues.mask |= (1u << priority);
 }
 
 UNMAP_AFTER_INIT void Scheduler::start()
@@ -405,6 +497,11 @@ bool Scheduler::context_switch(Thread* thread)
     }
 
     auto& proc = Processor::current();
+    if (proc.is_in_tickless_idle()) {
+        // We're switching away from the idle thread, resume ticking
+        TimeManagement::the().leave_tickless_idle();
+    }
+
     if (!thread->is_initialized()) {
         proc.init_context(*thread, false);
         thread->set_initialized(true);
@@ -497,7 +594,7 @@ UNMAP_AFTER_INIT void Scheduler::initialize()
 
     RefPtr<Thread> idle_thread;
     g_finalizer_wait_queue = new WaitQueue;
-    g_ready_queues = new ThreadReadyQueue[g_ready_queue_buckets];
+    g_ready_queues = new ProcessorReadyQueues[g_max_ready_queue_processors];
 
     g_finalizer_has_work.store(false, AK::MemoryOrder::memory_order_release);
     s_colonel_process = Process::create_kernel_process(idle_thread, "colonel", idle_loop, nullptr, 1).leak_ref();
@@ -618,9 +715,24 @@ void Scheduler::idle_loop(void*)
     dbgln("Scheduler[{}]: idle loop running", proc.get_id());
     VERIFY(are_interrupts_enabled());
 
+    auto& time_management = TimeManagement::the();
     for (;;) {
         proc.idle_begin();
-        asm("hlt");
+        if (time_management.is_tickless()) {
+            // Arm the local timer with interrupts disabled. "sti; hlt" only
+            // allows interrupts once we're about to halt, so an interrupt waking
+            // up a thread can't slip in between and leave us halted until the
+            // next timer deadline.
+            cli();
+            time_management.enter_tickless_idle();
+            asm volatile("sti\n"
+                         "hlt");
+            cli();
+            time_management.leave_tickless_idle();
+            sti();
+        } else {
+            asm("hlt");
+        }
 
         proc.idle_end();
         VERIFY_INTERRUPTS_ENABLED();
@@ -39,6 +39,7 @@ namespace Kernel {
 class Process;
 class Thread;
 class WaitQueue;
+struct ProcessorReadyQueues;
 struct RegisterState;
 
 extern Thread* g_finalizer;
@@ -70,6 +71,9 @@ public:
     static Thread& pull_next_runnable_thread();
     static bool dequeue_runnable_thread(Thread&, bool = false);
     static void queue_runnable_thread(Thread&);
+
+private:
+    static Thread* pull_runnable_thread_from(ProcessorReadyQueues&, u32 affinity_mask);
 };
 
 }
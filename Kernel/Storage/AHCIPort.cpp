@@ -25,6 +25,7 @@
  */
 
 #include <AK/Atomic.h>
+#include <AK/ScopeGuard.h>
 #include <Kernel/SpinLock.h>
 #include <Kernel/Storage/AHCIPort.h>
 #include <Kernel/Storage/ATA.h>
@@ -36,17 +37,6 @@
 
 namespace Kernel {
 
-NonnullRefPtr<AHCIPort::ScatterList> AHCIPort::ScatterList::create(AsyncBlockDeviceRequest& request, NonnullRefPtrVector<PhysicalPage> allocated_pages, size_t device_block_size)
-{
-    return adopt(*new ScatterList(request, allocated_pages, device_block_size));
-}
-
-AHCIPort::ScatterList::ScatterList(AsyncBlockDeviceRequest& request, NonnullRefPtrVector<PhysicalPage> allocated_pages, size_t device_block_size)
-    : m_vm_object(AnonymousVMObject::create_with_physical_pages(allocated_pages))
-{
-    m_dma_region = MM.allocate_kernel_region_with_vmobject(m_vm_object, page_round_up((request.block_count() * device_block_size)), "AHCI Scattered DMA", Region::Access::Read | Region::Access::Write, Region::Cacheable::Yes);
-}
-
 NonnullRefPtr<AHCIPort> AHCIPort::create(const AHCIPortHandler& handler, volatile AHCI::PortRegisters& registers, u32 port_index)
 {
     return adopt(*new AHCIPort(handler, registers, port_index));
@@ -72,12 +62,20 @@ AHCIPort::AHCIPort(const AHCIPortHandler& handler, volatile AHCI::PortRegisters&
     dbgln_if(AHCI_DEBUG, "AHCI Port {}: Command list page at {}", representative_port_index(), m_command_list_page->paddr());
     dbgln_if(AHCI_DEBUG, "AHCI Port {}: FIS receive page at {}", representative_port_index(), m_command_list_page->paddr());
 
-    for (size_t index = 0; index < 1; index++) {
-        m_dma_buffers.append(MM.allocate_supervisor_physical_page().release_nonnull());
-    }
-    for (size_t index = 0; index < 1; index++) {
-        m_command_table_pages.append(MM.allocate_supervisor_physical_page().release_nonnull());
+    size_t command_slots_count = min(m_parent_handler->hba_capabilities().max_command_list_entries_count, (size_t)AHCI::Limits::MaxCommands);
+    for (size_t index = 0; index < command_slots_count; index++) {
+        CommandSlot slot;
+        slot.command_table_page = MM.allocate_supervisor_physical_page();
+        slot.dma_buffer_page = MM.allocate_supervisor_physical_page();
+        if (slot.command_table_page.is_null() || slot.dma_buffer_page.is_null())
+            break;
+        slot.command_table_region = MM.allocate_kernel_region(slot.command_table_page->paddr(), PAGE_SIZE, "AHCI Command Table", Region::Access::Read | Region::Access::Write, Region::Cacheable::No);
+        slot.dma_buffer_region = MM.allocate_kernel_region(slot.dma_buffer_page->paddr(), PAGE_SIZE, "AHCI DMA Buffer", Region::Access::Read | Region::Access::Write);
+        if (!slot.command_table_region || !slot.dma_buffer_region)
+            break;
+        m_command_slots.append(move(slot));
     }
+    dbgln_if(AHCI_DEBUG, "AHCI Port {}: {} command slots available", representative_port_index(), m_command_slots.size());
     m_command_list_region = MM.allocate_kernel_region(m_command_list_page->paddr(), PAGE_SIZE, "AHCI Port Command List", Region::Access::Read | Region::Access::Write, Region::Cacheable::No);
     dbgln_if(AHCI_DEBUG, "AHCI Port {}: Command list region at {}", representative_port_index(), m_command_list_region->vaddr());
 
@@ -114,31 +112,28 @@ void AHCIPort::handle_interrupt()
         });
         return;
     }
-    if (m_interrupt_status.is_set(AHCI::PortInterruptFlag::DHR) || m_interrupt_status.is_set(AHCI::PortInterruptFlag::PS)) {
+    if (m_interrupt_status.is_set(AHCI::PortInterruptFlag::DHR) || m_interrupt_status.is_set(AHCI::PortInterruptFlag::PS) || m_interrupt_status.is_set(AHCI::PortInterruptFlag::SDB)) {
         m_wait_for_completion = false;
 
+        // Acknowledge before looking at PxCI and PxSACT, so a command that
+        // completes while we are in here raises a new interrupt.
+        m_interrupt_status.clear();
+
+        u32 completed_slots;
+        {
+            ScopedSpinLock lock(m_hard_lock);
+            completed_slots = m_issued_command_slots & ~(m_port_registers.ci | m_port_registers.sact);
+            m_issued_command_slots &= ~completed_slots;
+        }
+
         // Now schedule reading/writing the buffer as soon as we leave the irq handler.
         // This is important so that we can safely access the buffers, which could
         // trigger page faults
-        if (!m_current_request) {
+        if (!completed_slots) {
             dbgln_if(AHCI_DEBUG, "AHCI Port {}: Request handled, probably identify request", representative_port_index());
         } else {
-            g_io_work->queue([this]() {
-                dbgln_if(AHCI_DEBUG, "AHCI Port {}: Request handled", representative_port_index());
-                LOCKER(m_lock);
-                VERIFY(m_current_request);
-                VERIFY(m_current_scatter_list);
-                if (m_current_request->request_type() == AsyncBlockDeviceRequest::Read) {
-                    if (!m_current_request->write_to_buffer(m_current_request->buffer(), m_current_scatter_list->dma_region().as_ptr(), m_connected_device->block_size() * m_current_request->block_count())) {
-                        dbgln_if(AHCI_DEBUG, "AHCI Port {}: Request failure, memory fault occurred when reading in data.", representative_port_index());
-                        m_current_scatter_list = nullptr;
-                        complete_current_request(AsyncDeviceRequest::MemoryFault);
-                        return;
-                    }
-                }
-                m_current_scatter_list = nullptr;
-                dbgln_if(AHCI_DEBUG, "AHCI Port {}: Request success", representative_port_index());
-                complete_current_request(AsyncDeviceRequest::Success);
+            g_io_work->queue([this, completed_slots]() {
+                handle_completed_command_slots(completed_slots);
             });
         }
     }
@@ -151,15 +146,61 @@ bool AHCIPort::is_interrupts_enabled() const
     return !m_interrupt_enable.is_cleared();
 }
 
+void AHCIPort::handle_completed_command_slots(u32 completed_slots)
+{
+    CompletedRequests completed_requests;
+    {
+        LOCKER(m_lock);
+        for (size_t index = 0; index < m_command_slots.size(); index++) {
+            if (!(completed_slots & (1u << index)))
+                continue;
+            auto& slot = m_command_slots[index];
+            VERIFY(slot.request);
+            auto request = slot.request.release_nonnull();
+            dbgln_if(AHCI_DEBUG, "AHCI Port {}: Request in slot {} handled", representative_port_index(), index);
+            if (request->request_type() == AsyncBlockDeviceRequest::Read) {
+                if (!request->write_to_buffer(request->buffer(), slot.dma_buffer_region->vaddr().as_ptr(), m_connected_device->block_size() * request->block_count())) {
+                    dbgln_if(AHCI_DEBUG, "AHCI Port {}: Request failure, memory fault occurred when reading in data.", representative_port_index());
+                    completed_requests.append({ move(request), AsyncDeviceRequest::MemoryFault });
+                    continue;
+                }
+            }
+            dbgln_if(AHCI_DEBUG, "AHCI Port {}: Request success", representative_port_index());
+            completed_requests.append({ move(request), AsyncDeviceRequest::Success });
+        }
+        issue_pending_requests(completed_requests);
+    }
+    complete_requests(completed_requests);
+}
+
+void AHCIPort::abort_all_requests(CompletedRequests& completed_requests)
+{
+    VERIFY(m_lock.is_locked());
+    VERIFY(m_hard_lock.is_locked());
+    m_issued_command_slots = 0;
+    for (auto& slot : m_command_slots) {
+        if (slot.request)
+            completed_requests.append({ slot.request.release_nonnull(), AsyncDeviceRequest::Failure });
+    }
+    while (!m_pending_requests.is_empty())
+        completed_requests.append({ m_pending_requests.take_first(), AsyncDeviceRequest::Failure });
+}
+
 void AHCIPort::recover_from_fatal_error()
 {
-    LOCKER(m_lock);
-    ScopedSpinLock lock(m_hard_lock);
-    dmesgln("{}: AHCI Port {} fatal error, shutting down!", m_parent_handler->hba_controller()->pci_address(), representative_port_index());
-    dmesgln("{}: AHCI Port {} fatal error, SError {}", m_parent_handler->hba_controller()->pci_address(), representative_port_index(), (u32)m_port_registers.serr);
-    stop_command_list_processing();
-    stop_fis_receiving();
-    m_interrupt_enable.clear();
+    CompletedRequests failed_requests;
+    {
+        LOCKER(m_lock);
+        ScopedSpinLock lock(m_hard_lock);
+        dmesgln("{}: AHCI Port {} fatal error, shutting down!", m_parent_handler->hba_controller()->pci_address(), representative_port_index());
+        dmesgln("{}: AHCI Port {} fatal error, SError {}", m_parent_handler->hba_controller()->pci_address(), representative_port_index(), (u32)m_port_registers.serr);
+        stop_command_list_processing();
+        stop_fis_receiving();
+        m_interrupt_enable.clear();
+        // A failing queued command aborts all the others, so none of them will complete.
+        abort_all_requests(failed_requests);
+    }
+    complete_requests(failed_requests);
 }
 
 void AHCIPort::eject()
@@ -178,7 +219,8 @@ void AHCIPort::eject()
     auto unused_command_header = try_to_find_unused_command_header();
     VERIFY(unused_command_header.has_value());
     auto* command_list_entries = (volatile AHCI::CommandHeader*)m_command_list_region->vaddr().as_ptr();
-    command_list_entries[unused_command_header.value()].ctba = m_command_table_pages[unused_command_header.value()].paddr().get();
+    auto& slot = m_command_slots[unused_command_header.value()];
+    command_list_entries[unused_command_header.value()].ctba = slot.command_table_page->paddr().get();
     command_list_entries[unused_command_header.value()].ctbau = 0;
     command_list_entries[unused_command_header.value()].prdbc = 0;
     command_list_entries[unused_command_header.value()].prdtl = 0;
@@ -189,8 +231,7 @@ void AHCIPort::eject()
     // handshake error bit in PxSERR register if CFL is incorrect.
     command_list_entries[unused_command_header.value()].attributes = (size_t)FIS::DwordCount::RegisterHostToDevice | AHCI::CommandHeaderAttributes::P | AHCI::CommandHeaderAttributes::C | AHCI::CommandHeaderAttributes::A;
 
-    auto command_table_region = MM.allocate_kernel_region(m_command_table_pages[unused_command_header.value()].paddr().page_base(), page_round_up(sizeof(AHCI::CommandTable)), "AHCI Command Table", Region::Access::Read | Region::Access::Write, Region::Cacheable::No);
-    auto& command_table = *(volatile AHCI::CommandTable*)command_table_region->vaddr().as_ptr();
+    auto& command_table = *(volatile AHCI::CommandTable*)slot.command_table_region->vaddr().as_ptr();
     memset(const_cast<u8*>(command_table.command_fis), 0, 64);
     auto& fis = *(volatile FIS::HostToDevice::Register*)command_table.command_fis;
     fis.header.fis_type = (u8)FIS::Type::RegisterHostToDevice;
@@ -237,10 +278,17 @@ void AHCIPort::eject()
 
 bool AHCIPort::reset()
 {
+    CompletedRequests failed_requests;
+    ScopeGuard complete_failed_requests([&] {
+        complete_requests(failed_requests);
+    });
+
     LOCKER(m_lock);
     ScopedSpinLock lock(m_hard_lock);
 
     dbgln_if(AHCI_DEBUG, "AHCI Port {}: Resetting", representative_port_index());
+    // Whatever was issued before the reset is lost.
+    abort_all_requests(failed_requests);
 
     if (m_disabled_by_firmware) {
         dmesgln("AHCI Port {}: Disabled by firmware ", representative_port_index());
@@ -315,6 +363,8 @@ bool AHCIPort::initialize(ScopedSpinLock<SpinLock<u8>>& main_lock)
             m_port_registers.cmd = m_port_registers.cmd | (1 << 24);
         }
 
+        detect_native_command_queuing(*identify_block);
+
         dmesgln("AHCI Port {}: Device found, Capacity={}, Bytes per logical sector={}, Bytes per physical sector={}", representative_port_index(), max_addressable_sector * logical_sector_size, logical_sector_size, physical_sector_size);
 
         // FIXME: We don't support ATAPI devices yet, so for now we don't "create" them
@@ -445,65 +495,148 @@ void AHCIPort::set_sleep_state() const
     m_port_registers.cmd = (m_port_registers.cmd & 0x0ffffff) | (0b1000 << 28);
 }
 
-size_t AHCIPort::calculate_descriptors_count(size_t block_count) const
+void AHCIPort::detect_native_command_queuing(const ATAIdentifyBlock& identify_block)
 {
-    VERIFY(m_connected_device);
-    size_t needed_dma_regions_count = page_round_up((block_count * m_connected_device->block_size())) / PAGE_SIZE;
-    VERIFY(needed_dma_regions_count <= m_dma_buffers.size());
-    return needed_dma_regions_count;
+    m_native_command_queuing = false;
+    m_queue_depth = min((size_t)1, m_command_slots.size());
+    if (is_atapi_attached() || !m_parent_handler->hba_capabilities().native_command_queuing_supported)
+        return;
+    // Word 76 reads as all zeroes or all ones on devices that don't report SATA capabilities.
+    if (identify_block.serial_ata_capabilities == 0xffff || !(identify_block.serial_ata_capabilities & ATA_SATA_CAP_NCQ))
+        return;
+    size_t device_queue_depth = (identify_block.queue_depth & ATA_QUEUE_DEPTH_MASK) + 1;
+    if (device_queue_depth < 2 || m_command_slots.size() < 2)
+        return;
+    m_native_command_queuing = true;
+    m_queue_depth = min(device_queue_depth, m_command_slots.size());
+    dmesgln("AHCI Port {}: Native command queuing enabled, queue depth {}", representative_port_index(), m_queue_depth);
 }
 
-Optional<AsyncDeviceRequest::RequestResult> AHCIPort::prepare_and_set_scatter_list(AsyncBlockDeviceRequest& request)
+void AHCIPort::start_request(AsyncBlockDeviceRequest& request)
 {
-    VERIFY(m_lock.is_locked());
-    VERIFY(request.block_count() > 0);
-
-    NonnullRefPtrVector<PhysicalPage> allocated_dma_regions;
-    for (size_t index = 0; index < calculate_descriptors_count(request.block_count()); index++) {
-        allocated_dma_regions.append(m_dma_buffers.at(index));
+    dbgln_if(AHCI_DEBUG, "AHCI Port {}: Request start", representative_port_index());
+    CompletedRequests completed_requests;
+    {
+        LOCKER(m_lock);
+        m_pending_requests.append(request);
+        issue_pending_requests(completed_requests);
     }
+    complete_requests(completed_requests);
+}
 
-    m_current_scatter_list = ScatterList::create(request, allocated_dma_regions, m_connected_device->block_size());
-    if (request.request_type() == AsyncBlockDeviceRequest::Write) {
-        if (!request.read_from_buffer(request.buffer(), m_current_scatter_list->dma_region().as_ptr(), m_connected_device->block_size() * request.block_count())) {
-            return AsyncDeviceRequest::MemoryFault;
-        }
+void AHCIPort::complete_requests(CompletedRequests& completed_requests)
+{
+    // Completing a request may start the next one on this port, so this must
+    // only be called after dropping m_lock.
+    for (auto& completed_request : completed_requests)
+        completed_request.request->complete(completed_request.result);
+    completed_requests.clear();
+}
+
+Optional<u8> AHCIPort::try_to_find_free_command_slot() const
+{
+    VERIFY(m_lock.is_locked());
+    VERIFY(m_queue_depth <= m_command_slots.size());
+    for (size_t index = 0; index < m_queue_depth; index++) {
+        if (!m_command_slots[index].request)
+            return index;
     }
     return {};
 }
 
-void AHCIPort::start_request(AsyncBlockDeviceRequest& request)
+bool AHCIPort::conflicts_with_earlier_request(const AsyncBlockDeviceRequest& request, size_t pending_index) const
 {
-    LOCKER(m_lock);
-    dbgln_if(AHCI_DEBUG, "AHCI Port {}: Request start", representative_port_index());
-    VERIFY(!m_current_request);
-    VERIFY(!m_current_scatter_list);
-
-    m_current_request = request;
+    auto must_stay_ordered = [&](const AsyncBlockDeviceRequest& earlier_request) {
+        if (request.request_type() == AsyncBlockDeviceRequest::Read && earlier_request.request_type() == AsyncBlockDeviceRequest::Read)
+            return false;
+        return request.block_index() < earlier_request.block_index() + earlier_request.block_count()
+            && earlier_request.block_index() < request.block_index() + request.block_count();
+    };
+    for (auto& slot : m_command_slots) {
+        if (slot.request && must_stay_ordered(*slot.request))
+            return true;
+    }
+    for (size_t index = 0; index < pending_index; index++) {
+        if (must_stay_ordered(m_pending_requests[index]))
+            return true;
+    }
+    return false;
+}
 
-    auto result = prepare_and_set_scatter_list(request);
-    if (result.has_value()) {
-        dbgln_if(AHCI_DEBUG, "AHCI Port {}: Request failure.", representative_port_index());
-        m_lock.unlock();
-        complete_current_request(result.value());
-        return;
+Optional<size_t> AHCIPort::pick_next_pending_request() const
+{
+    VERIFY(m_lock.is_locked());
+    VERIFY(!m_pending_requests.is_empty());
+
+    // Don't let the elevator pass over the oldest request forever.
+    constexpr size_t max_oldest_pending_request_skips = 32;
+    if (m_oldest_pending_request_skips >= max_oldest_pending_request_skips) {
+        if (conflicts_with_earlier_request(m_pending_requests.first(), 0))
+            return {};
+        return 0;
     }
 
-    auto success = access_device(request.request_type(), request.block_index(), request.block_count());
-    if (!success) {
-        dbgln_if(AHCI_DEBUG, "AHCI Port {}: Request failure.", representative_port_index());
-        m_lock.unlock();
-        complete_current_request(AsyncDeviceRequest::Failure);
-        return;
+    // Sweep upwards from where the last request ended, and start over from the
+    // lowest block index once nothing is left ahead of us (C-LOOK). Requests that
+    // overlap an earlier write, or are writes overlapping an earlier request,
+    // have to wait for it so that reordering never changes what is on disk.
+    Optional<size_t> next_ahead;
+    Optional<size_t> next_behind;
+    for (size_t index = 0; index < m_pending_requests.size(); index++) {
+        auto& request = m_pending_requests[index];
+        if (conflicts_with_earlier_request(request, index))
+            continue;
+        auto& candidate = request->block_index() >= m_next_block_index ? next_ahead : next_behind;
+        if (!candidate.has_value() || request->block_index() < m_pending_requests[candidate.value()]->block_index())
+            candidate = index;
     }
+    if (next_ahead.has_value())
+        return next_ahead;
+    return next_behind;
 }
 
-void AHCIPort::complete_current_request(AsyncDeviceRequest::RequestResult result)
+void AHCIPort::issue_pending_requests(CompletedRequests& completed_requests)
 {
-    VERIFY(m_current_request);
-    auto current_request = m_current_request;
-    m_current_request.clear();
-    current_request->complete(result);
+    VERIFY(m_lock.is_locked());
+    if (!m_pending_requests.is_empty() && (!is_operable() || !m_connected_device || m_queue_depth == 0)) {
+        dbgln_if(AHCI_DEBUG, "AHCI Port {}: Request failure, port is not operable.", representative_port_index());
+        while (!m_pending_requests.is_empty())
+            completed_requests.append({ m_pending_requests.take_first(), AsyncDeviceRequest::Failure });
+        return;
+    }
+
+    while (!m_pending_requests.is_empty()) {
+        auto slot_index = try_to_find_free_command_slot();
+        if (!slot_index.has_value())
+            return;
+        auto pending_index = pick_next_pending_request();
+        if (!pending_index.has_value())
+            return;
+        if (pending_index.value() == 0)
+            m_oldest_pending_request_skips = 0;
+        else
+            m_oldest_pending_request_skips++;
+
+        auto request = m_pending_requests.take(pending_index.value());
+        auto& slot = m_command_slots[slot_index.value()];
+        VERIFY(request->block_count() > 0);
+        VERIFY(m_connected_device->block_size() * request->block_count() <= PAGE_SIZE);
+        if (request->request_type() == AsyncBlockDeviceRequest::Write) {
+            if (!request->read_from_buffer(request->buffer(), slot.dma_buffer_region->vaddr().as_ptr(), m_connected_device->block_size() * request->block_count())) {
+                dbgln_if(AHCI_DEBUG, "AHCI Port {}: Request failure, memory fault occurred when writing out data.", representative_port_index());
+                completed_requests.append({ move(request), AsyncDeviceRequest::MemoryFault });
+                continue;
+            }
+        }
+
+        slot.request = request;
+        m_next_block_index = request->block_index() + request->block_count();
+        if (!access_device(slot_index.value(), request->request_type(), request->block_index(), request->block_count())) {
+            dbgln_if(AHCI_DEBUG, "AHCI Port {}: Request failure.", representative_port_index());
+            slot.request = nullptr;
+            completed_requests.append({ move(request), AsyncDeviceRequest::Failure });
+        }
+    }
 }
 
 bool AHCIPort::spin_until_ready() const
@@ -522,59 +655,46 @@ bool AHCIPort::spin_until_ready() const
     return true;
 }
 
-bool AHCIPort::access_device(AsyncBlockDeviceRequest::RequestType direction, u64 lba, u8 block_count)
+bool AHCIPort::access_device(u8 slot_index, AsyncBlockDeviceRequest::RequestType direction, u64 lba, u16 block_count)
 {
     VERIFY(m_connected_device);
     VERIFY(is_operable());
     VERIFY(m_lock.is_locked());
-    VERIFY(m_current_scatter_list);
+    auto& slot = m_command_slots[slot_index];
+    VERIFY(slot.request);
     ScopedSpinLock lock(m_hard_lock);
 
-    dbgln_if(AHCI_DEBUG, "AHCI Port {}: Do a {}, lba {}, block count {}", representative_port_index(), direction == AsyncBlockDeviceRequest::RequestType::Write ? "write" : "read", lba, block_count);
-    if (!spin_until_ready())
+    dbgln_if(AHCI_DEBUG, "AHCI Port {}: Do a {}, lba {}, block count {}, slot {}", representative_port_index(), direction == AsyncBlockDeviceRequest::RequestType::Write ? "write" : "read", lba, block_count, slot_index);
+    // Queued commands are accepted while others are still in flight, so only
+    // wait for the device to become idle when we issue them one at a time.
+    if (!m_native_command_queuing && !spin_until_ready())
         return false;
 
-    auto unused_command_header = try_to_find_unused_command_header();
-    VERIFY(unused_command_header.has_value());
+    size_t data_transfer_count = block_count * m_connected_device->block_size();
+    VERIFY(data_transfer_count <= PAGE_SIZE);
+
     auto* command_list_entries = (volatile AHCI::CommandHeader*)m_command_list_region->vaddr().as_ptr();
-    command_list_entries[unused_command_header.value()].ctba = m_command_table_pages[unused_command_header.value()].paddr().get();
-    command_list_entries[unused_command_header.value()].ctbau = 0;
-    command_list_entries[unused_command_header.value()].prdbc = 0;
-    command_list_entries[unused_command_header.value()].prdtl = m_current_scatter_list->scatters_count();
+    command_list_entries[slot_index].ctba = slot.command_table_page->paddr().get();
+    command_list_entries[slot_index].ctbau = 0;
+    command_list_entries[slot_index].prdbc = 0;
+    command_list_entries[slot_index].prdtl = 1;
 
     // Note: we must set the correct Dword count in this register. Real hardware
     // AHCI controllers do care about this field! QEMU doesn't care if we don't
     // set the correct CFL field in this register, real hardware will set an
     // handshake error bit in PxSERR register if CFL is incorrect.
-    command_list_entries[unused_command_header.value()].attributes = (size_t)FIS::DwordCount::RegisterHostToDevice | AHCI::CommandHeaderAttributes::P | AHCI::CommandHeaderAttributes::C | (is_atapi_attached() ? AHCI::CommandHeaderAttributes::A : 0) | (direction == AsyncBlockDeviceRequest::RequestType::Write ? AHCI::CommandHeaderAttributes::W : 0);
-
-    dbgln_if(AHCI_DEBUG, "AHCI Port {}: CLE: ctba=0x{:08x}, ctbau=0x{:08x}, prdbc=0x{:08x}, prdtl=0x{:04x}, attributes=0x{:04x}", representative_port_index(), (u32)command_list_entries[unused_command_header.value()].ctba, (u32)command_list_entries[unused_command_header.value()].ctbau, (u32)command_list_entries[unused_command_header.value()].prdbc, (u16)command_list_entries[unused_command_header.value()].prdtl, (u16)command_list_entries[unused_command_header.value()].attributes);
+    command_list_entries[slot_index].attributes = (size_t)FIS::DwordCount::RegisterHostToDevice | AHCI::CommandHeaderAttributes::P | AHCI::CommandHeaderAttributes::C | (is_atapi_attached() ? AHCI::CommandHeaderAttributes::A : 0) | (direction == AsyncBlockDeviceRequest::RequestType::Write ? AHCI::CommandHeaderAttributes::W : 0);
 
-    auto command_table_region = MM.allocate_kernel_region(m_command_table_pages[unused_command_header.value()].paddr().page_base(), page_round_up(sizeof(AHCI::CommandTable)), "AHCI Command Table", Region::Access::Read | Region::Access::Write, Region::Cacheable::No);
-    auto& command_table = *(volatile AHCI::CommandTable*)command_table_region->vaddr().as_ptr();
+    dbgln_if(AHCI_DEBUG, "AHCI Port {}: CLE: ctba=0x{:08x}, ctbau=0x{:08x}, prdbc=0x{:08x}, prdtl=0x{:04x}, attributes=0x{:04x}", representative_port_index(), (u32)command_list_entries[slot_index].ctba, (u32)command_list_entries[slot_index].ctbau, (u32)command_list_entries[slot_index].prdbc, (u16)command_list_entries[slot_index].prdtl, (u16)command_list_entries[slot_index].attributes);
 
-    dbgln_if(AHCI_DEBUG, "AHCI Port {}: Allocated command table at {}", representative_port_index(), command_table_region->vaddr());
+    auto& command_table = *(volatile AHCI::CommandTable*)slot.command_table_region->vaddr().as_ptr();
 
     memset(const_cast<u8*>(command_table.command_fis), 0, 64);
 
-    size_t scatter_entry_index = 0;
-    size_t data_transfer_count = (block_count * m_connected_device->block_size());
-    for (auto scatter_page : m_current_scatter_list->vmobject().physical_pages()) {
-        VERIFY(data_transfer_count != 0);
-        VERIFY(scatter_page);
-        dbgln_if(AHCI_DEBUG, "AHCI Port {}: Add a transfer scatter entry @ {}", representative_port_index(), scatter_page->paddr());
-        command_table.descriptors[scatter_entry_index].base_high = 0;
-        command_table.descriptors[scatter_entry_index].base_low = scatter_page->paddr().get();
-        if (data_transfer_count <= PAGE_SIZE) {
-            command_table.descriptors[scatter_entry_index].byte_count = data_transfer_count - 1;
-            data_transfer_count = 0;
-        } else {
-            command_table.descriptors[scatter_entry_index].byte_count = PAGE_SIZE - 1;
-            data_transfer_count -= PAGE_SIZE;
-        }
-        scatter_entry_index++;
-    }
-    command_table.descriptors[scatter_entry_index].byte_count = (PAGE_SIZE - 1) | (1 << 31);
+    dbgln_if(AHCI_DEBUG, "AHCI Port {}: Add a transfer scatter entry @ {}", representative_port_index(), slot.dma_buffer_page->paddr());
+    command_table.descriptors[0].base_high = 0;
+    command_table.descriptors[0].base_low = slot.dma_buffer_page->paddr().get();
+    command_table.descriptors[0].byte_count = data_transfer_count - 1;
 
     memset(const_cast<u8*>(command_table.atapi_command), 0, 32);
 
@@ -583,6 +703,11 @@ bool AHCIPort::access_device(AsyncBlockDeviceRequest::RequestType direction, u64
     if (is_atapi_attached()) {
         fis.command = ATA_CMD_PACKET;
         TODO();
+    } else if (m_native_command_queuing) {
+        if (direction == AsyncBlockDeviceRequest::RequestType::Write)
+            fis.command = ATA_CMD_WRITE_FPDMA_QUEUED;
+        else
+            fis.command = ATA_CMD_READ_FPDMA_QUEUED;
     } else {
         if (direction == AsyncBlockDeviceRequest::RequestType::Write)
             fis.command = ATA_CMD_WRITE_DMA_EXT;
@@ -601,17 +726,21 @@ bool AHCIPort::access_device(AsyncBlockDeviceRequest::RequestType direction, u64
     fis.lba_low[0] = lba & 0xff;
     fis.lba_low[1] = (lba >> 8) & 0xff;
     fis.lba_low[2] = (lba >> 16) & 0xff;
-    fis.count = (block_count);
-
-    // The below loop waits until the port is no longer busy before issuing a new command
-    if (!spin_until_ready())
-        return false;
+    if (m_native_command_queuing) {
+        // Queued commands carry the block count in the features register,
+        // and their tag (which is the command slot) in the count register.
+        fis.features_low = block_count & 0xff;
+        fis.features_high = (block_count >> 8) & 0xff;
+        fis.count = slot_index << 3;
+    } else {
+        fis.count = block_count;
+    }
 
     full_memory_barrier();
-    mark_command_header_ready_to_process(unused_command_header.value());
+    mark_command_header_ready_to_process(slot_index);
     full_memory_barrier();
 
-    dbgln_if(AHCI_DEBUG, "AHCI Port {}: Do a {}, lba {}, block count {} @ {}, ended", representative_port_index(), direction == AsyncBlockDeviceRequest::RequestType::Write ? "write" : "read", lba, block_count, m_dma_buffers[0].paddr());
+    dbgln_if(AHCI_DEBUG, "AHCI Port {}: Do a {}, lba {}, block count {} @ {}, ended", representative_port_index(), direction == AsyncBlockDeviceRequest::RequestType::Write ? "write" : "read", lba, block_count, slot.dma_buffer_page->paddr());
     return true;
 }
 
@@ -623,9 +752,11 @@ bool AHCIPort::identify_device(ScopedSpinLock<SpinLock<u8>>& main_lock)
         return false;
 
     auto unused_command_header = try_to_find_unused_command_header();
-    VERIFY(unused_command_header.has_value());
+    if (!unused_command_header.has_value())
+        return false;
     auto* command_list_entries = (volatile AHCI::CommandHeader*)m_command_list_region->vaddr().as_ptr();
-    command_list_entries[unused_command_header.value()].ctba = m_command_table_pages[unused_command_header.value()].paddr().get();
+    auto& slot = m_command_slots[unused_command_header.value()];
+    command_list_entries[unused_command_header.value()].ctba = slot.command_table_page->paddr().get();
     command_list_entries[unused_command_header.value()].ctbau = 0;
     command_list_entries[unused_command_header.value()].prdbc = 512;
     command_list_entries[unused_command_header.value()].prdtl = 1;
@@ -634,8 +765,7 @@ bool AHCIPort::identify_device(ScopedSpinLock<SpinLock<u8>>& main_lock)
     // QEMU doesn't care if we don't set the correct CFL field in this register, real hardware will set an handshake error bit in PxSERR register.
     command_list_entries[unused_command_header.value()].attributes = (size_t)FIS::DwordCount::RegisterHostToDevice | AHCI::CommandHeaderAttributes::P | AHCI::CommandHeaderAttributes::C;
 
-    auto command_table_region = MM.allocate_kernel_region(m_command_table_pages[unused_command_header.value()].paddr().page_base(), page_round_up(sizeof(AHCI::CommandTable)), "AHCI Command Table", Region::Access::Read | Region::Access::Write);
-    auto& command_table = *(volatile AHCI::CommandTable*)command_table_region->vaddr().as_ptr();
+    auto& command_table = *(volatile AHCI::CommandTable*)slot.command_table_region->vaddr().as_ptr();
     memset(const_cast<u8*>(command_table.command_fis), 0, 64);
     command_table.descriptors[0].base_high = 0;
     command_table.descriptors[0].base_low = m_parent_handler->get_identify_metadata_physical_region(m_port_index).get();
@@ -688,7 +818,7 @@ Optional<u8> AHCIPort::try_to_find_unused_command_header()
 {
     VERIFY(m_lock.is_locked());
     u32 commands_issued = m_port_registers.ci;
-    for (size_t index = 0; index < 32; index++) {
+    for (size_t index = 0; index < m_command_slots.size(); index++) {
         if (!(commands_issued & 1)) {
             dbgln_if(AHCI_DEBUG, "AHCI Port {}: unused command header at index {}", representative_port_index(), index);
             return index;
@@ -707,15 +837,18 @@ void AHCIPort::start_command_list_processing() const
     m_port_registers.cmd = m_port_registers.cmd | 1;
 }
 
-void AHCIPort::mark_command_header_ready_to_process(u8 command_header_index) const
+void AHCIPort::mark_command_header_ready_to_process(u8 command_header_index)
 {
     VERIFY(m_lock.is_locked());
     VERIFY(m_hard_lock.is_locked());
     VERIFY(is_operable());
-    VERIFY(!m_wait_for_completion);
-    m_wait_for_completion = true;
+    VERIFY(!(m_issued_command_slots & (1u << command_header_index)));
+    m_issued_command_slots |= 1u << command_header_index;
     dbgln_if(AHCI_DEBUG, "AHCI Port {}: Marking command header at index {} as ready to process.", representative_port_index(), command_header_index);
-    m_port_registers.ci = 1 << command_header_index;
+    // PxSACT has to be set before PxCI for queued commands.
+    if (m_native_command_queuing)
+        m_port_registers.sact = 1u << command_header_index;
+    m_port_registers.ci = 1u << command_header_index;
 }
 
 void AHCIPort::stop_command_list_processing() const
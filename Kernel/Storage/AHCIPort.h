@@ -37,8 +37,8 @@
 #include <Kernel/SpinLock.h>
 #include <Kernel/Storage/AHCI.h>
 #include <Kernel/Storage/AHCIPortHandler.h>
+#include <Kernel/Storage/ATA.h>
 #include <Kernel/Storage/StorageDevice.h>
-#include <Kernel/VM/AnonymousVMObject.h>
 #include <Kernel/VM/PhysicalPage.h>
 #include <Kernel/WaitQueue.h>
 
@@ -53,19 +53,21 @@ class AHCIPort : public RefCounted<AHCIPort> {
     friend class SATADiskDevice;
 
 private:
-    class ScatterList : public RefCounted<ScatterList> {
-    public:
-        static NonnullRefPtr<ScatterList> create(AsyncBlockDeviceRequest&, NonnullRefPtrVector<PhysicalPage> allocated_pages, size_t device_block_size);
-        const VMObject& vmobject() const { return m_vm_object; }
-        VirtualAddress dma_region() const { return m_dma_region->vaddr(); }
-        size_t scatters_count() const { return m_vm_object->physical_pages().size(); }
-
-    private:
-        ScatterList(AsyncBlockDeviceRequest&, NonnullRefPtrVector<PhysicalPage> allocated_pages, size_t device_block_size);
-        NonnullRefPtr<AnonymousVMObject> m_vm_object;
-        OwnPtr<Region> m_dma_region;
+    // Each command slot owns the command table and the bounce buffer used by
+    // the request that is currently issued in it.
+    struct CommandSlot {
+        RefPtr<AsyncBlockDeviceRequest> request;
+        RefPtr<PhysicalPage> command_table_page;
+        OwnPtr<Region> command_table_region;
+        RefPtr<PhysicalPage> dma_buffer_page;
+        OwnPtr<Region> dma_buffer_region;
     };
 
+    // How many requests SATADiskDevice hands us before queueing them itself.
+    // Everything that is not issued yet waits in m_pending_requests, where it
+    // can be reordered by block index.
+    static constexpr size_t max_queued_requests = 128;
+
 public:
     UNMAP_AFTER_INIT static NonnullRefPtr<AHCIPort> create(const AHCIPortHandler&, volatile AHCI::PortRegisters&, u32 port_index);
 
@@ -77,6 +79,9 @@ public:
 
     RefPtr<StorageDevice> connected_device() const { return m_connected_device; }
 
+    bool uses_native_command_queuing() const { return m_native_command_queuing; }
+    size_t queue_depth() const { return m_queue_depth; }
+
     bool reset();
     UNMAP_AFTER_INIT bool initialize_without_reset();
     void handle_interrupt();
@@ -101,11 +106,21 @@ private:
     ALWAYS_INLINE void spin_up() const;
     ALWAYS_INLINE void power_on() const;
 
+    struct CompletedRequest {
+        NonnullRefPtr<AsyncBlockDeviceRequest> request;
+        AsyncDeviceRequest::RequestResult result;
+    };
+    using CompletedRequests = Vector<CompletedRequest, AHCI::Limits::MaxCommands>;
+
     void start_request(AsyncBlockDeviceRequest&);
-    void complete_current_request(AsyncDeviceRequest::RequestResult);
-    bool access_device(AsyncBlockDeviceRequest::RequestType, u64 lba, u8 block_count);
-    size_t calculate_descriptors_count(size_t block_count) const;
-    [[nodiscard]] Optional<AsyncDeviceRequest::RequestResult> prepare_and_set_scatter_list(AsyncBlockDeviceRequest& request);
+    void complete_requests(CompletedRequests&);
+    void handle_completed_command_slots(u32 completed_slots);
+    void abort_all_requests(CompletedRequests&);
+    void issue_pending_requests(CompletedRequests& failed_requests);
+    Optional<size_t> pick_next_pending_request() const;
+    bool conflicts_with_earlier_request(const AsyncBlockDeviceRequest&, size_t pending_index) const;
+    bool access_device(u8 slot_index, AsyncBlockDeviceRequest::RequestType, u64 lba, u16 block_count);
+    void detect_native_command_queuing(const ATAIdentifyBlock&);
 
     ALWAYS_INLINE bool is_interrupts_enabled() const;
 
@@ -114,7 +129,7 @@ private:
     bool identify_device(ScopedSpinLock<SpinLock<u8>>&);
 
     ALWAYS_INLINE void start_command_list_processing() const;
-    ALWAYS_INLINE void mark_command_header_ready_to_process(u8 command_header_index) const;
+    ALWAYS_INLINE void mark_command_header_ready_to_process(u8 command_header_index);
     ALWAYS_INLINE void stop_command_list_processing() const;
 
     ALWAYS_INLINE void start_fis_receiving() const;
@@ -126,21 +141,29 @@ private:
     void set_interface_state(AHCI::DeviceDetectionInitialization);
 
     Optional<u8> try_to_find_unused_command_header();
+    Optional<u8> try_to_find_free_command_slot() const;
 
     ALWAYS_INLINE bool is_interface_disabled() const { return (m_port_registers.ssts & 0xf) == 4; };
 
     // Data members
 
     EntropySource m_entropy_source;
-    RefPtr<AsyncBlockDeviceRequest> m_current_request;
     SpinLock<u8> m_hard_lock;
     Lock m_lock { "AHCIPort" };
 
     mutable bool m_wait_for_completion { false };
     bool m_wait_connect_for_completion { false };
 
-    NonnullRefPtrVector<PhysicalPage> m_dma_buffers;
-    NonnullRefPtrVector<PhysicalPage> m_command_table_pages;
+    Vector<CommandSlot, AHCI::Limits::MaxCommands> m_command_slots;
+    Vector<NonnullRefPtr<AsyncBlockDeviceRequest>> m_pending_requests;
+
+    // Guarded by m_hard_lock, as the interrupt handler compares it with PxCI and PxSACT.
+    u32 m_issued_command_slots { 0 };
+
+    size_t m_queue_depth { 1 };
+    bool m_native_command_queuing { false };
+    u64 m_next_block_index { 0 };
+    size_t m_oldest_pending_request_skips { 0 };
     RefPtr<PhysicalPage> m_command_list_page;
     OwnPtr<Region> m_command_list_region;
     RefPtr<PhysicalPage> m_fis_receive_page;
@@ -152,7 +175,6 @@ private:
     AHCI::PortInterruptStatusBitField m_interrupt_status;
     AHCI::PortInterruptEnableBitField m_interrupt_enable;
 
-    RefPtr<AHCIPort::ScatterList> m_current_scatter_list;
     bool m_disabled_by_firmware { false };
 };
 }
@@ -52,6 +52,8 @@
 #define ATA_CMD_WRITE_PIO_EXT 0x34
 #define ATA_CMD_WRITE_DMA 0xCA
 #define ATA_CMD_WRITE_DMA_EXT 0x35
+#define ATA_CMD_READ_FPDMA_QUEUED 0x60
+#define ATA_CMD_WRITE_FPDMA_QUEUED 0x61
 #define ATA_CMD_CACHE_FLUSH 0xE7
 #define ATA_CMD_CACHE_FLUSH_EXT 0xEA
 #define ATA_CMD_PACKET 0xA0
@@ -98,6 +100,9 @@
 
 #define ATA_CAP_LBA 0x200
 
+#define ATA_SATA_CAP_NCQ (1 << 8)
+#define ATA_QUEUE_DEPTH_MASK 0x1f
+
 #include <AK/Types.h>
 
 namespace Kernel {
@@ -58,6 +58,13 @@ void SATADiskDevice::start_request(AsyncBlockDeviceRequest& request)
     m_port->start_request(request);
 }
 
+size_t SATADiskDevice::max_requests_in_flight() const
+{
+    // The port keeps the requests it can't issue yet in its own queue, where
+    // they are sorted by block index rather than served first come, first served.
+    return AHCIPort::max_queued_requests;
+}
+
 String SATADiskDevice::device_name() const
 {
     return String::formatted("hd{:c}", 'a' + minor());
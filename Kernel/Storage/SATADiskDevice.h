@@ -58,6 +58,9 @@ private:
 
     // ^DiskDevice
     virtual const char* class_name() const override;
+    // ^Device
+    virtual size_t max_requests_in_flight() const override;
+
     NonnullRefPtr<AHCIPort> m_port;
 };
 
@@ -60,34 +60,34 @@ NonnullRefPtr<StorageController> StorageDevice::controller() const
 KResultOr<size_t> StorageDevice::read(FileDescription&, u64 offset, UserOrKernelBuffer& outbuf, size_t len)
 {
     unsigned index = offset / block_size();
-    u16 whole_blocks = len / block_size();
+    size_t whole_blocks = len / block_size();
     ssize_t remaining = len % block_size();
 
-    unsigned blocks_per_page = PAGE_SIZE / block_size();
-
     // PATAChannel will chuck a wobbly if we try to read more than PAGE_SIZE
-    // at a time, because it uses a single page for its DMA buffer.
-    if (whole_blocks >= blocks_per_page) {
-        whole_blocks = blocks_per_page;
-        remaining = 0;
-    }
+    // at a time, because it uses a single page for its DMA buffer. So we
+    // split larger reads into page-sized requests.
+    size_t blocks_per_page = PAGE_SIZE / block_size();
 
     dbgln_if(STORAGE_DEVICE_DEBUG, "StorageDevice::read() index={}, whole_blocks={}, remaining={}", index, whole_blocks, remaining);
 
-    if (whole_blocks > 0) {
-        auto read_request = make_request<AsyncBlockDeviceRequest>(AsyncBlockDeviceRequest::Read, index, whole_blocks, outbuf, whole_blocks * block_size());
+    for (size_t blocks_done = 0; blocks_done < whole_blocks;) {
+        size_t block_count = min(whole_blocks - blocks_done, blocks_per_page);
+        auto request_buffer = outbuf.offset(blocks_done * block_size());
+        auto read_request = make_request<AsyncBlockDeviceRequest>(AsyncBlockDeviceRequest::Read, index + blocks_done, block_count, request_buffer, block_count * block_size());
         auto result = read_request->wait();
+        // Report what we already have if a later request doesn't work out.
         if (result.wait_result().was_interrupted())
-            return EINTR;
+            return blocks_done ? KResultOr<size_t>(blocks_done * block_size()) : KResultOr<size_t>(EINTR);
         switch (result.request_result()) {
         case AsyncDeviceRequest::Failure:
         case AsyncDeviceRequest::Cancelled:
-            return EIO;
+            return blocks_done ? KResultOr<size_t>(blocks_done * block_size()) : KResultOr<size_t>(EIO);
         case AsyncDeviceRequest::MemoryFault:
             return EFAULT;
         default:
             break;
         }
+        blocks_done += block_count;
     }
 
     off_t pos = whole_blocks * block_size();
@@ -125,34 +125,34 @@ bool StorageDevice::can_read(const FileDescription&, size_t offset) const
 KResultOr<size_t> StorageDevice::write(FileDescription&, u64 offset, const UserOrKernelBuffer& inbuf, size_t len)
 {
     unsigned index = offset / block_size();
-    u16 whole_blocks = len / block_size();
+    size_t whole_blocks = len / block_size();
     ssize_t remaining = len % block_size();
 
-    unsigned blocks_per_page = PAGE_SIZE / block_size();
-
     // PATAChannel will chuck a wobbly if we try to write more than PAGE_SIZE
-    // at a time, because it uses a single page for its DMA buffer.
-    if (whole_blocks >= blocks_per_page) {
-        whole_blocks = blocks_per_page;
-        remaining = 0;
-    }
+    // at a time, because it uses a single page for its DMA buffer. So we
+    // split larger writes into page-sized requests.
+    size_t blocks_per_page = PAGE_SIZE / block_size();
 
     dbgln_if(STORAGE_DEVICE_DEBUG, "StorageDevice::write() index={}, whole_blocks={}, remaining={}", index, whole_blocks, remaining);
 
-    if (whole_blocks > 0) {
-        auto write_request = make_request<AsyncBlockDeviceRequest>(AsyncBlockDeviceRequest::Write, index, whole_blocks, inbuf, whole_blocks * block_size());
+    for (size_t blocks_done = 0; blocks_done < whole_blocks;) {
+        size_t block_count = min(whole_blocks - blocks_done, blocks_per_page);
+        auto request_buffer = inbuf.offset(blocks_done * block_size());
+        auto write_request = make_request<AsyncBlockDeviceRequest>(AsyncBlockDeviceRequest::Write, index + blocks_done, block_count, request_buffer, block_count * block_size());
         auto result = write_request->wait();
+        // Report what we already wrote if a later request doesn't work out.
         if (result.wait_result().was_interrupted())
-            return EINTR;
+            return blocks_done ? KResultOr<size_t>(blocks_done * block_size()) : KResultOr<size_t>(EINTR);
         switch (result.request_result()) {
         case AsyncDeviceRequest::Failure:
         case AsyncDeviceRequest::Cancelled:
-            return EIO;
+            return blocks_done ? KResultOr<size_t>(blocks_done * block_size()) : KResultOr<size_t>(EIO);
         case AsyncDeviceRequest::MemoryFault:
             return EFAULT;
         default:
             break;
         }
+        blocks_done += block_count;
     }
 
     off_t pos = whole_blocks * block_size();
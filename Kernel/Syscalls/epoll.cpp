@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) 2021, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <AK/Checked.h>
+#include <Kernel/FileSystem/EventPoll.h>
+#include <Kernel/FileSystem/FileDescription.h>
+#include <Kernel/Process.h>
+
+namespace Kernel {
+
+KResultOr<int> Process::sys$epoll_create1(int flags)
+{
+    REQUIRE_PROMISE(stdio);
+
+    if (flags & ~EPOLL_CLOEXEC)
+        return EINVAL;
+
+    int fd = alloc_fd();
+    if (fd < 0)
+        return fd;
+
+    auto description_or_error = FileDescription::create(*EventPoll::create());
+    if (description_or_error.is_error())
+        return description_or_error.error();
+
+    auto description = description_or_error.release_value();
+    description->set_readable(true);
+
+    u32 fd_flags = 0;
+    if (flags & EPOLL_CLOEXEC)
+        fd_flags |= FD_CLOEXEC;
+
+    m_fds[fd].set(move(description), fd_flags);
+    return fd;
+}
+
+static EventPoll* event_poll_from(FileDescription& description)
+{
+    if (!description.file().is_event_poll())
+        return nullptr;
+    return static_cast<EventPoll*>(&description.file());
+}
+
+KResultOr<int> Process::sys$epoll_ctl(Userspace<const Syscall::SC_epoll_ctl_params*> user_params)
+{
+    REQUIRE_PROMISE(stdio);
+
+    Syscall::SC_epoll_ctl_params params;
+    if (!copy_from_user(&params, user_params))
+        return EFAULT;
+
+    auto epoll_description = file_description(params.epfd);
+    if (!epoll_description)
+        return EBADF;
+    auto* event_poll = event_poll_from(*epoll_description);
+    if (!event_poll)
+        return EINVAL;
+
+    auto description = file_description(params.fd);
+    if (!description)
+        return EBADF;
+    if (description == epoll_description)
+        return EINVAL;
+
+    epoll_event event {};
+    if (params.op != EPOLL_CTL_DEL && !copy_from_user(&event, params.event))
+        return EFAULT;
+
+    switch (params.op) {
+    case EPOLL_CTL_ADD:
+        return event_poll->add(params.fd, *description, event);
+    case EPOLL_CTL_MOD:
+        return event_poll->modify(params.fd, *description, event);
+    case EPOLL_CTL_DEL:
+        return event_poll->remove(params.fd, *description);
+    default:
+        return EINVAL;
+    }
+}
+
+KResultOr<int> Process::sys$epoll_wait(Userspace<const Syscall::SC_epoll_wait_params*> user_params)
+{
+    REQUIRE_PROMISE(stdio);
+
+    Syscall::SC_epoll_wait_params params;
+    if (!copy_from_user(&params, user_params))
+        return EFAULT;
+
+    if (params.max_events <= 0)
+        return EINVAL;
+
+    Checked<size_t> events_size = sizeof(epoll_event);
+    events_size *= params.max_events;
+    if (events_size.has_overflow())
+        return EFAULT;
+
+    auto description = file_description(params.epfd);
+    if (!description)
+        return EBADF;
+    auto* event_poll = event_poll_from(*description);
+    if (!event_poll)
+        return EINVAL;
+
+    Thread::BlockTimeout timeout;
+    if (params.timeout) {
+        auto timeout_time = copy_time_from_user(params.timeout);
+        if (!timeout_time.has_value())
+            return EFAULT;
+        timeout = Thread::BlockTimeout(false, &timeout_time.value());
+    }
+
+    Vector<epoll_event> events;
+    for (;;) {
+        event_poll->collect_ready_events(events, params.max_events);
+        if (!events.is_empty())
+            break;
+
+        auto unblock_flags = Thread::FileBlocker::BlockFlags::None;
+        auto block_result = Thread::current()->block<Thread::ReadBlocker>(timeout, *description, unblock_flags);
+        if (block_result.was_interrupted())
+            return EINTR;
+        if (block_result.timed_out()) {
+            // Pick up anything that became ready just as we timed out.
+            event_poll->collect_ready_events(events, params.max_events);
+            break;
+        }
+    }
+
+    if (!events.is_empty() && !copy_to_user(params.events, events.data(), events.size() * sizeof(epoll_event)))
+        return EFAULT;
+    return events.size();
+}
+
+}
@@ -40,6 +40,7 @@
 #include <Kernel/VM/PageDirectory.h>
 #include <Kernel/VM/Region.h>
 #include <Kernel/VM/SharedInodeVMObject.h>
+#include <Kernel/VM/TLBFlushBatch.h>
 #include <LibC/limits.h>
 #include <LibELF/AuxiliaryVector.h>
 #include <LibELF/Image.h>
@@ -531,8 +532,12 @@ KResult Process::do_exec(NonnullRefPtr<FileDescription> main_program_description
 
     set_dumpable(!executable_is_setid);
 
-    m_space = load_result.space.release_nonnull();
-    MemoryManager::enter_space(*m_space);
+    {
+        // Tear down the old address space with a single TLB shootdown once we've left it.
+        TLBFlushBatch tlb_batch(m_space->page_directory());
+        auto old_space = exchange(m_space, load_result.space.release_nonnull());
+        MemoryManager::enter_space(*m_space);
+    }
 
     auto signal_trampoline_region = m_space->allocate_region_with_vmobject(signal_trampoline_range.value(), g_signal_trampoline_region->vmobject(), 0, "Signal trampoline", PROT_READ | PROT_EXEC, true);
     if (signal_trampoline_region.is_error()) {
@@ -551,7 +556,20 @@ KResult Process::do_exec(NonnullRefPtr<FileDescription> main_program_description
     m_coredump_metadata.clear();
 
     auto current_thread = Thread::current();
-    current_thread->clear_signals();
+    new_main_thread = nullptr;
+    if (&current_thread->process() == this) {
+        new_main_thread = current_thread;
+    } else {
+        for_each_thread([&](auto& thread) {
+            new_main_thread = &thread;
+            return IterationDecision::Break;
+        });
+    }
+    VERIFY(new_main_thread);
+
+    // NOTE: When building a process from the outside (at boot, or for posix_spawn()),
+    //       the current thread isn't ours and must keep its signal state.
+    new_main_thread->clear_signals();
 
     clear_futex_queues_on_exec();
 
@@ -571,17 +589,6 @@ KResult Process::do_exec(NonnullRefPtr<FileDescription> main_program_description
         m_fds[main_program_fd].set(move(main_program_description), FD_CLOEXEC);
     }
 
-    new_main_thread = nullptr;
-    if (&current_thread->process() == this) {
-        new_main_thread = current_thread;
-    } else {
-        for_each_thread([&](auto& thread) {
-            new_main_thread = &thread;
-            return IterationDecision::Break;
-        });
-    }
-    VERIFY(new_main_thread);
-
     auto auxv = generate_auxiliary_vector(load_result.load_base, load_result.entry_eip, uid(), euid(), gid(), egid(), path, main_program_fd);
 
     // NOTE: We create the new stack before disabling interrupts since it will zero-fault
@@ -896,6 +903,27 @@ KResult Process::exec(String path, Vector<String> arguments, Vector<String> envi
     return KSuccess;
 }
 
+bool Process::copy_user_strings(const Syscall::StringListArgument& list, Vector<String>& output)
+{
+    if (!list.length)
+        return true;
+    Checked size = sizeof(*list.strings);
+    size *= list.length;
+    if (size.has_overflow())
+        return false;
+    Vector<Syscall::StringArgument, 32> strings;
+    strings.resize(list.length);
+    if (!copy_from_user(strings.data(), list.strings, list.length * sizeof(*list.strings)))
+        return false;
+    for (size_t i = 0; i < list.length; ++i) {
+        auto string = copy_string_from_user(strings[i]);
+        if (string.is_null())
+            return false;
+        output.append(move(string));
+    }
+    return true;
+}
+
 KResultOr<int> Process::sys$execve(Userspace<const Syscall::SC_execve_params*> user_params)
 {
     REQUIRE_PROMISE(exec);
@@ -917,26 +945,6 @@ KResultOr<int> Process::sys$execve(Userspace<const Syscall::SC_execve_params*> u
         path = path_arg.value();
     }
 
-    auto copy_user_strings = [](const auto& list, auto& output) {
-        if (!list.length)
-            return true;
-        Checked size = sizeof(*list.strings);
-        size *= list.length;
-        if (size.has_overflow())
-            return false;
-        Vector<Syscall::StringArgument, 32> strings;
-        strings.resize(list.length);
-        if (!copy_from_user(strings.data(), list.strings, list.length * sizeof(*list.strings)))
-            return false;
-        for (size_t i = 0; i < list.length; ++i) {
-            auto string = copy_string_from_user(strings[i]);
-            if (string.is_null())
-                return false;
-            output.append(move(string));
-        }
-        return true;
-    };
-
     Vector<String> arguments;
     if (!copy_user_strings(params.arguments, arguments))
         return EFAULT;
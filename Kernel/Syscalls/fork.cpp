@@ -32,6 +32,25 @@
 
 namespace Kernel {
 
+void Process::copy_inherited_state_to(Process& child) const
+{
+    child.m_root_directory = m_root_directory;
+    child.m_root_directory_relative_to_global_root = m_root_directory_relative_to_global_root;
+    child.m_fds = m_fds;
+    child.m_pg = m_pg;
+
+    ProtectedDataMutationScope scope { child };
+    child.m_promises = m_promises;
+    child.m_execpromises = m_execpromises;
+    child.m_has_promises = m_has_promises;
+    child.m_has_execpromises = m_has_execpromises;
+    child.m_sid = m_sid;
+    child.m_extra_gids = m_extra_gids;
+    child.m_umask = m_umask;
+    child.m_signal_trampoline = m_signal_trampoline;
+    child.m_dumpable = m_dumpable;
+}
+
 KResultOr<pid_t> Process::sys$fork(RegisterState& regs)
 {
     REQUIRE_PROMISE(proc);
@@ -39,25 +58,9 @@ KResultOr<pid_t> Process::sys$fork(RegisterState& regs)
     auto child = adopt(*new Process(child_first_thread, m_name, uid(), gid(), pid(), m_is_kernel_process, m_cwd, m_executable, m_tty, this));
     if (!child_first_thread)
         return ENOMEM;
-    child->m_root_directory = m_root_directory;
-    child->m_root_directory_relative_to_global_root = m_root_directory_relative_to_global_root;
+    copy_inherited_state_to(*child);
     child->m_veil_state = m_veil_state;
     child->m_unveiled_paths = m_unveiled_paths.deep_copy();
-    child->m_fds = m_fds;
-    child->m_pg = m_pg;
-
-    {
-        ProtectedDataMutationScope scope { *child };
-        child->m_promises = m_promises;
-        child->m_execpromises = m_execpromises;
-        child->m_has_promises = m_has_promises;
-        child->m_has_execpromises = m_has_execpromises;
-        child->m_sid = m_sid;
-        child->m_extra_gids = m_extra_gids;
-        child->m_umask = m_umask;
-        child->m_signal_trampoline = m_signal_trampoline;
-        child->m_dumpable = m_dumpable;
-    }
 
     dbgln_if(FORK_DEBUG, "fork: child={}", child);
     child->space().set_enforces_syscall_regions(space().enforces_syscall_regions());
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2021, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <Kernel/FileSystem/FileDescription.h>
+#include <Kernel/FileSystem/IORing.h>
+#include <Kernel/Process.h>
+
+namespace Kernel {
+
+KResultOr<int> Process::sys$io_ring_create(u32 entries, Userspace<size_t*> user_mapping_size)
+{
+    REQUIRE_PROMISE(stdio);
+
+    int fd = alloc_fd();
+    if (fd < 0)
+        return fd;
+
+    auto io_ring_or_error = IORing::create(*this, entries);
+    if (io_ring_or_error.is_error())
+        return io_ring_or_error.error();
+    auto io_ring = io_ring_or_error.release_value();
+
+    size_t mapping_size = io_ring->mapping_size();
+    if (!copy_to_user(user_mapping_size, &mapping_size))
+        return EFAULT;
+
+    auto description_or_error = FileDescription::create(*io_ring);
+    if (description_or_error.is_error())
+        return description_or_error.error();
+
+    auto description = description_or_error.release_value();
+    description->set_readable(true);
+
+    // Submissions refer to addresses in this address space, so the ring must not survive exec().
+    m_fds[fd].set(move(description), FD_CLOEXEC);
+    return fd;
+}
+
+KResultOr<int> Process::sys$io_ring_enter(int fd, u32 to_submit, u32 min_complete)
+{
+    REQUIRE_PROMISE(stdio);
+
+    auto description = file_description(fd);
+    if (!description)
+        return EBADF;
+    if (!description->file().is_io_ring())
+        return EINVAL;
+
+    auto& io_ring = static_cast<IORing&>(description->file());
+    auto submitted_or_error = io_ring.enter(*this, to_submit, min_complete);
+    if (submitted_or_error.is_error())
+        return submitted_or_error.error();
+    return submitted_or_error.value();
+}
+
+}
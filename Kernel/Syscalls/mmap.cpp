@@ -34,6 +34,7 @@
 #include <Kernel/VM/PrivateInodeVMObject.h>
 #include <Kernel/VM/Region.h>
 #include <Kernel/VM/SharedInodeVMObject.h>
+#include <Kernel/VM/TLBFlushBatch.h>
 #include <LibC/limits.h>
 #include <LibELF/Validation.h>
 
@@ -193,6 +194,7 @@ KResultOr<FlatPtr> Process::sys$mmap(Userspace<const Syscall::SC_mmap_params*> u
     bool map_fixed = flags & MAP_FIXED;
     bool map_noreserve = flags & MAP_NORESERVE;
     bool map_randomized = flags & MAP_RANDOMIZED;
+    bool map_populate = flags & MAP_POPULATE;
 
     if (map_shared && map_private)
         return EINVAL;
@@ -212,10 +214,19 @@ KResultOr<FlatPtr> Process::sys$mmap(Userspace<const Syscall::SC_mmap_params*> u
     Region* region = nullptr;
     Optional<Range> range;
 
+    // Place big mappings on a 2 MiB boundary so they can be backed by large pages.
+    bool wants_large_page_alignment = !addr && page_round_up(size) >= LARGE_PAGE_SIZE && alignment < LARGE_PAGE_SIZE;
+
     if (map_randomized) {
-        range = space().page_directory().range_allocator().allocate_randomized(page_round_up(size), alignment);
+        if (wants_large_page_alignment)
+            range = space().page_directory().range_allocator().allocate_randomized(page_round_up(size), LARGE_PAGE_SIZE);
+        if (!range.has_value())
+            range = space().page_directory().range_allocator().allocate_randomized(page_round_up(size), alignment);
     } else {
-        range = space().allocate_range(VirtualAddress(addr), size, alignment);
+        if (wants_large_page_alignment)
+            range = space().allocate_range({}, size, LARGE_PAGE_SIZE);
+        if (!range.has_value())
+            range = space().allocate_range(VirtualAddress(addr), size, alignment);
         if (!range.has_value()) {
             if (addr && !map_fixed) {
                 // If there's an address but MAP_FIXED wasn't specified, the address is just a hint.
@@ -270,6 +281,10 @@ KResultOr<FlatPtr> Process::sys$mmap(Userspace<const Syscall::SC_mmap_params*> u
         region->set_stack(true);
     if (!name.is_null())
         region->set_name(name);
+    if (map_populate) {
+        // This is only a hint, whatever we can't bring in now will be faulted in later.
+        [[maybe_unused]] auto result = region->populate(region->range());
+    }
     return region->vaddr().get();
 }
 
@@ -384,6 +399,19 @@ KResultOr<int> Process::sys$madvise(Userspace<void*> address, size_t size, int a
     if (!is_user_range(range_to_madvise))
         return EFAULT;
 
+    if (advice & MADV_WILLNEED) {
+        if (advice & ~MADV_WILLNEED)
+            return EINVAL;
+        auto* region = space().find_region_containing(range_to_madvise);
+        if (!region)
+            return ENOMEM;
+        if (!region->is_mmap())
+            return EPERM;
+        if (auto result = region->populate(range_to_madvise); result.is_error())
+            return result;
+        return 0;
+    }
+
     auto* region = space().find_region_from_range(range_to_madvise);
     if (!region)
         return EINVAL;
@@ -463,6 +491,8 @@ KResultOr<int> Process::sys$munmap(Userspace<void*> addr, size_t size)
     if (!is_user_range(range_to_unmap))
         return EFAULT;
 
+    TLBFlushBatch tlb_batch(space().page_directory());
+
     if (auto* whole_region = space().find_region_from_range(range_to_unmap)) {
         if (!whole_region->is_mmap())
             return EPERM;
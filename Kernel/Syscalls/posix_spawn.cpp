@@ -0,0 +1,268 @@
+/*
+ * Copyright (c) 2021, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <AK/AnyOf.h>
+#include <AK/ScopeGuard.h>
+#include <Kernel/Debug.h>
+#include <Kernel/FileSystem/Custody.h>
+#include <Kernel/FileSystem/FileDescription.h>
+#include <Kernel/FileSystem/VirtualFileSystem.h>
+#include <Kernel/Process.h>
+#include <Kernel/ProcessGroup.h>
+#include <Kernel/TTY/TTY.h>
+#include <Kernel/VM/MemoryManager.h>
+#include <LibC/limits.h>
+
+namespace Kernel {
+
+static constexpr size_t max_spawn_file_actions = 1024;
+static constexpr int supported_spawn_flags = POSIX_SPAWN_RESETIDS | POSIX_SPAWN_SETPGROUP | POSIX_SPAWN_SETSCHEDPARAM | POSIX_SPAWN_SETSCHEDULER | POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSID;
+
+KResult Process::apply_spawn_attributes(const Syscall::SC_posix_spawn_params& params, Thread& first_thread)
+{
+    if (params.flags & POSIX_SPAWN_RESETIDS) {
+        ProtectedDataMutationScope scope { *this };
+        m_euid = m_uid;
+        m_egid = m_gid;
+    }
+
+    if (params.flags & POSIX_SPAWN_SETPGROUP) {
+        ProcessGroupID new_pgid = params.pgroup ? ProcessGroupID(params.pgroup) : pid().value();
+        if (new_pgid != pid().value()) {
+            // Joining an existing group, which must be in our session.
+            auto new_sid = get_sid_from_pgid(new_pgid);
+            if (new_sid == -1 || new_sid != sid())
+                return EPERM;
+        }
+        m_pg = ProcessGroup::find_or_create(new_pgid);
+    }
+
+    if (params.flags & POSIX_SPAWN_SETSCHEDPARAM) {
+        ScopedSpinLock lock(g_scheduler_lock);
+        first_thread.set_priority((u32)params.sched_priority);
+    }
+
+    // NOTE: POSIX_SPAWN_SETSIGDEF needs no work, exec() resets every signal to its default action.
+    //       POSIX_SPAWN_SETSIGMASK is applied after exec(), which clears the signal mask.
+    // FIXME: POSIX_SPAWN_SETSCHEDULER
+
+    if (params.flags & POSIX_SPAWN_SETSID) {
+        m_pg = ProcessGroup::create(ProcessGroupID(pid().value()));
+        m_tty = nullptr;
+        ProtectedDataMutationScope scope { *this };
+        m_sid = pid().value();
+    }
+    return KSuccess;
+}
+
+KResult Process::apply_spawn_file_action(const Syscall::SC_posix_spawn_file_action& action, const String& path)
+{
+    // NOTE: This runs on the child before it has any threads of its own, so the VFS
+    //       checks credentials, promises and veil against the spawning process.
+    // FIXME: With POSIX_SPAWN_RESETIDS, the reset IDs should apply to these checks too.
+    // The child inherited our promises. Missing ones fail the spawn rather than kill the spawning process.
+    auto is_promised = [this](Pledge promise) {
+        return !has_promises() || has_promised(promise);
+    };
+
+    switch (action.type) {
+    case Syscall::SpawnFileActionType::Open: {
+        if (action.fd < 0 || action.fd >= m_max_open_file_descriptors)
+            return EBADF;
+        if ((action.options & O_WRONLY) && !is_promised(Pledge::wpath))
+            return EPERM;
+        if (!(action.options & O_WRONLY) && (action.options & O_RDONLY) && !is_promised(Pledge::rpath))
+            return EPERM;
+        if ((action.options & O_CREAT) && !is_promised(Pledge::cpath))
+            return EPERM;
+        if (action.options & (O_NOFOLLOW_NOERROR | O_UNLINK_INTERNAL))
+            return EINVAL;
+
+        auto result = VFS::the().open(path, action.options, (action.mode & 0777) & ~umask(), current_directory());
+        if (result.is_error())
+            return result.error();
+        auto description = result.release_value();
+        if (description->inode() && description->inode()->socket())
+            return ENXIO;
+        m_fds[action.fd].set(move(description), (action.options & O_CLOEXEC) ? FD_CLOEXEC : 0);
+        return KSuccess;
+    }
+    case Syscall::SpawnFileActionType::Close: {
+        auto description = file_description(action.fd);
+        if (!description)
+            return EBADF;
+        auto rc = description->close();
+        m_fds[action.fd] = {};
+        return rc;
+    }
+    case Syscall::SpawnFileActionType::Dup2: {
+        auto description = file_description(action.fd);
+        if (!description)
+            return EBADF;
+        if (action.new_fd < 0 || action.new_fd >= m_max_open_file_descriptors)
+            return EBADF;
+        // Unlike dup2(), duplicating a descriptor onto itself makes it survive exec().
+        if (action.fd == action.new_fd)
+            m_fds[action.new_fd].set_flags(m_fds[action.new_fd].flags() & ~FD_CLOEXEC);
+        else
+            m_fds[action.new_fd].set(*description);
+        return KSuccess;
+    }
+    case Syscall::SpawnFileActionType::Chdir: {
+        if (!is_promised(Pledge::rpath))
+            return EPERM;
+        auto directory_or_error = VFS::the().open_directory(path, current_directory());
+        if (directory_or_error.is_error())
+            return directory_or_error.error();
+        m_cwd = *directory_or_error.value();
+        return KSuccess;
+    }
+    case Syscall::SpawnFileActionType::Fchdir: {
+        auto description = file_description(action.fd);
+        if (!description)
+            return EBADF;
+        if (!description->is_directory())
+            return ENOTDIR;
+        if (!description->metadata().may_execute(*this))
+            return EACCES;
+        m_cwd = description->custody();
+        return KSuccess;
+    }
+    }
+    return EINVAL;
+}
+
+KResultOr<pid_t> Process::sys$posix_spawn(Userspace<const Syscall::SC_posix_spawn_params*> user_params)
+{
+    REQUIRE_PROMISE(proc);
+    REQUIRE_PROMISE(exec);
+
+    Syscall::SC_posix_spawn_params params;
+    if (!copy_from_user(&params, user_params))
+        return EFAULT;
+
+    if (params.arguments.length > ARG_MAX || params.environment.length > ARG_MAX || params.file_action_count > max_spawn_file_actions)
+        return E2BIG;
+    if (params.flags & ~supported_spawn_flags)
+        return EINVAL;
+    if ((params.flags & POSIX_SPAWN_SETPGROUP) && params.pgroup < 0)
+        return EINVAL;
+    if ((params.flags & POSIX_SPAWN_SETSCHEDPARAM) && (params.sched_priority < THREAD_PRIORITY_MIN || params.sched_priority > THREAD_PRIORITY_MAX))
+        return EINVAL;
+
+    auto path_or_error = get_syscall_path_argument(params.path);
+    if (path_or_error.is_error())
+        return path_or_error.error();
+    auto path = path_or_error.release_value();
+
+    Vector<String> arguments;
+    if (!copy_user_strings(params.arguments, arguments))
+        return EFAULT;
+    Vector<String> environment;
+    if (!copy_user_strings(params.environment, environment))
+        return EFAULT;
+
+    Vector<Syscall::SC_posix_spawn_file_action> file_actions;
+    Vector<String> file_action_paths;
+    if (params.file_action_count) {
+        file_actions.resize(params.file_action_count);
+        if (!copy_from_user(file_actions.data(), params.file_actions, params.file_action_count * sizeof(Syscall::SC_posix_spawn_file_action)))
+            return EFAULT;
+        for (auto& action : file_actions) {
+            if (action.type != Syscall::SpawnFileActionType::Open && action.type != Syscall::SpawnFileActionType::Chdir) {
+                file_action_paths.append(String());
+                continue;
+            }
+            auto action_path = get_syscall_path_argument(action.path);
+            if (action_path.is_error())
+                return action_path.error();
+            file_action_paths.append(action_path.release_value());
+        }
+    }
+
+    // Catch the most common failure before creating a process we'd only have to throw away.
+    // If a file action changes the directory, a relative path can only be resolved in the child.
+    bool changes_directory = any_of(file_actions.begin(), file_actions.end(), [](auto& action) {
+        return action.type == Syscall::SpawnFileActionType::Chdir || action.type == Syscall::SpawnFileActionType::Fchdir;
+    });
+    if (!changes_directory || path.starts_with('/')) {
+        auto description_or_error = VFS::the().open(path, O_EXEC, 0, current_directory());
+        if (description_or_error.is_error())
+            return description_or_error.error();
+    }
+
+    // Unlike fork(), the child starts out with an empty address space that
+    // exec() fills, so none of our regions have to be cloned.
+    RefPtr<Thread> child_first_thread;
+    auto child = adopt(*new Process(child_first_thread, m_name, uid(), gid(), pid(), false, m_cwd, m_executable, m_tty));
+    if (!child_first_thread)
+        return ENOMEM;
+    copy_inherited_state_to(*child);
+    child_first_thread->set_affinity(Thread::current()->affinity());
+
+    dbgln_if(FORK_DEBUG, "posix_spawn: child={}, path={}", child, path);
+
+    auto result = child->apply_spawn_attributes(params, *child_first_thread);
+    for (size_t i = 0; i < file_actions.size() && !result.is_error(); ++i)
+        result = child->apply_spawn_file_action(file_actions[i], file_action_paths[i]);
+    if (!result.is_error()) {
+        // exec() loads the program from inside the child's address space, come back to ours.
+        ScopeGuard paging_scope_guard([&] {
+            MemoryManager::enter_process_paging_scope(*this);
+        });
+        result = child->exec(path, move(arguments), move(environment));
+    }
+
+    if (result.is_error()) {
+        dbgln_if(FORK_DEBUG, "posix_spawn: Failed to start {}: {}", path, result.error());
+        // Like a child that fails between fork() and execve(), exit with 127.
+        ProtectedDataMutationScope scope { *child };
+        child->m_termination_status = 127;
+        child->m_termination_signal = 0;
+    } else if (params.flags & POSIX_SPAWN_SETSIGMASK) {
+        // Nobody can send the child a signal until it's in the process list.
+        child_first_thread->update_signal_mask(params.sigmask);
+    }
+
+    {
+        ScopedSpinLock processes_lock(g_processes_lock);
+        g_processes->prepend(child);
+    }
+
+    if (result.is_error()) {
+        // The child never ran, so it can go straight to the finalizer.
+        ScopedSpinLock lock(g_scheduler_lock);
+        child_first_thread->set_state(Thread::State::Dying);
+    }
+
+    auto child_pid = child->pid().value();
+    // We need to leak one reference so we don't destroy the Process,
+    // which will be dropped by Process::reap
+    (void)child.leak_ref();
+    return child_pid;
+}
+
+}
@@ -0,0 +1,186 @@
+/*
+ * Copyright (c) 2021, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <AK/StringView.h>
+#include <Kernel/API/ProcessStatistics.h>
+#include <Kernel/FileSystem/Custody.h>
+#include <Kernel/FileSystem/VirtualFileSystem.h>
+#include <Kernel/KBufferBuilder.h>
+#include <Kernel/Process.h>
+#include <Kernel/TTY/TTY.h>
+
+namespace Kernel {
+
+template<size_t size>
+static void copy_truncated(char (&destination)[size], const StringView& source)
+{
+    size_t length = min(source.length(), size - 1);
+    memcpy(destination, source.characters_without_null_termination(), length);
+    destination[length] = '\0';
+}
+
+template<typename T>
+static void append_record(KBufferBuilder& builder, const T& record)
+{
+    builder.append_bytes({ &record, sizeof(record) });
+}
+
+static void append_process_records(KBufferBuilder& builder, const Process& process, u32 since_generation)
+{
+    bool changed = process.statistics_generation() >= since_generation;
+    if (!changed) {
+        // Running threads accumulate ticks without changing state.
+        process.for_each_thread([&](const Thread& thread) {
+            if (thread.state() != Thread::Running)
+                return IterationDecision::Continue;
+            changed = true;
+            return IterationDecision::Break;
+        });
+    }
+
+    if (!changed) {
+        UnchangedProcessStatisticsRecord record;
+        record.pid = process.pid().value();
+        append_record(builder, record);
+        return;
+    }
+
+    ProcessStatisticsRecord record;
+    record.pid = process.pid().value();
+    record.pgid = process.tty() ? process.tty()->pgid().value() : 0;
+    record.pgp = process.pgid().value();
+    record.sid = process.sid().value();
+    record.uid = process.uid();
+    record.gid = process.gid();
+    record.ppid = process.ppid().value();
+    record.nfds = process.number_of_open_file_descriptors();
+    record.kernel = process.is_kernel_process();
+    record.dumpable = process.is_dumpable();
+    record.amount_virtual = process.space().amount_virtual();
+    record.amount_resident = process.space().amount_resident();
+    record.amount_dirty_private = process.space().amount_dirty_private();
+    record.amount_clean_inode = process.space().amount_clean_inode();
+    record.amount_shared = process.space().amount_shared();
+    record.amount_purgeable_volatile = process.space().amount_purgeable_volatile();
+    record.amount_purgeable_nonvolatile = process.space().amount_purgeable_nonvolatile();
+    copy_truncated(record.name, process.name());
+    copy_truncated(record.tty, process.tty() ? process.tty()->tty_name() : "notty");
+    if (process.executable())
+        copy_truncated(record.executable, process.executable()->absolute_path());
+
+    if (process.is_user_process()) {
+        StringBuilder pledge_builder;
+
+#define __ENUMERATE_PLEDGE_PROMISE(promise)      \
+    if (process.has_promised(Pledge::promise)) { \
+        pledge_builder.append(#promise " ");     \
+    }
+        ENUMERATE_PLEDGE_PROMISES
+#undef __ENUMERATE_PLEDGE_PROMISE
+
+        copy_truncated(record.pledge, pledge_builder.string_view());
+
+        switch (process.veil_state()) {
+        case VeilState::None:
+            record.veil = ProcessStatisticsVeilState::None;
+            break;
+        case VeilState::Dropped:
+            record.veil = ProcessStatisticsVeilState::Dropped;
+            break;
+        case VeilState::Locked:
+            record.veil = ProcessStatisticsVeilState::Locked;
+            break;
+        }
+    }
+
+    Vector<ThreadStatisticsRecord> thread_records;
+    process.for_each_thread([&](const Thread& thread) {
+        ThreadStatisticsRecord thread_record;
+        thread_record.tid = thread.tid().value();
+        thread_record.times_scheduled = thread.times_scheduled();
+        thread_record.ticks_user = thread.ticks_in_user();
+        thread_record.ticks_kernel = thread.ticks_in_kernel();
+        thread_record.cpu = thread.cpu();
+        thread_record.priority = thread.priority();
+        thread_record.syscall_count = thread.syscall_count();
+        thread_record.inode_faults = thread.inode_faults();
+        thread_record.zero_faults = thread.zero_faults();
+        thread_record.cow_faults = thread.cow_faults();
+        thread_record.file_read_bytes = thread.file_read_bytes();
+        thread_record.file_write_bytes = thread.file_write_bytes();
+        thread_record.unix_socket_read_bytes = thread.unix_socket_read_bytes();
+        thread_record.unix_socket_write_bytes = thread.unix_socket_write_bytes();
+        thread_record.ipv4_socket_read_bytes = thread.ipv4_socket_read_bytes();
+        thread_record.ipv4_socket_write_bytes = thread.ipv4_socket_write_bytes();
+        copy_truncated(thread_record.state, thread.state_string());
+        copy_truncated(thread_record.name, thread.name());
+        thread_records.append(thread_record);
+        return IterationDecision::Continue;
+    });
+
+    record.thread_count = thread_records.size();
+    append_record(builder, record);
+    for (auto& thread_record : thread_records)
+        append_record(builder, thread_record);
+}
+
+KResultOr<ssize_t> Process::sys$get_process_statistics(Userspace<const Syscall::SC_get_process_statistics_params*> user_params)
+{
+    REQUIRE_PROMISE(rpath);
+    Syscall::SC_get_process_statistics_params params;
+    if (!copy_from_user(&params, user_params))
+        return EFAULT;
+
+    // This hands out everything /proc/all does, so it's subject to the same veil.
+    if (auto custody_or_error = VFS::the().resolve_path("/proc/all", current_directory(), nullptr, O_RDONLY); custody_or_error.is_error())
+        return custody_or_error.error();
+
+    // Everything that changes from now on is stamped with the new generation,
+    // so it will be included when the caller asks for changes since it.
+    u32 generation = s_statistics_generation.fetch_add(1, AK::MemoryOrder::memory_order_relaxed) + 1;
+
+    KBufferBuilder builder(true);
+    {
+        ScopedSpinLock lock(g_scheduler_lock);
+        auto processes = Process::all_processes();
+        append_process_records(builder, *Scheduler::colonel(), params.since_generation);
+        for (auto& process : processes)
+            append_process_records(builder, process, params.since_generation);
+    }
+
+    auto buffer = builder.build();
+    if (!buffer)
+        return ENOMEM;
+    if (buffer->size() > params.buffer_size)
+        return ENOSPC;
+    if (!copy_to_user((u8*)params.buffer, buffer->data(), buffer->size()))
+        return EFAULT;
+    if (!copy_to_user(params.generation, &generation))
+        return EFAULT;
+    return buffer->size();
+}
+
+}
@@ -35,18 +35,27 @@ namespace Kernel {
 PerformanceEventBuffer* g_global_perf_events;
 bool g_profiling_all_threads;
 
-KResultOr<int> Process::sys$profiling_enable(pid_t pid)
+KResultOr<int> Process::sys$profiling_enable(pid_t pid, unsigned flags)
 {
     REQUIRE_NO_PROMISES;
 
+    if (flags & ~PROFILING_FLAG_OVERWRITE)
+        return EINVAL;
+    auto mode = (flags & PROFILING_FLAG_OVERWRITE) ? PerformanceEventBuffer::Mode::Overwrite : PerformanceEventBuffer::Mode::StopWhenFull;
+
     if (pid == -1) {
         if (!is_superuser())
             return EPERM;
-        ScopedCritical critical;
-        if (g_global_perf_events)
+        if (g_global_perf_events) {
             g_global_perf_events->clear();
-        else
-            g_global_perf_events = PerformanceEventBuffer::try_create_with_size(32 * MiB).leak_ptr();
+            g_global_perf_events->set_mode(mode);
+        } else {
+            auto perf_events = PerformanceEventBuffer::try_create_with_size(32 * MiB, mode);
+            if (!perf_events)
+                return ENOMEM;
+            ScopedCritical critical;
+            g_global_perf_events = perf_events.leak_ptr();
+        }
         g_profiling_all_threads = true;
         return 0;
     }
@@ -61,6 +70,7 @@ KResultOr<int> Process::sys$profiling_enable(pid_t pid)
         return EPERM;
     if (!process->create_perf_events_buffer_if_needed())
         return ENOMEM;
+    process->perf_events()->set_mode(mode);
     process->set_profiling(true);
     return 0;
 }
@@ -87,4 +97,40 @@ KResultOr<int> Process::sys$profiling_disable(pid_t pid)
     return 0;
 }
 
+KResultOr<ssize_t> Process::sys$profiling_drain(pid_t pid, Userspace<void*> user_buffer, size_t user_size)
+{
+    REQUIRE_NO_PROMISES;
+
+    auto buffer = UserOrKernelBuffer::for_user_buffer(user_buffer, user_size);
+    if (!buffer.has_value())
+        return EFAULT;
+
+    if (pid == -1) {
+        if (!is_superuser())
+            return EPERM;
+        if (!g_global_perf_events)
+            return EINVAL;
+        auto result = g_global_perf_events->drain(buffer.value(), user_size);
+        if (result.is_error())
+            return result.error();
+        return result.value();
+    }
+
+    RefPtr<Process> process;
+    {
+        ScopedSpinLock lock(g_processes_lock);
+        process = Process::from_pid(pid);
+    }
+    if (!process)
+        return ESRCH;
+    if (!is_superuser() && process->uid() != euid())
+        return EPERM;
+    if (!process->perf_events())
+        return EINVAL;
+    auto result = process->perf_events()->drain(buffer.value(), user_size);
+    if (result.is_error())
+        return result.error();
+    return result.value();
+}
+
 }
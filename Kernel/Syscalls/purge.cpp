@@ -25,6 +25,8 @@
  */
 
 #include <AK/NonnullRefPtrVector.h>
+#include <Kernel/FileSystem/Inode.h>
+#include <Kernel/Heap/SlabAllocator.h>
 #include <Kernel/Process.h>
 #include <Kernel/VM/AnonymousVMObject.h>
 #include <Kernel/VM/InodeVMObject.h>
@@ -51,6 +53,8 @@ KResultOr<int> Process::sys$purge(int mode)
         for (auto& vmobject : vmobjects) {
             purged_page_count += vmobject.purge();
         }
+        // Empty slabs only go back to the kmalloc heap, so they don't count as purged pages.
+        slab_alloc_release_empty_slabs();
     }
     if (mode & PURGE_ALL_CLEAN_INODE) {
         NonnullRefPtrVector<InodeVMObject> vmobjects;
@@ -65,6 +69,8 @@ KResultOr<int> Process::sys$purge(int mode)
         for (auto& vmobject : vmobjects) {
             purged_page_count += vmobject.release_all_clean_pages();
         }
+        // Now that the mappings have let go of their clean pages, the inode page caches can too.
+        purged_page_count += Inode::release_all_unmapped_cached_pages();
     }
     return purged_page_count;
 }
@@ -0,0 +1,251 @@
+/*
+ * Copyright (c) 2021, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <AK/NumericLimits.h>
+#include <AK/Optional.h>
+#include <Kernel/Debug.h>
+#include <Kernel/FileSystem/FileDescription.h>
+#include <Kernel/KBuffer.h>
+#include <Kernel/Process.h>
+
+namespace Kernel {
+
+// The largest chunk we stage in a kernel buffer between reading from the
+// source and writing to the destination.
+static constexpr size_t transfer_buffer_size = 64 * KiB;
+
+KResultOr<ssize_t> Process::do_transfer(FileDescription& in, Optional<off_t>& in_offset, FileDescription& out, Optional<off_t>& out_offset, size_t count, bool nonblocking)
+{
+    if (count == 0)
+        return 0;
+
+    // The data never passes through userspace: we read straight from the source
+    // file into a kernel buffer, and hand that buffer directly to the destination.
+    auto buffer = KBuffer::try_create_with_size(min(count, transfer_buffer_size), Region::Access::Read | Region::Access::Write, "Transfer buffer", AllocationStrategy::AllocateNow);
+    if (!buffer)
+        return ENOMEM;
+    auto kernel_buffer = UserOrKernelBuffer::for_kernel_buffer(buffer->data());
+
+    bool in_is_blocking = in.is_blocking() && !nonblocking;
+    bool out_is_blocking = out.is_blocking() && !nonblocking;
+    // If we can't write everything we read, we have to be able to put the rest back.
+    bool in_can_rewind = in.file().is_seekable();
+
+    if (!out_offset.has_value() && out.should_append() && out.file().is_seekable()) {
+        auto seek_result = out.seek(0, SEEK_END);
+        if (seek_result.is_error())
+            return seek_result.error();
+    }
+
+    size_t total_transferred = 0;
+    while (total_transferred < count) {
+        if (!in_offset.has_value() && !in.can_read()) {
+            if (total_transferred > 0)
+                break;
+            if (!in_is_blocking)
+                return EAGAIN;
+            auto unblock_flags = Thread::FileBlocker::BlockFlags::None;
+            if (Thread::current()->block<Thread::ReadBlocker>({}, in, unblock_flags).was_interrupted())
+                return EINTR;
+            if (!has_flag(unblock_flags, Thread::FileBlocker::BlockFlags::Read))
+                return EAGAIN;
+        }
+        if (in_can_rewind && !out_is_blocking && !out.can_write()) {
+            if (total_transferred > 0)
+                break;
+            return EAGAIN;
+        }
+
+        size_t chunk_size = min(count - total_transferred, buffer->size());
+        auto nread_or_error = in_offset.has_value() ? in.read_at(kernel_buffer, in_offset.value(), chunk_size) : in.read(kernel_buffer, chunk_size);
+        if (nread_or_error.is_error()) {
+            if (total_transferred > 0)
+                break;
+            return nread_or_error.error();
+        }
+        size_t nread = nread_or_error.value();
+        if (nread == 0)
+            break;
+
+        size_t nwritten = 0;
+        KResult write_error = KSuccess;
+        while (nwritten < nread) {
+            if (!out.can_write()) {
+                // Bytes taken out of a pipe or socket can't be put back, so in
+                // that case we wait for the destination even if it's non-blocking.
+                if (!out_is_blocking && in_can_rewind)
+                    break;
+                auto unblock_flags = Thread::FileBlocker::BlockFlags::None;
+                if (Thread::current()->block<Thread::WriteBlocker>({}, out, unblock_flags).was_interrupted()) {
+                    write_error = EINTR;
+                    break;
+                }
+            }
+            auto chunk = kernel_buffer.offset(nwritten);
+            auto result = out_offset.has_value() ? out.write_at(out_offset.value() + nwritten, chunk, nread - nwritten) : out.write(chunk, nread - nwritten);
+            if (result.is_error()) {
+                write_error = result.error();
+                break;
+            }
+            if (result.value() == 0)
+                break;
+            nwritten += result.value();
+        }
+
+        if (nwritten < nread && in_can_rewind && !in_offset.has_value()) {
+            auto seek_result = in.seek(-(off_t)(nread - nwritten), SEEK_CUR);
+            if (seek_result.is_error())
+                dbgln("do_transfer: Failed to rewind source after short write: {}", seek_result.error());
+        }
+        if (nwritten < nread && !in_can_rewind)
+            dbgln_if(IO_DEBUG, "do_transfer: Dropped {} bytes after short write", nread - nwritten);
+
+        if (in_offset.has_value())
+            in_offset.value() += nwritten;
+        if (out_offset.has_value())
+            out_offset.value() += nwritten;
+        total_transferred += nwritten;
+
+        if (nwritten < nread) {
+            if (total_transferred == 0 && write_error.is_error())
+                return write_error;
+            break;
+        }
+    }
+
+    return total_transferred;
+}
+
+KResultOr<ssize_t> Process::sys$sendfile(Userspace<const Syscall::SC_sendfile_params*> user_params)
+{
+    REQUIRE_PROMISE(stdio);
+    Syscall::SC_sendfile_params params;
+    if (!copy_from_user(&params, user_params))
+        return EFAULT;
+
+    if (params.count > (size_t)NumericLimits<ssize_t>::max())
+        params.count = NumericLimits<ssize_t>::max();
+
+    auto in_description = file_description(params.in_fd);
+    auto out_description = file_description(params.out_fd);
+    if (!in_description || !out_description)
+        return EBADF;
+    if (!in_description->is_readable() || !out_description->is_writable())
+        return EBADF;
+    if (in_description->is_directory())
+        return EISDIR;
+    // Like other systems, we only allow sending from something that behaves like a file.
+    if (!in_description->file().is_seekable())
+        return EINVAL;
+
+    Optional<off_t> in_offset;
+    if (params.offset) {
+        off_t offset;
+        if (!copy_from_user(&offset, params.offset))
+            return EFAULT;
+        if (offset < 0)
+            return EINVAL;
+        in_offset = offset;
+    }
+
+    Optional<off_t> out_offset;
+    auto result = do_transfer(*in_description, in_offset, *out_description, out_offset, params.count, false);
+    if (result.is_error())
+        return result.error();
+
+    if (params.offset) {
+        off_t offset = in_offset.value();
+        if (!copy_to_user(params.offset, &offset))
+            return EFAULT;
+    }
+    return result.value();
+}
+
+KResultOr<ssize_t> Process::sys$splice(Userspace<const Syscall::SC_splice_params*> user_params)
+{
+    REQUIRE_PROMISE(stdio);
+    Syscall::SC_splice_params params;
+    if (!copy_from_user(&params, user_params))
+        return EFAULT;
+
+    if (params.flags & ~(SPLICE_F_MOVE | SPLICE_F_NONBLOCK | SPLICE_F_MORE))
+        return EINVAL;
+    if (params.count > (size_t)NumericLimits<ssize_t>::max())
+        params.count = NumericLimits<ssize_t>::max();
+
+    auto in_description = file_description(params.in_fd);
+    auto out_description = file_description(params.out_fd);
+    if (!in_description || !out_description)
+        return EBADF;
+    if (!in_description->is_readable() || !out_description->is_writable())
+        return EBADF;
+    if (in_description->is_directory() || out_description->is_directory())
+        return EISDIR;
+    // One side of a splice has to be a pipe.
+    if (!in_description->is_fifo() && !out_description->is_fifo())
+        return EINVAL;
+    if (in_description.ptr() == out_description.ptr())
+        return EINVAL;
+
+    auto copy_offset_from_user = [](i64* user_offset, FileDescription& description, Optional<off_t>& offset) -> KResult {
+        if (!user_offset)
+            return KSuccess;
+        if (!description.file().is_seekable())
+            return ESPIPE;
+        off_t value;
+        if (!copy_from_user(&value, user_offset))
+            return EFAULT;
+        if (value < 0)
+            return EINVAL;
+        offset = value;
+        return KSuccess;
+    };
+
+    Optional<off_t> in_offset;
+    Optional<off_t> out_offset;
+    if (auto result = copy_offset_from_user(params.in_offset, *in_description, in_offset); result.is_error())
+        return result;
+    if (auto result = copy_offset_from_user(params.out_offset, *out_description, out_offset); result.is_error())
+        return result;
+
+    auto result = do_transfer(*in_description, in_offset, *out_description, out_offset, params.count, params.flags & SPLICE_F_NONBLOCK);
+    if (result.is_error())
+        return result.error();
+
+    if (params.in_offset) {
+        off_t offset = in_offset.value();
+        if (!copy_to_user(params.in_offset, &offset))
+            return EFAULT;
+    }
+    if (params.out_offset) {
+        off_t offset = out_offset.value();
+        if (!copy_to_user(params.out_offset, &offset))
+            return EFAULT;
+    }
+    return result.value();
+}
+
+}
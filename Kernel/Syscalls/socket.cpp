@@ -97,7 +97,11 @@ KResultOr<int> Process::sys$listen(int sockfd, int backlog)
 KResultOr<int> Process::sys$accept(int accepting_socket_fd, Userspace<sockaddr*> user_address, Userspace<socklen_t*> user_address_size)
 {
     REQUIRE_PROMISE(accept);
+    return accept(accepting_socket_fd, user_address, user_address_size, true);
+}
 
+KResultOr<int> Process::accept(int accepting_socket_fd, Userspace<sockaddr*> user_address, Userspace<socklen_t*> user_address_size, bool may_block)
+{
     socklen_t address_size = 0;
     if (user_address && !copy_from_user(&address_size, static_ptr_cast<const socklen_t*>(user_address_size)))
         return EFAULT;
@@ -113,7 +117,7 @@ KResultOr<int> Process::sys$accept(int accepting_socket_fd, Userspace<sockaddr*>
     auto& socket = *accepting_socket_description->socket();
 
     if (!socket.can_accept()) {
-        if (accepting_socket_description->is_blocking()) {
+        if (may_block && accepting_socket_description->is_blocking()) {
             auto unblock_flags = Thread::FileBlocker::BlockFlags::None;
             if (Thread::current()->block<Thread::AcceptBlocker>({}, *accepting_socket_description, unblock_flags).was_interrupted())
                 return EINTR;
@@ -122,7 +126,10 @@ KResultOr<int> Process::sys$accept(int accepting_socket_fd, Userspace<sockaddr*>
         }
     }
     auto accepted_socket = socket.accept();
-    VERIFY(accepted_socket);
+    if (!accepted_socket) {
+        // Someone else took the pending connection after we checked.
+        return EAGAIN;
+    }
 
     if (user_address) {
         u8 address_buffer[sizeof(sockaddr_un)];
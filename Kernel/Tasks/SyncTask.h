@@ -30,5 +30,8 @@ namespace Kernel {
 class SyncTask {
 public:
     static void spawn();
+
+    // Ask SyncTask to write back dirty data now rather than at its next periodic sync.
+    static void request_sync();
 };
 }
@@ -875,6 +875,26 @@ RefPtr<Thread> Thread::clone(Process& process)
     return clone;
 }
 
+void Thread::set_priority(u32 priority)
+{
+    m_priority = priority;
+    process().did_change_statistics();
+}
+
+void Thread::set_name(const StringView& name)
+{
+    ScopedSpinLock lock(m_lock);
+    m_name = name;
+    process().did_change_statistics();
+}
+
+void Thread::set_name(String&& name)
+{
+    ScopedSpinLock lock(m_lock);
+    m_name = move(name);
+    process().did_change_statistics();
+}
+
 void Thread::set_state(State new_state, u8 stop_signal)
 {
     State previous_state;
@@ -896,6 +916,7 @@ void Thread::set_state(State new_state, u8 stop_signal)
         m_state = new_state;
         dbgln_if(THREAD_DEBUG, "Set thread {} state to {}", *this, state_string());
     }
+    process().did_change_statistics();
 
     if (previous_state == Runnable) {
         Scheduler::dequeue_runnable_thread(*this);
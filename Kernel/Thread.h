@@ -41,6 +41,7 @@
 #include <Kernel/Arch/x86/SafeMem.h>
 #include <Kernel/Debug.h>
 #include <Kernel/Forward.h>
+#include <Kernel/Heap/SlabAllocator.h>
 #include <Kernel/KResult.h>
 #include <Kernel/LockMode.h>
 #include <Kernel/Scheduler.h>
@@ -84,6 +85,7 @@ class Thread
     , public Weakable<Thread> {
     AK_MAKE_NONCOPYABLE(Thread);
     AK_MAKE_NONMOVABLE(Thread);
+    MAKE_SLAB_CACHED(Thread)
 
     friend class Process;
     friend class ProtectedProcessBase;
@@ -110,7 +112,7 @@ public:
     ThreadID tid() const { return m_tid; }
     ProcessID pid() const;
 
-    void set_priority(u32 p) { m_priority = p; }
+    void set_priority(u32 p);
     u32 priority() const { return m_priority; }
 
     void detach()
@@ -135,16 +137,8 @@ public:
         ScopedSpinLock lock(m_lock);
         return m_name;
     }
-    void set_name(const StringView& s)
-    {
-        ScopedSpinLock lock(m_lock);
-        m_name = s;
-    }
-    void set_name(String&& name)
-    {
-        ScopedSpinLock lock(m_lock);
-        m_name = move(name);
-    }
+    void set_name(const StringView&);
+    void set_name(String&&);
 
     void finalize();
 
@@ -210,7 +204,7 @@ public:
             : m_infinite(true)
         {
         }
-        explicit BlockTimeout(bool is_absolute, const Time* time, const Time* start_time = nullptr, clockid_t clock_id = CLOCK_MONOTONIC_COARSE);
+        explicit BlockTimeout(bool is_absolute, const Time* time, const Time* start_time = nullptr, clockid_t clock_id = CLOCK_MONOTONIC);
 
         const Time& absolute_time() const { return m_time; }
         const Time* start_time() const { return !m_infinite ? &m_start_time : nullptr; }
@@ -221,7 +215,7 @@ public:
     private:
         Time m_time {};
         Time m_start_time {};
-        clockid_t m_clock_id { CLOCK_MONOTONIC_COARSE };
+        clockid_t m_clock_id { CLOCK_MONOTONIC };
         bool m_infinite { false };
         bool m_should_block { false };
     };
@@ -1126,11 +1120,15 @@ public:
     }
     void set_handling_page_fault(bool b) { m_handling_page_fault = b; }
 
+    TLBFlushBatch* tlb_flush_batch() const { return m_tlb_flush_batch; }
+    void set_tlb_flush_batch(TLBFlushBatch* batch) { m_tlb_flush_batch = batch; }
+
 private:
     Thread(NonnullRefPtr<Process>, NonnullOwnPtr<Region> kernel_stack_region);
 
     IntrusiveListNode m_process_thread_list_node;
     int m_runnable_priority { -1 };
+    u32 m_runnable_cpu { 0 };
 
     friend class WaitQueue;
 
@@ -1234,6 +1232,7 @@ private:
     Atomic<bool, AK::MemoryOrder::memory_order_relaxed> m_is_active { false };
     bool m_is_joinable { true };
     bool m_handling_page_fault { false };
+    TLBFlushBatch* m_tlb_flush_batch { nullptr };
     PreviousMode m_previous_mode { PreviousMode::UserMode };
 
     unsigned m_syscall_count { 0 };
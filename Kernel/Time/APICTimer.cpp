@@ -166,13 +166,38 @@ size_t APICTimer::ticks_per_second() const
 
 void APICTimer::set_periodic()
 {
-    // FIXME: Implement it...
-    VERIFY_NOT_REACHED();
+    VERIFY_INTERRUPTS_DISABLED();
+    m_timer_mode = APIC::TimerMode::Periodic;
+    enable_local_timer();
 }
+
 void APICTimer::set_non_periodic()
 {
-    // FIXME: Implement it...
-    VERIFY_NOT_REACHED();
+    // NOTE: In one-shot mode the timer stops after firing once. Whoever
+    // handles the interrupt is responsible for arming it again using
+    // program_one_shot(), on every processor.
+    VERIFY_INTERRUPTS_DISABLED();
+    m_timer_mode = APIC::TimerMode::OneShot;
+    enable_local_timer();
+}
+
+void APICTimer::program_one_shot(u64 nanoseconds)
+{
+    VERIFY_INTERRUPTS_DISABLED();
+    VERIFY(m_timer_mode == APIC::TimerMode::OneShot);
+
+    // Keep the multiplication below from overflowing, callers never need
+    // to sleep for longer than this anyway.
+    constexpr u64 max_one_shot_nanoseconds = 1'000'000'000;
+    nanoseconds = min(nanoseconds, max_one_shot_nanoseconds);
+
+    auto& apic = APIC::the();
+    u64 bus_ticks_per_second = (u64)m_timer_period * m_frequency;
+    // Round up so that the timer never fires before the deadline.
+    u64 ticks = (nanoseconds * bus_ticks_per_second + 999'999'999) / 1'000'000'000;
+    // An initial count of 0 would stop the timer altogether.
+    ticks = clamp(ticks, (u64)apic.get_timer_divisor(), (u64)0xffffffff);
+    apic.setup_local_timer((u32)ticks, APIC::TimerMode::OneShot, true);
 }
 
 void APICTimer::reset_to_default_ticks_per_second()
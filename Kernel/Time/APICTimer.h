@@ -55,6 +55,10 @@ public:
     void enable_local_timer();
     void disable_local_timer();
 
+    // Arms the local timer of the current processor to fire once after
+    // the given amount of time. Only valid in non-periodic mode.
+    void program_one_shot(u64 nanoseconds);
+
 private:
     explicit APICTimer(u8, Function<void(const RegisterState&)>);
 
@@ -45,6 +45,12 @@ namespace Kernel {
 
 static AK::Singleton<TimeManagement> s_the;
 
+// In tickless mode a running thread still gets preempted at this rate (see time_slice_for()).
+static constexpr Time scheduler_tick_interval = Time::from_nanoseconds(1'000'000'000 / OPTIMAL_TICKS_PER_SECOND_RATE);
+// An idle processor without any pending timers still wakes up this often,
+// which keeps the HPET main counter from wrapping around unnoticed.
+static constexpr Time max_tickless_idle_interval = Time::from_seconds(1);
+
 TimeManagement& TimeManagement::the()
 {
     return *s_the;
@@ -126,16 +132,26 @@ Time TimeManagement::monotonic_time(TimePrecision precision) const
     return Time::from_timespec({ (i64)seconds, (i32)ns });
 }
 
-Time TimeManagement::epoch_time(TimePrecision) const
+Time TimeManagement::epoch_time(TimePrecision precision) const
 {
-    // TODO: Take into account precision
     timespec ts;
+    u64 delta_ns = 0;
+
+    // In tickless mode the epoch time may not have been updated in a long
+    // time, so add the time that passed since the last update.
+    bool do_query = precision == TimePrecision::Precise && m_can_query_precise_time;
+
     u32 update_iteration;
     do {
         update_iteration = m_update1.load(AK::MemoryOrder::memory_order_acquire);
         ts = m_epoch_time;
+        if (do_query) {
+            u64 seconds = m_seconds_since_boot;
+            u32 ticks = m_ticks_this_second;
+            delta_ns = HPET::the().update_time(seconds, ticks, true);
+        }
     } while (update_iteration != m_update2.load(AK::MemoryOrder::memory_order_acquire));
-    return Time::from_timespec(ts);
+    return Time::from_timespec(ts) + Time::from_nanoseconds(delta_ns);
 }
 
 u64 TimeManagement::uptime_ms() const
@@ -161,6 +177,13 @@ UNMAP_AFTER_INIT void TimeManagement::initialize(u32 cpu)
         if (auto* apic_timer = APIC::the().initialize_timers(*s_the->m_system_timer)) {
             dmesgln("Time: Using APIC timer as system timer");
             s_the->set_system_timer(*apic_timer);
+
+            // One-shot deadlines need a clock we can query at any time.
+            if (s_the->m_can_query_precise_time && kernel_command_line().is_tickless_enabled()) {
+                dmesgln("Time: Using tickless mode");
+                s_the->m_tickless = true;
+                apic_timer->set_non_periodic();
+            }
         }
     } else {
         VERIFY(s_the.is_initialized());
@@ -289,10 +312,10 @@ UNMAP_AFTER_INIT bool TimeManagement::probe_and_set_non_legacy_hardware_timers()
         // Update the time. We don't really care too much about the
         // frequency of the interrupt because we'll query the main
         // counter to get an accurate time.
-        if (Processor::id() == 0) {
-            // TODO: Have the other CPUs call system_timer_tick directly
+        // In tickless mode the BSP may be idle and not take any interrupts
+        // for a long time, so whoever gets here keeps the clocks going.
+        if (Processor::id() == 0 || m_tickless)
             increment_time_since_boot_hpet();
-        }
 
         system_timer_tick(regs);
     });
@@ -346,6 +369,7 @@ void TimeManagement::increment_time_since_boot_hpet()
     // updated here! So we can safely read that information, query the clock,
     // and when we're all done we can update the information. This reduces
     // contention when other processors attempt to read the clock.
+    ScopedSpinLock lock(m_time_update_lock);
     auto seconds_since_boot = m_seconds_since_boot;
     auto ticks_this_second = m_ticks_this_second;
     auto delta_ns = HPET::the().update_time(seconds_since_boot, ticks_this_second, false);
@@ -391,11 +415,81 @@ void TimeManagement::increment_time_since_boot()
 
 void TimeManagement::system_timer_tick(const RegisterState& regs)
 {
-    if (Processor::current().in_irq() <= 1) {
+    auto& processor = Processor::current();
+    if (processor.in_irq() <= 1) {
         // Don't expire timers while handling IRQs
         TimerQueue::the().fire();
     }
-    Scheduler::timer_tick(regs);
+
+    auto& time_management = TimeManagement::the();
+    if (!time_management.m_tickless) {
+        Scheduler::timer_tick(regs);
+        return;
+    }
+
+    // The local timer also fires for timer deadlines in between scheduler
+    // ticks, which must not count towards the current thread's time slice.
+    auto now = time_management.monotonic_time(TimePrecision::Precise);
+    if (!processor.is_in_tickless_idle() && now >= processor.next_scheduler_tick()) {
+        processor.set_next_scheduler_tick(now + scheduler_tick_interval);
+        Scheduler::timer_tick(regs);
+    }
+    time_management.program_local_timer(processor, now, TimerQueue::the().next_deadline());
+}
+
+void TimeManagement::program_local_timer(Processor& processor, const Time& now, const Optional<Time>& next_timer_deadline)
+{
+    VERIFY_INTERRUPTS_DISABLED();
+    VERIFY(m_tickless);
+    VERIFY(m_system_timer->timer_type() == HardwareTimerType::LocalAPICTimer);
+
+    Time deadline;
+    if (processor.is_in_tickless_idle())
+        deadline = now + max_tickless_idle_interval;
+    else
+        deadline = processor.next_scheduler_tick();
+    if (next_timer_deadline.has_value() && next_timer_deadline.value() < deadline)
+        deadline = next_timer_deadline.value();
+
+    u64 delta_ns = deadline > now ? (u64)(deadline - now).to_nanoseconds() : 0;
+    static_cast<APICTimer&>(*m_system_timer).program_one_shot(delta_ns);
+}
+
+void TimeManagement::enter_tickless_idle()
+{
+    VERIFY_INTERRUPTS_DISABLED();
+    if (!m_tickless)
+        return;
+    auto& processor = Processor::current();
+    processor.set_in_tickless_idle(true);
+    program_local_timer(processor, monotonic_time(TimePrecision::Precise), TimerQueue::the().next_deadline());
+}
+
+void TimeManagement::leave_tickless_idle()
+{
+    VERIFY_INTERRUPTS_DISABLED();
+    auto& processor = Processor::current();
+    if (!processor.is_in_tickless_idle())
+        return;
+    processor.set_in_tickless_idle(false);
+
+    // Nobody may have updated the coarse clocks for a while.
+    increment_time_since_boot_hpet();
+
+    // Whatever runs next needs to be preempted again.
+    auto now = monotonic_time(TimePrecision::Precise);
+    processor.set_next_scheduler_tick(now + scheduler_tick_interval);
+    program_local_timer(processor, now, TimerQueue::the().next_deadline());
+}
+
+void TimeManagement::timer_queue_deadline_changed(const Time& next_deadline)
+{
+    // NOTE: This is called by the TimerQueue with its lock held. Any other
+    //       processor picks up the new deadline whenever it reprograms its
+    //       own timer, so arming the local one is enough.
+    VERIFY_INTERRUPTS_DISABLED();
+    VERIFY(m_tickless);
+    program_local_timer(Processor::current(), monotonic_time(TimePrecision::Precise), next_deadline);
 }
 
 }
@@ -27,10 +27,12 @@
 #pragma once
 
 #include <AK/NonnullRefPtrVector.h>
+#include <AK/Optional.h>
 #include <AK/RefPtr.h>
 #include <AK/Time.h>
 #include <AK/Types.h>
 #include <Kernel/KResult.h>
+#include <Kernel/SpinLock.h>
 #include <Kernel/UnixTypes.h>
 
 namespace Kernel {
@@ -38,6 +40,7 @@ namespace Kernel {
 #define OPTIMAL_TICKS_PER_SECOND_RATE 250
 
 class HardwareTimerBase;
+class Processor;
 
 enum class TimePrecision {
     Coarse = 0,
@@ -87,6 +90,14 @@ public:
 
     bool can_query_precise_time() const { return m_can_query_precise_time; }
 
+    // In tickless mode the local APIC timers run in one-shot mode and are
+    // armed for the next scheduler tick or timer deadline, whichever comes
+    // first. Idle processors stop ticking altogether.
+    bool is_tickless() const { return m_tickless; }
+    void enter_tickless_idle();
+    void leave_tickless_idle();
+    void timer_queue_deadline_changed(const Time& next_deadline);
+
 private:
     bool probe_and_set_legacy_hardware_timers();
     bool probe_and_set_non_legacy_hardware_timers();
@@ -95,6 +106,11 @@ private:
     NonnullRefPtrVector<HardwareTimerBase> m_hardware_timers;
     void set_system_timer(HardwareTimerBase&);
     static void system_timer_tick(const RegisterState&);
+    void program_local_timer(Processor&, const Time& now, const Optional<Time>& next_timer_deadline);
+
+    // Serializes updates from processors in tickless mode, where whichever
+    // processor takes a timer interrupt updates the time.
+    SpinLock<u8> m_time_update_lock;
 
     // Variables between m_update1 and m_update2 are synchronized
     Atomic<u32> m_update1 { 0 };
@@ -107,6 +123,7 @@ private:
 
     u32 m_time_ticks_per_second { 0 }; // may be different from interrupts/second (e.g. hpet)
     bool m_can_query_precise_time { false };
+    bool m_tickless { false };
 
     RefPtr<HardwareTimerBase> m_system_timer;
     RefPtr<HardwareTimerBase> m_time_keeper_timer;
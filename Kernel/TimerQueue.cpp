@@ -45,11 +45,28 @@ Time Timer::remaining() const
 
 Time Timer::now(bool is_firing) const
 {
-    // NOTE: If is_firing is true then TimePrecision::Precise isn't really useful here.
-    // We already have a quite precise time stamp because we just updated the time in the
-    // interrupt handler. In those cases, just use coarse timestamps.
+    // NOTE: If is_firing is true then TimePrecision::Precise isn't really useful here,
+    // unless we can query the time. Otherwise we already have a quite precise time stamp
+    // because we just updated the time in the interrupt handler. In those cases, just use
+    // coarse timestamps. With a queryable clock the coarse time may be up to a tick old,
+    // which would delay expiring timers.
     auto clock_id = m_clock_id;
-    if (is_firing) {
+    auto& time_management = TimeManagement::the();
+    if (is_firing && time_management.is_tickless()) {
+        // The local timer was armed for this timer's deadline in precise time, so check
+        // coarse timers against the precise clock as well. Otherwise they would look
+        // like they're not due yet, and we'd keep re-arming the timer for right now.
+        switch (clock_id) {
+        case CLOCK_MONOTONIC_COARSE:
+            clock_id = CLOCK_MONOTONIC;
+            break;
+        case CLOCK_REALTIME_COARSE:
+            clock_id = CLOCK_REALTIME;
+            break;
+        default:
+            break;
+        }
+    } else if (is_firing && !time_management.can_query_precise_time()) {
         switch (clock_id) {
         case CLOCK_MONOTONIC:
             clock_id = CLOCK_MONOTONIC_COARSE;
@@ -64,7 +81,7 @@ Time Timer::now(bool is_firing) const
             break;
         }
     }
-    return TimeManagement::the().current_time(clock_id).value();
+    return time_management.current_time(clock_id).value();
 }
 
 TimerQueue& TimerQueue::the()
@@ -112,9 +129,11 @@ void TimerQueue::add_timer_locked(NonnullRefPtr<Timer> timer)
     VERIFY(!timer->is_queued());
 
     auto& queue = queue_for_timer(*timer);
+    bool next_timer_due_changed = false;
     if (queue.list.is_empty()) {
         queue.list.append(&timer.leak_ref());
         queue.next_timer_due = timer_expiration;
+        next_timer_due_changed = true;
     } else {
         Timer* following_timer = nullptr;
         queue.list.for_each([&](Timer& t) {
@@ -127,12 +146,19 @@ void TimerQueue::add_timer_locked(NonnullRefPtr<Timer> timer)
         if (following_timer) {
             bool next_timer_needs_update = queue.list.head() == following_timer;
             queue.list.insert_before(following_timer, &timer.leak_ref());
-            if (next_timer_needs_update)
+            if (next_timer_needs_update) {
                 queue.next_timer_due = timer_expiration;
+                next_timer_due_changed = true;
+            }
         } else {
             queue.list.append(&timer.leak_ref());
         }
     }
+
+    // In tickless mode nothing would look at the queue until the next
+    // interrupt, which may be a lot later than this timer's deadline.
+    if (next_timer_due_changed && TimeManagement::the().is_tickless())
+        TimeManagement::the().timer_queue_deadline_changed(next_deadline_locked().value());
 }
 
 TimerId TimerQueue::add_timer(clockid_t clock_id, const Time& deadline, Function<void()>&& callback)
@@ -280,6 +306,29 @@ void TimerQueue::fire()
         fire_timers(m_timer_queue_realtime);
 }
 
+Optional<Time> TimerQueue::next_deadline()
+{
+    ScopedSpinLock lock(g_timerqueue_lock);
+    return next_deadline_locked();
+}
+
+Optional<Time> TimerQueue::next_deadline_locked() const
+{
+    VERIFY(g_timerqueue_lock.is_locked());
+
+    Optional<Time> deadline;
+    if (!m_timer_queue_monotonic.list.is_empty())
+        deadline = m_timer_queue_monotonic.next_timer_due;
+    if (!m_timer_queue_realtime.list.is_empty()) {
+        // Translate the wall clock deadline into monotonic time.
+        auto& time_management = TimeManagement::the();
+        auto realtime_deadline = m_timer_queue_realtime.next_timer_due - time_management.epoch_time(TimePrecision::Precise) + time_management.monotonic_time(TimePrecision::Precise);
+        if (!deadline.has_value() || realtime_deadline < deadline.value())
+            deadline = realtime_deadline;
+    }
+    return deadline;
+}
+
 void TimerQueue::update_next_timer_due(Queue& queue)
 {
     VERIFY(g_timerqueue_lock.is_locked());
@@ -29,6 +29,7 @@
 #include <AK/Function.h>
 #include <AK/InlineLinkedList.h>
 #include <AK/NonnullRefPtr.h>
+#include <AK/Optional.h>
 #include <AK/OwnPtr.h>
 #include <AK/RefCounted.h>
 #include <AK/Time.h>
@@ -102,6 +103,9 @@ public:
     }
     void fire();
 
+    // The earliest deadline of all queued timers, as CLOCK_MONOTONIC time.
+    Optional<Time> next_deadline();
+
 private:
     struct Queue {
         InlineLinkedList<Timer> list;
@@ -110,6 +114,7 @@ private:
     void remove_timer_locked(Queue&, Timer&);
     void update_next_timer_due(Queue&);
     void add_timer_locked(NonnullRefPtr<Timer>);
+    Optional<Time> next_deadline_locked() const;
 
     Queue& queue_for_timer(Timer& timer)
     {
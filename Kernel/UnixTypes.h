@@ -70,6 +70,8 @@ enum {
 #define PERF_EVENT_MALLOC 1
 #define PERF_EVENT_FREE 2
 
+#define PROFILING_FLAG_OVERWRITE 1
+
 #define WNOHANG 1
 #define WUNTRACED 2
 #define WSTOPPED WUNTRACED
@@ -77,6 +79,14 @@ enum {
 #define WCONTINUED 8
 #define WNOWAIT 0x1000000
 
+#define POSIX_SPAWN_RESETIDS (1 << 0)
+#define POSIX_SPAWN_SETPGROUP (1 << 1)
+#define POSIX_SPAWN_SETSCHEDPARAM (1 << 2)
+#define POSIX_SPAWN_SETSCHEDULER (1 << 3)
+#define POSIX_SPAWN_SETSIGDEF (1 << 4)
+#define POSIX_SPAWN_SETSIGMASK (1 << 5)
+#define POSIX_SPAWN_SETSID (1 << 6)
+
 #define R_OK 4
 #define W_OK 2
 #define X_OK 1
@@ -98,6 +108,7 @@ enum {
 #define MAP_STACK 0x40
 #define MAP_NORESERVE 0x80
 #define MAP_RANDOMIZED 0x100
+#define MAP_POPULATE 0x200
 
 #define PROT_READ 0x1
 #define PROT_WRITE 0x2
@@ -107,6 +118,7 @@ enum {
 #define MADV_SET_VOLATILE 0x100
 #define MADV_SET_NONVOLATILE 0x200
 #define MADV_GET_VOLATILE 0x400
+#define MADV_WILLNEED 0x800
 
 #define F_DUPFD 0
 #define F_GETFD 1
@@ -475,12 +487,41 @@ struct stat {
 #define POLLNVAL (1u << 5)
 #define POLLRDHUP (1u << 13)
 
+#define SPLICE_F_MOVE (1u << 0)
+#define SPLICE_F_NONBLOCK (1u << 1)
+#define SPLICE_F_MORE (1u << 2)
+
 struct pollfd {
     int fd;
     short events;
     short revents;
 };
 
+#define EPOLL_CLOEXEC (1u << 0)
+
+#define EPOLL_CTL_ADD 1
+#define EPOLL_CTL_DEL 2
+#define EPOLL_CTL_MOD 3
+
+#define EPOLLIN (1u << 0)
+#define EPOLLOUT (1u << 2)
+#define EPOLLERR (1u << 3)
+#define EPOLLHUP (1u << 4)
+#define EPOLLONESHOT (1u << 30)
+#define EPOLLET (1u << 31)
+
+typedef union epoll_data {
+    void* ptr;
+    int fd;
+    uint32_t u32;
+    uint64_t u64;
+} epoll_data_t;
+
+struct epoll_event {
+    u32 events;
+    epoll_data_t data;
+};
+
 #define AF_MASK 0xff
 #define AF_UNSPEC 0
 #define AF_LOCAL 1
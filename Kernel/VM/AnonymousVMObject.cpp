@@ -412,6 +412,60 @@ RefPtr<PhysicalPage> AnonymousVMObject::allocate_committed_page(size_t page_inde
     return MM.allocate_committed_user_physical_page(MemoryManager::ShouldZeroFill::Yes);
 }
 
+bool AnonymousVMObject::try_to_allocate_large_page(size_t first_page_index)
+{
+    constexpr size_t pages_per_large_page = LARGE_PAGE_SIZE / PAGE_SIZE;
+    if (first_page_index + pages_per_large_page > page_count())
+        return false;
+
+    bool committed = false;
+    {
+        ScopedSpinLock lock(m_lock);
+
+        // Only replace pages that are all placeholders of the same kind,
+        // so the commit accounting works out for the whole large page.
+        auto& first_page = physical_pages()[first_page_index];
+        if (!first_page)
+            return false;
+        committed = first_page->is_lazy_committed_page();
+        if (!committed && !first_page->is_shared_zero_page())
+            return false;
+        for (size_t i = 0; i < pages_per_large_page; ++i) {
+            auto& page = physical_pages()[first_page_index + i];
+            if (!page)
+                return false;
+            if (committed ? !page->is_lazy_committed_page() : !page->is_shared_zero_page())
+                return false;
+            for (auto* purgeable_ranges : m_purgeable_ranges) {
+                if (purgeable_ranges->is_volatile(first_page_index + i))
+                    return false;
+            }
+        }
+
+        if (committed) {
+            VERIFY(m_unused_committed_pages >= pages_per_large_page);
+            m_unused_committed_pages -= pages_per_large_page;
+        }
+    }
+
+    auto pages = MM.allocate_user_physical_large_page(committed);
+    if (pages.is_empty()) {
+        if (committed) {
+            ScopedSpinLock lock(m_lock);
+            m_unused_committed_pages += pages_per_large_page;
+        }
+        return false;
+    }
+
+    for (size_t i = 0; i < pages_per_large_page; ++i) {
+        physical_pages()[first_page_index + i] = pages.ptr_at(i);
+        // These pages are brand new and only ours, there's nothing to copy on write.
+        if (!m_cow_map.is_null())
+            m_cow_map.set(first_page_index + i, false);
+    }
+    return true;
+}
+
 Bitmap& AnonymousVMObject::ensure_cow_map()
 {
     if (m_cow_map.is_null())
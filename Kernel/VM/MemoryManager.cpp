@@ -40,6 +40,7 @@
 #include <Kernel/VM/PageDirectory.h>
 #include <Kernel/VM/PhysicalRegion.h>
 #include <Kernel/VM/SharedInodeVMObject.h>
+#include <Kernel/VM/TLBFlushBatch.h>
 
 extern u8* start_of_kernel_image;
 extern u8* end_of_kernel_image;
@@ -327,7 +328,7 @@ PageTableEntry* MemoryManager::pte(PageDirectory& page_directory, VirtualAddress
 
     auto* pd = quickmap_pd(const_cast<PageDirectory&>(page_directory), page_directory_table_index);
     const PageDirectoryEntry& pde = pd[page_directory_index];
-    if (!pde.is_present())
+    if (!pde.is_present() || pde.is_huge())
         return nullptr;
 
     return &quickmap_pt(PhysicalAddress((FlatPtr)pde.page_table_base()))[page_table_index];
@@ -344,6 +345,14 @@ PageTableEntry* MemoryManager::ensure_pte(PageDirectory& page_directory, Virtual
 
     auto* pd = quickmap_pd(page_directory, page_directory_table_index);
     PageDirectoryEntry& pde = pd[page_directory_index];
+    if (pde.is_present() && pde.is_huge()) {
+        // Someone wants to change a single page inside a large page, so it
+        // has to be broken up into a page table first.
+        if (!split_large_page(page_directory, vaddr))
+            return nullptr;
+        pd = quickmap_pd(page_directory, page_directory_table_index);
+        VERIFY(&pde == &pd[page_directory_index]);
+    }
     if (!pde.is_present()) {
         bool did_purge = false;
         auto page_table = allocate_user_physical_page(ShouldZeroFill::Yes, &did_purge);
@@ -374,7 +383,7 @@ PageTableEntry* MemoryManager::ensure_pte(PageDirectory& page_directory, Virtual
     return &quickmap_pt(PhysicalAddress((FlatPtr)pde.page_table_base()))[page_table_index];
 }
 
-void MemoryManager::release_pte(PageDirectory& page_directory, VirtualAddress vaddr, bool is_last_release)
+void MemoryManager::release_pte(PageDirectory& page_directory, VirtualAddress vaddr, bool is_last_release, TLBFlushBatch* tlb_batch)
 {
     VERIFY_INTERRUPTS_DISABLED();
     VERIFY(s_mm_lock.own_lock());
@@ -385,6 +394,20 @@ void MemoryManager::release_pte(PageDirectory& page_directory, VirtualAddress va
 
     auto* pd = quickmap_pd(page_directory, page_directory_table_index);
     PageDirectoryEntry& pde = pd[page_directory_index];
+    if (pde.is_present() && pde.is_huge()) {
+        // Only part of the large page is going away, keep the rest mapped.
+        if (!split_large_page(page_directory, vaddr)) {
+            dbgln("MM: Unable to split large page to release {}, dropping all of it", vaddr);
+            // The rest of the large page belongs to someone else, who will fault it back in.
+            // Their translations must not outlive the mapping, so flush them right away.
+            auto large_page_vaddr = VirtualAddress(vaddr.get() & ~(LARGE_PAGE_SIZE - 1));
+            pde.clear();
+            flush_tlb(&page_directory, large_page_vaddr, LARGE_PAGE_SIZE / PAGE_SIZE);
+            return;
+        }
+        pd = quickmap_pd(page_directory, page_directory_table_index);
+        VERIFY(&pde == &pd[page_directory_index]);
+    }
     if (pde.is_present()) {
         auto* page_table = quickmap_pt(PhysicalAddress((FlatPtr)pde.page_table_base()));
         auto& pte = page_table[page_table_index];
@@ -403,13 +426,123 @@ void MemoryManager::release_pte(PageDirectory& page_directory, VirtualAddress va
             if (all_clear) {
                 pde.clear();
 
-                auto result = page_directory.m_page_tables.remove(vaddr.get() & ~0x1fffff);
-                VERIFY(result);
+                auto it = page_directory.m_page_tables.find(vaddr.get() & ~0x1fffff);
+                VERIFY(it != page_directory.m_page_tables.end());
+                // Other processors may still be walking this page table until the batch is flushed.
+                if (tlb_batch)
+                    tlb_batch->defer_release(*it->value);
+                page_directory.m_page_tables.remove(it);
             }
         }
     }
 }
 
+bool MemoryManager::split_large_page(PageDirectory& page_directory, VirtualAddress vaddr)
+{
+    VERIFY_INTERRUPTS_DISABLED();
+    VERIFY(s_mm_lock.own_lock());
+    VERIFY(page_directory.get_lock().own_lock());
+    u32 page_directory_table_index = (vaddr.get() >> 30) & 0x3;
+    u32 page_directory_index = (vaddr.get() >> 21) & 0x1ff;
+    auto large_page_vaddr = VirtualAddress(vaddr.get() & ~(LARGE_PAGE_SIZE - 1));
+
+    auto page_table = allocate_user_physical_page(ShouldZeroFill::No);
+    if (!page_table) {
+        dbgln("MM: Unable to allocate page table to split large page at {}", large_page_vaddr);
+        return false;
+    }
+
+    // Allocating may have purged memory, which could have split this large page already.
+    auto* pd = quickmap_pd(page_directory, page_directory_table_index);
+    PageDirectoryEntry& pde = pd[page_directory_index];
+    if (!pde.is_present() || !pde.is_huge())
+        return true;
+
+    auto large_page_base = (FlatPtr)pde.page_table_base();
+    auto* page_table_entries = quickmap_pt(page_table->paddr());
+    for (size_t i = 0; i < LARGE_PAGE_SIZE / PAGE_SIZE; ++i) {
+        auto& pte = page_table_entries[i];
+        pte.clear();
+        pte.set_physical_page_base(large_page_base + i * PAGE_SIZE);
+        pte.set_writable(pde.is_writable());
+        pte.set_user_allowed(pde.is_user_allowed());
+        pte.set_write_through(pde.is_write_through());
+        pte.set_cache_disabled(pde.is_cache_disabled());
+        pte.set_global(pde.is_global());
+        pte.set_execute_disabled(pde.is_execute_disabled());
+        pte.set_present(true);
+    }
+
+    pde.clear();
+    pde.set_page_table_base(page_table->paddr().get());
+    pde.set_user_allowed(true);
+    pde.set_present(true);
+    pde.set_writable(true);
+    pde.set_global(&page_directory == m_kernel_page_directory.ptr());
+    auto result = page_directory.m_page_tables.set(large_page_vaddr.get(), page_table.release_nonnull());
+    VERIFY(result == AK::HashSetResult::InsertedNewEntry);
+
+    // The translations didn't change, but the processor may not mix up the
+    // large and small page TLB entries for the same addresses.
+    flush_tlb(&page_directory, large_page_vaddr, LARGE_PAGE_SIZE / PAGE_SIZE);
+    ++m_large_pages_split;
+    return true;
+}
+
+PageDirectoryEntry* MemoryManager::ensure_large_pde(PageDirectory& page_directory, VirtualAddress vaddr)
+{
+    VERIFY_INTERRUPTS_DISABLED();
+    VERIFY(s_mm_lock.own_lock());
+    VERIFY(page_directory.get_lock().own_lock());
+    VERIFY(!(vaddr.get() & (LARGE_PAGE_SIZE - 1)));
+    u32 page_directory_table_index = (vaddr.get() >> 30) & 0x3;
+    u32 page_directory_index = (vaddr.get() >> 21) & 0x1ff;
+
+    auto* pd = quickmap_pd(page_directory, page_directory_table_index);
+    PageDirectoryEntry& pde = pd[page_directory_index];
+    if (pde.is_present() && !pde.is_huge()) {
+        // The caller owns all of the 2 MiB, so the page table only had its own pages in it.
+        // Other processors may still be walking it, so flush before letting go of it.
+        auto it = page_directory.m_page_tables.find(vaddr.get());
+        VERIFY(it != page_directory.m_page_tables.end());
+        auto page_table = move(it->value);
+        page_directory.m_page_tables.remove(it);
+        pde.clear();
+        flush_tlb(&page_directory, vaddr, LARGE_PAGE_SIZE / PAGE_SIZE);
+    }
+    return &pde;
+}
+
+bool MemoryManager::release_large_pde(PageDirectory& page_directory, VirtualAddress vaddr)
+{
+    VERIFY_INTERRUPTS_DISABLED();
+    VERIFY(s_mm_lock.own_lock());
+    VERIFY(page_directory.get_lock().own_lock());
+    VERIFY(!(vaddr.get() & (LARGE_PAGE_SIZE - 1)));
+    u32 page_directory_table_index = (vaddr.get() >> 30) & 0x3;
+    u32 page_directory_index = (vaddr.get() >> 21) & 0x1ff;
+
+    auto* pd = quickmap_pd(page_directory, page_directory_table_index);
+    PageDirectoryEntry& pde = pd[page_directory_index];
+    if (!pde.is_present() || !pde.is_huge())
+        return false;
+    pde.clear();
+    return true;
+}
+
+bool MemoryManager::is_mapped_as_large_page(PageDirectory& page_directory, VirtualAddress vaddr)
+{
+    VERIFY_INTERRUPTS_DISABLED();
+    VERIFY(s_mm_lock.own_lock());
+    VERIFY(page_directory.get_lock().own_lock());
+    u32 page_directory_table_index = (vaddr.get() >> 30) & 0x3;
+    u32 page_directory_index = (vaddr.get() >> 21) & 0x1ff;
+
+    auto* pd = quickmap_pd(page_directory, page_directory_table_index);
+    auto& pde = pd[page_directory_index];
+    return pde.is_present() && pde.is_huge();
+}
+
 UNMAP_AFTER_INIT void MemoryManager::initialize(u32 cpu)
 {
     auto mm_data = new MemoryManagerData;
@@ -455,7 +588,9 @@ Region* MemoryManager::find_region_from_vaddr(VirtualAddress vaddr)
     ScopedSpinLock lock(s_mm_lock);
     if (auto* region = kernel_region_from_vaddr(vaddr))
         return region;
-    auto page_directory = PageDirectory::find_by_cr3(read_cr3());
+    // NOTE: Look at the current thread's page directory rather than cr3, which might be borrowed.
+    auto* current_thread = Thread::current();
+    auto page_directory = PageDirectory::find_by_cr3(current_thread ? current_thread->tss().cr3 : read_cr3());
     if (!page_directory)
         return nullptr;
     VERIFY(page_directory->space());
@@ -485,7 +620,13 @@ OwnPtr<Region> MemoryManager::allocate_contiguous_kernel_region(size_t size, Str
 {
     VERIFY(!(size % PAGE_SIZE));
     ScopedSpinLock lock(s_mm_lock);
-    auto range = kernel_page_directory().range_allocator().allocate_anywhere(size);
+    // Align big regions both virtually and physically so they get mapped with large pages.
+    size_t virtual_alignment = PAGE_SIZE;
+    if (size >= LARGE_PAGE_SIZE) {
+        virtual_alignment = LARGE_PAGE_SIZE;
+        physical_alignment = max(physical_alignment, (size_t)LARGE_PAGE_SIZE);
+    }
+    auto range = kernel_page_directory().range_allocator().allocate_anywhere(size, virtual_alignment);
     if (!range.has_value())
         return {};
     auto vmobject = ContiguousVMObject::create_with_size(size, physical_alignment);
@@ -550,14 +691,24 @@ OwnPtr<Region> MemoryManager::allocate_kernel_region_with_vmobject(VMObject& vmo
     return allocate_kernel_region_with_vmobject(range.value(), vmobject, move(name), access, cacheable);
 }
 
+bool MemoryManager::take_uncommitted_user_physical_pages(size_t page_count)
+{
+    // This is used by the per-processor page caches without holding the MM lock,
+    // so the check and the update have to happen atomically.
+    auto uncommitted = m_user_physical_pages_uncommitted.load();
+    do {
+        if (uncommitted < page_count)
+            return false;
+    } while (!m_user_physical_pages_uncommitted.compare_exchange_strong(uncommitted, uncommitted - page_count));
+    return true;
+}
+
 bool MemoryManager::commit_user_physical_pages(size_t page_count)
 {
     VERIFY(page_count > 0);
-    ScopedSpinLock lock(s_mm_lock);
-    if (m_user_physical_pages_uncommitted < page_count)
+    if (!take_uncommitted_user_physical_pages(page_count))
         return false;
 
-    m_user_physical_pages_uncommitted -= page_count;
     m_user_physical_pages_committed += page_count;
     return true;
 }
@@ -565,64 +716,171 @@ bool MemoryManager::commit_user_physical_pages(size_t page_count)
 void MemoryManager::uncommit_user_physical_pages(size_t page_count)
 {
     VERIFY(page_count > 0);
-    ScopedSpinLock lock(s_mm_lock);
     VERIFY(m_user_physical_pages_committed >= page_count);
 
-    m_user_physical_pages_uncommitted += page_count;
     m_user_physical_pages_committed -= page_count;
+    m_user_physical_pages_uncommitted += page_count;
 }
 
-void MemoryManager::deallocate_user_physical_page(const PhysicalPage& page)
+void MemoryManager::return_user_physical_page_to_region(PhysicalAddress paddr)
 {
-    ScopedSpinLock lock(s_mm_lock);
+    VERIFY(s_mm_lock.own_lock());
     for (auto& region : m_user_physical_regions) {
-        if (!region.contains(page))
+        if (!region.contains(paddr))
             continue;
+        region.free_page_at(paddr);
+        return;
+    }
 
-        region.return_page(page);
-        --m_user_physical_pages_used;
+    dmesgln("MM: return_user_physical_page_to_region couldn't figure out region for user page @ {}", paddr);
+    VERIFY_NOT_REACHED();
+}
 
-        // Always return pages to the uncommitted pool. Pages that were
-        // committed and allocated are only freed upon request. Once
-        // returned there is no guarantee being able to get them back.
-        ++m_user_physical_pages_uncommitted;
+Optional<PhysicalAddress> MemoryManager::take_user_physical_page_from_cache()
+{
+    InterruptDisabler disabler;
+    auto& mm_data = get_data();
+    {
+        ScopedSpinLock cache_lock(mm_data.m_page_cache_lock);
+        if (mm_data.m_page_cache_count > 0)
+            return mm_data.m_page_cache[--mm_data.m_page_cache_count];
+    }
+
+    // The cache is empty, refill half of it from the physical regions at once.
+    // Note that the MM lock must be taken before the cache lock, never after.
+    ScopedSpinLock lock(s_mm_lock);
+    PhysicalAddress batch[MemoryManagerData::page_cache_batch_size];
+    size_t batch_count = 0;
+    for (auto& region : m_user_physical_regions) {
+        while (batch_count < MemoryManagerData::page_cache_batch_size) {
+            auto paddr = region.allocate_page();
+            if (!paddr.has_value())
+                break;
+            batch[batch_count++] = paddr.value();
+        }
+        if (batch_count == MemoryManagerData::page_cache_batch_size)
+            break;
+    }
+    if (batch_count == 0)
+        return {};
+
+    ScopedSpinLock cache_lock(mm_data.m_page_cache_lock);
+    for (size_t i = 1; i < batch_count; ++i) {
+        if (mm_data.m_page_cache_count < MemoryManagerData::page_cache_size)
+            mm_data.m_page_cache[mm_data.m_page_cache_count++] = batch[i];
+        else
+            return_user_physical_page_to_region(batch[i]);
+    }
+    return batch[0];
+}
+
+void MemoryManager::return_user_physical_page_to_cache(PhysicalAddress paddr)
+{
+    InterruptDisabler disabler;
+    auto& mm_data = get_data();
+    PhysicalAddress overflow[MemoryManagerData::page_cache_batch_size];
+    size_t overflow_count = 0;
+    {
+        ScopedSpinLock cache_lock(mm_data.m_page_cache_lock);
+        if (mm_data.m_page_cache_count == MemoryManagerData::page_cache_size) {
+            // Hand the oldest half back, the most recently freed pages are
+            // the ones most likely to still be in the processor's caches.
+            overflow_count = MemoryManagerData::page_cache_batch_size;
+            for (size_t i = 0; i < overflow_count; ++i)
+                overflow[i] = mm_data.m_page_cache[i];
+            for (size_t i = overflow_count; i < mm_data.m_page_cache_count; ++i)
+                mm_data.m_page_cache[i - overflow_count] = mm_data.m_page_cache[i];
+            mm_data.m_page_cache_count -= overflow_count;
+        }
+        mm_data.m_page_cache[mm_data.m_page_cache_count++] = paddr;
+    }
+
+    if (!overflow_count)
         return;
+    ScopedSpinLock lock(s_mm_lock);
+    for (size_t i = 0; i < overflow_count; ++i)
+        return_user_physical_page_to_region(overflow[i]);
+}
+
+void MemoryManager::drain_user_physical_page_caches()
+{
+    VERIFY(s_mm_lock.own_lock());
+    Processor::for_each([&](Processor& processor) {
+        if (!processor.has_mm_data())
+            return IterationDecision::Continue;
+        auto& mm_data = processor.get_mm_data();
+        ScopedSpinLock cache_lock(mm_data.m_page_cache_lock);
+        for (size_t i = 0; i < mm_data.m_page_cache_count; ++i)
+            return_user_physical_page_to_region(mm_data.m_page_cache[i]);
+        mm_data.m_page_cache_count = 0;
+        return IterationDecision::Continue;
+    });
+}
+
+void MemoryManager::deallocate_user_physical_page(const PhysicalPage& page)
+{
+    bool found_region = false;
+    for (auto& region : m_user_physical_regions) {
+        if (region.contains(page)) {
+            found_region = true;
+            break;
+        }
+    }
+    if (!found_region) {
+        dmesgln("MM: deallocate_user_physical_page couldn't figure out region for user page @ {}", page.paddr());
+        VERIFY_NOT_REACHED();
     }
 
-    dmesgln("MM: deallocate_user_physical_page couldn't figure out region for user page @ {}", page.paddr());
-    VERIFY_NOT_REACHED();
+    // Put the page into the cache before accounting for it, so that it can
+    // be found by anyone who commits to it afterwards.
+    return_user_physical_page_to_cache(page.paddr());
+    --m_user_physical_pages_used;
+
+    // Always return pages to the uncommitted pool. Pages that were
+    // committed and allocated are only freed upon request. Once
+    // returned there is no guarantee being able to get them back.
+    ++m_user_physical_pages_uncommitted;
 }
 
 RefPtr<PhysicalPage> MemoryManager::find_free_user_physical_page(bool committed)
 {
-    VERIFY(s_mm_lock.is_locked());
-    RefPtr<PhysicalPage> page;
     if (committed) {
         // Draw from the committed pages pool. We should always have these pages available
         VERIFY(m_user_physical_pages_committed > 0);
         m_user_physical_pages_committed--;
     } else {
         // We need to make sure we don't touch pages that we have committed to
-        if (m_user_physical_pages_uncommitted == 0)
+        if (!take_uncommitted_user_physical_pages(1))
             return {};
-        m_user_physical_pages_uncommitted--;
     }
-    for (auto& region : m_user_physical_regions) {
-        page = region.take_free_page(false);
-        if (!page.is_null()) {
-            ++m_user_physical_pages_used;
-            break;
+
+    auto paddr = take_user_physical_page_from_cache();
+    if (!paddr.has_value()) {
+        // The page we're entitled to may be sitting in another processor's cache.
+        ScopedSpinLock lock(s_mm_lock);
+        drain_user_physical_page_caches();
+        for (auto& region : m_user_physical_regions) {
+            paddr = region.allocate_page();
+            if (paddr.has_value())
+                break;
         }
     }
-    VERIFY(!committed || !page.is_null());
-    return page;
+
+    if (!paddr.has_value()) {
+        VERIFY(!committed);
+        ++m_user_physical_pages_uncommitted;
+        return {};
+    }
+
+    ++m_user_physical_pages_used;
+    return PhysicalPage::create(paddr.value(), false);
 }
 
 NonnullRefPtr<PhysicalPage> MemoryManager::allocate_committed_user_physical_page(ShouldZeroFill should_zero_fill)
 {
-    ScopedSpinLock lock(s_mm_lock);
     auto page = find_free_user_physical_page(true);
     if (should_zero_fill == ShouldZeroFill::Yes) {
+        InterruptDisabler disabler;
         auto* ptr = quickmap_page(*page);
         memset(ptr, 0, PAGE_SIZE);
         unquickmap_page();
@@ -632,13 +890,13 @@ NonnullRefPtr<PhysicalPage> MemoryManager::allocate_committed_user_physical_page
 
 RefPtr<PhysicalPage> MemoryManager::allocate_user_physical_page(ShouldZeroFill should_zero_fill, bool* did_purge)
 {
-    ScopedSpinLock lock(s_mm_lock);
     auto page = find_free_user_physical_page(false);
     bool purged_pages = false;
 
     if (!page) {
         // We didn't have a single free physical page. Let's try to free something up!
         // First, we look for a purgeable VMObject in the volatile state.
+        ScopedSpinLock lock(s_mm_lock);
         for_each_vmobject([&](auto& vmobject) {
             if (!vmobject.is_anonymous())
                 return IterationDecision::Continue;
@@ -659,6 +917,7 @@ RefPtr<PhysicalPage> MemoryManager::allocate_user_physical_page(ShouldZeroFill s
     }
 
     if (should_zero_fill == ShouldZeroFill::Yes) {
+        InterruptDisabler disabler;
         auto* ptr = quickmap_page(*page);
         memset(ptr, 0, PAGE_SIZE);
         unquickmap_page();
@@ -669,6 +928,47 @@ RefPtr<PhysicalPage> MemoryManager::allocate_user_physical_page(ShouldZeroFill s
     return page;
 }
 
+NonnullRefPtrVector<PhysicalPage> MemoryManager::allocate_user_physical_large_page(bool committed)
+{
+    constexpr size_t page_count = LARGE_PAGE_SIZE / PAGE_SIZE;
+    if (committed) {
+        VERIFY(m_user_physical_pages_committed >= page_count);
+        m_user_physical_pages_committed -= page_count;
+    } else if (!take_uncommitted_user_physical_pages(page_count)) {
+        return {};
+    }
+
+    NonnullRefPtrVector<PhysicalPage> physical_pages;
+    {
+        ScopedSpinLock lock(s_mm_lock);
+        for (auto& region : m_user_physical_regions) {
+            physical_pages = region.take_contiguous_free_pages(page_count, false, LARGE_PAGE_SIZE);
+            if (!physical_pages.is_empty())
+                break;
+        }
+    }
+
+    if (physical_pages.is_empty()) {
+        // Memory is too fragmented (or too full), the caller falls back to small pages.
+        if (committed)
+            m_user_physical_pages_committed += page_count;
+        else
+            m_user_physical_pages_uncommitted += page_count;
+        return {};
+    }
+
+    m_user_physical_pages_used += page_count;
+    ++m_large_pages_allocated;
+
+    InterruptDisabler disabler;
+    for (auto& page : physical_pages) {
+        auto* ptr = quickmap_page(page);
+        memset(ptr, 0, PAGE_SIZE);
+        unquickmap_page();
+    }
+    return physical_pages;
+}
+
 void MemoryManager::deallocate_supervisor_physical_page(const PhysicalPage& page)
 {
     ScopedSpinLock lock(s_mm_lock);
@@ -697,7 +997,7 @@ NonnullRefPtrVector<PhysicalPage> MemoryManager::allocate_contiguous_supervisor_
     for (auto& region : m_super_physical_regions) {
         physical_pages = region.take_contiguous_free_pages(count, true, physical_alignment);
         if (!physical_pages.is_empty())
-            continue;
+            break;
     }
 
     if (physical_pages.is_empty()) {
@@ -820,19 +1120,20 @@ PageTableEntry* MemoryManager::quickmap_pt(PhysicalAddress pt_paddr)
     return (PageTableEntry*)0xffe00000;
 }
 
-u8* MemoryManager::quickmap_page(PhysicalPage& physical_page)
+// Every processor has two slots for quickmapping pages. The second one is only used
+// while copying from one physical page to another.
+static VirtualAddress quickmap_slot_vaddr(u32 slot)
 {
-    VERIFY_INTERRUPTS_DISABLED();
-    auto& mm_data = get_data();
-    mm_data.m_quickmap_prev_flags = mm_data.m_quickmap_in_use.lock();
-    ScopedSpinLock lock(s_mm_lock);
-
-    u32 pte_idx = 8 + Processor::id();
-    VirtualAddress vaddr(0xffe00000 + pte_idx * PAGE_SIZE);
+    return VirtualAddress(0xffe00000 + (8 + 2 * Processor::id() + slot) * PAGE_SIZE);
+}
 
-    auto& pte = boot_pd3_pt1023[pte_idx];
-    if (pte.physical_page_base() != physical_page.paddr().as_ptr()) {
-        pte.set_physical_page_base(physical_page.paddr().get());
+u8* MemoryManager::map_quickmap_slot(u32 slot, PhysicalAddress paddr)
+{
+    VERIFY(s_mm_lock.own_lock());
+    auto vaddr = quickmap_slot_vaddr(slot);
+    auto& pte = boot_pd3_pt1023[8 + 2 * Processor::id() + slot];
+    if (pte.physical_page_base() != paddr.as_ptr()) {
+        pte.set_physical_page_base(paddr.get());
         pte.set_present(true);
         pte.set_writable(true);
         pte.set_user_allowed(false);
@@ -841,20 +1142,73 @@ u8* MemoryManager::quickmap_page(PhysicalPage& physical_page)
     return vaddr.as_ptr();
 }
 
+void MemoryManager::unmap_quickmap_slot(u32 slot)
+{
+    VERIFY(s_mm_lock.own_lock());
+    auto vaddr = quickmap_slot_vaddr(slot);
+    boot_pd3_pt1023[8 + 2 * Processor::id() + slot].clear();
+    flush_tlb_local(vaddr);
+}
+
+u8* MemoryManager::quickmap_page(PhysicalPage& physical_page)
+{
+    VERIFY_INTERRUPTS_DISABLED();
+    auto& mm_data = get_data();
+    mm_data.m_quickmap_prev_flags = mm_data.m_quickmap_in_use.lock();
+    ScopedSpinLock lock(s_mm_lock);
+    return map_quickmap_slot(0, physical_page.paddr());
+}
+
 void MemoryManager::unquickmap_page()
 {
     VERIFY_INTERRUPTS_DISABLED();
     ScopedSpinLock lock(s_mm_lock);
     auto& mm_data = get_data();
     VERIFY(mm_data.m_quickmap_in_use.is_locked());
-    u32 pte_idx = 8 + Processor::id();
-    VirtualAddress vaddr(0xffe00000 + pte_idx * PAGE_SIZE);
-    auto& pte = boot_pd3_pt1023[pte_idx];
-    pte.clear();
-    flush_tlb_local(vaddr);
+    unmap_quickmap_slot(0);
     mm_data.m_quickmap_in_use.unlock(mm_data.m_quickmap_prev_flags);
 }
 
+void MemoryManager::copy_physical_page(PhysicalPage& destination, PhysicalPage& source)
+{
+    InterruptDisabler disabler;
+    u8* destination_ptr = quickmap_page(destination);
+    {
+        ScopedSpinLock lock(s_mm_lock);
+        u8* source_ptr = map_quickmap_slot(1, source.paddr());
+        memcpy(destination_ptr, source_ptr, PAGE_SIZE);
+        unmap_quickmap_slot(1);
+    }
+    unquickmap_page();
+}
+
+void MemoryManager::zero_physical_page_range(PhysicalPage& physical_page, size_t offset, size_t size)
+{
+    VERIFY(offset + size <= PAGE_SIZE);
+    InterruptDisabler disabler;
+    u8* page_ptr = quickmap_page(physical_page);
+    memset(page_ptr + offset, 0, size);
+    unquickmap_page();
+}
+
+void MemoryManager::copy_to_physical_page(PhysicalPage& physical_page, size_t offset, const void* data, size_t size)
+{
+    VERIFY(offset + size <= PAGE_SIZE);
+    InterruptDisabler disabler;
+    u8* page_ptr = quickmap_page(physical_page);
+    memcpy(page_ptr + offset, data, size);
+    unquickmap_page();
+}
+
+void MemoryManager::copy_from_physical_page(PhysicalPage& physical_page, size_t offset, void* data, size_t size)
+{
+    VERIFY(offset + size <= PAGE_SIZE);
+    InterruptDisabler disabler;
+    u8* page_ptr = quickmap_page(physical_page);
+    memcpy(data, page_ptr + offset, size);
+    unquickmap_page();
+}
+
 bool MemoryManager::validate_user_stack(const Process& process, VirtualAddress vaddr) const
 {
     if (!is_user_address(vaddr))
@@ -108,11 +108,21 @@ struct PhysicalMemoryRange {
 #define MM Kernel::MemoryManager::the()
 
 struct MemoryManagerData {
+    static constexpr size_t page_cache_size = 64;
+    static constexpr size_t page_cache_batch_size = page_cache_size / 2;
+
     SpinLock<u8> m_quickmap_in_use;
     u32 m_quickmap_prev_flags;
 
     PhysicalAddress m_last_quickmap_pd;
     PhysicalAddress m_last_quickmap_pt;
+
+    // User physical pages that were freed on (or handed to) this processor.
+    // Single page allocations and frees are served from here, and only go
+    // to the physical regions under the MM lock in batches.
+    SpinLock<u8> m_page_cache_lock;
+    size_t m_page_cache_count { 0 };
+    PhysicalAddress m_page_cache[page_cache_size];
 };
 
 extern RecursiveSpinLock s_mm_lock;
@@ -158,11 +168,17 @@ public:
     void uncommit_user_physical_pages(size_t);
     NonnullRefPtr<PhysicalPage> allocate_committed_user_physical_page(ShouldZeroFill = ShouldZeroFill::Yes);
     RefPtr<PhysicalPage> allocate_user_physical_page(ShouldZeroFill = ShouldZeroFill::Yes, bool* did_purge = nullptr);
+    NonnullRefPtrVector<PhysicalPage> allocate_user_physical_large_page(bool committed);
     RefPtr<PhysicalPage> allocate_supervisor_physical_page();
     NonnullRefPtrVector<PhysicalPage> allocate_contiguous_supervisor_physical_pages(size_t size, size_t physical_alignment = PAGE_SIZE);
     void deallocate_user_physical_page(const PhysicalPage&);
     void deallocate_supervisor_physical_page(const PhysicalPage&);
 
+    void copy_to_physical_page(PhysicalPage&, size_t offset, const void* data, size_t);
+    void copy_from_physical_page(PhysicalPage&, size_t offset, void* data, size_t);
+    void copy_physical_page(PhysicalPage& destination, PhysicalPage& source);
+    void zero_physical_page_range(PhysicalPage&, size_t offset, size_t size);
+
     OwnPtr<Region> allocate_contiguous_kernel_region(size_t, String name, Region::Access access, size_t physical_alignment = PAGE_SIZE, Region::Cacheable = Region::Cacheable::Yes);
     OwnPtr<Region> allocate_kernel_region(size_t, String name, Region::Access access, AllocationStrategy strategy = AllocationStrategy::Reserve, Region::Cacheable = Region::Cacheable::Yes);
     OwnPtr<Region> allocate_kernel_region(PhysicalAddress, size_t, String name, Region::Access access, Region::Cacheable = Region::Cacheable::Yes);
@@ -176,6 +192,10 @@ public:
     unsigned user_physical_pages_uncommitted() const { return m_user_physical_pages_uncommitted; }
     unsigned super_physical_pages() const { return m_super_physical_pages; }
     unsigned super_physical_pages_used() const { return m_super_physical_pages_used; }
+    unsigned large_pages_allocated() const { return m_large_pages_allocated; }
+    unsigned large_pages_split() const { return m_large_pages_split; }
+    unsigned fault_around_pages() const { return m_fault_around_pages; }
+    void did_fault_around_page() { ++m_fault_around_pages; }
 
     template<typename Callback>
     static void for_each_vmobject(Callback callback)
@@ -220,15 +240,27 @@ private:
     static Region* find_region_from_vaddr(VirtualAddress);
 
     RefPtr<PhysicalPage> find_free_user_physical_page(bool);
+    bool take_uncommitted_user_physical_pages(size_t);
+    Optional<PhysicalAddress> take_user_physical_page_from_cache();
+    void return_user_physical_page_to_cache(PhysicalAddress);
+    void return_user_physical_page_to_region(PhysicalAddress);
+    void drain_user_physical_page_caches();
     u8* quickmap_page(PhysicalPage&);
     void unquickmap_page();
+    static u8* map_quickmap_slot(u32 slot, PhysicalAddress);
+    static void unmap_quickmap_slot(u32 slot);
 
     PageDirectoryEntry* quickmap_pd(PageDirectory&, size_t pdpt_index);
     PageTableEntry* quickmap_pt(PhysicalAddress);
 
     PageTableEntry* pte(PageDirectory&, VirtualAddress);
     PageTableEntry* ensure_pte(PageDirectory&, VirtualAddress);
-    void release_pte(PageDirectory&, VirtualAddress, bool);
+    void release_pte(PageDirectory&, VirtualAddress, bool, TLBFlushBatch* = nullptr);
+
+    PageDirectoryEntry* ensure_large_pde(PageDirectory&, VirtualAddress);
+    bool release_large_pde(PageDirectory&, VirtualAddress);
+    bool is_mapped_as_large_page(PageDirectory&, VirtualAddress);
+    bool split_large_page(PageDirectory&, VirtualAddress);
 
     RefPtr<PageDirectory> m_kernel_page_directory;
 
@@ -241,6 +273,9 @@ private:
     Atomic<unsigned, AK::MemoryOrder::memory_order_relaxed> m_user_physical_pages_uncommitted { 0 };
     Atomic<unsigned, AK::MemoryOrder::memory_order_relaxed> m_super_physical_pages { 0 };
     Atomic<unsigned, AK::MemoryOrder::memory_order_relaxed> m_super_physical_pages_used { 0 };
+    Atomic<unsigned, AK::MemoryOrder::memory_order_relaxed> m_large_pages_allocated { 0 };
+    Atomic<unsigned, AK::MemoryOrder::memory_order_relaxed> m_large_pages_split { 0 };
+    Atomic<unsigned, AK::MemoryOrder::memory_order_relaxed> m_fault_around_pages { 0 };
 
     NonnullRefPtrVector<PhysicalRegion> m_user_physical_regions;
     NonnullRefPtrVector<PhysicalRegion> m_super_physical_regions;
@@ -149,8 +149,11 @@ PageDirectory::PageDirectory(const RangeAllocator* parent_range_allocator)
 PageDirectory::~PageDirectory()
 {
     ScopedSpinLock lock(s_mm_lock);
-    if (m_space)
+    if (m_space) {
         cr3_map().remove(cr3());
+        // Kernel threads may still be borrowing us, make them let go before our pages are freed.
+        Processor::evict_page_directory(cr3(), MM.kernel_page_directory().cr3());
+    }
 }
 
 }
@@ -24,12 +24,11 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
-#include <AK/Bitmap.h>
+#include <AK/NonnullOwnPtr.h>
 #include <AK/NonnullRefPtr.h>
 #include <AK/RefPtr.h>
-#include <AK/Vector.h>
 #include <Kernel/Assertions.h>
-#include <Kernel/Random.h>
+#include <Kernel/CommandLine.h>
 #include <Kernel/VM/PhysicalPage.h>
 #include <Kernel/VM/PhysicalRegion.h>
 
@@ -59,133 +58,162 @@ unsigned PhysicalRegion::finalize_capacity()
     VERIFY(!m_pages);
 
     m_pages = (m_upper.get() - m_lower.get()) / PAGE_SIZE;
-    m_bitmap.grow(m_pages, false);
+
+    // Carve the region into naturally aligned power-of-two zones, so every
+    // buddy block is also aligned to its own size in physical memory.
+    bool randomize = kernel_command_line().is_physical_page_randomization_enabled();
+    auto first_page = m_lower.get() / PAGE_SIZE;
+    for (size_t offset = 0; offset < m_pages;) {
+        auto page = first_page + offset;
+        size_t order = PhysicalZone::max_order;
+        while (order > 0 && ((page & (((size_t)1 << order) - 1)) || offset + ((size_t)1 << order) > m_pages))
+            --order;
+        m_zones.append(make<PhysicalZone>(PhysicalAddress(page * PAGE_SIZE), order, randomize));
+        offset += (size_t)1 << order;
+    }
 
     return size();
 }
 
-NonnullRefPtrVector<PhysicalPage> PhysicalRegion::take_contiguous_free_pages(size_t count, bool supervisor, size_t physical_alignment)
+Optional<PhysicalAddress> PhysicalRegion::allocate_block(size_t order)
 {
-    VERIFY(m_pages);
-    VERIFY(m_used != m_pages);
+    for (size_t i = 0; i < m_zones.size(); ++i) {
+        auto zone_index = (m_zone_hint + i) % m_zones.size();
+        auto& zone = m_zones[zone_index];
+        if (!zone.has_free_block(order))
+            continue;
+        auto paddr = zone.allocate_block(order);
+        VERIFY(paddr.has_value());
+        m_zone_hint = zone_index;
+        m_used += (size_t)1 << order;
+        return paddr;
+    }
+    return {};
+}
 
-    NonnullRefPtrVector<PhysicalPage> physical_pages;
-    physical_pages.ensure_capacity(count);
+// Requests larger than a zone need a run of neighboring zones that are entirely free.
+// They're rare (big DMA buffers and the like), so a linear scan over the zones will do.
+Optional<PhysicalAddress> PhysicalRegion::allocate_across_zones(size_t count, size_t physical_alignment)
+{
+    for (size_t first = 0; first < m_zones.size(); ++first) {
+        if (m_zones[first].base().get() % physical_alignment)
+            continue;
+
+        size_t page_count = 0;
+        size_t end = first;
+        for (; end < m_zones.size() && page_count < count; ++end) {
+            auto& zone = m_zones[end];
+            if (zone.free_pages() != zone.page_count())
+                break;
+            page_count += zone.page_count();
+        }
+        if (page_count < count) {
+            // None of the zones up to the one in use can start a long enough run either.
+            first = end;
+            continue;
+        }
 
-    auto first_contiguous_page = find_contiguous_free_pages(count, physical_alignment);
+        for (size_t i = first; i < end; ++i) {
+            auto paddr = m_zones[i].allocate_block(m_zones[i].order());
+            VERIFY(paddr.has_value());
+        }
+        m_used += page_count;
 
-    for (size_t index = 0; index < count; index++)
-        physical_pages.append(PhysicalPage::create(m_lower.offset(PAGE_SIZE * (index + first_contiguous_page)), supervisor));
-    return physical_pages;
+        auto& last_zone = m_zones[end - 1];
+        release_block_tail(last_zone, last_zone.base(), last_zone.order(), count - (page_count - last_zone.page_count()));
+        return m_zones[first].base();
+    }
+    return {};
 }
 
-unsigned PhysicalRegion::find_contiguous_free_pages(size_t count, size_t physical_alignment)
+// Gives the part of an allocated block that we don't need back right away.
+void PhysicalRegion::release_block_tail(PhysicalZone& zone, PhysicalAddress block_base, size_t block_order, size_t used_page_count)
 {
-    VERIFY(count != 0);
-    VERIFY(physical_alignment % PAGE_SIZE == 0);
-    // search from the last page we allocated
-    auto range = find_and_allocate_contiguous_range(count, physical_alignment / PAGE_SIZE);
-    VERIFY(range.has_value());
-    return range.value();
+    auto block_pages = (size_t)1 << block_order;
+    for (size_t index = used_page_count; index < block_pages;) {
+        size_t tail_order = __builtin_ctz(index);
+        zone.deallocate_block(block_base.offset(index * PAGE_SIZE), tail_order);
+        m_used -= (size_t)1 << tail_order;
+        index += (size_t)1 << tail_order;
+    }
 }
 
-Optional<unsigned> PhysicalRegion::find_one_free_page()
+PhysicalZone* PhysicalRegion::zone_for(PhysicalAddress paddr)
 {
-    if (m_used == m_pages) {
-        // We know we don't have any free pages, no need to check the bitmap
-        // Check if we can draw one from the return queue
-        if (m_recently_returned.size() > 0) {
-            u8 index = get_fast_random<u8>() % m_recently_returned.size();
-            Checked<FlatPtr> local_offset = m_recently_returned[index].get();
-            local_offset -= m_lower.get();
-            m_recently_returned.remove(index);
-            VERIFY(!local_offset.has_overflow());
-            VERIFY(local_offset.value() < (FlatPtr)(m_pages * PAGE_SIZE));
-            return local_offset.value() / PAGE_SIZE;
-        }
-        return {};
+    size_t low = 0;
+    size_t high = m_zones.size();
+    while (low < high) {
+        auto middle = low + (high - low) / 2;
+        auto& zone = m_zones[middle];
+        if (paddr < zone.base())
+            high = middle;
+        else if (zone.contains(paddr))
+            return &zone;
+        else
+            low = middle + 1;
     }
-    auto free_index = m_bitmap.find_one_anywhere_unset(m_free_hint);
-    if (!free_index.has_value())
-        return {};
-
-    auto page_index = free_index.value();
-    m_bitmap.set(page_index, true);
-    m_used++;
-    m_free_hint = free_index.value() + 1; // Just a guess
-    if (m_free_hint >= m_bitmap.size())
-        m_free_hint = 0;
-    return page_index;
+    return nullptr;
 }
 
-Optional<unsigned> PhysicalRegion::find_and_allocate_contiguous_range(size_t count, unsigned alignment)
+NonnullRefPtrVector<PhysicalPage> PhysicalRegion::take_contiguous_free_pages(size_t count, bool supervisor, size_t physical_alignment)
 {
+    VERIFY(m_pages);
     VERIFY(count != 0);
-    size_t found_pages_count = 0;
-    // TODO: Improve how we deal with alignment != 1
-    auto first_index = m_bitmap.find_longest_range_of_unset_bits(count + alignment - 1, found_pages_count);
-    if (!first_index.has_value())
-        return {};
+    VERIFY(physical_alignment % PAGE_SIZE == 0);
 
-    auto page = first_index.value();
-    if (alignment != 1) {
-        auto lower_page = m_lower.get() / PAGE_SIZE;
-        page = ((lower_page + page + alignment - 1) & ~(alignment - 1)) - lower_page;
-    }
-    if (found_pages_count >= count) {
-        m_bitmap.set_range<true>(page, count);
-        m_used += count;
-        m_free_hint = first_index.value() + count + 1; // Just a guess
-        if (m_free_hint >= m_bitmap.size())
-            m_free_hint = 0;
-        return page;
+    // Buddy blocks are aligned to their size, so a block that is at least
+    // as large as the requested alignment is suitably aligned as well.
+    size_t order = 0;
+    while (((size_t)1 << order) < count || ((size_t)PAGE_SIZE << order) < physical_alignment)
+        ++order;
+
+    Optional<PhysicalAddress> base;
+    if (order > PhysicalZone::max_order) {
+        base = allocate_across_zones(count, physical_alignment);
+    } else {
+        base = allocate_block(order);
+        if (base.has_value())
+            release_block_tail(*zone_for(base.value()), base.value(), order, count);
     }
-    return {};
+    if (!base.has_value())
+        return {};
+
+    NonnullRefPtrVector<PhysicalPage> physical_pages;
+    physical_pages.ensure_capacity(count);
+    for (size_t index = 0; index < count; index++)
+        physical_pages.append(PhysicalPage::create(base.value().offset(index * PAGE_SIZE), supervisor));
+    return physical_pages;
 }
 
-RefPtr<PhysicalPage> PhysicalRegion::take_free_page(bool supervisor)
+Optional<PhysicalAddress> PhysicalRegion::allocate_page()
 {
     VERIFY(m_pages);
+    return allocate_block(0);
+}
 
-    auto free_index = find_one_free_page();
-    if (!free_index.has_value())
+RefPtr<PhysicalPage> PhysicalRegion::take_free_page(bool supervisor)
+{
+    auto paddr = allocate_page();
+    if (!paddr.has_value())
         return nullptr;
 
-    return PhysicalPage::create(m_lower.offset(free_index.value() * PAGE_SIZE), supervisor);
+    return PhysicalPage::create(paddr.value(), supervisor);
 }
 
 void PhysicalRegion::free_page_at(PhysicalAddress addr)
 {
     VERIFY(m_pages);
+    VERIFY(m_used > 0);
 
-    if (m_used == 0) {
-        VERIFY_NOT_REACHED();
-    }
-
-    Checked<FlatPtr> local_offset = addr.get();
-    local_offset -= m_lower.get();
-    VERIFY(!local_offset.has_overflow());
-    VERIFY(local_offset.value() < (FlatPtr)(m_pages * PAGE_SIZE));
-
-    auto page = local_offset.value() / PAGE_SIZE;
-    m_bitmap.set(page, false);
-    m_free_hint = page; // We know we can find one here for sure
+    auto* zone = zone_for(addr);
+    VERIFY(zone);
+    zone->deallocate_block(addr, 0);
     m_used--;
 }
 
 void PhysicalRegion::return_page(const PhysicalPage& page)
 {
-    auto returned_count = m_recently_returned.size();
-    if (returned_count >= m_recently_returned.capacity()) {
-        // Return queue is full, pick a random entry and free that page
-        // and replace the entry with this page
-        auto& entry = m_recently_returned[get_fast_random<u8>()];
-        free_page_at(entry);
-        entry = page.paddr();
-    } else {
-        // Still filling the return queue, just append it
-        m_recently_returned.append(page.paddr());
-    }
+    free_page_at(page.paddr());
 }
 
 }
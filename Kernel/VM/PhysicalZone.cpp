@@ -0,0 +1,191 @@
+/*
+ * Copyright (c) 2021, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <AK/StdLibExtras.h>
+#include <Kernel/Assertions.h>
+#include <Kernel/Heap/kmalloc.h>
+#include <Kernel/Random.h>
+#include <Kernel/VM/PhysicalZone.h>
+
+namespace Kernel {
+
+PhysicalZone::PhysicalZone(PhysicalAddress base, size_t order, bool randomize)
+    : m_base(base)
+    , m_order(order)
+    , m_randomize(randomize)
+{
+    VERIFY(order <= max_order);
+    VERIFY(!(base.get() & ((page_count() * PAGE_SIZE) - 1)));
+
+    size_t storage_words = 0;
+    for (size_t i = 0; i <= m_order; ++i) {
+        auto block_count = page_count() >> i;
+        auto word_count = ceil_div(block_count, (size_t)32);
+        storage_words += word_count + ceil_div(word_count, (size_t)32);
+    }
+    m_bitmap_storage = static_cast<u32*>(kmalloc(storage_words * sizeof(u32)));
+    VERIFY(m_bitmap_storage);
+    __builtin_memset(m_bitmap_storage, 0, storage_words * sizeof(u32));
+
+    auto* storage = m_bitmap_storage;
+    for (size_t i = 0; i <= m_order; ++i) {
+        auto word_count = ceil_div(page_count() >> i, (size_t)32);
+        auto& bitmap = m_free_blocks[i];
+        bitmap.words = storage;
+        storage += word_count;
+        bitmap.summary_word_count = ceil_div(word_count, (size_t)32);
+        bitmap.summary = storage;
+        storage += bitmap.summary_word_count;
+    }
+
+    // The whole zone starts out as a single free block.
+    set_block_free(m_order, 0, true);
+    m_free_pages = page_count();
+}
+
+PhysicalZone::~PhysicalZone()
+{
+    kfree(m_bitmap_storage);
+}
+
+bool PhysicalZone::is_block_free(size_t order, size_t block) const
+{
+    return m_free_blocks[order].words[block / 32] & (1u << (block % 32));
+}
+
+void PhysicalZone::set_block_free(size_t order, size_t block, bool free)
+{
+    auto& bitmap = m_free_blocks[order];
+    auto word_index = block / 32;
+    auto bit = 1u << (block % 32);
+    if (free) {
+        VERIFY(!(bitmap.words[word_index] & bit));
+        bitmap.words[word_index] |= bit;
+        bitmap.summary[word_index / 32] |= 1u << (word_index % 32);
+        ++m_free_block_count[order];
+    } else {
+        VERIFY(bitmap.words[word_index] & bit);
+        bitmap.words[word_index] &= ~bit;
+        if (!bitmap.words[word_index])
+            bitmap.summary[word_index / 32] &= ~(1u << (word_index % 32));
+        --m_free_block_count[order];
+    }
+}
+
+// Returns the index of a set bit, looking from bit `start` upwards and wrapping around.
+static size_t find_set_bit(u32 word, size_t start)
+{
+    VERIFY(word);
+    auto above_start = word & (~0u << (start % 32));
+    return __builtin_ctz(above_start ? above_start : word);
+}
+
+size_t PhysicalZone::find_free_block(size_t order) const
+{
+    auto& bitmap = m_free_blocks[order];
+    u32 random = m_randomize ? get_fast_random<u32>() : 0;
+    for (size_t n = 0; n < bitmap.summary_word_count; ++n) {
+        auto i = (random + n) % bitmap.summary_word_count;
+        if (!bitmap.summary[i])
+            continue;
+        auto word_index = i * 32 + find_set_bit(bitmap.summary[i], random >> 8);
+        return word_index * 32 + find_set_bit(bitmap.words[word_index], random >> 16);
+    }
+    VERIFY_NOT_REACHED();
+}
+
+bool PhysicalZone::is_page_free(size_t page_index) const
+{
+    for (size_t order = 0; order <= m_order; ++order) {
+        if (is_block_free(order, page_index >> order))
+            return true;
+    }
+    return false;
+}
+
+bool PhysicalZone::has_free_block(size_t order) const
+{
+    for (; order <= m_order; ++order) {
+        if (m_free_block_count[order])
+            return true;
+    }
+    return false;
+}
+
+Optional<PhysicalAddress> PhysicalZone::allocate_block(size_t order)
+{
+    if (order > m_order)
+        return {};
+
+    auto found_order = order;
+    while (found_order <= m_order && !m_free_block_count[found_order])
+        ++found_order;
+    if (found_order > m_order)
+        return {};
+
+    auto block = find_free_block(found_order);
+    set_block_free(found_order, block, false);
+
+    // Split the block in halves until it has the requested size, giving
+    // the upper half back every time.
+    while (found_order > order) {
+        --found_order;
+        block *= 2;
+        set_block_free(found_order, block + 1, true);
+    }
+
+    m_free_pages -= (size_t)1 << order;
+    return m_base.offset((block << order) * PAGE_SIZE);
+}
+
+void PhysicalZone::deallocate_block(PhysicalAddress paddr, size_t order)
+{
+    VERIFY(contains(paddr));
+    VERIFY(order <= m_order);
+
+    auto page_index = (paddr.get() - m_base.get()) / PAGE_SIZE;
+    VERIFY(!(page_index & (((size_t)1 << order) - 1)));
+    if (is_page_free(page_index)) {
+        dbgln("PhysicalZone: Double free of page {}", paddr);
+        VERIFY_NOT_REACHED();
+    }
+
+    m_free_pages += (size_t)1 << order;
+
+    // Merge with the buddy for as long as it is free as well.
+    auto block = page_index >> order;
+    while (order < m_order) {
+        auto buddy = block ^ 1;
+        if (!is_block_free(order, buddy))
+            break;
+        set_block_free(order, buddy, false);
+        block >>= 1;
+        ++order;
+    }
+    set_block_free(order, block, true);
+}
+
+}
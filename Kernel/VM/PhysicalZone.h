@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2021, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <AK/Noncopyable.h>
+#include <AK/Optional.h>
+#include <AK/Types.h>
+#include <Kernel/Arch/x86/CPU.h>
+#include <Kernel/PhysicalAddress.h>
+
+namespace Kernel {
+
+// A binary buddy allocator for one naturally aligned, power-of-two sized
+// chunk of physical memory. Blocks of 2^order pages are split on allocation
+// and merged with their buddy when freed, so both take O(max_order) steps.
+//
+// Physical memory isn't mapped into the kernel, so the free blocks can't
+// carry their own list links. Instead every order has a bitmap with one bit
+// per block, plus a summary bitmap with one bit per non-empty bitmap word,
+// which lets us find a free block with a couple of bit scans.
+//
+// Unless disabled with physical_page_randomization=off, the scans start at
+// a random position, so that which physical page gets (re)used next is hard
+// to predict.
+class PhysicalZone {
+    AK_MAKE_NONCOPYABLE(PhysicalZone);
+    AK_MAKE_NONMOVABLE(PhysicalZone);
+
+public:
+    // 2^12 pages, i.e. zones of up to 16 MiB.
+    static constexpr size_t max_order = 12;
+
+    PhysicalZone(PhysicalAddress base, size_t order, bool randomize);
+    ~PhysicalZone();
+
+    Optional<PhysicalAddress> allocate_block(size_t order);
+    void deallocate_block(PhysicalAddress, size_t order);
+
+    PhysicalAddress base() const { return m_base; }
+    size_t order() const { return m_order; }
+    size_t page_count() const { return (size_t)1 << m_order; }
+    size_t free_pages() const { return m_free_pages; }
+    size_t free_block_count(size_t order) const { return order <= m_order ? m_free_block_count[order] : 0; }
+    bool has_free_block(size_t order) const;
+    bool contains(PhysicalAddress paddr) const { return paddr >= m_base && paddr.get() - m_base.get() < page_count() * PAGE_SIZE; }
+
+private:
+    struct FreeBlockBitmap {
+        u32* words { nullptr };
+        u32* summary { nullptr };
+        size_t summary_word_count { 0 };
+    };
+
+    bool is_block_free(size_t order, size_t block) const;
+    void set_block_free(size_t order, size_t block, bool);
+    size_t find_free_block(size_t order) const;
+    bool is_page_free(size_t page_index) const;
+
+    PhysicalAddress m_base;
+    size_t m_order { 0 };
+    bool m_randomize { false };
+    size_t m_free_pages { 0 };
+    u32* m_bitmap_storage { nullptr };
+    FreeBlockBitmap m_free_blocks[max_order + 1];
+    size_t m_free_block_count[max_order + 1] {};
+};
+
+}
@@ -32,7 +32,8 @@ namespace Kernel {
 ProcessPagingScope::ProcessPagingScope(Process& process)
 {
     VERIFY(Thread::current() != nullptr);
-    m_previous_cr3 = read_cr3();
+    // NOTE: Kernel threads may be running on a borrowed page directory, so restore their own one.
+    m_previous_cr3 = Thread::current()->tss().cr3;
     MM.enter_process_paging_scope(process);
 }
 
@@ -36,6 +36,7 @@
 #include <Kernel/VM/PageDirectory.h>
 #include <Kernel/VM/Region.h>
 #include <Kernel/VM/SharedInodeVMObject.h>
+#include <Kernel/VM/TLBFlushBatch.h>
 
 namespace Kernel {
 
@@ -286,6 +287,81 @@ bool Region::map_individual_page_impl(size_t page_index)
     return true;
 }
 
+bool Region::can_map_large_page(size_t page_index) const
+{
+    constexpr size_t pages_per_large_page = LARGE_PAGE_SIZE / PAGE_SIZE;
+    auto page_vaddr = vaddr_from_page_index(page_index);
+    if (page_vaddr.get() & (LARGE_PAGE_SIZE - 1))
+        return false;
+    if (page_index + pages_per_large_page > page_count())
+        return false;
+    if (!is_readable() && !is_writable())
+        return false;
+    if (!vmobject().is_anonymous() && !vmobject().is_contiguous())
+        return false;
+
+    // All of the pages have to be physically contiguous and aligned, and
+    // none of them may need a write fault (CoW or lazily allocated).
+    auto* first_page = physical_page(page_index);
+    if (!first_page || (first_page->paddr().get() & (LARGE_PAGE_SIZE - 1)))
+        return false;
+    for (size_t i = 0; i < pages_per_large_page; ++i) {
+        auto* page = physical_page(page_index + i);
+        if (!page || page->paddr() != first_page->paddr().offset(i * PAGE_SIZE))
+            return false;
+        if (page->is_shared_zero_page() || page->is_lazy_committed_page() || should_cow(page_index + i))
+            return false;
+    }
+    return true;
+}
+
+bool Region::map_large_page_impl(size_t page_index)
+{
+    VERIFY(m_page_directory->get_lock().own_lock());
+    auto page_vaddr = vaddr_from_page_index(page_index);
+
+    bool user_allowed = page_vaddr.get() >= 0x00800000 && is_user_address(page_vaddr);
+    if (is_mmap() && !user_allowed) {
+        PANIC("About to map mmap'ed page at a kernel address");
+    }
+
+    auto* pde = MM.ensure_large_pde(*m_page_directory, page_vaddr);
+    pde->clear();
+    pde->set_page_table_base(physical_page(page_index)->paddr().get());
+    pde->set_huge(true);
+    pde->set_cache_disabled(!m_cacheable);
+    pde->set_writable(is_writable());
+    if (Processor::current().has_feature(CPUFeature::NX))
+        pde->set_execute_disabled(!is_executable());
+    pde->set_user_allowed(user_allowed);
+    pde->set_present(true);
+    return true;
+}
+
+size_t Region::map_page_or_large_page_impl(size_t page_index, size_t end_page_index)
+{
+    constexpr size_t pages_per_large_page = LARGE_PAGE_SIZE / PAGE_SIZE;
+    if (page_index + pages_per_large_page <= end_page_index && can_map_large_page(page_index))
+        return map_large_page_impl(page_index) ? pages_per_large_page : 0;
+    return map_individual_page_impl(page_index) ? 1 : 0;
+}
+
+size_t Region::large_page_count() const
+{
+    if (!m_page_directory)
+        return 0;
+    ScopedSpinLock lock(s_mm_lock);
+    auto& page_directory = const_cast<PageDirectory&>(*m_page_directory);
+    ScopedSpinLock page_lock(page_directory.get_lock());
+    size_t count = 0;
+    u64 end = (u64)vaddr().get() + size();
+    for (u64 large_page_vaddr = ((u64)vaddr().get() + LARGE_PAGE_SIZE - 1) & ~(u64)(LARGE_PAGE_SIZE - 1); large_page_vaddr + LARGE_PAGE_SIZE <= end; large_page_vaddr += LARGE_PAGE_SIZE) {
+        if (MM.is_mapped_as_large_page(page_directory, VirtualAddress((FlatPtr)large_page_vaddr)))
+            ++count;
+    }
+    return count;
+}
+
 bool Region::do_remap_vmobject_page_range(size_t page_index, size_t page_count)
 {
     bool success = true;
@@ -297,11 +373,12 @@ bool Region::do_remap_vmobject_page_range(size_t page_index, size_t page_count)
     ScopedSpinLock page_lock(m_page_directory->get_lock());
     size_t index = page_index;
     while (index < page_index + page_count) {
-        if (!map_individual_page_impl(index)) {
+        auto mapped_count = map_page_or_large_page_impl(index, page_index + page_count);
+        if (!mapped_count) {
             success = false;
             break;
         }
-        index++;
+        index += mapped_count;
     }
     if (index > page_index)
         MM.flush_tlb(m_page_directory, vaddr_from_page_index(page_index), index - page_index);
@@ -363,12 +440,23 @@ void Region::unmap(ShouldDeallocateVirtualMemoryRange deallocate_range)
     if (!m_page_directory)
         return;
     ScopedSpinLock page_lock(m_page_directory->get_lock());
+    auto* tlb_batch = TLBFlushBatch::current_for(*m_page_directory);
     size_t count = page_count();
-    for (size_t i = 0; i < count; ++i) {
+    for (size_t i = 0; i < count;) {
         auto vaddr = vaddr_from_page_index(i);
-        MM.release_pte(*m_page_directory, vaddr, i == count - 1);
+        if (!(vaddr.get() & (LARGE_PAGE_SIZE - 1)) && i + LARGE_PAGE_SIZE / PAGE_SIZE <= count && MM.release_large_pde(*m_page_directory, vaddr)) {
+            i += LARGE_PAGE_SIZE / PAGE_SIZE;
+            continue;
+        }
+        MM.release_pte(*m_page_directory, vaddr, i == count - 1, tlb_batch);
+        ++i;
+    }
+    if (tlb_batch) {
+        tlb_batch->add(vaddr(), page_count());
+        tlb_batch->defer_release(vmobject());
+    } else {
+        MM.flush_tlb(m_page_directory, vaddr(), page_count());
     }
-    MM.flush_tlb(m_page_directory, vaddr(), page_count());
     if (deallocate_range == ShouldDeallocateVirtualMemoryRange::Yes) {
         if (m_page_directory->range_allocator().contains(range()))
             m_page_directory->range_allocator().deallocate(range());
@@ -398,9 +486,10 @@ bool Region::map(PageDirectory& page_directory, ShouldFlushTLB should_flush_tlb)
     set_page_directory(page_directory);
     size_t page_index = 0;
     while (page_index < page_count()) {
-        if (!map_individual_page_impl(page_index))
+        auto mapped_count = map_page_or_large_page_impl(page_index, page_count());
+        if (!mapped_count)
             break;
-        ++page_index;
+        page_index += mapped_count;
     }
     if (page_index > 0) {
         if (should_flush_tlb == ShouldFlushTLB::Yes)
@@ -435,6 +524,8 @@ PageFaultResponse Region::handle_fault(const PageFault& fault, ScopedSpinLock<Re
 
         auto& page_slot = physical_page_slot(page_index_in_region);
         if (page_slot->is_lazy_committed_page()) {
+            if (try_to_allocate_large_page(page_index_in_region))
+                return PageFaultResponse::Continue;
             auto page_index_in_vmobject = translate_to_vmobject_page(page_index_in_region);
             page_slot = static_cast<AnonymousVMObject&>(*m_vmobject).allocate_committed_page(page_index_in_vmobject);
             remap_vmobject_page(page_index_in_vmobject);
@@ -489,6 +580,9 @@ PageFaultResponse Region::handle_zero_fault(size_t page_index_in_region)
     if (current_thread != nullptr)
         current_thread->did_zero_fault();
 
+    if (try_to_allocate_large_page(page_index_in_region))
+        return PageFaultResponse::Continue;
+
     if (page_slot->is_lazy_committed_page()) {
         page_slot = static_cast<AnonymousVMObject&>(*m_vmobject).allocate_committed_page(page_index_in_vmobject);
         dbgln_if(PAGE_FAULT_DEBUG, "      >> ALLOCATED COMMITTED {}", page_slot->paddr());
@@ -508,6 +602,33 @@ PageFaultResponse Region::handle_zero_fault(size_t page_index_in_region)
     return PageFaultResponse::Continue;
 }
 
+bool Region::try_to_allocate_large_page(size_t page_index_in_region)
+{
+    // Back the whole 2 MiB around the faulting page with one large page,
+    // as long as it lies completely inside this region and none of it has
+    // been touched yet.
+    constexpr size_t pages_per_large_page = LARGE_PAGE_SIZE / PAGE_SIZE;
+    if (m_shared || !is_writable() || vmobject().is_shared_by_multiple_regions())
+        return false;
+    auto large_page_vaddr = vaddr_from_page_index(page_index_in_region).get() & ~(LARGE_PAGE_SIZE - 1);
+    if (large_page_vaddr < vaddr().get() || (u64)large_page_vaddr + LARGE_PAGE_SIZE > (u64)vaddr().get() + size())
+        return false;
+
+    auto first_page_index_in_region = page_index_from_address(VirtualAddress(large_page_vaddr));
+    auto first_page_index_in_vmobject = translate_to_vmobject_page(first_page_index_in_region);
+    auto& vmobject = static_cast<AnonymousVMObject&>(*m_vmobject);
+    if (!vmobject.try_to_allocate_large_page(first_page_index_in_vmobject))
+        return false;
+
+    dbgln_if(PAGE_FAULT_DEBUG, "      >> ALLOCATED LARGE PAGE {} for {}", physical_page(first_page_index_in_region)->paddr(), VirtualAddress(large_page_vaddr));
+    if (!remap_vmobject_page_range(first_page_index_in_vmobject, pages_per_large_page)) {
+        // The pages are ours now either way, so this is only a mapping problem
+        // that the next fault will run into as well.
+        dmesgln("MM: try_to_allocate_large_page was unable to map {}", VirtualAddress(large_page_vaddr));
+    }
+    return true;
+}
+
 PageFaultResponse Region::handle_cow_fault(size_t page_index_in_region)
 {
     VERIFY_INTERRUPTS_DISABLED();
@@ -525,6 +646,54 @@ PageFaultResponse Region::handle_cow_fault(size_t page_index_in_region)
     return response;
 }
 
+static constexpr size_t fault_around_page_count = 16;
+
+static RefPtr<PhysicalPage> copy_cached_page(PhysicalPage& cached_page)
+{
+    auto page = MM.allocate_user_physical_page(MemoryManager::ShouldZeroFill::No);
+    if (!page)
+        return nullptr;
+    MM.copy_physical_page(*page, cached_page);
+    return page;
+}
+
+static KResultOr<NonnullRefPtr<PhysicalPage>> read_inode_page(InodeVMObject& inode_vmobject, size_t page_index_in_vmobject)
+{
+    VERIFY(!s_mm_lock.own_lock());
+    auto& inode = inode_vmobject.inode();
+    if (inode.uses_page_cache()) {
+        // Shared mappings use the inode's page cache directly, so they see the same data as read() and write().
+        if (inode_vmobject.is_shared_inode())
+            return inode.page_cache_page(page_index_in_vmobject);
+        // Private mappings get their own copy of the cached page. Reading it would have gone
+        // through the page cache anyway.
+        auto cached_page_or_error = inode.page_cache_page(page_index_in_vmobject);
+        if (cached_page_or_error.is_error())
+            return cached_page_or_error.error();
+        auto page = copy_cached_page(*cached_page_or_error.value());
+        if (!page)
+            return ENOMEM;
+        return page.release_nonnull();
+    }
+
+    // NOTE: This buffer is on the heap since we're handling a page fault, possibly on a deep kernel stack.
+    auto page_buffer = ByteBuffer::create_uninitialized(PAGE_SIZE);
+    auto buffer = UserOrKernelBuffer::for_kernel_buffer(page_buffer.data());
+    auto nread = inode.read_bytes(page_index_in_vmobject * PAGE_SIZE, PAGE_SIZE, buffer, nullptr);
+    if (nread < 0)
+        return KResult((ErrnoCode)-nread);
+    if (nread < PAGE_SIZE) {
+        // If we read less than a page, zero out the rest to avoid leaking uninitialized data.
+        memset(page_buffer.data() + nread, 0, PAGE_SIZE - nread);
+    }
+
+    auto page = MM.allocate_user_physical_page(MemoryManager::ShouldZeroFill::No);
+    if (!page)
+        return ENOMEM;
+    MM.copy_to_physical_page(*page, 0, page_buffer.data(), PAGE_SIZE);
+    return page.release_nonnull();
+}
+
 PageFaultResponse Region::handle_inode_fault(size_t page_index_in_region, ScopedSpinLock<RecursiveSpinLock>& mm_lock)
 {
     VERIFY_INTERRUPTS_DISABLED();
@@ -556,47 +725,138 @@ PageFaultResponse Region::handle_inode_fault(size_t page_index_in_region, Scoped
     if (current_thread)
         current_thread->did_inode_fault();
 
-    u8 page_buffer[PAGE_SIZE];
-    auto& inode = inode_vmobject.inode();
-
     // Reading the page may block, so release the MM lock temporarily
     mm_lock.unlock();
-    auto buffer = UserOrKernelBuffer::for_kernel_buffer(page_buffer);
-    auto nread = inode.read_bytes(page_index_in_vmobject * PAGE_SIZE, PAGE_SIZE, buffer, nullptr);
+    auto page_or_error = read_inode_page(inode_vmobject, page_index_in_vmobject);
     mm_lock.lock();
 
-    if (nread < 0) {
-        dmesgln("MM: handle_inode_fault had error ({}) while reading!", nread);
-        return PageFaultResponse::ShouldCrash;
+    if (page_or_error.is_error()) {
+        dmesgln("MM: handle_inode_fault had error ({}) while reading!", page_or_error.error());
+        return page_or_error.error() == -ENOMEM ? PageFaultResponse::OutOfMemory : PageFaultResponse::ShouldCrash;
     }
-    if (nread < PAGE_SIZE) {
-        // If we read less than a page, zero out the rest to avoid leaking uninitialized data.
-        memset(page_buffer + nread, 0, PAGE_SIZE - nread);
+    vmobject_physical_page_entry = page_or_error.release_value();
+    if (!remap_vmobject_page(page_index_in_vmobject))
+        return PageFaultResponse::OutOfMemory;
+
+    fault_around(page_index_in_region, mm_lock);
+    return PageFaultResponse::Continue;
+}
+
+void Region::fault_around(size_t page_index_in_region, ScopedSpinLock<RecursiveSpinLock>& mm_lock)
+{
+    // Map the neighbors of the faulting page as well, as long as the inode has them cached
+    // already. This saves a fault per page when a mapping is walked through sequentially,
+    // like a program's text and data are during startup.
+    VERIFY(vmobject().is_inode());
+    VERIFY(s_mm_lock.own_lock());
+    auto& inode_vmobject = static_cast<InodeVMObject&>(vmobject());
+    auto& inode = inode_vmobject.inode();
+    if (!inode.uses_page_cache())
+        return;
+
+    auto first_page_index = page_index_in_region & ~(fault_around_page_count - 1);
+    auto end_page_index = min(first_page_index + fault_around_page_count, page_count());
+    auto first_page_index_in_vmobject = translate_to_vmobject_page(first_page_index);
+    if (first_page_index_in_vmobject >= inode_vmobject.page_count())
+        return;
+    end_page_index = min(end_page_index, first_page_index + inode_vmobject.page_count() - first_page_index_in_vmobject);
+    auto window_page_count = end_page_index - first_page_index;
+
+    bool any_missing = false;
+    for (size_t i = 0; i < window_page_count; ++i) {
+        if (inode_vmobject.physical_pages()[first_page_index_in_vmobject + i].is_null())
+            any_missing = true;
     }
 
-    vmobject_physical_page_entry = MM.allocate_user_physical_page(MemoryManager::ShouldZeroFill::No);
-    if (vmobject_physical_page_entry.is_null()) {
-        dmesgln("MM: handle_inode_fault was unable to allocate a physical page");
-        return PageFaultResponse::OutOfMemory;
+    if (any_missing) {
+        RefPtr<PhysicalPage> pages[fault_around_page_count];
+        mm_lock.unlock();
+        for (size_t i = 0; i < window_page_count; ++i) {
+            auto page_index_in_vmobject = first_page_index_in_vmobject + i;
+            if (!inode_vmobject.physical_pages()[page_index_in_vmobject].is_null())
+                continue;
+            auto cached_page = inode.cached_page(page_index_in_vmobject);
+            if (!cached_page)
+                continue;
+            if (inode_vmobject.is_shared_inode()) {
+                pages[i] = move(cached_page);
+                continue;
+            }
+            auto private_page = copy_cached_page(*cached_page);
+            if (!private_page)
+                break;
+            pages[i] = move(private_page);
+        }
+        mm_lock.lock();
+
+        for (size_t i = 0; i < window_page_count; ++i) {
+            auto& entry = inode_vmobject.physical_pages()[first_page_index_in_vmobject + i];
+            if (entry.is_null() && pages[i]) {
+                entry = move(pages[i]);
+                MM.did_fault_around_page();
+            }
+        }
     }
 
-    u8* dest_ptr = MM.quickmap_page(*vmobject_physical_page_entry);
-    {
-        void* fault_at;
-        if (!safe_memcpy(dest_ptr, page_buffer, PAGE_SIZE, fault_at)) {
-            if ((u8*)fault_at >= dest_ptr && (u8*)fault_at <= dest_ptr + PAGE_SIZE)
-                dbgln("      >> inode fault: error copying data to {}/{}, failed at {}",
-                    vmobject_physical_page_entry->paddr(),
-                    VirtualAddress(dest_ptr),
-                    VirtualAddress(fault_at));
-            else
-                VERIFY_NOT_REACHED();
+    do_remap_vmobject_page_range(first_page_index_in_vmobject, window_page_count);
+}
+
+KResult Region::populate(const Range& range)
+{
+    VERIFY(m_range.contains(range));
+    auto first_page_index = page_index_from_address(range.base());
+    auto end_page_index = first_page_index + range.size() / PAGE_SIZE;
+
+    if (vmobject().is_inode()) {
+        auto& inode_vmobject = static_cast<InodeVMObject&>(vmobject());
+        LOCKER(inode_vmobject.m_paging_lock);
+        for (auto page_index = first_page_index; page_index < end_page_index; ++page_index) {
+            auto page_index_in_vmobject = translate_to_vmobject_page(page_index);
+            {
+                ScopedSpinLock lock(s_mm_lock);
+                if (!inode_vmobject.physical_pages()[page_index_in_vmobject].is_null())
+                    continue;
+            }
+            auto page_or_error = read_inode_page(inode_vmobject, page_index_in_vmobject);
+            if (page_or_error.is_error())
+                return page_or_error.error();
+            ScopedSpinLock lock(s_mm_lock);
+            inode_vmobject.physical_pages()[page_index_in_vmobject] = page_or_error.release_value();
+        }
+    } else if (vmobject().is_anonymous()) {
+        auto& anonymous_vmobject = static_cast<AnonymousVMObject&>(vmobject());
+        if (is_volatile(range.base(), range.size()))
+            return KSuccess;
+        LOCKER(anonymous_vmobject.m_paging_lock);
+        for (auto page_index = first_page_index; page_index < end_page_index;) {
+            ScopedSpinLock lock(s_mm_lock);
+            auto page_index_in_vmobject = translate_to_vmobject_page(page_index);
+            if (!(vaddr_from_page_index(page_index).get() & (LARGE_PAGE_SIZE - 1))
+                && page_index + LARGE_PAGE_SIZE / PAGE_SIZE <= end_page_index
+                && try_to_allocate_large_page(page_index)) {
+                page_index += LARGE_PAGE_SIZE / PAGE_SIZE;
+                continue;
+            }
+            auto& page_slot = physical_page_slot(page_index);
+            if (page_slot->is_lazy_committed_page()) {
+                page_slot = anonymous_vmobject.allocate_committed_page(page_index_in_vmobject);
+            } else if (page_slot->is_shared_zero_page() && is_writable()) {
+                auto page = MM.allocate_user_physical_page(MemoryManager::ShouldZeroFill::Yes);
+                if (!page)
+                    return ENOMEM;
+                page_slot = move(page);
+            }
+            ++page_index;
         }
+    } else {
+        // Everything else is mapped completely from the start.
+        return KSuccess;
     }
-    MM.unquickmap_page();
 
-    remap_vmobject_page(page_index_in_vmobject);
-    return PageFaultResponse::Continue;
+    ScopedSpinLock lock(s_mm_lock);
+    if (!do_remap_vmobject_page_range(translate_to_vmobject_page(first_page_index), end_page_index - first_page_index))
+        return ENOMEM;
+    return KSuccess;
 }
 
 RefPtr<Process> Region::get_owner()
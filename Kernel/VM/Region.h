@@ -33,6 +33,7 @@
 #include <AK/Weakable.h>
 #include <Kernel/Arch/x86/CPU.h>
 #include <Kernel/Heap/SlabAllocator.h>
+#include <Kernel/KResult.h>
 #include <Kernel/VM/PageFaultResponse.h>
 #include <Kernel/VM/PurgeablePageRanges.h>
 #include <Kernel/VM/RangeAllocator.h>
@@ -54,7 +55,7 @@ class Region final
     , public PurgeablePageRanges {
     friend class MemoryManager;
 
-    MAKE_SLAB_ALLOCATED(Region)
+    MAKE_SLAB_CACHED(Region)
 public:
     enum Access : u8 {
         None = 0,
@@ -211,6 +212,7 @@ public:
     size_t amount_resident() const;
     size_t amount_shared() const;
     size_t amount_dirty() const;
+    size_t large_page_count() const;
 
     bool should_cow(size_t page_index) const;
     void set_should_cow(size_t page_index, bool);
@@ -237,6 +239,10 @@ public:
 
     bool remap_vmobject_page_range(size_t page_index, size_t page_count);
 
+    // Brings in all pages of the given range up front and maps them in one go,
+    // instead of faulting them in one at a time (MAP_POPULATE, MADV_WILLNEED).
+    KResult populate(const Range&);
+
     bool is_volatile(VirtualAddress vaddr, size_t size) const;
     enum class SetVolatileError {
         Success = 0,
@@ -269,8 +275,13 @@ private:
     PageFaultResponse handle_cow_fault(size_t page_index);
     PageFaultResponse handle_inode_fault(size_t page_index, ScopedSpinLock<RecursiveSpinLock>&);
     PageFaultResponse handle_zero_fault(size_t page_index);
+    void fault_around(size_t page_index, ScopedSpinLock<RecursiveSpinLock>&);
 
     bool map_individual_page_impl(size_t page_index);
+    bool can_map_large_page(size_t page_index) const;
+    bool map_large_page_impl(size_t page_index);
+    size_t map_page_or_large_page_impl(size_t page_index, size_t end_page_index);
+    bool try_to_allocate_large_page(size_t page_index);
 
     void register_purgeable_page_ranges();
     void unregister_purgeable_page_ranges();
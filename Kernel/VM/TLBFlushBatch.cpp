@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2021, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <Kernel/Thread.h>
+#include <Kernel/VM/MemoryManager.h>
+#include <Kernel/VM/TLBFlushBatch.h>
+
+namespace Kernel {
+
+TLBFlushBatch::TLBFlushBatch(PageDirectory& page_directory)
+    : m_page_directory(page_directory)
+    , m_thread(Thread::current())
+{
+    VERIFY(m_thread);
+    VERIFY(&page_directory != &MM.kernel_page_directory());
+    m_previous_batch = m_thread->tlb_flush_batch();
+    m_thread->set_tlb_flush_batch(this);
+}
+
+TLBFlushBatch::~TLBFlushBatch()
+{
+    VERIFY(Thread::current() == m_thread);
+    VERIFY(m_thread->tlb_flush_batch() == this);
+    m_thread->set_tlb_flush_batch(m_previous_batch);
+    flush();
+}
+
+TLBFlushBatch* TLBFlushBatch::current_for(const PageDirectory& page_directory)
+{
+    auto* current_thread = Thread::current();
+    if (!current_thread)
+        return nullptr;
+    auto* batch = current_thread->tlb_flush_batch();
+    if (!batch || batch->m_page_directory.ptr() != &page_directory)
+        return nullptr;
+    return batch;
+}
+
+void TLBFlushBatch::add(VirtualAddress vaddr, size_t page_count)
+{
+    VERIFY(is_user_range(vaddr, page_count * PAGE_SIZE));
+    m_page_count += page_count;
+    if (m_page_count > full_flush_threshold)
+        m_flush_all = true;
+    if (m_range_count > 0) {
+        auto& last_range = m_ranges[m_range_count - 1];
+        if (last_range.base + last_range.page_count * PAGE_SIZE == vaddr.get()) {
+            last_range.page_count += page_count;
+            return;
+        }
+    }
+    if (m_range_count == max_ranges) {
+        m_flush_all = true;
+        return;
+    }
+    m_ranges[m_range_count++] = { vaddr.get(), page_count };
+}
+
+void TLBFlushBatch::defer_release(VMObject& vmobject)
+{
+    m_deferred_vmobjects.append(vmobject);
+}
+
+void TLBFlushBatch::defer_release(PhysicalPage& page)
+{
+    m_deferred_pages.append(page);
+}
+
+void TLBFlushBatch::flush()
+{
+    if (m_range_count > 0)
+        Processor::flush_tlb(m_page_directory.ptr(), m_ranges, m_range_count, m_flush_all);
+    m_range_count = 0;
+    m_page_count = 0;
+    m_flush_all = false;
+    // Now that nobody can reach them anymore, let go of the pages.
+    m_deferred_pages.clear();
+    m_deferred_vmobjects.clear();
+}
+
+}
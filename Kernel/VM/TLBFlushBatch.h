@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2021, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <AK/NonnullRefPtrVector.h>
+#include <Kernel/Arch/x86/CPU.h>
+#include <Kernel/VM/PageDirectory.h>
+#include <Kernel/VM/PhysicalPage.h>
+#include <Kernel/VM/VMObject.h>
+
+namespace Kernel {
+
+// Collects the TLB invalidations of a multi-region operation on one page directory
+// (munmap of several regions, tearing down an address space, ...) and sends them to
+// the other processors in a single shootdown when the batch goes out of scope.
+// Anything that might still be reachable through stale TLB entries on other processors
+// is kept alive until then. The batch must be destroyed without holding any spinlocks.
+class TLBFlushBatch {
+    AK_MAKE_NONCOPYABLE(TLBFlushBatch);
+    AK_MAKE_NONMOVABLE(TLBFlushBatch);
+
+public:
+    explicit TLBFlushBatch(PageDirectory&);
+    ~TLBFlushBatch();
+
+    // Returns the batch the current thread is collecting for this page directory, if any.
+    static TLBFlushBatch* current_for(const PageDirectory&);
+
+    void add(VirtualAddress, size_t page_count);
+    void defer_release(VMObject&);
+    void defer_release(PhysicalPage&);
+
+private:
+    void flush();
+
+    static constexpr size_t max_ranges = 16;
+    static constexpr size_t full_flush_threshold = 64;
+
+    NonnullRefPtr<PageDirectory> m_page_directory;
+    Thread* m_thread { nullptr };
+    TLBFlushBatch* m_previous_batch { nullptr };
+    TLBFlushRange m_ranges[max_ranges];
+    size_t m_range_count { 0 };
+    size_t m_page_count { 0 };
+    bool m_flush_all { false };
+    NonnullRefPtrVector<VMObject> m_deferred_vmobjects;
+    NonnullRefPtrVector<PhysicalPage> m_deferred_pages;
+};
+
+}
@@ -145,11 +145,10 @@ private:
         busy = 0;
         idle = 0;
 
-        auto all_processes = Core::ProcessStatisticsReader::get_all(m_proc_all);
-        if (!all_processes.has_value() || all_processes.value().is_empty())
+        if (!m_statistics_reader.update() || m_statistics_reader.processes().is_empty())
             return false;
 
-        for (auto& it : all_processes.value()) {
+        for (auto& it : m_statistics_reader.processes()) {
             for (auto& jt : it.value.threads) {
                 if (it.value.pid == 0)
                     idle += jt.ticks_user + jt.ticks_kernel;
@@ -197,7 +196,7 @@ private:
     unsigned m_last_cpu_busy { 0 };
     unsigned m_last_cpu_idle { 0 };
     String m_tooltip;
-    RefPtr<Core::File> m_proc_all;
+    Core::ProcessStatisticsReader m_statistics_reader;
     RefPtr<Core::File> m_proc_mem;
 };
 
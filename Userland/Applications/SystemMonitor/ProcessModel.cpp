@@ -336,7 +336,7 @@ GUI::Variant ProcessModel::data(const GUI::ModelIndex& index, GUI::ModelRole rol
 void ProcessModel::update()
 {
     auto previous_tid_count = m_tids.size();
-    auto all_processes = Core::ProcessStatisticsReader::get_all(m_proc_all);
+    bool did_read_statistics = m_statistics_reader.update();
 
     u64 last_sum_ticks_scheduled = 0, last_sum_ticks_scheduled_kernel = 0;
     for (auto& it : m_threads) {
@@ -347,8 +347,8 @@ void ProcessModel::update()
 
     HashTable<int> live_tids;
     u64 sum_ticks_scheduled = 0, sum_ticks_scheduled_kernel = 0;
-    if (all_processes.has_value()) {
-        for (auto& it : all_processes.value()) {
+    if (did_read_statistics) {
+        for (auto& it : m_statistics_reader.processes()) {
             for (auto& thread : it.value.threads) {
                 ThreadState state;
                 state.kernel = it.value.kernel;
@@ -434,7 +434,7 @@ void ProcessModel::update()
         on_cpu_info_change(m_cpus);
 
     if (on_state_update)
-        on_state_update(all_processes->size(), m_threads.size());
+        on_state_update(m_statistics_reader.processes().size(), m_threads.size());
 
     // FIXME: This is a rather hackish way of invalidating indexes.
     //        It would be good if GUI::Model had a way to orchestrate removal/insertion while preserving indexes.
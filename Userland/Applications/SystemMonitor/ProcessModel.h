@@ -30,6 +30,7 @@
 #include <AK/NonnullOwnPtrVector.h>
 #include <AK/String.h>
 #include <AK/Vector.h>
+#include <LibCore/ProcessStatisticsReader.h>
 #include <LibGUI/Model.h>
 #include <unistd.h>
 
@@ -146,6 +147,6 @@ private:
     HashMap<int, NonnullOwnPtr<Thread>> m_threads;
     NonnullOwnPtrVector<CpuInfo> m_cpus;
     Vector<int> m_tids;
-    RefPtr<Core::File> m_proc_all;
+    Core::ProcessStatisticsReader m_statistics_reader;
     GUI::Icon m_kernel_process_icon;
 };
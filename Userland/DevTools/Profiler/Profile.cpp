@@ -219,8 +219,11 @@ Result<NonnullOwnPtr<Profile>, String> Profile::load_from_perfcore_file(const St
     if (!json.has_value() || !json.value().is_object())
         return String { "Invalid perfcore format (not a JSON object)" };
 
-    auto& object = json.value().as_object();
+    return load_from_perfcore_object(json.value().as_object());
+}
 
+Result<NonnullOwnPtr<Profile>, String> Profile::load_from_perfcore_object(const JsonObject& object)
+{
     auto processes_value = object.get("processes");
     if (processes_value.is_null())
         return String { "Invalid perfcore format (no processes)" };
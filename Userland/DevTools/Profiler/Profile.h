@@ -179,6 +179,7 @@ private:
 class Profile {
 public:
     static Result<NonnullOwnPtr<Profile>, String> load_from_perfcore_file(const StringView& path);
+    static Result<NonnullOwnPtr<Profile>, String> load_from_perfcore_object(const JsonObject&);
     ~Profile();
 
     GUI::Model& model();
@@ -27,6 +27,7 @@
 #include "IndividualSampleModel.h"
 #include "Profile.h"
 #include "ProfileTimelineWidget.h"
+#include <Kernel/API/PerformanceEvent.h>
 #include <LibCore/ArgsParser.h>
 #include <LibCore/ElapsedTimer.h>
 #include <LibCore/EventLoop.h>
@@ -51,7 +52,8 @@
 #include <serenity.h>
 #include <string.h>
 
-static bool generate_profile(pid_t& pid);
+static bool generate_profile(pid_t& pid, JsonArray& streamed_events);
+static Result<NonnullOwnPtr<Profile>, String> load_live_profile(pid_t pid, JsonArray& streamed_events);
 
 int main(int argc, char** argv)
 {
@@ -70,16 +72,15 @@ int main(int argc, char** argv)
     auto app = GUI::Application::construct(argc, argv);
     auto app_icon = GUI::Icon::default_icon("app-profiler");
 
-    String perfcore_file;
+    JsonArray streamed_events;
     if (!perfcore_file_arg) {
-        if (!generate_profile(pid))
+        if (!generate_profile(pid, streamed_events))
             return 0;
-        perfcore_file = String::formatted("/proc/{}/perf_events", pid);
-    } else {
-        perfcore_file = perfcore_file_arg;
     }
 
-    auto profile_or_error = Profile::load_from_perfcore_file(perfcore_file);
+    auto profile_or_error = perfcore_file_arg
+        ? Profile::load_from_perfcore_file(perfcore_file_arg)
+        : load_live_profile(pid, streamed_events);
     if (profile_or_error.is_error()) {
         GUI::MessageBox::show(nullptr, profile_or_error.error(), "Profiler", GUI::MessageBox::Type::Error);
         return 0;
@@ -177,7 +178,76 @@ int main(int argc, char** argv)
     return app->exec();
 }
 
-static bool prompt_to_stop_profiling(pid_t pid, const String& process_name)
+static JsonObject perf_event_to_json(const PerformanceEvent& event)
+{
+    // Keep this in sync with PerformanceEventBuffer::to_json() in the kernel.
+    JsonObject object;
+    switch (event.type) {
+    case PERF_EVENT_SAMPLE:
+        object.set("type", "sample");
+        break;
+    case PERF_EVENT_MALLOC:
+        object.set("type", "malloc");
+        object.set("ptr", static_cast<u64>(event.data.malloc.ptr));
+        object.set("size", static_cast<u64>(event.data.malloc.size));
+        break;
+    case PERF_EVENT_FREE:
+        object.set("type", "free");
+        object.set("ptr", static_cast<u64>(event.data.free.ptr));
+        break;
+    }
+    object.set("tid", static_cast<u32>(event.tid));
+    object.set("timestamp", static_cast<u64>(event.timestamp));
+    JsonArray stack;
+    for (size_t i = 0; i < event.stack_size; ++i)
+        stack.append(static_cast<u32>(event.stack[i]));
+    object.set("stack", move(stack));
+    return object;
+}
+
+// Moves the events collected so far out of the kernel, so that the profile
+// isn't limited by the size of the kernel's event buffer.
+static void drain_perf_events(pid_t pid, JsonArray& events)
+{
+    static constexpr size_t events_per_drain = 256;
+    Vector<PerformanceEvent> buffer;
+    buffer.resize(events_per_drain);
+    for (;;) {
+        auto nread = profiling_drain(pid, buffer.data(), buffer.size() * sizeof(PerformanceEvent));
+        if (nread <= 0)
+            return;
+        size_t event_count = static_cast<size_t>(nread) / sizeof(PerformanceEvent);
+        for (size_t i = 0; i < event_count; ++i)
+            events.append(perf_event_to_json(buffer[i]));
+        if (event_count < events_per_drain)
+            return;
+    }
+}
+
+Result<NonnullOwnPtr<Profile>, String> load_live_profile(pid_t pid, JsonArray& streamed_events)
+{
+    auto path = String::formatted("/proc/{}/perf_events", pid);
+    auto file = Core::File::construct(path);
+    if (!file->open(Core::IODevice::ReadOnly))
+        return String::formatted("Unable to open {}, error: {}", path, file->error_string());
+
+    auto json = JsonValue::from_string(file->read_all());
+    if (!json.has_value() || !json.value().is_object())
+        return String { "Invalid perfcore format (not a JSON object)" };
+
+    // The streamed events have already been removed from the kernel's buffer,
+    // so they go in front of whatever is still left in there.
+    auto object = json.value().as_object();
+    auto remaining_events = object.get("events");
+    if (remaining_events.is_array()) {
+        for (auto& event : remaining_events.as_array().values())
+            streamed_events.append(event);
+    }
+    object.set("events", move(streamed_events));
+    return Profile::load_from_perfcore_object(object);
+}
+
+static bool prompt_to_stop_profiling(pid_t pid, const String& process_name, JsonArray& streamed_events)
 {
     auto window = GUI::Window::construct();
     window->set_title(String::formatted("Profiling {}({})", process_name, pid));
@@ -194,7 +264,8 @@ static bool prompt_to_stop_profiling(pid_t pid, const String& process_name)
     Core::ElapsedTimer clock;
     clock.start();
     auto update_timer = Core::Timer::construct(100, [&] {
-        timer_label.set_text(String::format("%.1f seconds", (float)clock.elapsed() / 1000.0f));
+        drain_perf_events(pid, streamed_events);
+        timer_label.set_text(String::format("%.1f seconds, %zu events", (float)clock.elapsed() / 1000.0f, streamed_events.size()));
     });
 
     auto& stop_button = widget.add<GUI::Button>("Stop");
@@ -207,7 +278,7 @@ static bool prompt_to_stop_profiling(pid_t pid, const String& process_name)
     return GUI::Application::the()->exec() == 0;
 }
 
-bool generate_profile(pid_t& pid)
+bool generate_profile(pid_t& pid, JsonArray& streamed_events)
 {
     if (!pid) {
         auto process_chooser = GUI::ProcessChooser::construct("Profiler", "Profile", Gfx::Bitmap::load_from_file("/res/icons/16x16/app-profiler.png"));
@@ -234,7 +305,7 @@ bool generate_profile(pid_t& pid)
         return false;
     }
 
-    if (!prompt_to_stop_profiling(pid, process_name))
+    if (!prompt_to_stop_profiling(pid, process_name, streamed_events))
         return false;
 
     if (profiling_disable(pid) < 0) {
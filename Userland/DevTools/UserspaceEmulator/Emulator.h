@@ -97,7 +97,7 @@ private:
     int virt$stat(FlatPtr);
     int virt$realpath(FlatPtr);
     int virt$gethostname(FlatPtr, ssize_t);
-    int virt$profiling_enable(pid_t);
+    int virt$profiling_enable(pid_t, unsigned);
     int virt$profiling_disable(pid_t);
     int virt$disown(pid_t);
     int virt$purge(int mode);
@@ -155,6 +155,11 @@ private:
     int virt$getsockname(FlatPtr);
     int virt$getpeername(FlatPtr);
     int virt$select(FlatPtr);
+    int virt$epoll_create1(int flags);
+    int virt$epoll_ctl(FlatPtr);
+    int virt$epoll_wait(FlatPtr);
+    int virt$sendfile(FlatPtr);
+    int virt$splice(FlatPtr);
     int virt$get_stack_bounds(FlatPtr, FlatPtr);
     int virt$accept(int sockfd, FlatPtr address, FlatPtr address_length);
     int virt$bind(int sockfd, FlatPtr address, socklen_t address_length);
@@ -33,6 +33,7 @@
 #include <sched.h>
 #include <serenity.h>
 #include <strings.h>
+#include <sys/epoll.h>
 #include <sys/ioctl.h>
 #include <sys/mman.h>
 #include <sys/select.h>
@@ -92,7 +93,7 @@ u32 Emulator::virt_syscall(u32 function, u32 arg1, u32 arg2, u32 arg3)
     case SC_get_dir_entries:
         return virt$get_dir_entries(arg1, arg2, arg3);
     case SC_profiling_enable:
-        return virt$profiling_enable(arg1);
+        return virt$profiling_enable(arg1, arg2);
     case SC_profiling_disable:
         return virt$profiling_disable(arg1);
     case SC_disown:
@@ -207,6 +208,16 @@ u32 Emulator::virt_syscall(u32 function, u32 arg1, u32 arg2, u32 arg3)
         return virt$listen(arg1, arg2);
     case SC_select:
         return virt$select(arg1);
+    case SC_epoll_create1:
+        return virt$epoll_create1(arg1);
+    case SC_epoll_ctl:
+        return virt$epoll_ctl(arg1);
+    case SC_epoll_wait:
+        return virt$epoll_wait(arg1);
+    case SC_sendfile:
+        return virt$sendfile(arg1);
+    case SC_splice:
+        return virt$splice(arg1);
     case SC_recvmsg:
         return virt$recvmsg(arg1, arg2, arg3);
     case SC_sendmsg:
@@ -288,9 +299,9 @@ int Emulator::virt$recvfd(int socket, int options)
     return syscall(SC_recvfd, socket, options);
 }
 
-int Emulator::virt$profiling_enable(pid_t pid)
+int Emulator::virt$profiling_enable(pid_t pid, unsigned flags)
 {
-    return syscall(SC_profiling_enable, pid);
+    return syscall(SC_profiling_enable, pid, flags);
 }
 
 int Emulator::virt$profiling_disable(pid_t pid)
@@ -701,6 +712,84 @@ int Emulator::virt$select(FlatPtr params_addr)
     return rc;
 }
 
+int Emulator::virt$epoll_create1(int flags)
+{
+    return syscall(SC_epoll_create1, flags);
+}
+
+int Emulator::virt$epoll_ctl(FlatPtr params_addr)
+{
+    Syscall::SC_epoll_ctl_params params;
+    mmu().copy_from_vm(&params, params_addr, sizeof(params));
+
+    epoll_event event {};
+    if (params.event)
+        mmu().copy_from_vm(&event, (FlatPtr)params.event, sizeof(event));
+
+    Syscall::SC_epoll_ctl_params host_params { params.epfd, params.op, params.fd, params.event ? &event : nullptr };
+    return syscall(SC_epoll_ctl, &host_params);
+}
+
+int Emulator::virt$epoll_wait(FlatPtr params_addr)
+{
+    Syscall::SC_epoll_wait_params params;
+    mmu().copy_from_vm(&params, params_addr, sizeof(params));
+
+    if (params.max_events <= 0)
+        return -EINVAL;
+
+    Vector<epoll_event> events;
+    events.resize(params.max_events);
+    struct timespec timeout;
+    if (params.timeout)
+        mmu().copy_from_vm(&timeout, (FlatPtr)params.timeout, sizeof(timeout));
+
+    Syscall::SC_epoll_wait_params host_params { params.epfd, events.data(), params.max_events, params.timeout ? &timeout : nullptr };
+    int rc = syscall(SC_epoll_wait, &host_params);
+    if (rc < 0)
+        return rc;
+
+    mmu().copy_to_vm((FlatPtr)params.events, events.data(), rc * sizeof(epoll_event));
+    return rc;
+}
+
+int Emulator::virt$sendfile(FlatPtr params_addr)
+{
+    Syscall::SC_sendfile_params params;
+    mmu().copy_from_vm(&params, params_addr, sizeof(params));
+
+    off_t offset = 0;
+    if (params.offset)
+        mmu().copy_from_vm(&offset, (FlatPtr)params.offset, sizeof(offset));
+
+    Syscall::SC_sendfile_params host_params { params.out_fd, params.in_fd, params.offset ? &offset : nullptr, params.count };
+    int rc = syscall(SC_sendfile, &host_params);
+    if (rc >= 0 && params.offset)
+        mmu().copy_to_vm((FlatPtr)params.offset, &offset, sizeof(offset));
+    return rc;
+}
+
+int Emulator::virt$splice(FlatPtr params_addr)
+{
+    Syscall::SC_splice_params params;
+    mmu().copy_from_vm(&params, params_addr, sizeof(params));
+
+    off_t in_offset = 0;
+    off_t out_offset = 0;
+    if (params.in_offset)
+        mmu().copy_from_vm(&in_offset, (FlatPtr)params.in_offset, sizeof(in_offset));
+    if (params.out_offset)
+        mmu().copy_from_vm(&out_offset, (FlatPtr)params.out_offset, sizeof(out_offset));
+
+    Syscall::SC_splice_params host_params { params.in_fd, params.in_offset ? &in_offset : nullptr, params.out_fd, params.out_offset ? &out_offset : nullptr, params.count, params.flags };
+    int rc = syscall(SC_splice, &host_params);
+    if (rc >= 0 && params.in_offset)
+        mmu().copy_to_vm((FlatPtr)params.in_offset, &in_offset, sizeof(in_offset));
+    if (rc >= 0 && params.out_offset)
+        mmu().copy_to_vm((FlatPtr)params.out_offset, &out_offset, sizeof(out_offset));
+    return rc;
+}
+
 int Emulator::virt$getsockopt(FlatPtr params_addr)
 {
     Syscall::SC_getsockopt_params params;
@@ -92,4 +92,11 @@ int openat(int dirfd, const char* path, int options, ...)
     int rc = syscall(SC_open, &params);
     __RETURN_WITH_ERRNO(rc, rc, -1);
 }
+
+ssize_t splice(int in_fd, off_t* in_offset, int out_fd, off_t* out_offset, size_t count, unsigned flags)
+{
+    Syscall::SC_splice_params params { in_fd, in_offset, out_fd, out_offset, count, flags };
+    int rc = syscall(SC_splice, &params);
+    __RETURN_WITH_ERRNO(rc, rc, -1);
+}
 }
@@ -79,4 +79,10 @@ struct flock {
     pid_t l_pid;
 };
 
+#define SPLICE_F_MOVE (1u << 0)
+#define SPLICE_F_NONBLOCK (1u << 1)
+#define SPLICE_F_MORE (1u << 2)
+
+ssize_t splice(int in_fd, off_t* in_offset, int out_fd, off_t* out_offset, size_t count, unsigned flags);
+
 __END_DECLS
@@ -38,6 +38,7 @@
 #define MAP_STACK 0x40
 #define MAP_NORESERVE 0x80
 #define MAP_RANDOMIZED 0x100
+#define MAP_POPULATE 0x200
 
 #define PROT_READ 0x1
 #define PROT_WRITE 0x2
@@ -49,6 +50,7 @@
 #define MADV_SET_VOLATILE 0x100
 #define MADV_SET_NONVOLATILE 0x200
 #define MADV_GET_VOLATILE 0x400
+#define MADV_WILLNEED 0x800
 
 __BEGIN_DECLS
 
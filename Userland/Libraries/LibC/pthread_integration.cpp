@@ -26,10 +26,12 @@
 
 #include <AK/Atomic.h>
 #include <AK/NeverDestroyed.h>
+#include <AK/Platform.h>
 #include <AK/Types.h>
 #include <AK/Vector.h>
 #include <bits/pthread_integration.h>
-#include <sched.h>
+#include <errno.h>
+#include <serenity.h>
 #include <sys/types.h>
 #include <unistd.h>
 
@@ -42,6 +44,54 @@ static NeverDestroyed<Vector<void (*)(void), 4>> g_atfork_prepare_list;
 static NeverDestroyed<Vector<void (*)(void), 4>> g_atfork_child_list;
 static NeverDestroyed<Vector<void (*)(void), 4>> g_atfork_parent_list;
 
+// The mutex lock word is one of these three states. Unlocking a mutex that
+// was never contended is a single atomic exchange, we only have to make the
+// futex syscall if somebody may be sleeping on it.
+static constexpr u32 mutex_unlocked = 0;
+static constexpr u32 mutex_locked = 1;
+static constexpr u32 mutex_locked_with_waiters = 2;
+
+// How many times we poll a mutex held by another thread before going to sleep.
+// Most critical sections are short, so this usually saves us two syscalls.
+static constexpr size_t mutex_spin_count = 100;
+
+ALWAYS_INLINE static void spin_loop_hint()
+{
+#if ARCH(I386) || ARCH(X86_64)
+    asm volatile("pause");
+#endif
+}
+
+static u32 mutex_spin_until_unlocked(Atomic<u32>& atomic)
+{
+    u32 value = atomic.load(AK::memory_order_relaxed);
+    for (size_t i = 0; i < mutex_spin_count; ++i) {
+        // If others are already sleeping, spinning won't get us ahead of them.
+        if (value != mutex_locked)
+            break;
+        spin_loop_hint();
+        value = atomic.load(AK::memory_order_relaxed);
+    }
+    return value;
+}
+
+static void mutex_lock_slow(Atomic<u32>& atomic, u32 value)
+{
+    value = mutex_spin_until_unlocked(atomic);
+    if (value == mutex_unlocked && atomic.compare_exchange_strong(value, mutex_locked, AK::memory_order_acquire))
+        return;
+
+    // Announce that we are about to sleep, so the owner knows to wake us up.
+    // Since we can't know whether there are other sleepers, we have to keep
+    // the mutex marked as contended once we get it.
+    if (value != mutex_locked_with_waiters)
+        value = atomic.exchange(mutex_locked_with_waiters, AK::memory_order_acquire);
+    while (value != mutex_unlocked) {
+        futex(reinterpret_cast<u32*>(&atomic), FUTEX_WAIT | FUTEX_PRIVATE_FLAG, mutex_locked_with_waiters, nullptr, nullptr, 0);
+        value = atomic.exchange(mutex_locked_with_waiters, AK::memory_order_acquire);
+    }
+}
+
 }
 
 extern "C" {
@@ -115,20 +165,38 @@ int __pthread_mutex_lock(void* mutexp)
     auto* mutex = reinterpret_cast<pthread_mutex_t*>(mutexp);
     auto& atomic = reinterpret_cast<Atomic<u32>&>(mutex->lock);
     pthread_t this_thread = __pthread_self();
-    for (;;) {
-        u32 expected = false;
-        if (!atomic.compare_exchange_strong(expected, true, AK::memory_order_acq_rel)) {
-            if (mutex->type == __PTHREAD_MUTEX_RECURSIVE && mutex->owner == this_thread) {
-                mutex->level++;
-                return 0;
-            }
-            sched_yield();
-            continue;
-        }
-        mutex->owner = this_thread;
-        mutex->level = 0;
+
+    if (mutex->type == __PTHREAD_MUTEX_RECURSIVE && mutex->owner == this_thread) {
+        mutex->level++;
         return 0;
     }
+
+    u32 expected = mutex_unlocked;
+    if (!atomic.compare_exchange_strong(expected, mutex_locked, AK::memory_order_acquire))
+        mutex_lock_slow(atomic, expected);
+
+    mutex->owner = this_thread;
+    mutex->level = 0;
+    return 0;
+}
+
+int __pthread_mutex_trylock(void* mutexp)
+{
+    auto* mutex = reinterpret_cast<pthread_mutex_t*>(mutexp);
+    auto& atomic = reinterpret_cast<Atomic<u32>&>(mutex->lock);
+    pthread_t this_thread = __pthread_self();
+
+    u32 expected = mutex_unlocked;
+    if (!atomic.compare_exchange_strong(expected, mutex_locked, AK::memory_order_acquire)) {
+        if (mutex->type == __PTHREAD_MUTEX_RECURSIVE && mutex->owner == this_thread) {
+            mutex->level++;
+            return 0;
+        }
+        return EBUSY;
+    }
+    mutex->owner = this_thread;
+    mutex->level = 0;
+    return 0;
 }
 
 int __pthread_mutex_unlock(void* mutexp)
@@ -139,7 +207,10 @@ int __pthread_mutex_unlock(void* mutexp)
         return 0;
     }
     mutex->owner = 0;
-    mutex->lock = 0;
+
+    auto& atomic = reinterpret_cast<Atomic<u32>&>(mutex->lock);
+    if (atomic.exchange(mutex_unlocked, AK::memory_order_release) == mutex_locked_with_waiters)
+        futex(&mutex->lock, FUTEX_WAKE | FUTEX_PRIVATE_FLAG, 1, nullptr, nullptr, 0);
     return 0;
 }
 
@@ -52,7 +52,12 @@ int module_unload(const char* name, size_t name_length)
 
 int profiling_enable(pid_t pid)
 {
-    int rc = syscall(SC_profiling_enable, pid);
+    return profiling_enable_with_flags(pid, 0);
+}
+
+int profiling_enable_with_flags(pid_t pid, unsigned flags)
+{
+    int rc = syscall(SC_profiling_enable, pid, flags);
     __RETURN_WITH_ERRNO(rc, rc, -1);
 }
 
@@ -62,6 +67,19 @@ int profiling_disable(pid_t pid)
     __RETURN_WITH_ERRNO(rc, rc, -1);
 }
 
+ssize_t profiling_drain(pid_t pid, void* buffer, size_t size)
+{
+    int rc = syscall(SC_profiling_drain, pid, buffer, size);
+    __RETURN_WITH_ERRNO(rc, rc, -1);
+}
+
+ssize_t get_process_statistics(uint32_t since_generation, void* buffer, size_t buffer_size, uint32_t* generation)
+{
+    Syscall::SC_get_process_statistics_params params { since_generation, buffer, buffer_size, generation };
+    int rc = syscall(SC_get_process_statistics, &params);
+    __RETURN_WITH_ERRNO(rc, rc, -1);
+}
+
 int futex(uint32_t* userspace_address, int futex_op, uint32_t value, const struct timespec* timeout, uint32_t* userspace_address2, uint32_t value3)
 {
     int rc;
@@ -121,6 +139,18 @@ int anon_create(size_t size, int options)
     __RETURN_WITH_ERRNO(rc, rc, -1);
 }
 
+int io_ring_create(unsigned entries, size_t* mapping_size)
+{
+    int rc = syscall(SC_io_ring_create, entries, mapping_size);
+    __RETURN_WITH_ERRNO(rc, rc, -1);
+}
+
+int io_ring_enter(int fd, unsigned to_submit, unsigned min_complete)
+{
+    int rc = syscall(SC_io_ring_enter, fd, to_submit, min_complete);
+    __RETURN_WITH_ERRNO(rc, rc, -1);
+}
+
 int serenity_readlink(const char* path, size_t path_length, char* buffer, size_t buffer_size)
 {
     Syscall::SC_readlink_params small_params {
@@ -37,8 +37,14 @@ int disown(pid_t);
 int module_load(const char* path, size_t path_length);
 int module_unload(const char* name, size_t name_length);
 
+#define PROFILING_FLAG_OVERWRITE 1
+
 int profiling_enable(pid_t);
+int profiling_enable_with_flags(pid_t, unsigned flags);
 int profiling_disable(pid_t);
+ssize_t profiling_drain(pid_t, void* buffer, size_t size);
+
+ssize_t get_process_statistics(uint32_t since_generation, void* buffer, size_t buffer_size, uint32_t* generation);
 
 #define THREAD_PRIORITY_MIN 1
 #define THREAD_PRIORITY_LOW 10
@@ -104,6 +110,10 @@ int get_stack_bounds(uintptr_t* user_stack_base, size_t* user_stack_size);
 
 int anon_create(size_t size, int options);
 
+// See <Kernel/API/IORing.h> for the layout of the ring.
+int io_ring_create(unsigned entries, size_t* mapping_size);
+int io_ring_enter(int fd, unsigned to_submit, unsigned min_complete);
+
 int serenity_readlink(const char* path, size_t path_length, char* buffer, size_t buffer_size);
 
 int getkeymap(char* name_buffer, size_t name_buffer_size, uint32_t* map, uint32_t* shift_map, uint32_t* alt_map, uint32_t* altgr_map, uint32_t* shift_altgr_map);
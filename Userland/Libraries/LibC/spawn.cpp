@@ -34,153 +34,141 @@
 
 #include <spawn.h>
 
-#include <AK/Function.h>
+#include <AK/String.h>
 #include <AK/Vector.h>
+#include <Kernel/API/Syscall.h>
+#include <alloca.h>
+#include <errno.h>
 #include <fcntl.h>
-#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <syscall.h>
 #include <unistd.h>
 
 struct posix_spawn_file_actions_state {
-    Vector<Function<int()>, 4> actions;
+    Vector<Syscall::SC_posix_spawn_file_action, 4> actions;
+    // Paths for the Open and Chdir actions, the kernel reads them when the child is set up.
+    Vector<String, 4> paths;
 };
 
 extern "C" {
 
-[[noreturn]] static void posix_spawn_child(const char* path, const posix_spawn_file_actions_t* file_actions, const posix_spawnattr_t* attr, char* const argv[], char* const envp[], int (*exec)(const char*, char* const[], char* const[]))
+int posix_spawn(pid_t* out_pid, const char* path, const posix_spawn_file_actions_t* file_actions, const posix_spawnattr_t* attr, char* const argv[], char* const envp[])
 {
-    if (attr) {
-        short flags = attr->flags;
-        if (flags & POSIX_SPAWN_RESETIDS) {
-            if (seteuid(getuid()) < 0) {
-                perror("posix_spawn seteuid");
-                _exit(127);
-            }
-            if (setegid(getgid()) < 0) {
-                perror("posix_spawn setegid");
-                _exit(127);
-            }
-        }
-        if (flags & POSIX_SPAWN_SETPGROUP) {
-            if (setpgid(0, attr->pgroup) < 0) {
-                perror("posix_spawn setpgid");
-                _exit(127);
-            }
-        }
-        if (flags & POSIX_SPAWN_SETSCHEDPARAM) {
-            if (sched_setparam(0, &attr->schedparam) < 0) {
-                perror("posix_spawn sched_setparam");
-                _exit(127);
-            }
-        }
-        if (flags & POSIX_SPAWN_SETSIGDEF) {
-            struct sigaction default_action;
-            default_action.sa_flags = 0;
-            sigemptyset(&default_action.sa_mask);
-            default_action.sa_handler = SIG_DFL;
-
-            sigset_t sigdefault = attr->sigdefault;
-            for (int i = 0; i < NSIG; ++i) {
-                if (sigismember(&sigdefault, i) && sigaction(i, &default_action, nullptr) < 0) {
-                    perror("posix_spawn sigaction");
-                    _exit(127);
-                }
-            }
-        }
-        if (flags & POSIX_SPAWN_SETSIGMASK) {
-            if (sigprocmask(SIG_SETMASK, &attr->sigmask, nullptr) < 0) {
-                perror("posix_spawn sigprocmask");
-                _exit(127);
-            }
-        }
-        if (flags & POSIX_SPAWN_SETSID) {
-            if (setsid() < 0) {
-                perror("posix_spawn setsid");
-                _exit(127);
-            }
+    size_t arg_count = 0;
+    for (size_t i = 0; argv[i]; ++i)
+        ++arg_count;
+
+    size_t env_count = 0;
+    for (size_t i = 0; envp[i]; ++i)
+        ++env_count;
+
+    auto copy_strings = [&](auto& vec, size_t count, auto& output) {
+        output.length = count;
+        for (size_t i = 0; vec[i]; ++i) {
+            output.strings[i].characters = vec[i];
+            output.strings[i].length = strlen(vec[i]);
         }
+    };
 
-        // FIXME: POSIX_SPAWN_SETSCHEDULER
-    }
+    Syscall::SC_posix_spawn_params params {};
+    params.arguments.strings = (Syscall::StringArgument*)alloca(arg_count * sizeof(Syscall::StringArgument));
+    params.environment.strings = (Syscall::StringArgument*)alloca(env_count * sizeof(Syscall::StringArgument));
+
+    params.path = { path, strlen(path) };
+    copy_strings(argv, arg_count, params.arguments);
+    copy_strings(envp, env_count, params.environment);
 
     if (file_actions) {
-        for (const auto& action : file_actions->state->actions) {
-            if (action() < 0) {
-                perror("posix_spawn file action");
-                _exit(127);
-            }
-        }
+        auto& state = *file_actions->state;
+        for (size_t i = 0; i < state.actions.size(); ++i)
+            state.actions[i].path = { state.paths[i].characters(), state.paths[i].length() };
+        params.file_actions = state.actions.data();
+        params.file_action_count = state.actions.size();
     }
 
-    exec(path, argv, envp);
-    perror("posix_spawn exec");
-    _exit(127);
-}
-
-int posix_spawn(pid_t* out_pid, const char* path, const posix_spawn_file_actions_t* file_actions, const posix_spawnattr_t* attr, char* const argv[], char* const envp[])
-{
-    pid_t child_pid = fork();
-    if (child_pid < 0)
-        return errno;
-
-    if (child_pid != 0) {
-        *out_pid = child_pid;
-        return 0;
+    if (attr) {
+        // NOTE: The kernel uses the same values for the POSIX_SPAWN_* flags.
+        params.flags = attr->flags;
+        params.pgroup = attr->pgroup;
+        params.sched_priority = attr->schedparam.sched_priority;
+        params.sigmask = attr->sigmask;
     }
 
-    posix_spawn_child(path, file_actions, attr, argv, envp, execve);
+    int rc = syscall(SC_posix_spawn, &params);
+    if (rc < 0)
+        return -rc;
+    if (out_pid)
+        *out_pid = rc;
+    return 0;
 }
 
-int posix_spawnp(pid_t* out_pid, const char* path, const posix_spawn_file_actions_t* file_actions, const posix_spawnattr_t* attr, char* const argv[], char* const envp[])
+int posix_spawnp(pid_t* out_pid, const char* file, const posix_spawn_file_actions_t* file_actions, const posix_spawnattr_t* attr, char* const argv[], char* const envp[])
 {
-    pid_t child_pid = fork();
-    if (child_pid < 0)
-        return errno;
-
-    if (child_pid != 0) {
-        *out_pid = child_pid;
-        return 0;
+    if (strchr(file, '/'))
+        return posix_spawn(out_pid, file, file_actions, attr, argv, envp);
+
+    String path = getenv("PATH");
+    if (path.is_empty())
+        path = "/bin:/usr/bin";
+    auto parts = path.split(':');
+    bool seen_eacces = false;
+    for (auto& part : parts) {
+        auto candidate = String::formatted("{}/{}", part, file);
+        int rc = posix_spawn(out_pid, candidate.characters(), file_actions, attr, argv, envp);
+        // Keep looking if a directory has a file by that name that we can't execute,
+        // but report that if nothing else turns up.
+        if (rc == EACCES) {
+            seen_eacces = true;
+            continue;
+        }
+        if (rc != ENOENT && rc != ENOTDIR)
+            return rc;
     }
+    return seen_eacces ? EACCES : ENOENT;
+}
 
-    posix_spawn_child(path, file_actions, attr, argv, envp, execvpe);
+static void append_file_action(posix_spawn_file_actions_t* actions, Syscall::SpawnFileActionType type, int fd, int new_fd = -1, int options = 0, mode_t mode = 0, const char* path = nullptr)
+{
+    actions->state->actions.append({ type, fd, new_fd, options, (u16)mode, {} });
+    actions->state->paths.append(path ? String(path) : String());
 }
 
 int posix_spawn_file_actions_addchdir(posix_spawn_file_actions_t* actions, const char* path)
 {
-    actions->state->actions.append([path]() { return chdir(path); });
+    append_file_action(actions, Syscall::SpawnFileActionType::Chdir, -1, -1, 0, 0, path);
     return 0;
 }
 
 int posix_spawn_file_actions_addfchdir(posix_spawn_file_actions_t* actions, int fd)
 {
-    actions->state->actions.append([fd]() { return fchdir(fd); });
+    append_file_action(actions, Syscall::SpawnFileActionType::Fchdir, fd);
     return 0;
 }
 
 int posix_spawn_file_actions_addclose(posix_spawn_file_actions_t* actions, int fd)
 {
-    actions->state->actions.append([fd]() { return close(fd); });
+    if (fd < 0)
+        return EBADF;
+    append_file_action(actions, Syscall::SpawnFileActionType::Close, fd);
     return 0;
 }
 
 int posix_spawn_file_actions_adddup2(posix_spawn_file_actions_t* actions, int old_fd, int new_fd)
 {
-    actions->state->actions.append([old_fd, new_fd]() { return dup2(old_fd, new_fd); });
+    if (old_fd < 0 || new_fd < 0)
+        return EBADF;
+    append_file_action(actions, Syscall::SpawnFileActionType::Dup2, old_fd, new_fd);
     return 0;
 }
 
 int posix_spawn_file_actions_addopen(posix_spawn_file_actions_t* actions, int want_fd, const char* path, int flags, mode_t mode)
 {
-    actions->state->actions.append([want_fd, path, flags, mode]() {
-        int opened_fd = open(path, flags, mode);
-        if (opened_fd < 0 || opened_fd == want_fd)
-            return opened_fd;
-        if (int rc = dup2(opened_fd, want_fd); rc < 0)
-            return rc;
-        return close(opened_fd);
-    });
+    if (want_fd < 0)
+        return EBADF;
+    append_file_action(actions, Syscall::SpawnFileActionType::Open, want_fd, -1, flags, mode, path);
     return 0;
 }
 
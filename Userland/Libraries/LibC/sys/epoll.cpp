@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2021, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <errno.h>
+#include <sys/epoll.h>
+#include <sys/time.h>
+#include <syscall.h>
+
+extern "C" {
+
+int epoll_create(int size)
+{
+    // The size hint has been meaningless ever since epoll sets could grow dynamically.
+    if (size <= 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    return epoll_create1(0);
+}
+
+int epoll_create1(int flags)
+{
+    int rc = syscall(SC_epoll_create1, flags);
+    __RETURN_WITH_ERRNO(rc, rc, -1);
+}
+
+int epoll_ctl(int epfd, int op, int fd, epoll_event* event)
+{
+    Syscall::SC_epoll_ctl_params params { epfd, op, fd, event };
+    int rc = syscall(SC_epoll_ctl, &params);
+    __RETURN_WITH_ERRNO(rc, rc, -1);
+}
+
+int epoll_wait(int epfd, epoll_event* events, int max_events, int timeout_ms)
+{
+    timespec timeout;
+    timespec* timeout_ts = &timeout;
+    if (timeout_ms < 0)
+        timeout_ts = nullptr;
+    else
+        timeout = { timeout_ms / 1000, (timeout_ms % 1000) * 1'000'000 };
+    Syscall::SC_epoll_wait_params params { epfd, events, max_events, timeout_ts };
+    int rc = syscall(SC_epoll_wait, &params);
+    __RETURN_WITH_ERRNO(rc, rc, -1);
+}
+}
@@ -94,7 +94,7 @@ typedef struct __pthread_mutexattr_t {
 
 typedef struct __pthread_cond_t {
     uint32_t value;
-    uint32_t previous;
+    uint32_t waiters;
     int clockid; // clockid_t
 } pthread_cond_t;
 
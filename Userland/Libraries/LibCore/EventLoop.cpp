@@ -55,6 +55,10 @@
 #include <time.h>
 #include <unistd.h>
 
+#ifdef __serenity__
+#    include <sys/epoll.h>
+#endif
+
 namespace Core {
 
 class RPCClient;
@@ -79,7 +83,13 @@ static EventLoop* s_main_event_loop;
 static Vector<EventLoop*>* s_event_loop_stack;
 static NeverDestroyed<IDAllocator> s_id_allocator;
 static HashMap<int, NonnullOwnPtr<EventLoopTimer>>* s_timers;
-static HashTable<Notifier*>* s_notifiers;
+// Notifiers grouped by file descriptor, since several of them may watch the same one.
+static HashMap<int, Vector<Notifier*, 1>>* s_notifiers;
+#ifdef __serenity__
+// Instead of handing every notifier to select() each time we wait, we keep a
+// persistent epoll interest set that mirrors s_notifiers.
+static int s_epoll_fd = -1;
+#endif
 int EventLoop::s_wake_pipe_fds[2];
 static RefPtr<LocalServer> s_rpc_server;
 HashMap<int, RefPtr<RPCClient>> s_rpc_clients;
@@ -282,7 +292,7 @@ EventLoop::EventLoop()
     if (!s_event_loop_stack) {
         s_event_loop_stack = new Vector<EventLoop*>;
         s_timers = new HashMap<int, NonnullOwnPtr<EventLoopTimer>>;
-        s_notifiers = new HashTable<Notifier*>;
+        s_notifiers = new HashMap<int, Vector<Notifier*, 1>>;
     }
 
     if (!s_main_event_loop) {
@@ -299,6 +309,19 @@ EventLoop::EventLoop()
         VERIFY(rc == 0);
         s_event_loop_stack->append(this);
 
+#ifdef __serenity__
+        s_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        VERIFY(s_epoll_fd >= 0);
+        epoll_event wake_event {};
+        wake_event.events = EPOLLIN;
+        wake_event.data.fd = s_wake_pipe_fds[0];
+        rc = epoll_ctl(s_epoll_fd, EPOLL_CTL_ADD, s_wake_pipe_fds[0], &wake_event);
+        VERIFY(rc == 0);
+        // Notifiers may have been registered before the main event loop was created.
+        for (auto& it : *s_notifiers)
+            update_epoll_interest(it.key);
+#endif
+
 #ifdef __serenity__
         if (!s_rpc_server) {
             if (!start_rpc_server())
@@ -343,6 +366,11 @@ EventLoop& EventLoop::current()
     return *event_loop;
 }
 
+bool EventLoop::has_current()
+{
+    return s_event_loop_stack && !s_event_loop_stack->is_empty();
+}
+
 void EventLoop::quit(int code)
 {
 #if EVENTLOOP_DEBUG
@@ -600,6 +628,13 @@ void EventLoop::notify_forked(ForkEvent event)
         s_event_loop_stack->clear();
         s_timers->clear();
         s_notifiers->clear();
+#ifdef __serenity__
+        // The epoll instance is shared with our parent, so we have to get our own.
+        if (s_epoll_fd >= 0) {
+            close(s_epoll_fd);
+            s_epoll_fd = -1;
+        }
+#endif
         if (auto* info = signals_info<false>()) {
             info->signal_handlers.clear();
             info->next_signal_id = 0;
@@ -617,9 +652,14 @@ void EventLoop::notify_forked(ForkEvent event)
 
 void EventLoop::wait_for_event(WaitMode mode)
 {
+#ifdef __serenity__
+    epoll_event ready_events[64];
+#else
     fd_set rfds;
     fd_set wfds;
+#endif
 retry:
+#ifndef __serenity__
     FD_ZERO(&rfds);
     FD_ZERO(&wfds);
 
@@ -633,14 +673,17 @@ retry:
     int max_fd_added = -1;
     add_fd_to_set(s_wake_pipe_fds[0], rfds);
     max_fd = max(max_fd, max_fd_added);
-    for (auto& notifier : *s_notifiers) {
-        if (notifier->event_mask() & Notifier::Read)
-            add_fd_to_set(notifier->fd(), rfds);
-        if (notifier->event_mask() & Notifier::Write)
-            add_fd_to_set(notifier->fd(), wfds);
-        if (notifier->event_mask() & Notifier::Exceptional)
-            VERIFY_NOT_REACHED();
+    for (auto& it : *s_notifiers) {
+        for (auto* notifier : it.value) {
+            if (notifier->event_mask() & Notifier::Read)
+                add_fd_to_set(notifier->fd(), rfds);
+            if (notifier->event_mask() & Notifier::Write)
+                add_fd_to_set(notifier->fd(), wfds);
+            if (notifier->event_mask() & Notifier::Exceptional)
+                VERIFY_NOT_REACHED();
+        }
     }
+#endif
 
     bool queued_events_is_empty;
     {
@@ -669,7 +712,13 @@ retry:
     }
 
 try_select_again:
+#ifdef __serenity__
+    // Round up, so we don't wake up just before the next timer is due and spin.
+    int timeout_ms = should_wait_forever ? -1 : timeout.tv_sec * 1000 + (timeout.tv_usec + 999) / 1000;
+    int marked_fd_count = epoll_wait(s_epoll_fd, ready_events, array_size(ready_events), timeout_ms);
+#else
     int marked_fd_count = select(max_fd + 1, &rfds, &wfds, nullptr, should_wait_forever ? nullptr : &timeout);
+#endif
     if (marked_fd_count < 0) {
         int saved_errno = errno;
         if (saved_errno == EINTR) {
@@ -683,7 +732,17 @@ try_select_again:
         // Blow up, similar to Core::safe_syscall.
         VERIFY_NOT_REACHED();
     }
-    if (FD_ISSET(s_wake_pipe_fds[0], &rfds)) {
+
+#ifdef __serenity__
+    bool wake_pipe_is_readable = false;
+    for (int i = 0; i < marked_fd_count; ++i) {
+        if (ready_events[i].data.fd == s_wake_pipe_fds[0])
+            wake_pipe_is_readable = true;
+    }
+#else
+    bool wake_pipe_is_readable = FD_ISSET(s_wake_pipe_fds[0], &rfds);
+#endif
+    if (wake_pipe_is_readable) {
         int wake_events[8];
         auto nread = read(s_wake_pipe_fds[0], wake_events, sizeof(wake_events));
         if (nread < 0) {
@@ -736,16 +795,33 @@ try_select_again:
     if (!marked_fd_count)
         return;
 
-    for (auto& notifier : *s_notifiers) {
-        if (FD_ISSET(notifier->fd(), &rfds)) {
-            if (notifier->event_mask() & Notifier::Event::Read)
+#ifdef __serenity__
+    for (int i = 0; i < marked_fd_count; ++i) {
+        auto& ready_event = ready_events[i];
+        auto it = s_notifiers->find(ready_event.data.fd);
+        if (it == s_notifiers->end())
+            continue;
+        for (auto* notifier : it->value) {
+            if ((ready_event.events & EPOLLIN) && (notifier->event_mask() & Notifier::Event::Read))
                 post_event(*notifier, make<NotifierReadEvent>(notifier->fd()));
-        }
-        if (FD_ISSET(notifier->fd(), &wfds)) {
-            if (notifier->event_mask() & Notifier::Event::Write)
+            if ((ready_event.events & EPOLLOUT) && (notifier->event_mask() & Notifier::Event::Write))
                 post_event(*notifier, make<NotifierWriteEvent>(notifier->fd()));
         }
     }
+#else
+    for (auto& it : *s_notifiers) {
+        for (auto* notifier : it.value) {
+            if (FD_ISSET(notifier->fd(), &rfds)) {
+                if (notifier->event_mask() & Notifier::Event::Read)
+                    post_event(*notifier, make<NotifierReadEvent>(notifier->fd()));
+            }
+            if (FD_ISSET(notifier->fd(), &wfds)) {
+                if (notifier->event_mask() & Notifier::Event::Write)
+                    post_event(*notifier, make<NotifierWriteEvent>(notifier->fd()));
+            }
+        }
+    }
+#endif
 }
 
 bool EventLoopTimer::has_expired(const timeval& now) const
@@ -806,14 +882,64 @@ bool EventLoop::unregister_timer(int timer_id)
     return true;
 }
 
+void EventLoop::update_epoll_interest([[maybe_unused]] int fd)
+{
+#ifdef __serenity__
+    if (s_epoll_fd < 0)
+        return;
+
+    unsigned event_mask = 0;
+    if (auto it = s_notifiers->find(fd); it != s_notifiers->end()) {
+        for (auto* notifier : it->value)
+            event_mask |= notifier->event_mask();
+    }
+    VERIFY(!(event_mask & Notifier::Exceptional));
+
+    epoll_event event {};
+    event.data.fd = fd;
+    if (event_mask & Notifier::Read)
+        event.events |= EPOLLIN;
+    if (event_mask & Notifier::Write)
+        event.events |= EPOLLOUT;
+
+    if (!event.events) {
+        // NOTE: If the fd was closed before its notifiers went away, this fails with EBADF. The kernel
+        //       drops the interest by itself once the last fd referring to the file is closed.
+        epoll_ctl(s_epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+        return;
+    }
+    if (epoll_ctl(s_epoll_fd, EPOLL_CTL_MOD, fd, &event) < 0 && errno == ENOENT) {
+        if (epoll_ctl(s_epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0)
+            perror("EventLoop: epoll_ctl");
+    }
+#endif
+}
+
 void EventLoop::register_notifier(Badge<Notifier>, Notifier& notifier)
 {
-    s_notifiers->set(&notifier);
+    auto& notifiers = s_notifiers->ensure(notifier.fd());
+    if (!notifiers.contains_slow(&notifier))
+        notifiers.append(&notifier);
+    update_epoll_interest(notifier.fd());
 }
 
 void EventLoop::unregister_notifier(Badge<Notifier>, Notifier& notifier)
 {
-    s_notifiers->remove(&notifier);
+    auto it = s_notifiers->find(notifier.fd());
+    if (it == s_notifiers->end())
+        return;
+    it->value.remove_first_matching([&](auto* entry) { return entry == &notifier; });
+    if (it->value.is_empty())
+        s_notifiers->remove(it);
+    update_epoll_interest(notifier.fd());
+}
+
+void EventLoop::did_change_notifier_event_mask(Badge<Notifier>, Notifier& notifier)
+{
+    auto it = s_notifiers->find(notifier.fd());
+    if (it == s_notifiers->end() || !it->value.contains_slow(&notifier))
+        return;
+    update_epoll_interest(notifier.fd());
 }
 
 void EventLoop::wake()
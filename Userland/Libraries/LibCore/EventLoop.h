@@ -59,6 +59,7 @@ public:
 
     static EventLoop& main();
     static EventLoop& current();
+    static bool has_current();
 
     bool was_exit_requested() const { return m_exit_requested; }
 
@@ -67,6 +68,7 @@ public:
 
     static void register_notifier(Badge<Notifier>, Notifier&);
     static void unregister_notifier(Badge<Notifier>, Notifier&);
+    static void did_change_notifier_event_mask(Badge<Notifier>, Notifier&);
 
     void quit(int);
     void unquit();
@@ -93,6 +95,7 @@ private:
     void wait_for_event(WaitMode);
     Optional<struct timeval> get_next_timer_expiration();
     static void dispatch_signal(int);
+    static void update_epoll_interest(int fd);
     static void handle_signal(int);
 
     struct QueuedEvent {
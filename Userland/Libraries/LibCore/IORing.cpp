@@ -0,0 +1,219 @@
+/*
+ * Copyright (c) 2021, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <AK/Atomic.h>
+#include <LibCore/EventLoop.h>
+#include <LibCore/IORing.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#if defined(__serenity__)
+#    include <serenity.h>
+#endif
+
+namespace Core {
+
+// Only supported in serenity mode because we use `io_ring_create`
+#ifdef __serenity__
+
+IORing::IORing(unsigned entries, Object* parent)
+    : Object(parent)
+{
+    size_t mapping_size = 0;
+    m_fd = io_ring_create(entries, &mapping_size);
+    if (m_fd < 0) {
+        perror("io_ring_create");
+        return;
+    }
+
+    auto* data = mmap(nullptr, mapping_size, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+    if (data == MAP_FAILED) {
+        perror("mmap");
+        close(m_fd);
+        m_fd = -1;
+        return;
+    }
+
+    m_header = reinterpret_cast<IORingHeader*>(data);
+    m_submissions = reinterpret_cast<IORingSubmission*>(reinterpret_cast<u8*>(data) + m_header->sq_offset);
+    m_completions = reinterpret_cast<IORingCompletion*>(reinterpret_cast<u8*>(data) + m_header->cq_offset);
+    m_sq_tail = m_header->sq_tail;
+    m_cq_head = m_header->cq_head;
+
+    if (!EventLoop::has_current())
+        return;
+    m_notifier = Notifier::construct(m_fd, Notifier::Read, this);
+    m_notifier->on_ready_to_read = [this] {
+        flush();
+    };
+}
+
+IORing::~IORing()
+{
+    if (m_notifier)
+        m_notifier->on_ready_to_read = nullptr;
+    if (m_header)
+        munmap(m_header, m_header->size);
+    if (m_fd >= 0)
+        close(m_fd);
+}
+
+unsigned IORing::pending_submissions() const
+{
+    return m_sq_tail - AK::atomic_load(&m_header->sq_head, AK::memory_order_acquire);
+}
+
+void IORing::make_room_for_submission()
+{
+    while (pending_submissions() == m_header->sq_entries) {
+        // Don't wait for the end of this event loop iteration, the kernel needs to consume
+        // some submissions first. If it can't take any because every completion slot is
+        // spoken for, wait for something to complete.
+        unsigned pending_before = pending_submissions();
+        if (!enter(0))
+            return;
+        if (pending_submissions() == pending_before && !enter(1))
+            return;
+    }
+}
+
+void IORing::submit(IORingSubmission& submission, Callback callback)
+{
+    if (!is_valid()) {
+        if (callback)
+            callback(-EBADF);
+        return;
+    }
+
+    make_room_for_submission();
+
+    submission.user_data = m_next_user_data++;
+    m_callbacks.set(submission.user_data, move(callback));
+    m_submissions[m_sq_tail & (m_header->sq_entries - 1)] = submission;
+    ++m_sq_tail;
+    AK::atomic_store(&m_header->sq_tail, m_sq_tail, AK::memory_order_release);
+
+    if (m_flush_scheduled || !m_notifier)
+        return;
+    m_flush_scheduled = true;
+    deferred_invoke([this](auto&) {
+        flush();
+    });
+}
+
+void IORing::submit_read(int fd, void* buffer, size_t size, Callback callback, i64 offset)
+{
+    IORingSubmission submission;
+    submission.opcode = IO_RING_OP_READ;
+    submission.fd = fd;
+    submission.offset = offset;
+    submission.address = reinterpret_cast<FlatPtr>(buffer);
+    submission.length = size;
+    submit(submission, move(callback));
+}
+
+void IORing::submit_write(int fd, const void* buffer, size_t size, Callback callback, i64 offset)
+{
+    IORingSubmission submission;
+    submission.opcode = IO_RING_OP_WRITE;
+    submission.fd = fd;
+    submission.offset = offset;
+    submission.address = reinterpret_cast<FlatPtr>(buffer);
+    submission.length = size;
+    submit(submission, move(callback));
+}
+
+void IORing::submit_accept(int fd, Callback callback)
+{
+    IORingSubmission submission;
+    submission.opcode = IO_RING_OP_ACCEPT;
+    submission.fd = fd;
+    submit(submission, move(callback));
+}
+
+void IORing::submit_fsync(int fd, Callback callback)
+{
+    IORingSubmission submission;
+    submission.opcode = IO_RING_OP_FSYNC;
+    submission.fd = fd;
+    submit(submission, move(callback));
+}
+
+void IORing::submit_nop(Callback callback)
+{
+    IORingSubmission submission;
+    submission.opcode = IO_RING_OP_NOP;
+    submit(submission, move(callback));
+}
+
+bool IORing::enter(unsigned min_complete)
+{
+    if (io_ring_enter(m_fd, pending_submissions(), min_complete) < 0 && errno != EINTR) {
+        perror("io_ring_enter");
+        return false;
+    }
+    reap_completions();
+    return true;
+}
+
+void IORing::flush()
+{
+    m_flush_scheduled = false;
+    if (is_valid())
+        enter(0);
+}
+
+bool IORing::wait(unsigned min_complete)
+{
+    m_flush_scheduled = false;
+    if (!is_valid())
+        return false;
+    return enter(min(min_complete, static_cast<unsigned>(m_callbacks.size())));
+}
+
+void IORing::reap_completions()
+{
+    // NOTE: Callbacks may submit more work and even reap completions themselves,
+    //       so consume each completion before invoking its callback.
+    while (m_cq_head != AK::atomic_load(&m_header->cq_tail, AK::memory_order_acquire)) {
+        auto completion = m_completions[m_cq_head & (m_header->cq_entries - 1)];
+        ++m_cq_head;
+        AK::atomic_store(&m_header->cq_head, m_cq_head, AK::memory_order_release);
+
+        auto it = m_callbacks.find(completion.user_data);
+        if (it == m_callbacks.end())
+            continue;
+        auto callback = move(it->value);
+        m_callbacks.remove(it);
+        if (callback)
+            callback(completion.result);
+    }
+}
+
+#endif
+
+}
@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2021, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <AK/Function.h>
+#include <AK/HashMap.h>
+#include <Kernel/API/IORing.h>
+#include <LibCore/Notifier.h>
+#include <LibCore/Object.h>
+
+namespace Core {
+
+// IORing batches I/O through a kernel submission/completion ring (see io_ring_create()).
+//
+// Submissions are queued in shared memory and handed to the kernel all at once,
+// at the end of the current event loop iteration, with a single io_ring_enter().
+// Completion callbacks are invoked from the event loop when the ring signals that
+// completions are available.
+//
+// An IORing created without an event loop only talks to the kernel when asked to,
+// so submissions are handed over and callbacks invoked from flush() and wait().
+class IORing final : public Object {
+    C_OBJECT(IORing)
+public:
+    using Callback = Function<void(int result)>;
+
+    virtual ~IORing() override;
+
+    bool is_valid() const { return m_header; }
+    int fd() const { return m_fd; }
+    size_t in_flight() const { return m_callbacks.size(); }
+
+    // Callbacks receive what the equivalent system call would return, or a negated errno.
+    // An offset of -1 reads or writes at (and advances) the file's current offset.
+    void submit_read(int fd, void* buffer, size_t, Callback, i64 offset = -1);
+    void submit_write(int fd, const void* buffer, size_t, Callback, i64 offset = -1);
+    void submit_accept(int fd, Callback);
+    void submit_fsync(int fd, Callback);
+    void submit_nop(Callback);
+
+    // Hands all queued submissions to the kernel and invokes the callbacks of everything that has completed.
+    void flush();
+
+    // Like flush(), but blocks until at least min_complete operations have completed.
+    bool wait(unsigned min_complete = 1);
+
+private:
+    explicit IORing(unsigned entries = 256, Object* parent = nullptr);
+
+    void submit(IORingSubmission&, Callback);
+    void make_room_for_submission();
+    unsigned pending_submissions() const;
+    bool enter(unsigned min_complete);
+    void reap_completions();
+
+    int m_fd { -1 };
+    IORingHeader* m_header { nullptr };
+    IORingSubmission* m_submissions { nullptr };
+    IORingCompletion* m_completions { nullptr };
+    u32 m_sq_tail { 0 };
+    u32 m_cq_head { 0 };
+    u64 m_next_user_data { 1 };
+    bool m_flush_scheduled { false };
+    HashMap<u64, Callback> m_callbacks;
+    RefPtr<Notifier> m_notifier;
+};
+
+}
@@ -24,40 +24,195 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
-#include <AK/ByteBuffer.h>
-#include <AK/JsonArray.h>
-#include <AK/JsonObject.h>
-#include <AK/JsonValue.h>
-#include <LibCore/File.h>
+#include <AK/Optional.h>
+#include <AK/ScopeGuard.h>
 #include <LibCore/ProcessStatisticsReader.h>
+#include <errno.h>
 #include <pwd.h>
 #include <stdio.h>
+#include <string.h>
+
+#if defined(__serenity__)
+#    include <Kernel/API/ProcessStatistics.h>
+#    include <serenity.h>
+#else
+#    include <AK/JsonArray.h>
+#    include <AK/JsonObject.h>
+#    include <AK/JsonValue.h>
+#    include <LibCore/File.h>
+#endif
 
 namespace Core {
 
 HashMap<uid_t, String> ProcessStatisticsReader::s_usernames;
 
-Optional<HashMap<pid_t, Core::ProcessStatistics>> ProcessStatisticsReader::get_all(RefPtr<Core::File>& proc_all_file)
+// get_process_statistics() only exists on Serenity, elsewhere we read a full snapshot from /proc/all.
+#if defined(__serenity__)
+
+static constexpr size_t initial_buffer_size = 64 * KiB;
+
+template<typename T>
+static Optional<T> read_record(ReadonlyBytes bytes, size_t& offset)
+{
+    if (bytes.size() - offset < sizeof(T))
+        return {};
+    T record;
+    memcpy(&record, bytes.offset_pointer(offset), sizeof(T));
+    offset += sizeof(T);
+    return record;
+}
+
+template<size_t size>
+static String string_from_record(const char (&characters)[size])
+{
+    return String(characters, strnlen(characters, size));
+}
+
+bool ProcessStatisticsReader::update()
 {
-    if (proc_all_file) {
-        if (!proc_all_file->seek(0, Core::File::SeekMode::SetPosition)) {
-            fprintf(stderr, "ProcessStatisticsReader: Failed to refresh /proc/all: %s\n", proc_all_file->error_string());
-            return {};
+    if (m_buffer.is_empty())
+        m_buffer = ByteBuffer::create_uninitialized(initial_buffer_size);
+
+    u32 generation = 0;
+    ssize_t nread;
+    for (;;) {
+        nread = get_process_statistics(m_generation, m_buffer.data(), m_buffer.size(), &generation);
+        if (nread >= 0)
+            break;
+        if (errno != ENOSPC) {
+            perror("ProcessStatisticsReader: get_process_statistics");
+            return false;
+        }
+        m_buffer = ByteBuffer::create_uninitialized(m_buffer.size() * 2);
+    }
+
+    // Unchanged processes are moved out of m_processes as we go, so if we have to
+    // bail out halfway, forget what we had and ask for everything next time.
+    ArmedScopeGuard reset_on_failure([&] {
+        m_processes.clear();
+        m_generation = 0;
+    });
+
+    HashMap<pid_t, Core::ProcessStatistics> processes;
+    auto bytes = m_buffer.bytes().trim(nread);
+    size_t offset = 0;
+    while (offset < bytes.size()) {
+        ProcessStatisticsRecordType type;
+        if (bytes.size() - offset < sizeof(type))
+            return false;
+        memcpy(&type, bytes.offset_pointer(offset), sizeof(type));
+
+        if (type == ProcessStatisticsRecordType::UnchangedProcess) {
+            auto record = read_record<UnchangedProcessStatisticsRecord>(bytes, offset);
+            if (!record.has_value())
+                return false;
+            auto it = m_processes.find(record->pid);
+            if (it == m_processes.end()) {
+                // We can't describe a process we've never seen, so start over.
+                reset_on_failure.disarm();
+                m_processes.clear();
+                m_generation = 0;
+                return update();
+            }
+            processes.set(record->pid, move(it->value));
+            continue;
+        }
+
+        auto record = read_record<ProcessStatisticsRecord>(bytes, offset);
+        if (!record.has_value() || record->type != ProcessStatisticsRecordType::Process)
+            return false;
+
+        Core::ProcessStatistics process;
+
+        // kernel data first
+        process.pid = record->pid;
+        process.pgid = record->pgid;
+        process.pgp = record->pgp;
+        process.sid = record->sid;
+        process.uid = record->uid;
+        process.gid = record->gid;
+        process.ppid = record->ppid;
+        process.nfds = record->nfds;
+        process.kernel = record->kernel;
+        process.name = string_from_record(record->name);
+        process.executable = string_from_record(record->executable);
+        process.tty = string_from_record(record->tty);
+        if (!record->kernel) {
+            process.pledge = string_from_record(record->pledge);
+            switch (record->veil) {
+            case ProcessStatisticsVeilState::None:
+                process.veil = "None";
+                break;
+            case ProcessStatisticsVeilState::Dropped:
+                process.veil = "Dropped";
+                break;
+            case ProcessStatisticsVeilState::Locked:
+                process.veil = "Locked";
+                break;
+            }
         }
-    } else {
-        proc_all_file = Core::File::construct("/proc/all");
-        if (!proc_all_file->open(Core::IODevice::ReadOnly)) {
-            fprintf(stderr, "ProcessStatisticsReader: Failed to open /proc/all: %s\n", proc_all_file->error_string());
-            return {};
+        process.amount_virtual = record->amount_virtual;
+        process.amount_resident = record->amount_resident;
+        process.amount_shared = record->amount_shared;
+        process.amount_dirty_private = record->amount_dirty_private;
+        process.amount_clean_inode = record->amount_clean_inode;
+        process.amount_purgeable_volatile = record->amount_purgeable_volatile;
+        process.amount_purgeable_nonvolatile = record->amount_purgeable_nonvolatile;
+
+        process.threads.ensure_capacity(record->thread_count);
+        for (u32 i = 0; i < record->thread_count; ++i) {
+            auto thread_record = read_record<ThreadStatisticsRecord>(bytes, offset);
+            if (!thread_record.has_value() || thread_record->type != ProcessStatisticsRecordType::Thread)
+                return false;
+            Core::ThreadStatistics thread;
+            thread.tid = thread_record->tid;
+            thread.times_scheduled = thread_record->times_scheduled;
+            thread.name = string_from_record(thread_record->name);
+            thread.state = string_from_record(thread_record->state);
+            thread.ticks_user = thread_record->ticks_user;
+            thread.ticks_kernel = thread_record->ticks_kernel;
+            thread.cpu = thread_record->cpu;
+            thread.priority = thread_record->priority;
+            thread.syscall_count = thread_record->syscall_count;
+            thread.inode_faults = thread_record->inode_faults;
+            thread.zero_faults = thread_record->zero_faults;
+            thread.cow_faults = thread_record->cow_faults;
+            thread.unix_socket_read_bytes = thread_record->unix_socket_read_bytes;
+            thread.unix_socket_write_bytes = thread_record->unix_socket_write_bytes;
+            thread.ipv4_socket_read_bytes = thread_record->ipv4_socket_read_bytes;
+            thread.ipv4_socket_write_bytes = thread_record->ipv4_socket_write_bytes;
+            thread.file_read_bytes = thread_record->file_read_bytes;
+            thread.file_write_bytes = thread_record->file_write_bytes;
+            process.threads.append(move(thread));
         }
+
+        // and synthetic data last
+        process.username = username_from_uid(process.uid);
+        processes.set(process.pid, move(process));
     }
 
-    HashMap<pid_t, Core::ProcessStatistics> map;
+    reset_on_failure.disarm();
+    m_processes = move(processes);
+    m_generation = generation;
+    return true;
+}
+
+#else
+
+bool ProcessStatisticsReader::update()
+{
+    auto proc_all_file = Core::File::construct("/proc/all");
+    if (!proc_all_file->open(Core::IODevice::ReadOnly)) {
+        fprintf(stderr, "ProcessStatisticsReader: Failed to open /proc/all: %s\n", proc_all_file->error_string());
+        return false;
+    }
 
     auto file_contents = proc_all_file->read_all();
     auto json = JsonValue::from_string(file_contents);
-    if (!json.has_value())
-        return {};
+    if (!json.has_value() || !json.value().is_array())
+        return false;
+
+    HashMap<pid_t, Core::ProcessStatistics> processes;
     json.value().as_array().for_each([&](auto& value) {
         const JsonObject& process_object = value.as_object();
         Core::ProcessStatistics process;
@@ -113,16 +268,21 @@ Optional<HashMap<pid_t, Core::ProcessStatistics>> ProcessStatisticsReader::get_a
 
         // and synthetic data last
         process.username = username_from_uid(process.uid);
-        map.set(process.pid, process);
+        processes.set(process.pid, move(process));
     });
 
-    return map;
+    m_processes = move(processes);
+    return true;
 }
 
+#endif
+
 Optional<HashMap<pid_t, Core::ProcessStatistics>> ProcessStatisticsReader::get_all()
 {
-    RefPtr<Core::File> proc_all_file;
-    return get_all(proc_all_file);
+    ProcessStatisticsReader reader;
+    if (!reader.update())
+        return {};
+    return move(reader.m_processes);
 }
 
 String ProcessStatisticsReader::username_from_uid(uid_t uid)
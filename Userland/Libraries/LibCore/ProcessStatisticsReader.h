@@ -26,9 +26,9 @@
 
 #pragma once
 
+#include <AK/ByteBuffer.h>
 #include <AK/HashMap.h>
 #include <AK/String.h>
-#include <LibCore/File.h>
 #include <unistd.h>
 
 namespace Core {
@@ -55,7 +55,7 @@ struct ThreadStatistics {
 };
 
 struct ProcessStatistics {
-    // Keep this in sync with /proc/all.
+    // Keep this in sync with Kernel/API/ProcessStatistics.h.
     // From the kernel side:
     pid_t pid;
     pid_t pgid;
@@ -87,12 +87,20 @@ struct ProcessStatistics {
 
 class ProcessStatisticsReader {
 public:
-    static Optional<HashMap<pid_t, Core::ProcessStatistics>> get_all(RefPtr<Core::File>&);
     static Optional<HashMap<pid_t, Core::ProcessStatistics>> get_all();
 
+    // Refreshes processes(). Only the processes that changed since the
+    // previous update are fetched from the kernel, the rest are carried over.
+    bool update();
+    const HashMap<pid_t, Core::ProcessStatistics>& processes() const { return m_processes; }
+
 private:
     static String username_from_uid(uid_t);
     static HashMap<uid_t, String> s_usernames;
+
+    HashMap<pid_t, Core::ProcessStatistics> m_processes;
+    u32 m_generation { 0 };
+    ByteBuffer m_buffer;
 };
 
 }
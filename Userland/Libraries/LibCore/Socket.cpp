@@ -187,17 +187,29 @@ bool Socket::send(ReadonlyBytes data)
     return true;
 }
 
+bool Socket::close()
+{
+    // Unregister from the event loop while the fd is still open, so it can still be removed from the epoll set.
+    remove_notifiers();
+    return IODevice::close();
+}
+
+void Socket::remove_notifiers()
+{
+    if (m_read_notifier) {
+        m_read_notifier->remove_from_parent();
+        m_read_notifier = nullptr;
+    }
+    if (m_notifier) {
+        m_notifier->remove_from_parent();
+        m_notifier = nullptr;
+    }
+}
+
 void Socket::did_update_fd(int fd)
 {
     if (fd < 0) {
-        if (m_read_notifier) {
-            m_read_notifier->remove_from_parent();
-            m_read_notifier = nullptr;
-        }
-        if (m_notifier) {
-            m_notifier->remove_from_parent();
-            m_notifier = nullptr;
-        }
+        remove_notifiers();
         return;
     }
     if (m_connected) {
@@ -208,6 +220,12 @@ void Socket::did_update_fd(int fd)
     }
 }
 
+void Socket::set_read_notifications_enabled(bool enabled)
+{
+    if (m_read_notifier)
+        m_read_notifier->set_enabled(enabled);
+}
+
 void Socket::ensure_read_notifier()
 {
     VERIFY(m_connected);
@@ -56,6 +56,9 @@ public:
     bool is_connected() const { return m_connected; }
     void set_blocking(bool blocking);
 
+    // Stop (or resume) calling on_ready_to_read, e.g. to apply back-pressure to a peer.
+    void set_read_notifications_enabled(bool);
+
     SocketAddress source_address() const { return m_source_address; }
     int source_port() const { return m_source_port; }
 
@@ -79,7 +82,9 @@ protected:
 
 private:
     virtual bool open(IODevice::OpenMode) override { VERIFY_NOT_REACHED(); }
+    virtual bool close() override;
     void ensure_read_notifier();
+    void remove_notifiers();
 
     Type m_type { Type::Invalid };
     RefPtr<Notifier> m_notifier;
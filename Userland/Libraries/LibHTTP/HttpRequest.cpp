@@ -180,12 +180,36 @@ Optional<HttpRequest> HttpRequest::from_raw_request(ReadonlyBytes raw_request)
     else
         return {};
 
+    if (protocol == "HTTP/1.1")
+        request.m_version = Version::HTTP_1_1;
+    else if (protocol == "HTTP/1.0")
+        request.m_version = Version::HTTP_1_0;
+    else
+        return {};
+
     request.m_resource = resource;
     request.m_headers = move(headers);
 
     return request;
 }
 
+Optional<String> HttpRequest::header(const StringView& name) const
+{
+    for (auto& header : m_headers) {
+        if (header.name.equals_ignoring_case(name))
+            return header.value;
+    }
+    return {};
+}
+
+bool HttpRequest::wants_keep_alive() const
+{
+    auto connection = header("Connection");
+    if (m_version == Version::HTTP_1_0)
+        return connection.has_value() && connection->equals_ignoring_case("keep-alive");
+    return !connection.has_value() || !connection->equals_ignoring_case("close");
+}
+
 void HttpRequest::set_headers(const HashMap<String, String>& headers)
 {
     for (auto& it : headers)
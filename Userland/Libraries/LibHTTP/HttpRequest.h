@@ -44,6 +44,11 @@ public:
         POST
     };
 
+    enum class Version {
+        HTTP_1_0,
+        HTTP_1_1,
+    };
+
     struct Header {
         String name;
         String value;
@@ -58,6 +63,14 @@ public:
     const URL& url() const { return m_url; }
     void set_url(const URL& url) { m_url = url; }
 
+    Version version() const { return m_version; }
+
+    // Header names are case-insensitive, so this is what you want rather than iterating headers().
+    Optional<String> header(const StringView& name) const;
+
+    // HTTP/1.1 connections stay open by default, HTTP/1.0 ones only when asked to.
+    bool wants_keep_alive() const;
+
     Method method() const { return m_method; }
     void set_method(Method method) { m_method = method; }
 
@@ -76,6 +89,7 @@ private:
     URL m_url;
     String m_resource;
     Method m_method { GET };
+    Version m_version { Version::HTTP_1_1 };
     Vector<Header> m_headers;
     ByteBuffer m_body;
 };
@@ -35,10 +35,10 @@
 #include <LibCore/SyscallUtils.h>
 #include <LibCore/Timer.h>
 #include <LibIPC/Message.h>
+#include <poll.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include <sys/select.h>
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <unistd.h>
@@ -164,15 +164,15 @@ protected:
 
             if (!m_socket->is_open())
                 break;
-            fd_set rfds;
-            FD_ZERO(&rfds);
-            FD_SET(m_socket->fd(), &rfds);
-            int rc = Core::safe_syscall(select, m_socket->fd() + 1, &rfds, nullptr, nullptr, nullptr);
+            // NOTE: We only ever wait on a single fd here, so poll() saves us from building
+            //       an fd_set that has to span every fd number below ours.
+            pollfd pfd { m_socket->fd(), POLLIN, 0 };
+            int rc = Core::safe_syscall(poll, &pfd, 1, -1);
             if (rc < 0) {
-                perror("select");
+                perror("poll");
             }
             VERIFY(rc > 0);
-            VERIFY(FD_ISSET(m_socket->fd(), &rfds));
+            VERIFY(pfd.revents != 0);
             if (!drain_messages_from_peer())
                 break;
         }
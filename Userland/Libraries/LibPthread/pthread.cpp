@@ -187,18 +187,7 @@ int pthread_mutex_lock(pthread_mutex_t* mutex)
 
 int pthread_mutex_trylock(pthread_mutex_t* mutex)
 {
-    auto& atomic = reinterpret_cast<Atomic<u32>&>(mutex->lock);
-    u32 expected = false;
-    if (!atomic.compare_exchange_strong(expected, true, AK::memory_order_acq_rel)) {
-        if (mutex->type == PTHREAD_MUTEX_RECURSIVE && mutex->owner == pthread_self()) {
-            mutex->level++;
-            return 0;
-        }
-        return EBUSY;
-    }
-    mutex->owner = pthread_self();
-    mutex->level = 0;
-    return 0;
+    return __pthread_mutex_trylock(mutex);
 }
 
 int pthread_mutex_unlock(pthread_mutex_t* mutex)
@@ -449,7 +438,7 @@ int pthread_setschedparam([[maybe_unused]] pthread_t thread, [[maybe_unused]] in
 int pthread_cond_init(pthread_cond_t* cond, const pthread_condattr_t* attr)
 {
     cond->value = 0;
-    cond->previous = 0;
+    cond->waiters = 0;
     cond->clockid = attr ? attr->clockid : CLOCK_MONOTONIC_COARSE;
     return 0;
 }
@@ -459,11 +448,14 @@ int pthread_cond_destroy(pthread_cond_t*)
     return 0;
 }
 
-static int futex_wait(uint32_t& futex_addr, uint32_t value, const struct timespec* abstime)
+static int futex_wait(uint32_t& futex_addr, uint32_t value, const struct timespec* abstime, int clockid)
 {
     int saved_errno = errno;
     // NOTE: FUTEX_WAIT takes a relative timeout, so use FUTEX_WAIT_BITSET instead!
-    int rc = futex(&futex_addr, FUTEX_WAIT_BITSET, value, abstime, nullptr, FUTEX_BITSET_MATCH_ANY);
+    int op = FUTEX_WAIT_BITSET | FUTEX_PRIVATE_FLAG;
+    if (clockid == CLOCK_REALTIME || clockid == CLOCK_REALTIME_COARSE)
+        op |= FUTEX_CLOCK_REALTIME;
+    int rc = futex(&futex_addr, op, value, abstime, nullptr, FUTEX_BITSET_MATCH_ANY);
     if (rc < 0 && errno == EAGAIN) {
         // If we didn't wait, that's not an error
         errno = saved_errno;
@@ -474,10 +466,14 @@ static int futex_wait(uint32_t& futex_addr, uint32_t value, const struct timespe
 
 static int cond_wait(pthread_cond_t* cond, pthread_mutex_t* mutex, const struct timespec* abstime)
 {
-    u32 value = cond->value;
-    cond->previous = value;
+    // We register as a waiter and sample the sequence number while still holding
+    // the mutex. A signal that comes in between unlocking the mutex and going to
+    // sleep bumps the sequence number, which makes the futex wait return at once.
+    AK::atomic_fetch_add(&cond->waiters, 1u);
+    u32 value = AK::atomic_load(&cond->value);
     pthread_mutex_unlock(mutex);
-    int rc = futex_wait(cond->value, value, abstime);
+    int rc = futex_wait(cond->value, value, abstime, cond->clockid);
+    AK::atomic_fetch_sub(&cond->waiters, 1u);
     pthread_mutex_lock(mutex);
     return rc;
 }
@@ -513,18 +509,21 @@ int pthread_cond_timedwait(pthread_cond_t* cond, pthread_mutex_t* mutex, const s
 
 int pthread_cond_signal(pthread_cond_t* cond)
 {
-    u32 value = cond->previous + 1;
-    cond->value = value;
-    int rc = futex(&cond->value, FUTEX_WAKE, 1, nullptr, nullptr, 0);
+    AK::atomic_fetch_add(&cond->value, 1u);
+    // Nobody is waiting, so there's nobody to wake up. No need for a syscall.
+    if (AK::atomic_load(&cond->waiters) == 0)
+        return 0;
+    int rc = futex(&cond->value, FUTEX_WAKE | FUTEX_PRIVATE_FLAG, 1, nullptr, nullptr, 0);
     VERIFY(rc >= 0);
     return 0;
 }
 
 int pthread_cond_broadcast(pthread_cond_t* cond)
 {
-    u32 value = cond->previous + 1;
-    cond->value = value;
-    int rc = futex(&cond->value, FUTEX_WAKE, INT32_MAX, nullptr, nullptr, 0);
+    AK::atomic_fetch_add(&cond->value, 1u);
+    if (AK::atomic_load(&cond->waiters) == 0)
+        return 0;
+    int rc = futex(&cond->value, FUTEX_WAKE | FUTEX_PRIVATE_FLAG, INT32_MAX, nullptr, nullptr, 0);
     VERIFY(rc >= 0);
     return 0;
 }
@@ -648,8 +647,6 @@ int pthread_equal(pthread_t t1, pthread_t t2)
     return t1 == t2;
 }
 
-// FIXME: Use the fancy futex mechanism above to write an rw lock.
-//        For the time being, let's just use a less-than-good lock to get things working.
 int pthread_rwlock_destroy(pthread_rwlock_t* rl)
 {
     if (!rl)
@@ -657,18 +654,44 @@ int pthread_rwlock_destroy(pthread_rwlock_t* rl)
     return 0;
 }
 
-// In a very non-straightforward way, this value is composed of two 32-bit integers
-// the top 32 bits are reserved for the ID of write-locking thread (if any)
-// and the bottom 32 bits are:
-//     top 2 bits (30,31): reader wake mask, writer wake mask
-//     middle 16 bits: information
-//        bit 16: someone is waiting to write
-//        bit 17: locked for write
-//     bottom 16 bits (0..15): reader count
-constexpr static u32 reader_wake_mask = 1 << 30;
-constexpr static u32 writer_wake_mask = 1 << 31;
-constexpr static u32 writer_locked_mask = 1 << 17;
-constexpr static u32 writer_intent_mask = 1 << 16;
+// The 64-bit rwlock value is composed of two 32-bit integers.
+// The top 32 bits hold the ID of the write-locking thread (if any),
+// the bottom 32 bits are the futex word:
+//     bit 31: locked for write
+//     bit 30: there are readers sleeping on the futex
+//     bit 29: there are writers sleeping on the futex
+//     bits 0..28: reader count
+// As long as neither of the waiter bits are set, locking and unlocking never
+// has to enter the kernel. New readers don't join in while a writer waits,
+// so a steady stream of readers can't starve writers. Threads that already
+// hold a read lock are the exception, a recursive pthread_rwlock_rdlock()
+// would otherwise deadlock against the waiting writer.
+constexpr static u32 writer_locked_mask = 1u << 31;
+constexpr static u32 readers_waiting_mask = 1u << 30;
+constexpr static u32 writers_waiting_mask = 1u << 29;
+constexpr static u32 reader_count_mask = writers_waiting_mask - 1;
+constexpr static u32 reader_wake_bitset = 1u << 0;
+constexpr static u32 writer_wake_bitset = 1u << 1;
+constexpr static size_t rwlock_spin_count = 100;
+
+// Each thread remembers which rwlocks it holds for reading. Once it holds more
+// than we keep track of, it is let in on every rwlock regardless of waiting
+// writers, which is less fair but never deadlocks.
+struct HeldReadLock {
+    pthread_rwlock_t* lock;
+    size_t count;
+};
+constexpr static size_t max_tracked_read_locks = 8;
+static __thread HeldReadLock t_held_read_locks[max_tracked_read_locks];
+static __thread size_t t_untracked_read_locks;
+
+ALWAYS_INLINE static void spin_loop_hint()
+{
+#if ARCH(I386) || ARCH(X86_64)
+    asm volatile("pause");
+#endif
+}
+
 int pthread_rwlock_init(pthread_rwlock_t* __restrict lockp, const pthread_rwlockattr_t* __restrict attr)
 {
     // Just ignore the attributes. use defaults for now.
@@ -679,100 +702,155 @@ int pthread_rwlock_init(pthread_rwlock_t* __restrict lockp, const pthread_rwlock
     return 0;
 }
 
-// Note that this function does not care about the top 32 bits at all.
-static int rwlock_rdlock_maybe_timed(u32* lockp, const struct timespec* timeout = nullptr, bool only_once = false, int value_if_timeout = -1, int value_if_okay = -2)
-{
-    auto current = AK::atomic_load(lockp);
-    for (; !only_once;) {
-        // First, see if this is locked for writing
-        // if it's not, try to add to the counter.
-        // If someone is waiting to write, and there is one or no other readers, let them have the lock.
-        if (!(current & writer_locked_mask)) {
-            auto count = (u16)current;
-            if (!(current & writer_intent_mask) || count > 1) {
-                ++count;
-                auto desired = (current << 16) | count;
-                auto did_exchange = AK::atomic_compare_exchange_strong(lockp, current, desired, AK::MemoryOrder::memory_order_acquire);
-                if (!did_exchange)
-                    continue; // tough luck, try again.
-                return value_if_okay;
-            }
-        }
+static u32* rwlock_futex_word(pthread_rwlock_t* lockval_p)
+{
+    return reinterpret_cast<u32*>(lockval_p);
+}
+
+static i32* rwlock_writer_id(pthread_rwlock_t* lockval_p)
+{
+    return reinterpret_cast<i32*>(lockval_p) + 1;
+}
 
-        // If no one else is waiting for the read wake bit, set it.
-        if (!(current & reader_wake_mask)) {
-            auto desired = current | reader_wake_mask;
-            auto did_exchange = AK::atomic_compare_exchange_strong(lockp, current, desired, AK::MemoryOrder::memory_order_acquire);
-            if (!did_exchange)
-                continue; // Something interesting happened!
+static bool rwlock_is_read_locked_by_current_thread(pthread_rwlock_t* lockval_p)
+{
+    if (t_untracked_read_locks)
+        return true;
+    for (auto& held : t_held_read_locks) {
+        if (held.lock == lockval_p)
+            return true;
+    }
+    return false;
+}
 
-            current = desired;
+static void rwlock_did_read_lock(pthread_rwlock_t* lockval_p)
+{
+    HeldReadLock* free_slot = nullptr;
+    for (auto& held : t_held_read_locks) {
+        if (held.lock == lockval_p) {
+            ++held.count;
+            return;
         }
+        if (!held.lock && !free_slot)
+            free_slot = &held;
+    }
+    if (!free_slot) {
+        ++t_untracked_read_locks;
+        return;
+    }
+    free_slot->lock = lockval_p;
+    free_slot->count = 1;
+}
 
-        // Seems like someone is writing (or is interested in writing and we let them have the lock)
-        // wait until they're done.
-        auto rc = futex(lockp, FUTEX_WAIT_BITSET, current, timeout, nullptr, reader_wake_mask);
-        if (rc < 0 && errno == ETIMEDOUT && timeout) {
-            return value_if_timeout;
-        }
-        if (rc < 0 && errno != EAGAIN) {
-            // Something broke. let's just bail out.
-            return errno;
+static void rwlock_did_read_unlock(pthread_rwlock_t* lockval_p)
+{
+    for (auto& held : t_held_read_locks) {
+        if (held.lock == lockval_p) {
+            if (--held.count == 0)
+                held.lock = nullptr;
+            return;
         }
-        errno = 0;
-        // Reload the 'current' value
-        current = AK::atomic_load(lockp);
     }
-    return value_if_timeout;
-}
-
-static int rwlock_wrlock_maybe_timed(pthread_rwlock_t* lockval_p, const struct timespec* timeout = nullptr, bool only_once = false, int value_if_timeout = -1, int value_if_okay = -2)
-{
-    u32* lockp = reinterpret_cast<u32*>(lockval_p);
-    auto current = AK::atomic_load(lockp);
-    for (; !only_once;) {
-        // First, see if this is locked for writing, and if there are any readers.
-        // if not, lock it.
-        // If someone is waiting to write, let them have the lock.
-        if (!(current & writer_locked_mask) && ((u16)current) == 0) {
-            if (!(current & writer_intent_mask)) {
-                auto desired = current | writer_locked_mask | writer_intent_mask;
-                auto did_exchange = AK::atomic_compare_exchange_strong(lockp, current, desired, AK::MemoryOrder::memory_order_acquire);
-                if (!did_exchange)
-                    continue;
-
-                // Now that we've locked the value, it's safe to set our thread ID.
-                AK::atomic_store(reinterpret_cast<i32*>(lockval_p) + 1, pthread_self());
-                return value_if_okay;
+    if (t_untracked_read_locks)
+        --t_untracked_read_locks;
+}
+
+static void rwlock_wake_waiters(u32* lockp, u32 previous_value)
+{
+    u32 bitset = 0;
+    if (previous_value & readers_waiting_mask)
+        bitset |= reader_wake_bitset;
+    if (previous_value & writers_waiting_mask)
+        bitset |= writer_wake_bitset;
+    if (bitset)
+        futex(lockp, FUTEX_WAKE_BITSET | FUTEX_PRIVATE_FLAG, INT32_MAX, nullptr, nullptr, bitset);
+}
+
+static int rwlock_wait(u32* lockp, u32 expected, u32 bitset, const struct timespec* abstime)
+{
+    // Timed rwlock operations take an absolute CLOCK_REALTIME timeout.
+    auto rc = futex(lockp, FUTEX_WAIT_BITSET | FUTEX_PRIVATE_FLAG | FUTEX_CLOCK_REALTIME, expected, abstime, nullptr, bitset);
+    if (rc < 0 && errno == ETIMEDOUT && abstime)
+        return ETIMEDOUT;
+    if (rc < 0 && errno != EAGAIN && errno != EINTR)
+        return errno;
+    return 0;
+}
+
+static int rwlock_rdlock(pthread_rwlock_t* lockval_p, const struct timespec* abstime, bool only_once)
+{
+    auto* lockp = rwlock_futex_word(lockval_p);
+    auto current = AK::atomic_load(lockp, AK::MemoryOrder::memory_order_relaxed);
+    bool already_read_locked = rwlock_is_read_locked_by_current_thread(lockval_p);
+    size_t spins = 0;
+    for (;;) {
+        if (!(current & writer_locked_mask) && (!(current & writers_waiting_mask) || already_read_locked)) {
+            if ((current & reader_count_mask) == reader_count_mask)
+                return EAGAIN;
+            if (AK::atomic_compare_exchange_strong(lockp, current, current + 1, AK::MemoryOrder::memory_order_acquire)) {
+                rwlock_did_read_lock(lockval_p);
+                return 0;
             }
+            continue;
         }
 
-        // That didn't work, if no one else is waiting for the write bit, set it.
-        if (!(current & writer_wake_mask)) {
-            auto desired = current | writer_wake_mask | writer_intent_mask;
-            auto did_exchange = AK::atomic_compare_exchange_strong(lockp, current, desired, AK::MemoryOrder::memory_order_acquire);
-            if (!did_exchange)
-                continue; // Something interesting happened!
+        if (only_once)
+            return EBUSY;
 
-            current = desired;
+        // Somebody is writing, or wants to. Give them a moment before going to sleep.
+        if (spins++ < rwlock_spin_count) {
+            spin_loop_hint();
+            current = AK::atomic_load(lockp, AK::MemoryOrder::memory_order_relaxed);
+            continue;
         }
 
-        // Seems like someone is writing (or is interested in writing and we let them have the lock)
-        // wait until they're done.
-        auto rc = futex(lockp, FUTEX_WAIT_BITSET, current, timeout, nullptr, writer_wake_mask);
-        if (rc < 0 && errno == ETIMEDOUT && timeout) {
-            return value_if_timeout;
+        if (!(current & readers_waiting_mask)) {
+            if (!AK::atomic_compare_exchange_strong(lockp, current, current | readers_waiting_mask, AK::MemoryOrder::memory_order_relaxed))
+                continue;
+            current |= readers_waiting_mask;
         }
-        if (rc < 0 && errno != EAGAIN) {
-            // Something broke. let's just bail out.
-            return errno;
-        }
-        errno = 0;
-        // Reload the 'current' value
-        current = AK::atomic_load(lockp);
+
+        if (auto rc = rwlock_wait(lockp, current, reader_wake_bitset, abstime); rc != 0)
+            return rc;
+        current = AK::atomic_load(lockp, AK::MemoryOrder::memory_order_relaxed);
     }
+}
+
+static int rwlock_wrlock(pthread_rwlock_t* lockval_p, const struct timespec* abstime, bool only_once)
+{
+    auto* lockp = rwlock_futex_word(lockval_p);
+    auto current = AK::atomic_load(lockp, AK::MemoryOrder::memory_order_relaxed);
+    size_t spins = 0;
+    for (;;) {
+        if (!(current & writer_locked_mask) && (current & reader_count_mask) == 0) {
+            // Grab the lock, and keep whatever waiter bits are set so we wake them up on unlock.
+            if (!AK::atomic_compare_exchange_strong(lockp, current, current | writer_locked_mask, AK::MemoryOrder::memory_order_acquire))
+                continue;
 
-    return value_if_timeout;
+            // Now that we've locked the value, it's safe to set our thread ID.
+            AK::atomic_store(rwlock_writer_id(lockval_p), pthread_self());
+            return 0;
+        }
+
+        if (only_once)
+            return EBUSY;
+
+        if (spins++ < rwlock_spin_count) {
+            spin_loop_hint();
+            current = AK::atomic_load(lockp, AK::MemoryOrder::memory_order_relaxed);
+            continue;
+        }
+
+        if (!(current & writers_waiting_mask)) {
+            if (!AK::atomic_compare_exchange_strong(lockp, current, current | writers_waiting_mask, AK::MemoryOrder::memory_order_relaxed))
+                continue;
+            current |= writers_waiting_mask;
+        }
+
+        if (auto rc = rwlock_wait(lockp, current, writer_wake_bitset, abstime); rc != 0)
+            return rc;
+        current = AK::atomic_load(lockp, AK::MemoryOrder::memory_order_relaxed);
+    }
 }
 
 int pthread_rwlock_rdlock(pthread_rwlock_t* lockp)
@@ -780,45 +858,35 @@ int pthread_rwlock_rdlock(pthread_rwlock_t* lockp)
     if (!lockp)
         return EINVAL;
 
-    return rwlock_rdlock_maybe_timed(reinterpret_cast<u32*>(lockp), nullptr, false, 0, 0);
+    return rwlock_rdlock(lockp, nullptr, false);
 }
 int pthread_rwlock_timedrdlock(pthread_rwlock_t* __restrict lockp, const struct timespec* __restrict timespec)
 {
     if (!lockp)
         return EINVAL;
 
-    auto rc = rwlock_rdlock_maybe_timed(reinterpret_cast<u32*>(lockp), timespec);
-    if (rc == -1) // "ok"
-        return 0;
-    if (rc == -2) // "timed out"
-        return 1;
-    return rc;
+    return rwlock_rdlock(lockp, timespec, false);
 }
 int pthread_rwlock_timedwrlock(pthread_rwlock_t* __restrict lockp, const struct timespec* __restrict timespec)
 {
     if (!lockp)
         return EINVAL;
 
-    auto rc = rwlock_wrlock_maybe_timed(lockp, timespec);
-    if (rc == -1) // "ok"
-        return 0;
-    if (rc == -2) // "timed out"
-        return 1;
-    return rc;
+    return rwlock_wrlock(lockp, timespec, false);
 }
 int pthread_rwlock_tryrdlock(pthread_rwlock_t* lockp)
 {
     if (!lockp)
         return EINVAL;
 
-    return rwlock_rdlock_maybe_timed(reinterpret_cast<u32*>(lockp), nullptr, true, EBUSY, 0);
+    return rwlock_rdlock(lockp, nullptr, true);
 }
 int pthread_rwlock_trywrlock(pthread_rwlock_t* lockp)
 {
     if (!lockp)
         return EINVAL;
 
-    return rwlock_wrlock_maybe_timed(lockp, nullptr, true, EBUSY, 0);
+    return rwlock_wrlock(lockp, nullptr, true);
 }
 int pthread_rwlock_unlock(pthread_rwlock_t* lockval_p)
 {
@@ -826,47 +894,45 @@ int pthread_rwlock_unlock(pthread_rwlock_t* lockval_p)
         return EINVAL;
 
     // This is a weird API, we don't really know whether we're unlocking write or read...
-    auto lockp = reinterpret_cast<u32*>(lockval_p);
+    auto* lockp = rwlock_futex_word(lockval_p);
     auto current = AK::atomic_load(lockp, AK::MemoryOrder::memory_order_relaxed);
     if (current & writer_locked_mask) {
         // If this lock is locked for writing, its owner better be us!
-        auto owner_id = AK::atomic_load(reinterpret_cast<i32*>(lockval_p) + 1);
+        auto owner_id = AK::atomic_load(rwlock_writer_id(lockval_p));
         auto my_id = pthread_self();
         if (owner_id != my_id)
             return EINVAL; // you don't own this lock, silly.
 
-        // Now just unlock it.
-        auto desired = current & ~(writer_locked_mask | writer_intent_mask);
-        AK::atomic_store(lockp, desired, AK::MemoryOrder::memory_order_release);
-        // Then wake both readers and writers, if any.
-        auto rc = futex(lockp, FUTEX_WAKE_BITSET, current, nullptr, nullptr, (current & writer_wake_mask) | reader_wake_mask);
-        if (rc < 0)
-            return errno;
+        AK::atomic_store(rwlock_writer_id(lockval_p), 0);
+        // Unlock it and clear the waiter bits, everybody we wake up will set them again if they have to go back to sleep.
+        auto previous = AK::atomic_exchange(lockp, 0u, AK::MemoryOrder::memory_order_release);
+        rwlock_wake_waiters(lockp, previous);
         return 0;
     }
 
     for (;;) {
-        auto count = (u16)current;
-        if (!count) {
+        if (!(current & reader_count_mask)) {
             // Are you crazy? this isn't even locked!
             return EINVAL;
         }
-        --count;
-        auto desired = (current << 16) | count;
-        auto did_exchange = AK::atomic_compare_exchange_strong(lockp, current, desired, AK::MemoryOrder::memory_order_release);
-        if (!did_exchange)
+        auto desired = current - 1;
+        // The last reader out hands the lock over to whoever is waiting.
+        if ((desired & reader_count_mask) == 0)
+            desired &= ~(readers_waiting_mask | writers_waiting_mask);
+        if (!AK::atomic_compare_exchange_strong(lockp, current, desired, AK::MemoryOrder::memory_order_release))
             continue; // tough luck, try again.
+        rwlock_did_read_unlock(lockval_p);
+        if ((desired & reader_count_mask) == 0)
+            rwlock_wake_waiters(lockp, current);
+        return 0;
     }
-
-    // Finally, unlocked at last!
-    return 0;
 }
 int pthread_rwlock_wrlock(pthread_rwlock_t* lockp)
 {
     if (!lockp)
         return EINVAL;
 
-    return rwlock_wrlock_maybe_timed(lockp, nullptr, false, 0, 0);
+    return rwlock_wrlock(lockp, nullptr, false);
 }
 int pthread_rwlockattr_destroy(pthread_rwlockattr_t*)
 {
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2020, Andreas Kling <kling@serenityos.org>
+ * Copyright (c) 2021, the SerenityOS developers.
  * All rights reserved.
  *
  * Redistribution and use in source and binary forms, with or without
@@ -25,261 +25,264 @@
  */
 
 #include "Client.h"
-#include <AK/Base64.h>
-#include <AK/LexicalPath.h>
-#include <AK/MappedFile.h>
-#include <AK/MemoryStream.h>
-#include <AK/StringBuilder.h>
-#include <AK/URLParser.h>
+#include "WorkerPool.h"
 #include <LibCore/DateTime.h>
-#include <LibCore/DirIterator.h>
-#include <LibCore/File.h>
-#include <LibCore/FileStream.h>
-#include <LibCore/MimeData.h>
 #include <LibHTTP/HttpRequest.h>
+#include <errno.h>
 #include <stdio.h>
-#include <sys/stat.h>
-#include <time.h>
+#include <sys/sendfile.h>
 #include <unistd.h>
 
 namespace WebServer {
 
-Client::Client(NonnullRefPtr<Core::TCPSocket> socket, const String& root, Core::Object* parent)
+// How many requests of a single connection we work on at the same time.
+static constexpr size_t max_pipelined_requests = 16;
+// Anything beyond this that the client sends us without waiting for responses is abuse.
+static constexpr size_t max_buffered_input = 1 * MiB;
+static constexpr size_t max_request_header_size = 64 * KiB;
+static constexpr int keep_alive_timeout_ms = 15000;
+
+Client::Client(NonnullRefPtr<Core::TCPSocket> socket, const RequestHandler& request_handler, WorkerPool& worker_pool, Core::Object* parent)
     : Core::Object(parent)
     , m_socket(socket)
-    , m_root_path(root)
+    , m_request_handler(request_handler)
+    , m_worker_pool(worker_pool)
 {
 }
 
 void Client::die()
 {
-    remove_from_parent();
+    if (m_dead)
+        return;
+    m_dead = true;
+    m_idle_timer->stop();
+    m_write_notifier->close();
+    m_socket->close();
+    m_pending_responses.clear();
+    // We're usually deep inside one of our own callbacks at this point, so let the event loop get rid of us.
+    deferred_invoke([](auto& object) {
+        object.remove_from_parent();
+    });
 }
 
 void Client::start()
 {
-    m_socket->on_ready_to_read = [this] {
-        auto raw_request = m_socket->read_all();
-        if (raw_request.is_null()) {
-            die();
-            return;
-        }
+    m_socket->set_blocking(false);
 
-        dbgln("Got raw request: '{}'", String::copy(raw_request));
+    m_write_notifier = Core::Notifier::construct(m_socket->fd(), Core::Notifier::Write, this);
+    m_write_notifier->set_enabled(false);
+    m_write_notifier->on_ready_to_write = [this] {
+        pump();
+    };
 
-        handle_request(raw_request.bytes());
-        die();
+    m_idle_timer = Core::Timer::create_single_shot(
+        keep_alive_timeout_ms, [this] {
+            if (m_pending_responses.is_empty())
+                die();
+            else
+                m_idle_timer->restart();
+        },
+        this);
+    m_idle_timer->start();
+
+    m_socket->on_ready_to_read = [this] {
+        did_become_readable();
     };
 }
 
-void Client::handle_request(ReadonlyBytes raw_request)
+void Client::did_become_readable()
 {
-    auto request_or_error = HTTP::HttpRequest::from_raw_request(raw_request);
-    if (!request_or_error.has_value())
-        return;
-    auto& request = request_or_error.value();
-
-    dbgln("Got HTTP request: {} {}", request.method_name(), request.resource());
-    for (auto& header : request.headers()) {
-        dbgln("    {} => {}", header.name, header.value);
-    }
-
-    if (request.method() != HTTP::HttpRequest::Method::GET) {
-        send_error_response(403, "Forbidden!", request);
+    if (m_dead)
         return;
-    }
-
-    auto requested_path = LexicalPath::canonicalized_path(request.resource());
-    dbgln("Canonical requested path: '{}'", requested_path);
 
-    StringBuilder path_builder;
-    path_builder.append(m_root_path);
-    path_builder.append('/');
-    path_builder.append(requested_path);
-    auto real_path = path_builder.to_string();
-
-    if (Core::File::is_directory(real_path)) {
-
-        if (!request.resource().ends_with("/")) {
-            StringBuilder red;
-
-            red.append(requested_path);
-            red.append("/");
-
-            send_redirect(red.to_string(), request);
+    for (;;) {
+        u8 buffer[16 * KiB];
+        auto nread = read(m_socket->fd(), buffer, sizeof(buffer));
+        if (nread < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN)
+                break;
+            perror("Client: read");
+            die();
             return;
         }
-
-        StringBuilder index_html_path_builder;
-        index_html_path_builder.append(real_path);
-        index_html_path_builder.append("/index.html");
-        auto index_html_path = index_html_path_builder.to_string();
-        if (!Core::File::exists(index_html_path)) {
-            handle_directory_listing(requested_path, real_path, request);
+        if (nread == 0) {
+            // Keep the connection around until everything we owe the peer has been sent.
+            m_peer_closed = true;
+            m_socket->set_read_notifications_enabled(false);
+            break;
+        }
+        m_input.append(buffer, nread);
+        if (m_input.size() > max_buffered_input) {
+            dbgln("Client sent too much data without waiting for responses, disconnecting");
+            die();
             return;
         }
-        real_path = index_html_path;
-    }
-
-    auto file = Core::File::construct(real_path);
-    if (!file->open(Core::File::ReadOnly)) {
-        send_error_response(404, "Not found!", request);
-        return;
     }
 
-    Core::InputFileStream stream { file };
-
-    send_response(stream, request, Core::guess_mime_type_based_on_filename(real_path));
+    m_idle_timer->restart();
+    pump();
 }
 
-void Client::send_response(InputStream& response, const HTTP::HttpRequest& request, const String& content_type)
+void Client::pump()
 {
-    StringBuilder builder;
-    builder.append("HTTP/1.0 200 OK\r\n");
-    builder.append("Server: WebServer (SerenityOS)\r\n");
-    builder.append("X-Frame-Options: SAMEORIGIN\r\n");
-    builder.append("X-Content-Type-Options: nosniff\r\n");
-    builder.append("Content-Type: ");
-    builder.append(content_type);
-    builder.append("\r\n");
-    builder.append("\r\n");
-
-    m_socket->write(builder.to_string());
-    log_response(200, request);
-
-    char buffer[PAGE_SIZE];
-    do {
-        auto size = response.read({ buffer, sizeof(buffer) });
-        if (response.unreliable_eof() && size == 0)
+    for (;;) {
+        process_requests();
+        if (m_dead)
+            return;
+        if (flush_responses() == 0 || m_dead)
             break;
-
-        m_socket->write({ buffer, size });
-    } while (true);
+    }
+    if (m_peer_closed && m_pending_responses.is_empty())
+        die();
 }
 
-void Client::send_redirect(StringView redirect_path, const HTTP::HttpRequest& request)
+static Optional<size_t> find_end_of_header(const Vector<u8>& input)
 {
-    StringBuilder builder;
-    builder.append("HTTP/1.0 301 Moved Permanently\r\n");
-    builder.append("Location: ");
-    builder.append(redirect_path);
-    builder.append("\r\n");
-    builder.append("\r\n");
-
-    m_socket->write(builder.to_string());
-
-    log_response(301, request);
+    for (size_t i = 0; i + 3 < input.size(); ++i) {
+        if (input[i] == '\r' && input[i + 1] == '\n' && input[i + 2] == '\r' && input[i + 3] == '\n')
+            return i;
+    }
+    return {};
 }
 
-static String folder_image_data()
+void Client::process_requests()
 {
-    static String cache;
-    if (cache.is_empty()) {
-        auto file_or_error = MappedFile::map("/res/icons/16x16/filetype-folder.png");
-        VERIFY(!file_or_error.is_error());
-        cache = encode_base64(file_or_error.value()->bytes());
+    while (!m_closing && m_pending_responses.size() < max_pipelined_requests) {
+        // Clients are allowed to send empty lines between requests.
+        size_t leading_empty_lines = 0;
+        while (leading_empty_lines + 1 < m_input.size() && m_input[leading_empty_lines] == '\r' && m_input[leading_empty_lines + 1] == '\n')
+            leading_empty_lines += 2;
+        m_input.remove(0, leading_empty_lines);
+
+        auto end_of_header = find_end_of_header(m_input);
+        if (!end_of_header.has_value()) {
+            if (m_input.size() > max_request_header_size) {
+                m_closing = true;
+                m_pending_responses.append({ m_next_serial++, "?", "?", RequestHandler::error_response(431, "Request Header Fields Too Large", false) });
+            }
+            return;
+        }
+
+        // NOTE: We hand the parser everything up to and including the last header's line break.
+        auto request = HTTP::HttpRequest::from_raw_request({ m_input.data(), end_of_header.value() + 2 });
+        m_input.remove(0, end_of_header.value() + 4);
+        if (!request.has_value()) {
+            m_closing = true;
+            m_pending_responses.append({ m_next_serial++, "?", "?", RequestHandler::error_response(400, "Bad Request", false) });
+            return;
+        }
+
+        // We never read request bodies, so we can't find the next request after one that has one.
+        bool keep_alive = request->wants_keep_alive()
+            && (request->method() == HTTP::HttpRequest::Method::GET || request->method() == HTTP::HttpRequest::Method::HEAD);
+        if (!keep_alive)
+            m_closing = true;
+
+        dbgln("Got HTTP request: {} {}", request->method_name(), request->resource());
+
+        auto serial = m_next_serial++;
+        m_pending_responses.append({ serial, request->method_name(), request->resource(), {} });
+
+        auto& handler = m_request_handler;
+        m_worker_pool.submit<NonnullOwnPtr<Response>>(
+            [&handler, request = request.release_value(), keep_alive] {
+                return handler.handle(request, keep_alive);
+            },
+            [this, protector = NonnullRefPtr(*this), serial](auto response) {
+                did_complete_request(serial, move(response));
+            });
     }
-    return cache;
 }
 
-static String file_image_data()
+void Client::did_complete_request(u32 serial, NonnullOwnPtr<Response> response)
 {
-    static String cache;
-    if (cache.is_empty()) {
-        auto file_or_error = MappedFile::map("/res/icons/16x16/filetype-unknown.png");
-        VERIFY(!file_or_error.is_error());
-        cache = encode_base64(file_or_error.value()->bytes());
+    if (m_dead)
+        return;
+    for (auto& pending : m_pending_responses) {
+        if (pending.serial == serial) {
+            pending.response = move(response);
+            break;
+        }
     }
-    return cache;
+    pump();
 }
 
-void Client::handle_directory_listing(const String& requested_path, const String& real_path, const HTTP::HttpRequest& request)
+size_t Client::flush_responses()
 {
-    StringBuilder builder;
-
-    builder.append("<!DOCTYPE html>\n");
-    builder.append("<html>\n");
-    builder.append("<head><title>Index of ");
-    builder.append(escape_html_entities(requested_path));
-    builder.append("</title><style>\n");
-    builder.append(".folder { width: 16px; height: 16px; background-image: url('data:image/png;base64,");
-    builder.append(folder_image_data());
-    builder.append("'); }\n");
-    builder.append(".file { width: 16px; height: 16px; background-image: url('data:image/png;base64,");
-    builder.append(file_image_data());
-    builder.append("'); }\n");
-    builder.append("</style></head><body>\n");
-    builder.append("<h1>Index of ");
-    builder.append(escape_html_entities(requested_path));
-    builder.append("</h1>\n");
-    builder.append("<hr>\n");
-    builder.append("<code><table>\n");
-
-    Core::DirIterator dt(real_path);
-    while (dt.has_next()) {
-        auto name = dt.next_path();
-
-        StringBuilder path_builder;
-        path_builder.append(real_path);
-        path_builder.append('/');
-        path_builder.append(name);
-        struct stat st;
-        memset(&st, 0, sizeof(st));
-        int rc = stat(path_builder.to_string().characters(), &st);
-        if (rc < 0) {
-            perror("stat");
+    size_t responses_sent = 0;
+    while (!m_pending_responses.is_empty() && m_pending_responses.first().response) {
+        auto& pending = m_pending_responses.first();
+        auto result = send_some(*pending.response);
+        if (result == SendResult::Error) {
+            die();
+            return responses_sent;
+        }
+        if (result == SendResult::WouldBlock) {
+            m_write_notifier->set_enabled(true);
+            return responses_sent;
         }
 
-        bool is_directory = S_ISDIR(st.st_mode) || name.is_one_of(".", "..");
-
-        builder.append("<tr>");
-        builder.appendf("<td><div class=\"%s\"></div></td>", is_directory ? "folder" : "file");
-        builder.append("<td><a href=\"");
-        builder.append(urlencode(name));
-        builder.append("\">");
-        builder.append(escape_html_entities(name));
-        builder.append("</a></td><td>&nbsp;</td>");
+        log_response(pending.response->code, pending);
+        bool should_close = pending.response->close_connection;
+        m_pending_responses.take_first();
+        ++responses_sent;
+        m_idle_timer->restart();
 
-        builder.appendf("<td>%10lld</td><td>&nbsp;</td>", st.st_size);
-        builder.append("<td>");
-        builder.append(Core::DateTime::from_timestamp(st.st_mtime).to_string());
-        builder.append("</td>");
-        builder.append("</tr>\n");
+        if (should_close) {
+            die();
+            return responses_sent;
+        }
     }
-
-    builder.append("</table></code>\n");
-    builder.append("<hr>\n");
-    builder.append("<i>Generated by WebServer (SerenityOS)</i>\n");
-    builder.append("</body>\n");
-    builder.append("</html>\n");
-
-    auto response = builder.to_string();
-    InputMemoryStream stream { response.bytes() };
-    send_response(stream, request, "text/html");
+    m_write_notifier->set_enabled(false);
+    return responses_sent;
 }
 
-void Client::send_error_response(unsigned code, const StringView& message, const HTTP::HttpRequest& request)
+Client::SendResult Client::send_some(Response& response)
 {
-    StringBuilder builder;
-    builder.appendf("HTTP/1.0 %u ", code);
-    builder.append(message);
-    builder.append("\r\n\r\n");
-    builder.append("<!DOCTYPE html><html><body><h1>");
-    builder.appendf("%u ", code);
-    builder.append(message);
-    builder.append("</h1></body></html>");
-    m_socket->write(builder.to_string());
+    auto header = response.header.bytes();
+    auto body = response.body_bytes();
+    while (response.bytes_sent < header.size() + body.size()) {
+        auto chunk = response.bytes_sent < header.size() ? header.slice(response.bytes_sent) : body.slice(response.bytes_sent - header.size());
+        auto nwritten = write(m_socket->fd(), chunk.data(), chunk.size());
+        if (nwritten < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN)
+                return SendResult::WouldBlock;
+            perror("Client: write");
+            return SendResult::Error;
+        }
+        response.bytes_sent += nwritten;
+    }
 
-    log_response(code, request);
+    // Let the kernel move the file contents straight into the socket
+    // instead of bouncing every chunk through a userspace buffer.
+    while (response.file_offset < response.file_size) {
+        auto nsent = sendfile(m_socket->fd(), response.file_fd, &response.file_offset, response.file_size - response.file_offset);
+        if (nsent < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN)
+                return SendResult::WouldBlock;
+            perror("Client: sendfile");
+            return SendResult::Error;
+        }
+        // The file shrunk after we promised the client a Content-Length, so all we can do is hang up.
+        if (nsent == 0)
+            return SendResult::Error;
+    }
+    return SendResult::Done;
 }
 
-void Client::log_response(unsigned code, const HTTP::HttpRequest& request)
+void Client::log_response(unsigned code, const PendingResponse& pending)
 {
     printf("%s :: %03u :: %s %s\n",
         Core::DateTime::now().to_string().characters(),
         code,
-        request.method_name().characters(),
-        request.resource().characters());
+        pending.method_name.characters(),
+        pending.resource.characters());
 }
 
 }
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2020, Andreas Kling <kling@serenityos.org>
+ * Copyright (c) 2021, the SerenityOS developers.
  * All rights reserved.
  *
  * Redistribution and use in source and binary forms, with or without
@@ -26,12 +26,22 @@
 
 #pragma once
 
+#include "RequestHandler.h"
+#include <AK/Vector.h>
+#include <LibCore/Notifier.h>
 #include <LibCore/Object.h>
 #include <LibCore/TCPSocket.h>
+#include <LibCore/Timer.h>
 #include <LibHTTP/Forward.h>
 
 namespace WebServer {
 
+class WorkerPool;
+
+// One HTTP/1.1 connection. All socket I/O happens on the main thread without
+// blocking. Requests are parsed as soon as they arrive (so pipelined requests
+// get handled in parallel), handed to the worker pool, and their responses are
+// sent back strictly in request order.
 class Client final : public Core::Object {
     C_OBJECT(Client);
 
@@ -39,18 +49,44 @@ public:
     void start();
 
 private:
-    Client(NonnullRefPtr<Core::TCPSocket>, const String&, Core::Object* parent);
+    Client(NonnullRefPtr<Core::TCPSocket>, const RequestHandler&, WorkerPool&, Core::Object* parent);
+
+    struct PendingResponse {
+        u32 serial { 0 };
+        String method_name;
+        String resource;
+        OwnPtr<Response> response;
+    };
+
+    enum class SendResult {
+        Done,
+        WouldBlock,
+        Error,
+    };
 
-    void handle_request(ReadonlyBytes);
-    void send_response(InputStream&, const HTTP::HttpRequest&, const String& content_type);
-    void send_redirect(StringView redirect, const HTTP::HttpRequest& request);
-    void send_error_response(unsigned code, const StringView& message, const HTTP::HttpRequest&);
+    void did_become_readable();
+    void pump();
+    void process_requests();
+    size_t flush_responses();
+    SendResult send_some(Response&);
+    void did_complete_request(u32 serial, NonnullOwnPtr<Response>);
     void die();
-    void log_response(unsigned code, const HTTP::HttpRequest&);
-    void handle_directory_listing(const String& requested_path, const String& real_path, const HTTP::HttpRequest&);
+    void log_response(unsigned code, const PendingResponse&);
 
     NonnullRefPtr<Core::TCPSocket> m_socket;
-    String m_root_path;
+    RefPtr<Core::Notifier> m_write_notifier;
+    RefPtr<Core::Timer> m_idle_timer;
+    const RequestHandler& m_request_handler;
+    WorkerPool& m_worker_pool;
+
+    Vector<u8> m_input;
+    Vector<PendingResponse> m_pending_responses;
+    u32 m_next_serial { 0 };
+
+    bool m_peer_closed { false };
+    // Set once we've queued a response after which the connection is closed.
+    bool m_closing { false };
+    bool m_dead { false };
 };
 
 }
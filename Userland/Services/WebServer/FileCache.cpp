@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2021, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "FileCache.h"
+#include <stdio.h>
+#include <unistd.h>
+
+namespace WebServer {
+
+FileCache::FileCache(size_t capacity, size_t max_file_size)
+    : m_capacity(capacity)
+    , m_max_file_size(min(max_file_size, capacity))
+{
+}
+
+RefPtr<CachedFile> FileCache::get(const String& path, const struct stat& st)
+{
+    LOCKER(m_lock);
+    auto it = m_entries.find(path);
+    if (it == m_entries.end())
+        return nullptr;
+    if (!it->value.file->matches(st)) {
+        m_size -= it->value.file->size();
+        m_entries.remove(it);
+        return nullptr;
+    }
+    it->value.last_used = ++m_use_counter;
+    return it->value.file;
+}
+
+RefPtr<CachedFile> FileCache::load(const String& path, int fd, const struct stat& st)
+{
+    if (!S_ISREG(st.st_mode) || (size_t)st.st_size > m_max_file_size)
+        return nullptr;
+
+    auto data = ByteBuffer::create_uninitialized(st.st_size);
+    size_t nread = 0;
+    while (nread < data.size()) {
+        auto rc = read(fd, data.data() + nread, data.size() - nread);
+        if (rc < 0) {
+            perror("FileCache: read");
+            return nullptr;
+        }
+        // The file shrunk under us, don't cache a truncated copy.
+        if (rc == 0)
+            return nullptr;
+        nread += rc;
+    }
+
+    auto file = CachedFile::create(st, move(data));
+
+    LOCKER(m_lock);
+    if (auto it = m_entries.find(path); it != m_entries.end()) {
+        m_size -= it->value.file->size();
+        m_entries.remove(it);
+    }
+    evict_until_available(file->size());
+    m_entries.set(path, { file, ++m_use_counter });
+    m_size += file->size();
+    return file;
+}
+
+void FileCache::evict_until_available(size_t size)
+{
+    while (!m_entries.is_empty() && m_size + size > m_capacity) {
+        auto least_recently_used = m_entries.begin();
+        for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+            if (it->value.last_used < least_recently_used->value.last_used)
+                least_recently_used = it;
+        }
+        m_size -= least_recently_used->value.file->size();
+        m_entries.remove(least_recently_used);
+    }
+}
+
+}
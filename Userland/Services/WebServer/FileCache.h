@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2021, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <AK/ByteBuffer.h>
+#include <AK/HashMap.h>
+#include <AK/RefCounted.h>
+#include <AK/String.h>
+#include <LibThread/Lock.h>
+#include <sys/stat.h>
+
+namespace WebServer {
+
+class CachedFile : public RefCounted<CachedFile> {
+public:
+    static NonnullRefPtr<CachedFile> create(const struct stat& st, ByteBuffer&& data)
+    {
+        return adopt(*new CachedFile(st, move(data)));
+    }
+
+    // We consider the contents stale as soon as any of these change.
+    bool matches(const struct stat& st) const { return m_inode == st.st_ino && m_mtime == st.st_mtime && m_data.size() == (size_t)st.st_size; }
+
+    ReadonlyBytes bytes() const { return m_data.bytes(); }
+    size_t size() const { return m_data.size(); }
+
+private:
+    CachedFile(const struct stat& st, ByteBuffer&& data)
+        : m_inode(st.st_ino)
+        , m_mtime(st.st_mtime)
+        , m_data(move(data))
+    {
+    }
+
+    ino_t m_inode { 0 };
+    time_t m_mtime { 0 };
+    ByteBuffer m_data;
+};
+
+// Keeps the contents of small, frequently requested files in memory, so that
+// serving them doesn't have to touch the file system beyond a stat().
+// This is shared between all worker threads.
+class FileCache {
+public:
+    FileCache(size_t capacity, size_t max_file_size);
+
+    size_t max_file_size() const { return m_max_file_size; }
+
+    RefPtr<CachedFile> get(const String& path, const struct stat&);
+    // Reads the file behind fd (which must be at offset 0) and, if it's small enough, remembers it under path.
+    RefPtr<CachedFile> load(const String& path, int fd, const struct stat&);
+
+private:
+    struct Entry {
+        NonnullRefPtr<CachedFile> file;
+        u64 last_used { 0 };
+    };
+
+    void evict_until_available(size_t);
+
+    LibThread::Lock m_lock;
+    HashMap<String, Entry> m_entries;
+    size_t m_capacity { 0 };
+    size_t m_max_file_size { 0 };
+    size_t m_size { 0 };
+    u64 m_use_counter { 0 };
+};
+
+}
@@ -0,0 +1,263 @@
+/*
+ * Copyright (c) 2021, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "RequestHandler.h"
+#include <AK/Base64.h>
+#include <AK/LexicalPath.h>
+#include <AK/MappedFile.h>
+#include <AK/StringBuilder.h>
+#include <AK/URLParser.h>
+#include <LibCore/DateTime.h>
+#include <LibCore/DirIterator.h>
+#include <LibCore/File.h>
+#include <LibCore/MimeData.h>
+#include <LibHTTP/HttpRequest.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace WebServer {
+
+Response::~Response()
+{
+    if (file_fd >= 0)
+        close(file_fd);
+}
+
+void Response::drop_body()
+{
+    body.clear();
+    cached_body = nullptr;
+    if (file_fd >= 0) {
+        close(file_fd);
+        file_fd = -1;
+    }
+    file_offset = 0;
+    file_size = 0;
+}
+
+static String s_folder_image_data;
+static String s_file_image_data;
+
+static String load_icon(const char* path)
+{
+    auto file_or_error = MappedFile::map(path);
+    VERIFY(!file_or_error.is_error());
+    return encode_base64(file_or_error.value()->bytes());
+}
+
+void RequestHandler::initialize()
+{
+    s_folder_image_data = load_icon("/res/icons/16x16/filetype-folder.png");
+    s_file_image_data = load_icon("/res/icons/16x16/filetype-unknown.png");
+}
+
+static void build_header(Response& response, const StringView& status, const StringView& content_type, size_t content_length, bool keep_alive, const StringView& extra_headers = {})
+{
+    StringBuilder builder;
+    builder.appendff("HTTP/1.1 {} {}\r\n", response.code, status);
+    builder.append("Server: WebServer (SerenityOS)\r\n");
+    if (!content_type.is_null()) {
+        builder.append("X-Frame-Options: SAMEORIGIN\r\n");
+        builder.append("X-Content-Type-Options: nosniff\r\n");
+        builder.appendff("Content-Type: {}\r\n", content_type);
+    }
+    builder.appendff("Content-Length: {}\r\n", content_length);
+    builder.append(keep_alive ? "Connection: keep-alive\r\n" : "Connection: close\r\n");
+    builder.append(extra_headers);
+    builder.append("\r\n");
+    response.header = builder.to_byte_buffer();
+    response.close_connection = !keep_alive;
+}
+
+RequestHandler::RequestHandler(const String& root_path, FileCache& file_cache)
+    : m_root_path(root_path)
+    , m_file_cache(file_cache)
+{
+}
+
+NonnullOwnPtr<Response> RequestHandler::handle(const HTTP::HttpRequest& request, bool keep_alive) const
+{
+    if (request.method() != HTTP::HttpRequest::Method::GET && request.method() != HTTP::HttpRequest::Method::HEAD)
+        return error_response(403, "Forbidden!", keep_alive);
+
+    auto response = [&] {
+        auto requested_path = LexicalPath::canonicalized_path(request.resource());
+
+        StringBuilder path_builder;
+        path_builder.append(m_root_path);
+        path_builder.append('/');
+        path_builder.append(requested_path);
+        auto real_path = path_builder.to_string();
+
+        if (Core::File::is_directory(real_path)) {
+            if (!request.resource().ends_with("/")) {
+                StringBuilder red;
+                red.append(requested_path);
+                red.append("/");
+                return redirect_response(red.to_string(), keep_alive);
+            }
+
+            StringBuilder index_html_path_builder;
+            index_html_path_builder.append(real_path);
+            index_html_path_builder.append("/index.html");
+            auto index_html_path = index_html_path_builder.to_string();
+            if (!Core::File::exists(index_html_path))
+                return directory_listing(requested_path, real_path, keep_alive);
+            real_path = index_html_path;
+        }
+
+        return file_response(real_path, keep_alive);
+    }();
+
+    if (request.method() == HTTP::HttpRequest::Method::HEAD)
+        response->drop_body();
+    return response;
+}
+
+NonnullOwnPtr<Response> RequestHandler::file_response(const String& path, bool keep_alive) const
+{
+    int fd = open(path.characters(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return error_response(404, "Not found!", keep_alive);
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode)) {
+        close(fd);
+        return error_response(403, "Forbidden!", keep_alive);
+    }
+
+    auto response = make<Response>();
+    build_header(*response, "OK", Core::guess_mime_type_based_on_filename(path), st.st_size, keep_alive);
+
+    if (auto cached_file = m_file_cache.get(path, st)) {
+        close(fd);
+        response->cached_body = move(cached_file);
+        return response;
+    }
+    if (auto cached_file = m_file_cache.load(path, fd, st)) {
+        close(fd);
+        response->cached_body = move(cached_file);
+        return response;
+    }
+
+    // Too big to keep around, so we'll let the kernel send it straight from the file.
+    response->file_fd = fd;
+    response->file_size = st.st_size;
+    return response;
+}
+
+NonnullOwnPtr<Response> RequestHandler::redirect_response(const StringView& location, bool keep_alive)
+{
+    auto response = make<Response>();
+    response->code = 301;
+    build_header(*response, "Moved Permanently", {}, 0, keep_alive, String::formatted("Location: {}\r\n", location));
+    return response;
+}
+
+NonnullOwnPtr<Response> RequestHandler::directory_listing(const String& requested_path, const String& real_path, bool keep_alive) const
+{
+    StringBuilder builder;
+
+    builder.append("<!DOCTYPE html>\n");
+    builder.append("<html>\n");
+    builder.append("<head><title>Index of ");
+    builder.append(escape_html_entities(requested_path));
+    builder.append("</title><style>\n");
+    builder.append(".folder { width: 16px; height: 16px; background-image: url('data:image/png;base64,");
+    builder.append(s_folder_image_data);
+    builder.append("'); }\n");
+    builder.append(".file { width: 16px; height: 16px; background-image: url('data:image/png;base64,");
+    builder.append(s_file_image_data);
+    builder.append("'); }\n");
+    builder.append("</style></head><body>\n");
+    builder.append("<h1>Index of ");
+    builder.append(escape_html_entities(requested_path));
+    builder.append("</h1>\n");
+    builder.append("<hr>\n");
+    builder.append("<code><table>\n");
+
+    Core::DirIterator dt(real_path);
+    while (dt.has_next()) {
+        auto name = dt.next_path();
+
+        StringBuilder path_builder;
+        path_builder.append(real_path);
+        path_builder.append('/');
+        path_builder.append(name);
+        struct stat st;
+        memset(&st, 0, sizeof(st));
+        int rc = stat(path_builder.to_string().characters(), &st);
+        if (rc < 0) {
+            perror("stat");
+        }
+
+        bool is_directory = S_ISDIR(st.st_mode) || name.is_one_of(".", "..");
+
+        builder.append("<tr>");
+        builder.appendf("<td><div class=\"%s\"></div></td>", is_directory ? "folder" : "file");
+        builder.append("<td><a href=\"");
+        builder.append(urlencode(name));
+        builder.append("\">");
+        builder.append(escape_html_entities(name));
+        builder.append("</a></td><td>&nbsp;</td>");
+
+        builder.appendf("<td>%10lld</td><td>&nbsp;</td>", st.st_size);
+        builder.append("<td>");
+        builder.append(Core::DateTime::from_timestamp(st.st_mtime).to_string());
+        builder.append("</td>");
+        builder.append("</tr>\n");
+    }
+
+    builder.append("</table></code>\n");
+    builder.append("<hr>\n");
+    builder.append("<i>Generated by WebServer (SerenityOS)</i>\n");
+    builder.append("</body>\n");
+    builder.append("</html>\n");
+
+    auto response = make<Response>();
+    response->body = builder.to_byte_buffer();
+    build_header(*response, "OK", "text/html", response->body.size(), keep_alive);
+    return response;
+}
+
+NonnullOwnPtr<Response> RequestHandler::error_response(unsigned code, const StringView& message, bool keep_alive)
+{
+    StringBuilder builder;
+    builder.append("<!DOCTYPE html><html><body><h1>");
+    builder.appendf("%u ", code);
+    builder.append(message);
+    builder.append("</h1></body></html>");
+
+    auto response = make<Response>();
+    response->code = code;
+    response->body = builder.to_byte_buffer();
+    build_header(*response, message, "text/html", response->body.size(), keep_alive);
+    return response;
+}
+
+}
@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2021, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include "FileCache.h"
+#include <AK/ByteBuffer.h>
+#include <AK/Noncopyable.h>
+#include <AK/NonnullOwnPtr.h>
+#include <AK/Optional.h>
+#include <AK/String.h>
+#include <LibHTTP/Forward.h>
+#include <sys/types.h>
+
+namespace WebServer {
+
+// A fully prepared response. The body is either generated, shared with the
+// file cache, or streamed from file_fd with sendfile() when it's sent.
+struct Response {
+    AK_MAKE_NONCOPYABLE(Response);
+    AK_MAKE_NONMOVABLE(Response);
+
+public:
+    Response() { }
+    ~Response();
+
+    ReadonlyBytes body_bytes() const { return cached_body ? cached_body->bytes() : body.bytes(); }
+    void drop_body();
+
+    unsigned code { 200 };
+    ByteBuffer header;
+    ByteBuffer body;
+    RefPtr<CachedFile> cached_body;
+    int file_fd { -1 };
+    off_t file_offset { 0 };
+    off_t file_size { 0 };
+    bool close_connection { false };
+
+    // How much of header + body_bytes() has been sent so far.
+    size_t bytes_sent { 0 };
+};
+
+// Turns requests into responses. This runs on the worker threads, so it must
+// not touch any Core::Object, and all of its state has to be thread-safe.
+class RequestHandler {
+public:
+    RequestHandler(const String& root_path, FileCache&);
+
+    // Prepares state that can't be lazily initialized from multiple threads at once.
+    static void initialize();
+
+    NonnullOwnPtr<Response> handle(const HTTP::HttpRequest&, bool keep_alive) const;
+
+    static NonnullOwnPtr<Response> error_response(unsigned code, const StringView& message, bool keep_alive);
+
+private:
+    NonnullOwnPtr<Response> file_response(const String& path, bool keep_alive) const;
+    NonnullOwnPtr<Response> directory_listing(const String& requested_path, const String& real_path, bool keep_alive) const;
+    static NonnullOwnPtr<Response> redirect_response(const StringView& location, bool keep_alive);
+
+    String m_root_path;
+    FileCache& m_file_cache;
+};
+
+}
@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2021, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "WorkerPool.h"
+#include <AK/String.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
+
+namespace WebServer {
+
+WorkerPool::WorkerPool(size_t thread_count, Core::Object* parent)
+    : Core::Object(parent)
+{
+    pthread_mutex_init(&m_mutex, nullptr);
+    pthread_cond_init(&m_work_available, nullptr);
+
+    int rc = pipe2(m_completion_pipe, O_CLOEXEC);
+    VERIFY(rc == 0);
+    m_completion_notifier = Core::Notifier::construct(m_completion_pipe[0], Core::Notifier::Read, this);
+    m_completion_notifier->on_ready_to_read = [this] {
+        char buffer[64];
+        // We may have been poked multiple times, but one drain handles all of them.
+        if (read(m_completion_pipe[0], buffer, sizeof(buffer)) < 0)
+            perror("WorkerPool: read");
+        run_completion_handlers();
+    };
+
+    for (size_t i = 0; i < thread_count; ++i) {
+        auto thread = LibThread::Thread::construct([this] { return worker_main(); }, String::formatted("WebServer worker {}", i));
+        thread->start();
+        m_threads.append(move(thread));
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+}
+
+void WorkerPool::enqueue(NonnullOwnPtr<JobBase> job)
+{
+    pthread_mutex_lock(&m_mutex);
+    m_pending_jobs.enqueue(move(job));
+    pthread_cond_signal(&m_work_available);
+    pthread_mutex_unlock(&m_mutex);
+}
+
+int WorkerPool::worker_main()
+{
+    for (;;) {
+        pthread_mutex_lock(&m_mutex);
+        while (m_pending_jobs.is_empty())
+            pthread_cond_wait(&m_work_available, &m_mutex);
+        auto job = m_pending_jobs.dequeue();
+        pthread_mutex_unlock(&m_mutex);
+
+        job->run();
+
+        pthread_mutex_lock(&m_mutex);
+        bool needs_wake = m_completed_jobs.is_empty();
+        m_completed_jobs.enqueue(move(job));
+        pthread_mutex_unlock(&m_mutex);
+
+        // Only the first completion in a batch needs to wake the main thread.
+        if (needs_wake) {
+            char byte = 0;
+            if (write(m_completion_pipe[1], &byte, 1) < 0)
+                perror("WorkerPool: write");
+        }
+    }
+}
+
+void WorkerPool::run_completion_handlers()
+{
+    for (;;) {
+        pthread_mutex_lock(&m_mutex);
+        if (m_completed_jobs.is_empty()) {
+            pthread_mutex_unlock(&m_mutex);
+            return;
+        }
+        auto job = m_completed_jobs.dequeue();
+        pthread_mutex_unlock(&m_mutex);
+
+        job->complete();
+    }
+}
+
+}
@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2021, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <AK/Function.h>
+#include <AK/NonnullRefPtrVector.h>
+#include <AK/Optional.h>
+#include <AK/OwnPtr.h>
+#include <AK/Queue.h>
+#include <LibCore/Notifier.h>
+#include <LibCore/Object.h>
+#include <LibThread/Thread.h>
+#include <pthread.h>
+
+namespace WebServer {
+
+// A fixed set of threads that run jobs off the main thread. Each job's
+// completion handler is run back on the thread running the event loop, so it
+// can touch Core::Objects freely. The work function itself must not.
+// NOTE: The worker threads run until the process exits, so a pool is meant to be leaked.
+class WorkerPool final : public Core::Object {
+    C_OBJECT(WorkerPool);
+
+public:
+    virtual ~WorkerPool() override;
+
+    template<typename Result>
+    void submit(Function<Result()> work, Function<void(Result)> on_complete)
+    {
+        enqueue(make<Job<Result>>(move(work), move(on_complete)));
+    }
+
+    size_t thread_count() const { return m_threads.size(); }
+
+private:
+    explicit WorkerPool(size_t thread_count, Core::Object* parent = nullptr);
+
+    struct JobBase {
+        virtual ~JobBase() { }
+        virtual void run() = 0;
+        virtual void complete() = 0;
+    };
+
+    template<typename Result>
+    struct Job final : public JobBase {
+        Job(Function<Result()> work, Function<void(Result)> on_complete)
+            : work(move(work))
+            , on_complete(move(on_complete))
+        {
+        }
+
+        virtual void run() override { result = work(); }
+        virtual void complete() override
+        {
+            if (on_complete)
+                on_complete(result.release_value());
+        }
+
+        Function<Result()> work;
+        Function<void(Result)> on_complete;
+        Optional<Result> result;
+    };
+
+    void enqueue(NonnullOwnPtr<JobBase>);
+    int worker_main();
+    void run_completion_handlers();
+
+    pthread_mutex_t m_mutex;
+    pthread_cond_t m_work_available;
+    Queue<OwnPtr<JobBase>> m_pending_jobs;
+    Queue<OwnPtr<JobBase>> m_completed_jobs;
+
+    NonnullRefPtrVector<LibThread::Thread> m_threads;
+
+    // Workers poke this pipe to get the main thread to run completion handlers.
+    int m_completion_pipe[2] { -1, -1 };
+    RefPtr<Core::Notifier> m_completion_notifier;
+};
+
+}
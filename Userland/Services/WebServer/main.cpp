@@ -25,7 +25,9 @@
  */
 
 #include "Client.h"
-#include <AK/MappedFile.h>
+#include "FileCache.h"
+#include "RequestHandler.h"
+#include "WorkerPool.h"
 #include <LibCore/ArgsParser.h>
 #include <LibCore/EventLoop.h>
 #include <LibCore/File.h>
@@ -39,9 +41,13 @@ int main(int argc, char** argv)
     const char* root_path = "/www";
 
     int port = default_port;
+    int thread_count = 0;
+    int cache_size_in_mib = 16;
 
     Core::ArgsParser args_parser;
     args_parser.add_option(port, "Port to listen on", "port", 'p', "port");
+    args_parser.add_option(thread_count, "Number of worker threads (default: number of processors, at least 2)", "threads", 'j', "count");
+    args_parser.add_option(cache_size_in_mib, "Size of the in-memory file cache", "cache-size", 'c', "MiB");
     args_parser.add_positional_argument(root_path, "Path to serve the contents of", "path", Core::ArgsParser::Required::No);
     args_parser.parse(argc, argv);
 
@@ -57,19 +63,30 @@ int main(int argc, char** argv)
         return 1;
     }
 
-    if (pledge("stdio accept rpath inet unix cpath fattr", nullptr) < 0) {
+    if (thread_count <= 0)
+        thread_count = max(sysconf(_SC_NPROCESSORS_ONLN), 2l);
+    if (cache_size_in_mib < 0)
+        cache_size_in_mib = 0;
+
+    if (pledge("stdio accept rpath inet unix cpath fattr thread", nullptr) < 0) {
         perror("pledge");
         return 1;
     }
 
     Core::EventLoop loop;
 
+    WebServer::RequestHandler::initialize();
+    WebServer::FileCache file_cache(cache_size_in_mib * MiB, 256 * KiB);
+    WebServer::RequestHandler request_handler(real_root_path, file_cache);
+    auto& worker_pool = WebServer::WorkerPool::construct(thread_count).leak_ref();
+
     auto server = Core::TCPServer::construct();
 
     server->on_ready_to_accept = [&] {
         auto client_socket = server->accept();
-        VERIFY(client_socket);
-        auto client = WebServer::Client::construct(client_socket.release_nonnull(), real_root_path, server);
+        if (!client_socket)
+            return;
+        auto client = WebServer::Client::construct(client_socket.release_nonnull(), request_handler, worker_pool, server);
         client->start();
     };
 
@@ -78,7 +95,7 @@ int main(int argc, char** argv)
         return 1;
     }
 
-    outln("Listening on 0.0.0.0:{}", port);
+    outln("Listening on 0.0.0.0:{} with {} worker threads", port, thread_count);
 
     if (unveil("/res/icons", "r") < 0) {
         perror("unveil");
@@ -92,7 +109,7 @@ int main(int argc, char** argv)
 
     unveil(nullptr, nullptr);
 
-    if (pledge("stdio accept rpath", nullptr) < 0) {
+    if (pledge("stdio accept rpath thread", nullptr) < 0) {
         perror("pledge");
         return 1;
     }
@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) 2021, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <AK/Atomic.h>
+#include <AK/NonnullOwnPtrVector.h>
+#include <LibCore/ArgsParser.h>
+#include <LibCore/ElapsedTimer.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+// Measures how many context switches per second the scheduler can sustain.
+// Each pair of threads bounces a single byte back and forth through two
+// pipes, so every round trip forces two blocking reads and two wakeups.
+// Running with more pairs than processors shows how the scheduler scales.
+
+static Atomic<bool> s_stop { false };
+
+struct PingPongPair {
+    int ping_fds[2] { -1, -1 };
+    int pong_fds[2] { -1, -1 };
+    pthread_t pinger {};
+    pthread_t ponger {};
+    u64 round_trips { 0 };
+};
+
+static void* pinger_main(void* arg)
+{
+    auto& pair = *reinterpret_cast<PingPongPair*>(arg);
+    char byte = 'x';
+    while (!s_stop.load(AK::MemoryOrder::memory_order_relaxed)) {
+        if (write(pair.ping_fds[1], &byte, 1) != 1 || read(pair.pong_fds[0], &byte, 1) != 1) {
+            perror("pinger");
+            break;
+        }
+        ++pair.round_trips;
+    }
+    // Wake up the ponger one last time so it can notice we're done
+    close(pair.ping_fds[1]);
+    return nullptr;
+}
+
+static void* ponger_main(void* arg)
+{
+    auto& pair = *reinterpret_cast<PingPongPair*>(arg);
+    char byte;
+    for (;;) {
+        auto nread = read(pair.ping_fds[0], &byte, 1);
+        if (nread <= 0)
+            break;
+        if (write(pair.pong_fds[1], &byte, 1) != 1)
+            break;
+    }
+    close(pair.pong_fds[1]);
+    return nullptr;
+}
+
+static bool run_round(int pair_count, int seconds, u64& switches_per_second)
+{
+    NonnullOwnPtrVector<PingPongPair> pairs;
+    for (int i = 0; i < pair_count; ++i) {
+        auto pair = make<PingPongPair>();
+        if (pipe(pair->ping_fds) < 0 || pipe(pair->pong_fds) < 0) {
+            perror("pipe");
+            return false;
+        }
+        pairs.append(move(pair));
+    }
+
+    s_stop.store(false);
+    Core::ElapsedTimer timer(true);
+    timer.start();
+
+    for (auto& pair : pairs) {
+        if (pthread_create(&pair.ponger, nullptr, ponger_main, &pair) != 0 || pthread_create(&pair.pinger, nullptr, pinger_main, &pair) != 0) {
+            perror("pthread_create");
+            return false;
+        }
+    }
+
+    sleep(seconds);
+    s_stop.store(true);
+
+    u64 total_round_trips = 0;
+    for (auto& pair : pairs) {
+        pthread_join(pair.pinger, nullptr);
+        pthread_join(pair.ponger, nullptr);
+        close(pair.ping_fds[0]);
+        close(pair.pong_fds[0]);
+        total_round_trips += pair.round_trips;
+    }
+
+    auto elapsed_ms = max(timer.elapsed(), 1);
+    // Every round trip is two blocking reads, i.e. at least two context switches.
+    switches_per_second = total_round_trips * 2 * 1000 / elapsed_ms;
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    int max_pairs = 0;
+    int seconds = 3;
+
+    Core::ArgsParser args_parser;
+    args_parser.set_general_help("Measure context switches per second with an increasing number of ping-ponging thread pairs.");
+    args_parser.add_option(max_pairs, "Maximum number of thread pairs (default: twice the number of processors)", "pairs", 'p', "count");
+    args_parser.add_option(seconds, "Duration of each round in seconds", "seconds", 's', "seconds");
+    args_parser.parse(argc, argv);
+
+    auto processor_count = sysconf(_SC_NPROCESSORS_ONLN);
+    if (processor_count < 1)
+        processor_count = 1;
+    if (max_pairs <= 0)
+        max_pairs = processor_count * 2;
+
+    outln("Processors: {}", processor_count);
+    outln("{:>6} {:>16} {:>16}", "pairs", "switches/s", "per pair");
+    for (int pair_count = 1; pair_count <= max_pairs; ++pair_count) {
+        u64 switches_per_second = 0;
+        if (!run_round(pair_count, seconds, switches_per_second))
+            return 1;
+        outln("{:>6} {:>16} {:>16}", pair_count, switches_per_second, switches_per_second / pair_count);
+    }
+    return 0;
+}
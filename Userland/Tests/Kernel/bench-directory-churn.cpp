@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2021, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <AK/String.h>
+#include <LibCore/ArgsParser.h>
+#include <LibCore/ElapsedTimer.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Creates, looks up and deletes many files in a single directory. The rate is
+// reported per batch, so a directory whose operations get slower as it grows
+// (i.e. a linear directory that is rewritten on every change) is easy to spot.
+
+static String file_path(const char* directory, int index)
+{
+    return String::formatted("{}/spool-file-{:06}", directory, index);
+}
+
+static void report(const char* operation, int first, int count, int elapsed_ms)
+{
+    elapsed_ms = max(elapsed_ms, 1);
+    outln("{:<8} {:>8}..{:<8} {:>10} ops/s", operation, first, first + count, (u64)count * 1000 / elapsed_ms);
+}
+
+int main(int argc, char** argv)
+{
+    const char* directory = "/tmp/bench-directory-churn";
+    int file_count = 20000;
+    int batch_size = 2000;
+
+    Core::ArgsParser args_parser;
+    args_parser.set_general_help("Measure file creation, lookup and deletion rates in one large directory.");
+    args_parser.add_option(directory, "Directory to create the files in (default: /tmp/bench-directory-churn)", "directory", 'd', "path");
+    args_parser.add_option(file_count, "Number of files to create", "files", 'n', "count");
+    args_parser.add_option(batch_size, "Number of operations per reported batch", "batch", 'b', "count");
+    args_parser.parse(argc, argv);
+
+    if (batch_size <= 0)
+        batch_size = file_count;
+
+    if (mkdir(directory, 0755) < 0) {
+        perror("mkdir");
+        return 1;
+    }
+
+    Core::ElapsedTimer timer;
+    for (int first = 0; first < file_count; first += batch_size) {
+        int count = min(batch_size, file_count - first);
+        timer.start();
+        for (int i = first; i < first + count; ++i) {
+            int fd = open(file_path(directory, i).characters(), O_CREAT | O_EXCL | O_WRONLY, 0644);
+            if (fd < 0) {
+                perror("open");
+                return 1;
+            }
+            close(fd);
+        }
+        report("create", first, count, timer.elapsed());
+    }
+
+    timer.start();
+    for (int i = 0; i < file_count; ++i) {
+        struct stat st;
+        if (stat(file_path(directory, i).characters(), &st) < 0) {
+            perror("stat");
+            return 1;
+        }
+    }
+    report("stat", 0, file_count, timer.elapsed());
+
+    for (int first = 0; first < file_count; first += batch_size) {
+        int count = min(batch_size, file_count - first);
+        timer.start();
+        for (int i = first; i < first + count; ++i) {
+            if (unlink(file_path(directory, i).characters()) < 0) {
+                perror("unlink");
+                return 1;
+            }
+        }
+        report("unlink", first, count, timer.elapsed());
+    }
+
+    if (rmdir(directory) < 0) {
+        perror("rmdir");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,188 @@
+/*
+ * Copyright (c) 2021, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <AK/Vector.h>
+#include <LibCore/ArgsParser.h>
+#include <LibCore/ElapsedTimer.h>
+#include <stdio.h>
+#include <sys/epoll.h>
+#include <sys/select.h>
+#include <unistd.h>
+
+// Compares the cost of waiting for a single active file descriptor among many
+// idle ones using select() (which has to scan the whole set on every call)
+// versus epoll_wait() (which only looks at the descriptors that became ready).
+// Each idle descriptor is the read end of a pipe that never gets written to.
+
+struct Pipe {
+    int read_fd { -1 };
+    int write_fd { -1 };
+};
+
+static bool make_pipe(Pipe& p)
+{
+    int fds[2];
+    if (pipe(fds) < 0) {
+        perror("pipe");
+        return false;
+    }
+    p.read_fd = fds[0];
+    p.write_fd = fds[1];
+    return true;
+}
+
+static bool ping(const Pipe& active)
+{
+    char byte = 'x';
+    if (write(active.write_fd, &byte, 1) != 1) {
+        perror("write");
+        return false;
+    }
+    return true;
+}
+
+static bool pong(const Pipe& active)
+{
+    char byte;
+    if (read(active.read_fd, &byte, 1) != 1) {
+        perror("read");
+        return false;
+    }
+    return true;
+}
+
+static i64 bench_select(const Vector<Pipe>& idle, const Pipe& active, int iterations)
+{
+    int max_fd = active.read_fd;
+    for (auto& p : idle)
+        max_fd = max(max_fd, p.read_fd);
+
+    Core::ElapsedTimer timer(true);
+    timer.start();
+    for (int i = 0; i < iterations; ++i) {
+        if (!ping(active))
+            return -1;
+        fd_set rfds;
+        FD_ZERO(&rfds);
+        FD_SET(active.read_fd, &rfds);
+        for (auto& p : idle)
+            FD_SET(p.read_fd, &rfds);
+        int rc = select(max_fd + 1, &rfds, nullptr, nullptr, nullptr);
+        if (rc != 1 || !FD_ISSET(active.read_fd, &rfds)) {
+            perror("select");
+            return -1;
+        }
+        if (!pong(active))
+            return -1;
+    }
+    return timer.elapsed();
+}
+
+static i64 bench_epoll(const Vector<Pipe>& idle, const Pipe& active, int iterations)
+{
+    int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd < 0) {
+        perror("epoll_create1");
+        return -1;
+    }
+
+    auto add = [&](int fd) {
+        epoll_event event {};
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0) {
+            perror("epoll_ctl");
+            return false;
+        }
+        return true;
+    };
+    if (!add(active.read_fd))
+        return -1;
+    for (auto& p : idle) {
+        if (!add(p.read_fd))
+            return -1;
+    }
+
+    Core::ElapsedTimer timer(true);
+    timer.start();
+    for (int i = 0; i < iterations; ++i) {
+        if (!ping(active))
+            return -1;
+        epoll_event events[8];
+        int rc = epoll_wait(epoll_fd, events, 8, -1);
+        if (rc != 1 || events[0].data.fd != active.read_fd) {
+            perror("epoll_wait");
+            return -1;
+        }
+        if (!pong(active))
+            return -1;
+    }
+    auto elapsed = timer.elapsed();
+    close(epoll_fd);
+    return elapsed;
+}
+
+int main(int argc, char** argv)
+{
+    int max_idle = 480;
+    int iterations = 10000;
+
+    Core::ArgsParser args_parser;
+    args_parser.set_general_help("Compare select() and epoll_wait() latency with an increasing number of idle file descriptors.");
+    args_parser.add_option(max_idle, "Maximum number of idle pipes (each one uses two fds)", "idle", 'n', "count");
+    args_parser.add_option(iterations, "Number of wakeups to measure per round", "iterations", 'i', "count");
+    args_parser.parse(argc, argv);
+
+    Pipe active;
+    if (!make_pipe(active))
+        return 1;
+
+    Vector<Pipe> idle;
+    outln("{:>8} {:>14} {:>14}", "idle fds", "select us/op", "epoll us/op");
+    for (int idle_count = 0; idle_count <= max_idle; idle_count = idle_count ? idle_count * 2 : 15) {
+        idle_count = min(idle_count, max_idle);
+        while ((int)idle.size() < idle_count) {
+            Pipe p;
+            if (!make_pipe(p))
+                return 1;
+            idle.append(p);
+        }
+
+        auto select_ms = bench_select(idle, active, iterations);
+        auto epoll_ms = bench_epoll(idle, active, iterations);
+        if (select_ms < 0 || epoll_ms < 0)
+            return 1;
+        outln("{:>8} {:>14} {:>14}", idle_count, select_ms * 1000 / iterations, epoll_ms * 1000 / iterations);
+        if (idle_count == max_idle)
+            break;
+    }
+
+    for (auto& p : idle) {
+        close(p.read_fd);
+        close(p.write_fd);
+    }
+    return 0;
+}
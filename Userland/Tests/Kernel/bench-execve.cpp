@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) 2021, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "BenchmarkHelpers.h"
+#include <AK/QuickSort.h>
+#include <AK/String.h>
+#include <AK/Vector.h>
+#include <LibCore/ArgsParser.h>
+#include <errno.h>
+#include <spawn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Measures how long it takes to get a program running. Without a command, this
+// program spawns itself and reports the time from posix_spawn() until the child
+// reaches main(), which covers execve(), dynamic loading and all the page faults
+// taken on the way. With a command, it reports the time until that command exits.
+
+extern char** environ;
+
+static constexpr const char* report_startup_option = "--report-startup-since";
+
+static bool run_once(const Vector<const char*>& command, bool report_startup, u64& elapsed_ns)
+{
+    int pipe_fds[2] = { -1, -1 };
+    posix_spawn_file_actions_t file_actions;
+    posix_spawn_file_actions_init(&file_actions);
+    if (report_startup) {
+        if (pipe(pipe_fds) < 0) {
+            perror("pipe");
+            return false;
+        }
+        posix_spawn_file_actions_adddup2(&file_actions, pipe_fds[1], STDOUT_FILENO);
+        posix_spawn_file_actions_addclose(&file_actions, pipe_fds[0]);
+    }
+
+    auto argv = command;
+    String start_string;
+    auto start = now_ns();
+    if (report_startup) {
+        start_string = String::number(start);
+        argv.append(report_startup_option);
+        argv.append(start_string.characters());
+    }
+    argv.append(nullptr);
+
+    pid_t pid;
+    int rc = posix_spawnp(&pid, argv[0], &file_actions, nullptr, const_cast<char**>(argv.data()), environ);
+    posix_spawn_file_actions_destroy(&file_actions);
+    if (report_startup)
+        close(pipe_fds[1]);
+    if (rc != 0) {
+        errno = rc;
+        perror("posix_spawn");
+        if (report_startup)
+            close(pipe_fds[0]);
+        return false;
+    }
+
+    bool success = true;
+    if (report_startup) {
+        u64 startup_ns = 0;
+        if (read(pipe_fds[0], &startup_ns, sizeof(startup_ns)) != sizeof(startup_ns)) {
+            warnln("Child didn't report its startup time");
+            success = false;
+        }
+        close(pipe_fds[0]);
+        elapsed_ns = startup_ns;
+    }
+
+    int status = 0;
+    if (waitpid(pid, &status, 0) < 0) {
+        perror("waitpid");
+        return false;
+    }
+    if (!report_startup)
+        elapsed_ns = now_ns() - start;
+    if (!WIFEXITED(status)) {
+        warnln("{} did not exit normally", argv[0]);
+        return false;
+    }
+    return success;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc == 3 && !strcmp(argv[1], report_startup_option)) {
+        u64 startup_ns = now_ns() - strtoull(argv[2], nullptr, 10);
+        return write(STDOUT_FILENO, &startup_ns, sizeof(startup_ns)) == sizeof(startup_ns) ? 0 : 1;
+    }
+
+    int iterations = 100;
+    Vector<const char*> command;
+
+    Core::ArgsParser args_parser;
+    args_parser.set_general_help("Measure how long it takes to execve() a program and get it to main(), or to run a command.");
+    args_parser.add_option(iterations, "Number of runs (default: 100)", "iterations", 'n', "count");
+    args_parser.add_positional_argument(command, "Command to time until it exits (default: time our own startup)", "command", Core::ArgsParser::Required::No);
+    args_parser.parse(argc, argv);
+
+    if (iterations <= 0) {
+        warnln("Iterations must be positive");
+        return 1;
+    }
+
+    bool report_startup = command.is_empty();
+    if (report_startup)
+        command.append(argv[0]);
+
+    Vector<u64> samples;
+    samples.ensure_capacity(iterations);
+    u64 total_ns = 0;
+    for (int i = 0; i < iterations; ++i) {
+        u64 elapsed_ns = 0;
+        if (!run_once(command, report_startup, elapsed_ns))
+            return 1;
+        samples.append(elapsed_ns);
+        total_ns += elapsed_ns;
+    }
+
+    quick_sort(samples);
+    outln("{} {} runs of {}. All times in us.", report_startup ? "Startup time over" : "Run time over", iterations, command[0]);
+    outln("{:>10} {:>10} {:>10} {:>10} {:>10}", "avg", "min", "p50", "p99", "max");
+    outln("{:>10} {:>10} {:>10} {:>10} {:>10}",
+        total_ns / iterations / 1000,
+        samples.first() / 1000,
+        percentile(samples, 50) / 1000,
+        percentile(samples, 99) / 1000,
+        samples.last() / 1000);
+    return 0;
+}
@@ -0,0 +1,235 @@
+/*
+ * Copyright (c) 2021, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <AK/ByteBuffer.h>
+#include <AK/Vector.h>
+#include <LibCore/ArgsParser.h>
+#include <LibCore/ElapsedTimer.h>
+#include <LibCore/EventLoop.h>
+#include <LibCore/IORing.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
+
+// Compares issuing I/O one system call at a time with batching it through an
+// I/O ring. The file test reads a file block by block with pread() and then
+// with batches of ring submissions. The pipe test keeps a read in flight on
+// many pipes at once, which the ring completes as the pipes become readable.
+
+static const char* file_path = "/tmp/bench-io-ring.data";
+
+static bool create_test_file(size_t size)
+{
+    int fd = open(file_path, O_CREAT | O_TRUNC | O_WRONLY, 0600);
+    if (fd < 0) {
+        perror("open");
+        return false;
+    }
+    auto block = ByteBuffer::create_zeroed(64 * KiB);
+    for (size_t written = 0; written < size; written += block.size()) {
+        if (write(fd, block.data(), block.size()) != (ssize_t)block.size()) {
+            perror("write");
+            close(fd);
+            return false;
+        }
+    }
+    close(fd);
+    return true;
+}
+
+static bool measure_pread(size_t file_size, size_t block_size, u64& operations_per_second)
+{
+    int fd = open(file_path, O_RDONLY);
+    if (fd < 0) {
+        perror("open");
+        return false;
+    }
+    auto buffer = ByteBuffer::create_uninitialized(block_size);
+    size_t block_count = file_size / block_size;
+
+    Core::ElapsedTimer timer;
+    timer.start();
+    for (size_t i = 0; i < block_count; ++i) {
+        if (pread(fd, buffer.data(), block_size, i * block_size) != (ssize_t)block_size) {
+            perror("pread");
+            close(fd);
+            return false;
+        }
+    }
+    auto elapsed_ms = max(timer.elapsed(), 1);
+    close(fd);
+    operations_per_second = (u64)block_count * 1000 / elapsed_ms;
+    return true;
+}
+
+static bool measure_ring_read(size_t file_size, size_t block_size, size_t batch_size, u64& operations_per_second)
+{
+    int fd = open(file_path, O_RDONLY);
+    if (fd < 0) {
+        perror("open");
+        return false;
+    }
+    auto ring = Core::IORing::construct(batch_size);
+    if (!ring->is_valid())
+        return false;
+
+    // Every operation in a batch needs its own buffer, they are all in flight at the same time.
+    auto buffers = ByteBuffer::create_uninitialized(block_size * batch_size);
+    size_t block_count = file_size / block_size;
+    bool ok = true;
+
+    Core::ElapsedTimer timer;
+    timer.start();
+    for (size_t first_block = 0; first_block < block_count && ok; first_block += batch_size) {
+        size_t blocks_in_batch = min(batch_size, block_count - first_block);
+        for (size_t i = 0; i < blocks_in_batch; ++i) {
+            ring->submit_read(
+                fd, buffers.offset_pointer(i * block_size), block_size, [&](int result) {
+                    if (result != (int)block_size)
+                        ok = false;
+                },
+                (first_block + i) * block_size);
+        }
+        if (!ring->wait(blocks_in_batch))
+            ok = false;
+    }
+    auto elapsed_ms = max(timer.elapsed(), 1);
+    close(fd);
+    if (!ok) {
+        warnln("Ring read failed");
+        return false;
+    }
+    operations_per_second = (u64)block_count * 1000 / elapsed_ms;
+    return true;
+}
+
+static bool measure_ring_pipes(size_t pipe_count, int rounds, u64& operations_per_second)
+{
+    Vector<int> read_fds;
+    Vector<int> write_fds;
+    for (size_t i = 0; i < pipe_count; ++i) {
+        int fds[2];
+        if (pipe(fds) < 0) {
+            perror("pipe");
+            return false;
+        }
+        read_fds.append(fds[0]);
+        write_fds.append(fds[1]);
+    }
+
+    auto ring = Core::IORing::construct(pipe_count);
+    if (!ring->is_valid())
+        return false;
+
+    Vector<u8> bytes;
+    bytes.resize(pipe_count);
+    size_t completed = 0;
+    bool ok = true;
+
+    Core::ElapsedTimer timer;
+    timer.start();
+    for (int round = 0; round < rounds && ok; ++round) {
+        // Park a read on every pipe first, then make them readable one by one.
+        for (size_t i = 0; i < pipe_count; ++i) {
+            ring->submit_read(read_fds[i], &bytes[i], 1, [&](int result) {
+                if (result != 1)
+                    ok = false;
+                ++completed;
+            });
+        }
+        ring->flush();
+        for (size_t i = 0; i < pipe_count; ++i) {
+            u8 byte = round;
+            if (write(write_fds[i], &byte, 1) != 1) {
+                perror("write");
+                ok = false;
+                break;
+            }
+        }
+        while (ok && ring->in_flight() > 0)
+            ok = ring->wait(ring->in_flight());
+    }
+    auto elapsed_ms = max(timer.elapsed(), 1);
+
+    for (size_t i = 0; i < pipe_count; ++i) {
+        close(read_fds[i]);
+        close(write_fds[i]);
+    }
+    if (!ok) {
+        warnln("Pipe reads failed");
+        return false;
+    }
+    operations_per_second = (u64)completed * 1000 / elapsed_ms;
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    int file_megabytes = 16;
+    int batch_size = 64;
+    int pipe_count = 256;
+    int rounds = 100;
+
+    Core::ArgsParser args_parser;
+    args_parser.set_general_help("Compare one system call per I/O with batched I/O through an I/O ring.");
+    args_parser.add_option(file_megabytes, "Size of the test file in megabytes", "megabytes", 'm', "count");
+    args_parser.add_option(batch_size, "Number of ring submissions per batch", "batch", 'b', "count");
+    args_parser.add_option(pipe_count, "Number of pipes with a read in flight", "pipes", 'p', "count");
+    args_parser.add_option(rounds, "Number of rounds of pipe reads", "rounds", 'r', "count");
+    args_parser.parse(argc, argv);
+
+    if (batch_size <= 0 || batch_size > IO_RING_MAX_ENTRIES || pipe_count <= 0 || pipe_count > IO_RING_MAX_ENTRIES) {
+        warnln("Batch size and pipe count must be between 1 and {}", IO_RING_MAX_ENTRIES);
+        return 1;
+    }
+
+    // The rings are only driven through wait(), but LibCore objects expect an event loop to exist.
+    Core::EventLoop loop;
+
+    size_t file_size = (size_t)file_megabytes * MiB;
+    if (!create_test_file(file_size))
+        return 1;
+
+    static constexpr size_t block_sizes[] = { 512, 4096, 65536 };
+
+    outln("{:<10} {:>10} {:>14} {:>14}", "test", "block", "pread ops/s", "ring ops/s");
+    for (auto block_size : block_sizes) {
+        u64 pread_operations_per_second = 0;
+        u64 ring_operations_per_second = 0;
+        if (!measure_pread(file_size, block_size, pread_operations_per_second))
+            return 1;
+        if (!measure_ring_read(file_size, block_size, batch_size, ring_operations_per_second))
+            return 1;
+        outln("{:<10} {:>10} {:>14} {:>14}", "file", block_size, pread_operations_per_second, ring_operations_per_second);
+    }
+    unlink(file_path);
+
+    u64 pipe_operations_per_second = 0;
+    if (!measure_ring_pipes(pipe_count, rounds, pipe_operations_per_second))
+        return 1;
+    outln("{:<10} {:>10} {:>14} {:>14}", "pipes", 1, "-", pipe_operations_per_second);
+    return 0;
+}
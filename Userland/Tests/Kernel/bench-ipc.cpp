@@ -0,0 +1,253 @@
+/*
+ * Copyright (c) 2021, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <AK/ByteBuffer.h>
+#include <AK/Function.h>
+#include <LibCore/ArgsParser.h>
+#include <LibCore/ElapsedTimer.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Measures the bandwidth and latency of the two byte stream IPC mechanisms,
+// pipes and local sockets. For bandwidth, a writer thread streams messages of
+// a given size to a reader thread. For latency, two threads bounce a single
+// message back and forth.
+
+struct Channel {
+    int write_fd { -1 };
+    int read_fd { -1 };
+};
+
+struct ChannelPair {
+    Channel forward;
+    Channel backward;
+};
+
+static bool make_pipe_channel(Channel& channel)
+{
+    int fds[2];
+    if (pipe(fds) < 0) {
+        perror("pipe");
+        return false;
+    }
+    channel = { fds[1], fds[0] };
+    return true;
+}
+
+static const char* socket_path = "/tmp/bench-ipc.socket";
+
+static bool make_socket_channels(ChannelPair& pair)
+{
+    unlink(socket_path);
+    int server_fd = socket(AF_LOCAL, SOCK_STREAM, 0);
+    if (server_fd < 0) {
+        perror("socket");
+        return false;
+    }
+    sockaddr_un address {};
+    address.sun_family = AF_LOCAL;
+    strlcpy(address.sun_path, socket_path, sizeof(address.sun_path));
+    if (bind(server_fd, (const sockaddr*)&address, sizeof(address)) < 0 || listen(server_fd, 1) < 0) {
+        perror("bind/listen");
+        return false;
+    }
+    int client_fd = socket(AF_LOCAL, SOCK_STREAM, 0);
+    if (client_fd < 0 || connect(client_fd, (const sockaddr*)&address, sizeof(address)) < 0) {
+        perror("connect");
+        return false;
+    }
+    int accepted_fd = accept(server_fd, nullptr, nullptr);
+    if (accepted_fd < 0) {
+        perror("accept");
+        return false;
+    }
+    close(server_fd);
+    unlink(socket_path);
+    // Local sockets are bidirectional, so one connection serves both directions.
+    pair.forward = { client_fd, accepted_fd };
+    pair.backward = { accepted_fd, client_fd };
+    return true;
+}
+
+static bool make_channels(bool use_sockets, ChannelPair& pair)
+{
+    if (use_sockets)
+        return make_socket_channels(pair);
+    return make_pipe_channel(pair.forward) && make_pipe_channel(pair.backward);
+}
+
+static void close_channels(bool use_sockets, ChannelPair& pair)
+{
+    close(pair.forward.write_fd);
+    close(pair.forward.read_fd);
+    if (!use_sockets) {
+        close(pair.backward.write_fd);
+        close(pair.backward.read_fd);
+    }
+}
+
+static bool write_all(int fd, const u8* data, size_t size)
+{
+    while (size > 0) {
+        auto nwritten = write(fd, data, size);
+        if (nwritten <= 0)
+            return false;
+        data += nwritten;
+        size -= nwritten;
+    }
+    return true;
+}
+
+static bool read_all(int fd, u8* data, size_t size)
+{
+    while (size > 0) {
+        auto nread = read(fd, data, size);
+        if (nread <= 0)
+            return false;
+        data += nread;
+        size -= nread;
+    }
+    return true;
+}
+
+struct ThreadContext {
+    Function<void()> function;
+};
+
+static void* thread_main(void* arg)
+{
+    reinterpret_cast<ThreadContext*>(arg)->function();
+    return nullptr;
+}
+
+static bool measure_bandwidth(bool use_sockets, size_t message_size, size_t total_size, u64& bytes_per_second)
+{
+    ChannelPair pair;
+    if (!make_channels(use_sockets, pair))
+        return false;
+
+    size_t message_count = max(total_size / message_size, (size_t)1);
+    bool reader_ok = true;
+    ThreadContext reader {
+        [&] {
+            auto buffer = ByteBuffer::create_uninitialized(message_size);
+            for (size_t i = 0; i < message_count && reader_ok; ++i)
+                reader_ok = read_all(pair.forward.read_fd, buffer.data(), message_size);
+        }
+    };
+
+    Core::ElapsedTimer timer;
+    timer.start();
+    pthread_t reader_thread;
+    if (pthread_create(&reader_thread, nullptr, thread_main, &reader) != 0) {
+        perror("pthread_create");
+        return false;
+    }
+    auto message = ByteBuffer::create_zeroed(message_size);
+    bool writer_ok = true;
+    for (size_t i = 0; i < message_count && writer_ok; ++i)
+        writer_ok = write_all(pair.forward.write_fd, message.data(), message_size);
+    pthread_join(reader_thread, nullptr);
+    auto elapsed_ms = max(timer.elapsed(), 1);
+
+    close_channels(use_sockets, pair);
+    if (!writer_ok || !reader_ok) {
+        warnln("Transfer failed");
+        return false;
+    }
+    bytes_per_second = (u64)message_count * message_size * 1000 / elapsed_ms;
+    return true;
+}
+
+static bool measure_latency(bool use_sockets, size_t message_size, int round_trips, u64& nanoseconds_per_round_trip)
+{
+    ChannelPair pair;
+    if (!make_channels(use_sockets, pair))
+        return false;
+
+    bool echo_ok = true;
+    ThreadContext echo {
+        [&] {
+            auto buffer = ByteBuffer::create_uninitialized(message_size);
+            for (int i = 0; i < round_trips && echo_ok; ++i)
+                echo_ok = read_all(pair.forward.read_fd, buffer.data(), message_size) && write_all(pair.backward.write_fd, buffer.data(), message_size);
+        }
+    };
+
+    Core::ElapsedTimer timer;
+    timer.start();
+    pthread_t echo_thread;
+    if (pthread_create(&echo_thread, nullptr, thread_main, &echo) != 0) {
+        perror("pthread_create");
+        return false;
+    }
+    auto message = ByteBuffer::create_zeroed(message_size);
+    bool ok = true;
+    for (int i = 0; i < round_trips && ok; ++i)
+        ok = write_all(pair.forward.write_fd, message.data(), message_size) && read_all(pair.backward.read_fd, message.data(), message_size);
+    pthread_join(echo_thread, nullptr);
+    auto elapsed_ms = max(timer.elapsed(), 1);
+
+    close_channels(use_sockets, pair);
+    if (!ok || !echo_ok) {
+        warnln("Round trip failed");
+        return false;
+    }
+    nanoseconds_per_round_trip = (u64)elapsed_ms * 1000000 / max(round_trips, 1);
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    int total_megabytes = 64;
+    int round_trips = 20000;
+
+    Core::ArgsParser args_parser;
+    args_parser.set_general_help("Measure pipe and local socket bandwidth and round trip latency.");
+    args_parser.add_option(total_megabytes, "Megabytes to transfer per bandwidth test", "megabytes", 'm', "count");
+    args_parser.add_option(round_trips, "Number of round trips per latency test", "round-trips", 'r', "count");
+    args_parser.parse(argc, argv);
+
+    static constexpr size_t message_sizes[] = { 64, 1024, 4096, 65536, 262144 };
+
+    outln("{:<8} {:>10} {:>14} {:>14}", "channel", "message", "MiB/s", "ns/round trip");
+    for (bool use_sockets : { false, true }) {
+        for (auto message_size : message_sizes) {
+            u64 bytes_per_second = 0;
+            u64 nanoseconds_per_round_trip = 0;
+            if (!measure_bandwidth(use_sockets, message_size, (size_t)total_megabytes * MiB, bytes_per_second))
+                return 1;
+            if (!measure_latency(use_sockets, message_size, message_size > 4096 ? round_trips / 10 : round_trips, nanoseconds_per_round_trip))
+                return 1;
+            outln("{:<8} {:>10} {:>14} {:>14}", use_sockets ? "socket" : "pipe", message_size, bytes_per_second / MiB, nanoseconds_per_round_trip);
+        }
+    }
+    return 0;
+}
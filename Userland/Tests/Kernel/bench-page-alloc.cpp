@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2021, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "BenchmarkHelpers.h"
+#include <AK/QuickSort.h>
+#include <AK/Vector.h>
+#include <LibCore/ArgsParser.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Measures how long it takes the kernel to hand out and take back physical
+// pages. Every first touch of an anonymous page faults in a fresh zeroed
+// page, and munmap() returns all of them to the physical page allocator.
+// Running several processes at once shows how well that scales across
+// processors.
+
+static constexpr size_t page_size = 4096;
+static constexpr size_t pages_per_sample = 16;
+
+static bool run_worker(int worker, size_t page_count, int rounds)
+{
+    Vector<u64> fault_samples;
+    fault_samples.ensure_capacity(rounds * (page_count / pages_per_sample));
+    u64 total_fault_ns = 0;
+    u64 total_unmap_ns = 0;
+
+    for (int round = 0; round < rounds; ++round) {
+        auto* memory = (u8*)mmap(nullptr, page_count * page_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, 0, 0);
+        if (memory == MAP_FAILED) {
+            perror("mmap");
+            return false;
+        }
+
+        for (size_t page = 0; page + pages_per_sample <= page_count; page += pages_per_sample) {
+            auto start = now_ns();
+            for (size_t i = 0; i < pages_per_sample; ++i)
+                memory[(page + i) * page_size] = 1;
+            auto elapsed = now_ns() - start;
+            fault_samples.append(elapsed / pages_per_sample);
+            total_fault_ns += elapsed;
+        }
+
+        auto start = now_ns();
+        if (munmap(memory, page_count * page_size) < 0) {
+            perror("munmap");
+            return false;
+        }
+        total_unmap_ns += now_ns() - start;
+    }
+
+    quick_sort(fault_samples);
+    auto pages_touched = max((u64)1, (u64)fault_samples.size() * pages_per_sample);
+    auto pages_unmapped = max((u64)1, (u64)rounds * page_count);
+    outln("{:>6} {:>10} {:>10} {:>10} {:>10} {:>12}", worker,
+        total_fault_ns / pages_touched,
+        percentile(fault_samples, 50),
+        percentile(fault_samples, 99),
+        fault_samples.is_empty() ? 0 : fault_samples.last(),
+        total_unmap_ns / pages_unmapped);
+    fflush(stdout);
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    int megabytes = 16;
+    int rounds = 8;
+    int workers = 1;
+
+    Core::ArgsParser args_parser;
+    args_parser.set_general_help("Measure the latency of page faults that allocate physical pages, and of munmap() freeing them.");
+    args_parser.add_option(megabytes, "Memory touched per round in MiB (default: 16)", "size", 's', "MiB");
+    args_parser.add_option(rounds, "Number of rounds (default: 8)", "rounds", 'r', "count");
+    args_parser.add_option(workers, "Number of processes allocating at the same time (default: 1)", "workers", 'j', "count");
+    args_parser.parse(argc, argv);
+
+    if (megabytes <= 0 || rounds <= 0 || workers <= 0) {
+        warnln("Size, rounds and workers must be positive");
+        return 1;
+    }
+
+    size_t page_count = (size_t)megabytes * MiB / page_size;
+    outln("Touching {} pages per round, {} rounds, {} worker(s). All times in ns per page.", page_count, rounds, workers);
+    outln("{:>6} {:>10} {:>10} {:>10} {:>10} {:>12}", "worker", "fault avg", "p50", "p99", "max", "munmap avg");
+    // Make sure the header isn't duplicated into the children's buffers.
+    fflush(stdout);
+
+    if (workers == 1)
+        return run_worker(0, page_count, rounds) ? 0 : 1;
+
+    Vector<pid_t> children;
+    for (int worker = 0; worker < workers; ++worker) {
+        pid_t pid = fork();
+        if (pid < 0) {
+            perror("fork");
+            break;
+        }
+        if (pid == 0)
+            _exit(run_worker(worker, page_count, rounds) ? 0 : 1);
+        children.append(pid);
+    }
+
+    int exit_code = children.size() == (size_t)workers ? 0 : 1;
+    for (auto pid : children) {
+        int status = 0;
+        if (waitpid(pid, &status, 0) < 0) {
+            perror("waitpid");
+            exit_code = 1;
+            continue;
+        }
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+            exit_code = 1;
+    }
+    return exit_code;
+}
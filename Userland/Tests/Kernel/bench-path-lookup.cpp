@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2021, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <AK/String.h>
+#include <AK/Vector.h>
+#include <LibCore/ArgsParser.h>
+#include <LibCore/ElapsedTimer.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Measures how fast the kernel resolves paths. Each test repeatedly stat()s
+// or open()s the same set of paths, so after the first iteration every
+// component lookup should be served from the dentry cache. The PATH search
+// test mimics a shell looking for a command in several directories where it
+// only exists in the last one, which mostly exercises negative lookups.
+
+struct Test {
+    const char* name;
+    Vector<String> paths;
+    bool use_open { false };
+};
+
+static void run_test(const Test& test, int iterations)
+{
+    u64 succeeded = 0;
+    u64 failed = 0;
+    Core::ElapsedTimer timer(true);
+    timer.start();
+    for (int i = 0; i < iterations; ++i) {
+        for (auto& path : test.paths) {
+            if (test.use_open) {
+                int fd = open(path.characters(), O_RDONLY);
+                if (fd < 0) {
+                    ++failed;
+                    continue;
+                }
+                close(fd);
+                ++succeeded;
+            } else {
+                struct stat st;
+                if (stat(path.characters(), &st) < 0)
+                    ++failed;
+                else
+                    ++succeeded;
+            }
+        }
+    }
+    auto elapsed_ms = max(timer.elapsed(), 1);
+    auto lookups = succeeded + failed;
+    outln("{:<24} {:>10} {:>10} {:>12} {:>10}", test.name, succeeded, failed, lookups * 1000 / elapsed_ms, elapsed_ms * 1000000 / max(lookups, 1ull));
+}
+
+int main(int argc, char** argv)
+{
+    int iterations = 10000;
+
+    Core::ArgsParser args_parser;
+    args_parser.set_general_help("Measure path resolution throughput for existing and missing paths.");
+    args_parser.add_option(iterations, "Number of iterations per test", "iterations", 'i', "count");
+    args_parser.parse(argc, argv);
+
+    Vector<Test> tests;
+    tests.append({ "stat shallow", { "/bin", "/etc", "/usr" } });
+    tests.append({ "stat deep", { "/usr/lib/libc.so", "/res/icons/16x16/filetype-text.png", "/etc/passwd" } });
+    tests.append({ "stat missing", { "/usr/lib/does-not-exist.so", "/etc/nonexistent", "/bin/no-such-command" } });
+    tests.append({ "stat relative", { "../../etc/passwd", "./../../bin/../usr/lib" } });
+    tests.append({ "open deep", { "/etc/passwd", "/usr/lib/libc.so" }, true });
+
+    Vector<String> path_search;
+    for (auto* directory : { "/usr/local/sbin", "/usr/local/bin", "/usr/sbin", "/usr/bin", "/sbin", "/bin" })
+        path_search.append(String::formatted("{}/ls", directory));
+    tests.append({ "PATH search", move(path_search) });
+
+    outln("{:<24} {:>10} {:>10} {:>12} {:>10}", "test", "found", "missing", "lookups/s", "ns/lookup");
+    for (auto& test : tests)
+        run_test(test, iterations);
+    return 0;
+}
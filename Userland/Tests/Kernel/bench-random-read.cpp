@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) 2021, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <AK/Vector.h>
+#include <LibCore/ArgsParser.h>
+#include <LibCore/ElapsedTimer.h>
+#include <fcntl.h>
+#include <serenity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+// Measures random 4 KiB reads from a large file. The first pass runs with
+// cold caches, so every read has to find its block through the inode's
+// block map; the second pass shows the cost once everything is cached.
+// With -d the reads use O_DIRECT and always go to the disk.
+
+static constexpr size_t read_size = 4096;
+
+static bool create_file(const char* path, size_t file_size)
+{
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        perror("open");
+        return false;
+    }
+
+    Vector<u8> chunk;
+    chunk.resize(64 * KiB);
+    for (size_t i = 0; i < chunk.size(); ++i)
+        chunk[i] = i;
+
+    for (size_t written = 0; written < file_size;) {
+        auto nwritten = write(fd, chunk.data(), min(chunk.size(), file_size - written));
+        if (nwritten <= 0) {
+            perror("write");
+            close(fd);
+            return false;
+        }
+        written += nwritten;
+    }
+    fsync(fd);
+    close(fd);
+    return true;
+}
+
+static bool run_pass(const char* name, int fd, size_t file_size, int read_count)
+{
+    u8 buffer[read_size];
+    size_t block_count = file_size / read_size;
+
+    Core::ElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < read_count; ++i) {
+        off_t offset = (off_t)arc4random_uniform(block_count) * read_size;
+        if (pread(fd, buffer, read_size, offset) != (ssize_t)read_size) {
+            perror("pread");
+            return false;
+        }
+    }
+    auto elapsed_ms = max(timer.elapsed(), 1);
+
+    outln("{:>6} {:>10} {:>12} {:>14}", name, read_count, (u64)read_count * 1000 / elapsed_ms, (u64)elapsed_ms * 1000 / read_count);
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    const char* path = "/home/anon/bench-random-read.dat";
+    int size_in_mib = 256;
+    int read_count = 10000;
+    bool direct = false;
+    bool keep = false;
+
+    Core::ArgsParser args_parser;
+    args_parser.set_general_help("Measure random 4 KiB reads from a large file.");
+    args_parser.add_option(path, "File to read (it will be created)", "path", 'p', "path");
+    args_parser.add_option(size_in_mib, "Size of the file in MiB (default: 256)", "size", 's', "MiB");
+    args_parser.add_option(read_count, "Number of reads in each pass (default: 10000)", "reads", 'n', "count");
+    args_parser.add_option(direct, "Read with O_DIRECT", "direct", 'd');
+    args_parser.add_option(keep, "Keep the file around afterwards", "keep", 'k');
+    args_parser.parse(argc, argv);
+
+    size_t file_size = (size_t)size_in_mib * MiB;
+    if (file_size < read_size || read_count <= 0) {
+        warnln("Nothing to do");
+        return 1;
+    }
+
+    outln("Creating {} MiB file at {}", size_in_mib, path);
+    if (!create_file(path, file_size))
+        return 1;
+
+    int fd = open(path, O_RDONLY | (direct ? O_DIRECT : 0));
+    if (fd < 0) {
+        perror("open");
+        return 1;
+    }
+
+    // Drop whatever the page cache kept around from creating the file.
+    purge(PURGE_ALL_CLEAN_INODE);
+
+    outln("{:>6} {:>10} {:>12} {:>14}", "pass", "reads", "reads/s", "us per read");
+    bool success = run_pass("cold", fd, file_size, read_count) && run_pass("warm", fd, file_size, read_count);
+
+    close(fd);
+    if (!keep)
+        unlink(path);
+    return success ? 0 : 1;
+}
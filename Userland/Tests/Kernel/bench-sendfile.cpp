@@ -0,0 +1,204 @@
+/*
+ * Copyright (c) 2021, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <LibCore/ArgsParser.h>
+#include <LibCore/ElapsedTimer.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Compares sending a file over a socket with a read()/write() loop through a
+// userspace buffer (what WebServer used to do) against sendfile(), which
+// keeps the data inside the kernel. A child process connects over loopback
+// TCP and drains everything we send it.
+
+static constexpr size_t copy_buffer_size = 4096;
+static constexpr size_t fill_chunk_size = 64 * KiB;
+
+static bool create_test_file(const char* path, size_t size)
+{
+    int fd = open(path, O_CREAT | O_TRUNC | O_WRONLY, 0644);
+    if (fd < 0) {
+        perror("open");
+        return false;
+    }
+    auto* chunk = (char*)malloc(fill_chunk_size);
+    for (size_t i = 0; i < fill_chunk_size; ++i)
+        chunk[i] = (char)i;
+    bool ok = true;
+    for (size_t written = 0; written < size;) {
+        auto nwritten = write(fd, chunk, min(size - written, fill_chunk_size));
+        if (nwritten <= 0) {
+            perror("write");
+            ok = false;
+            break;
+        }
+        written += nwritten;
+    }
+    free(chunk);
+    close(fd);
+    return ok;
+}
+
+static pid_t spawn_drain(const sockaddr_in& address)
+{
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork");
+        return -1;
+    }
+    if (pid == 0) {
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0 || connect(fd, (const sockaddr*)&address, sizeof(address)) < 0) {
+            perror("connect");
+            _exit(1);
+        }
+        char buffer[16 * KiB];
+        while (read(fd, buffer, sizeof(buffer)) > 0)
+            ;
+        _exit(0);
+    }
+    return pid;
+}
+
+static bool copy_with_read_write(int in_fd, int out_fd)
+{
+    char buffer[copy_buffer_size];
+    for (;;) {
+        auto nread = read(in_fd, buffer, sizeof(buffer));
+        if (nread < 0) {
+            perror("read");
+            return false;
+        }
+        if (nread == 0)
+            return true;
+        for (ssize_t nwritten = 0; nwritten < nread;) {
+            auto rc = write(out_fd, buffer + nwritten, nread - nwritten);
+            if (rc < 0) {
+                perror("write");
+                return false;
+            }
+            nwritten += rc;
+        }
+    }
+}
+
+static bool copy_with_sendfile(int in_fd, int out_fd, size_t size)
+{
+    off_t offset = 0;
+    while ((size_t)offset < size) {
+        auto rc = sendfile(out_fd, in_fd, &offset, size - offset);
+        if (rc < 0) {
+            perror("sendfile");
+            return false;
+        }
+        if (rc == 0)
+            break;
+    }
+    return true;
+}
+
+static i64 run(const char* path, size_t size, bool use_sendfile)
+{
+    int listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_fd < 0) {
+        perror("socket");
+        return -1;
+    }
+    sockaddr_in address {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t address_size = sizeof(address);
+    if (bind(listen_fd, (const sockaddr*)&address, sizeof(address)) < 0 || listen(listen_fd, 1) < 0
+        || getsockname(listen_fd, (sockaddr*)&address, &address_size) < 0) {
+        perror("bind/listen");
+        return -1;
+    }
+
+    pid_t drain = spawn_drain(address);
+    if (drain < 0)
+        return -1;
+    int socket_fd = accept(listen_fd, nullptr, nullptr);
+    close(listen_fd);
+    if (socket_fd < 0) {
+        perror("accept");
+        return -1;
+    }
+
+    int in_fd = open(path, O_RDONLY);
+    if (in_fd < 0) {
+        perror("open");
+        return -1;
+    }
+
+    Core::ElapsedTimer timer(true);
+    timer.start();
+    bool ok = use_sendfile ? copy_with_sendfile(in_fd, socket_fd, size) : copy_with_read_write(in_fd, socket_fd);
+    close(socket_fd);
+    waitpid(drain, nullptr, 0);
+    auto elapsed = timer.elapsed();
+    close(in_fd);
+    return ok ? elapsed : -1;
+}
+
+int main(int argc, char** argv)
+{
+    const char* path = "/tmp/bench-sendfile.dat";
+    int size_in_mib = 32;
+    int rounds = 3;
+
+    Core::ArgsParser args_parser;
+    args_parser.set_general_help("Compare read()/write() and sendfile() throughput when sending a file over loopback TCP.");
+    args_parser.add_option(size_in_mib, "Size of the test file in MiB", "size", 's', "MiB");
+    args_parser.add_option(rounds, "Number of rounds per method", "rounds", 'r', "count");
+    args_parser.add_option(path, "Path of the test file", "path", 'p', "path");
+    args_parser.parse(argc, argv);
+
+    size_t size = (size_t)size_in_mib * MiB;
+    if (!create_test_file(path, size))
+        return 1;
+
+    outln("{:>6} {:>12} {:>12} {:>12}", "round", "method", "ms", "MiB/s");
+    for (int round = 1; round <= rounds; ++round) {
+        for (bool use_sendfile : { false, true }) {
+            auto elapsed_ms = run(path, size, use_sendfile);
+            if (elapsed_ms < 0) {
+                unlink(path);
+                return 1;
+            }
+            outln("{:>6} {:>12} {:>12} {:>12}", round, use_sendfile ? "sendfile" : "read/write", elapsed_ms, (u64)size_in_mib * 1000 / max(elapsed_ms, (i64)1));
+        }
+    }
+
+    unlink(path);
+    return 0;
+}
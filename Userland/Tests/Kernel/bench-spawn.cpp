@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2021, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "BenchmarkHelpers.h"
+#include <LibCore/ArgsParser.h>
+#include <errno.h>
+#include <spawn.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Compares fork()+execve() with posix_spawn() from a process with a large,
+// fully populated heap. fork() has to clone every region of the parent only for
+// execve() to throw the copy away, posix_spawn() never touches the parent's memory.
+
+extern char** environ;
+
+static pid_t spawn_with_fork(const char* path, char* const argv[])
+{
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork");
+        return -1;
+    }
+    if (pid == 0) {
+        execve(path, argv, environ);
+        perror("execve");
+        _exit(127);
+    }
+    return pid;
+}
+
+static pid_t spawn_with_posix_spawn(const char* path, char* const argv[])
+{
+    pid_t pid;
+    if (int rc = posix_spawn(&pid, path, nullptr, nullptr, argv, environ); rc != 0) {
+        errno = rc;
+        perror("posix_spawn");
+        return -1;
+    }
+    return pid;
+}
+
+static bool run(const char* name, pid_t (*spawn)(const char*, char* const[]), const char* path, int iterations)
+{
+    char* const argv[] = { const_cast<char*>(path), nullptr };
+    auto start = now_ns();
+    for (int i = 0; i < iterations; ++i) {
+        pid_t pid = spawn(path, argv);
+        if (pid < 0)
+            return false;
+        int status = 0;
+        if (waitpid(pid, &status, 0) < 0) {
+            perror("waitpid");
+            return false;
+        }
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            warnln("{} did not exit successfully", path);
+            return false;
+        }
+    }
+    auto elapsed_ns = now_ns() - start;
+    outln("{:>12} {:>10} {:>10}", name, elapsed_ns / iterations / 1000, (u64)iterations * 1'000'000'000 / elapsed_ns);
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    int iterations = 100;
+    int heap_mib = 1024;
+    const char* path = "/bin/true";
+
+    Core::ArgsParser args_parser;
+    args_parser.set_general_help("Compare the cost of fork()+execve() and posix_spawn() from a process with a large heap.");
+    args_parser.add_option(iterations, "Number of spawns per method (default: 100)", "iterations", 'n', "count");
+    args_parser.add_option(heap_mib, "MiB of memory to populate in the parent (default: 1024)", "heap", 's', "MiB");
+    args_parser.add_positional_argument(path, "Program to spawn (default: /bin/true)", "path", Core::ArgsParser::Required::No);
+    args_parser.parse(argc, argv);
+
+    if (iterations <= 0 || heap_mib < 0) {
+        warnln("Iterations must be positive and the heap size can't be negative");
+        return 1;
+    }
+
+    size_t heap_size = (size_t)heap_mib * MiB;
+    if (heap_size) {
+        auto* heap = (u8*)mmap(nullptr, heap_size, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, 0, 0);
+        if (heap == MAP_FAILED) {
+            perror("mmap");
+            return 1;
+        }
+        memset(heap, 0xa5, heap_size);
+    }
+
+    outln("Spawning {} {} times with {} MiB populated in the parent.", path, iterations, heap_mib);
+    outln("{:>12} {:>10} {:>10}", "method", "avg us", "spawns/s");
+    if (!run("fork+execve", spawn_with_fork, path, iterations))
+        return 1;
+    if (!run("posix_spawn", spawn_with_posix_spawn, path, iterations))
+        return 1;
+    return 0;
+}
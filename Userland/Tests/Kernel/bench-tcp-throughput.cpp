@@ -0,0 +1,180 @@
+/*
+ * Copyright (c) 2021, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <AK/ByteBuffer.h>
+#include <LibCore/ArgsParser.h>
+#include <LibCore/ElapsedTimer.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Measures bulk TCP throughput over the loopback interface.
+// A child process connects to the parent and streams a known byte pattern,
+// which the parent reads back and verifies. The kernel's per-socket window
+// and retransmission counters can be inspected in /proc/net/tcp afterwards.
+
+static u8 pattern_byte(size_t offset)
+{
+    return (u8)(offset * 31 + (offset >> 12));
+}
+
+static int run_sender(u16 port, size_t total_bytes, size_t chunk_size)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        perror("socket");
+        return 1;
+    }
+
+    sockaddr_in address {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(fd, (const sockaddr*)&address, sizeof(address)) < 0) {
+        perror("connect");
+        return 1;
+    }
+
+    auto buffer = ByteBuffer::create_uninitialized(chunk_size);
+    size_t offset = 0;
+    while (offset < total_bytes) {
+        size_t count = min(chunk_size, total_bytes - offset);
+        for (size_t i = 0; i < count; ++i)
+            buffer[i] = pattern_byte(offset + i);
+        size_t written = 0;
+        while (written < count) {
+            auto nwritten = write(fd, buffer.data() + written, count - written);
+            if (nwritten < 0) {
+                perror("write");
+                return 1;
+            }
+            written += nwritten;
+        }
+        offset += count;
+    }
+    close(fd);
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    int megabytes = 64;
+    int chunk_size = 64 * KiB;
+    int port = 9123;
+
+    Core::ArgsParser args_parser;
+    args_parser.set_general_help("Measure TCP throughput over the loopback interface.");
+    args_parser.add_option(megabytes, "Amount of data to transfer in MiB", "size", 's', "MiB");
+    args_parser.add_option(chunk_size, "Size of each write() and read() in bytes", "chunk-size", 'c', "bytes");
+    args_parser.add_option(port, "Port to listen on", "port", 'p', "port");
+    args_parser.parse(argc, argv);
+
+    if (megabytes <= 0 || chunk_size <= 0) {
+        warnln("Size and chunk size must be positive");
+        return 1;
+    }
+    size_t total_bytes = (size_t)megabytes * MiB;
+
+    int listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_fd < 0) {
+        perror("socket");
+        return 1;
+    }
+    int opt = 1;
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+
+    sockaddr_in address {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(listen_fd, (const sockaddr*)&address, sizeof(address)) < 0) {
+        perror("bind");
+        return 1;
+    }
+    if (listen(listen_fd, 1) < 0) {
+        perror("listen");
+        return 1;
+    }
+
+    pid_t sender_pid = fork();
+    if (sender_pid < 0) {
+        perror("fork");
+        return 1;
+    }
+    if (sender_pid == 0) {
+        close(listen_fd);
+        _exit(run_sender(port, total_bytes, chunk_size));
+    }
+
+    int fd = accept(listen_fd, nullptr, nullptr);
+    if (fd < 0) {
+        perror("accept");
+        return 1;
+    }
+
+    auto buffer = ByteBuffer::create_uninitialized(chunk_size);
+    Core::ElapsedTimer timer;
+    timer.start();
+
+    size_t received = 0;
+    bool corrupted = false;
+    for (;;) {
+        auto nread = read(fd, buffer.data(), buffer.size());
+        if (nread < 0) {
+            perror("read");
+            return 1;
+        }
+        if (nread == 0)
+            break;
+        for (ssize_t i = 0; i < nread && !corrupted; ++i) {
+            if (buffer[i] != pattern_byte(received + i)) {
+                warnln("Data mismatch at offset {}", received + i);
+                corrupted = true;
+            }
+        }
+        received += nread;
+    }
+
+    auto elapsed_ms = max(timer.elapsed(), 1);
+    close(fd);
+    close(listen_fd);
+
+    int status = 0;
+    waitpid(sender_pid, &status, 0);
+
+    outln("Transferred {} of {} bytes in {} ms", received, total_bytes, elapsed_ms);
+    outln("Throughput: {} KiB/s", (u64)received * 1000 / elapsed_ms / KiB);
+
+    if (received != total_bytes || corrupted || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        warnln("FAIL");
+        return 1;
+    }
+    return 0;
+}
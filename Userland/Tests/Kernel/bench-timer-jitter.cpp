@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2021, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "BenchmarkHelpers.h"
+#include <AK/QuickSort.h>
+#include <AK/Time.h>
+#include <AK/Vector.h>
+#include <LibCore/ArgsParser.h>
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <time.h>
+
+// Measures how late timer wakeups are. Each sample sleeps until an absolute
+// CLOCK_MONOTONIC deadline (or waits for a poll() timeout) and records how
+// much later than the deadline the thread actually got to run again.
+// With a periodic tick this is dominated by the tick interval, with one-shot
+// timer deadlines it should be close to the interrupt and wakeup latency.
+
+static Time monotonic_now()
+{
+    return Time::from_nanoseconds(now_ns());
+}
+
+static bool sample_clock_nanosleep(const Time& interval, Vector<i64>& lateness_ns)
+{
+    auto deadline = monotonic_now() + interval;
+    auto deadline_ts = deadline.to_timespec();
+    int rc = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline_ts, nullptr);
+    auto woke = monotonic_now();
+    if (rc != 0) {
+        errno = rc;
+        perror("clock_nanosleep");
+        return false;
+    }
+    lateness_ns.append((woke - deadline).to_nanoseconds());
+    return true;
+}
+
+static bool sample_poll(const Time& interval, Vector<i64>& lateness_ns)
+{
+    auto start = monotonic_now();
+    if (poll(nullptr, 0, interval.to_milliseconds()) < 0) {
+        perror("poll");
+        return false;
+    }
+    auto woke = monotonic_now();
+    lateness_ns.append((woke - start - Time::from_milliseconds(interval.to_milliseconds())).to_nanoseconds());
+    return true;
+}
+
+static void print_statistics(const char* name, i64 interval_us, Vector<i64>& lateness_ns)
+{
+    quick_sort(lateness_ns);
+    i64 total = 0;
+    for (auto ns : lateness_ns)
+        total += ns;
+    outln("{:>16} {:>10} {:>10} {:>10} {:>10} {:>10} {:>10}", name, interval_us,
+        lateness_ns.first() / 1000, total / (i64)lateness_ns.size() / 1000, percentile(lateness_ns, 50) / 1000, percentile(lateness_ns, 99) / 1000, lateness_ns.last() / 1000);
+}
+
+int main(int argc, char** argv)
+{
+    int samples = 200;
+
+    Core::ArgsParser args_parser;
+    args_parser.set_general_help("Measure how late clock_nanosleep() and poll() timeouts wake up (all values in microseconds).");
+    args_parser.add_option(samples, "Number of samples per interval", "samples", 'n', "count");
+    args_parser.parse(argc, argv);
+
+    if (samples <= 0) {
+        warnln("Need at least one sample");
+        return 1;
+    }
+
+    static constexpr i64 intervals_us[] = { 50, 500, 1000, 2500, 10000 };
+
+    outln("{:>16} {:>10} {:>10} {:>10} {:>10} {:>10} {:>10}", "timer", "interval", "min", "avg", "p50", "p99", "max");
+    for (auto interval_us : intervals_us) {
+        auto interval = Time::from_microseconds(interval_us);
+        Vector<i64> lateness_ns;
+        lateness_ns.ensure_capacity(samples);
+        for (int i = 0; i < samples; ++i) {
+            if (!sample_clock_nanosleep(interval, lateness_ns))
+                return 1;
+        }
+        print_statistics("clock_nanosleep", interval_us, lateness_ns);
+    }
+
+    for (auto interval_us : intervals_us) {
+        // poll() takes milliseconds
+        if (interval_us < 1000)
+            continue;
+        auto interval = Time::from_microseconds(interval_us);
+        Vector<i64> lateness_ns;
+        lateness_ns.ensure_capacity(samples);
+        for (int i = 0; i < samples; ++i) {
+            if (!sample_poll(interval, lateness_ns))
+                return 1;
+        }
+        print_statistics("poll", interval_us, lateness_ns);
+    }
+    return 0;
+}
@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2021, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// read() and write() go through the same page cache that MAP_SHARED mappings
+// use, so changes made through either one must be visible through the other.
+
+int main()
+{
+    const char* path = "/tmp/mmap-shared-read-write-coherence";
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        perror("open");
+        return 1;
+    }
+    unlink(path);
+
+    char buffer[8192];
+    memset(buffer, 'A', sizeof(buffer));
+    if (write(fd, buffer, sizeof(buffer)) != sizeof(buffer)) {
+        perror("write");
+        return 1;
+    }
+
+    auto* ptr = (char*)mmap(nullptr, sizeof(buffer), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (ptr == MAP_FAILED) {
+        perror("mmap");
+        return 1;
+    }
+
+    if (lseek(fd, 4094, SEEK_SET) < 0 || write(fd, "hello", 5) != 5) {
+        perror("write");
+        return 1;
+    }
+    if (memcmp(ptr + 4094, "hello", 5) != 0) {
+        fprintf(stderr, "FAIL: write() is not visible through the mapping\n");
+        return 1;
+    }
+
+    memcpy(ptr + 100, "world", 5);
+    char readback[5];
+    if (pread(fd, readback, 5, 100) != 5) {
+        perror("pread");
+        return 1;
+    }
+    if (memcmp(readback, "world", 5) != 0) {
+        fprintf(stderr, "FAIL: stores through the mapping are not visible to read()\n");
+        return 1;
+    }
+
+    if (ftruncate(fd, 4096) < 0 || ftruncate(fd, 8192) < 0) {
+        perror("ftruncate");
+        return 1;
+    }
+    if (pread(fd, readback, 5, 4094) != 5) {
+        perror("pread");
+        return 1;
+    }
+    if (memcmp(readback, "he\0\0\0", 5) != 0) {
+        fprintf(stderr, "FAIL: truncated data came back after growing the file again\n");
+        return 1;
+    }
+
+    munmap(ptr, sizeof(buffer));
+    close(fd);
+    printf("PASS\n");
+    return 0;
+}
@@ -0,0 +1,159 @@
+/*
+ * Copyright (c) 2021, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <AK/Atomic.h>
+#include <AK/Vector.h>
+#include <LibCore/ArgsParser.h>
+#include <LibCore/ElapsedTimer.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+// Hammers a single mutex, condition variable or rwlock from several threads
+// and reports how many lock operations per second we manage to get through.
+// The critical section is kept short on purpose, which is where spinning
+// before going to sleep on the futex pays off the most.
+
+static pthread_mutex_t s_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t s_cond = PTHREAD_COND_INITIALIZER;
+static pthread_rwlock_t s_rwlock = PTHREAD_RWLOCK_INITIALIZER;
+static Atomic<bool> s_stop { false };
+static u64 s_shared_counter { 0 };
+static int s_critical_section_work { 50 };
+
+static void do_work(int iterations)
+{
+    for (int i = 0; i < iterations; ++i)
+        asm volatile("" ::: "memory");
+}
+
+static void* mutex_worker(void* arg)
+{
+    auto& operations = *reinterpret_cast<u64*>(arg);
+    while (!s_stop.load(AK::MemoryOrder::memory_order_relaxed)) {
+        pthread_mutex_lock(&s_mutex);
+        ++s_shared_counter;
+        do_work(s_critical_section_work);
+        pthread_mutex_unlock(&s_mutex);
+        ++operations;
+    }
+    return nullptr;
+}
+
+static void* condvar_worker(void* arg)
+{
+    // Every thread waits for the counter to reach its turn, then hands over to the next one.
+    auto& operations = *reinterpret_cast<u64*>(arg);
+    pthread_mutex_lock(&s_mutex);
+    while (!s_stop.load(AK::MemoryOrder::memory_order_relaxed)) {
+        ++s_shared_counter;
+        pthread_cond_signal(&s_cond);
+        pthread_cond_wait(&s_cond, &s_mutex);
+        ++operations;
+    }
+    pthread_cond_broadcast(&s_cond);
+    pthread_mutex_unlock(&s_mutex);
+    return nullptr;
+}
+
+static void* rwlock_worker(void* arg)
+{
+    // One in eight operations is a write.
+    auto& operations = *reinterpret_cast<u64*>(arg);
+    while (!s_stop.load(AK::MemoryOrder::memory_order_relaxed)) {
+        if ((operations & 7) == 0) {
+            pthread_rwlock_wrlock(&s_rwlock);
+            ++s_shared_counter;
+        } else {
+            pthread_rwlock_rdlock(&s_rwlock);
+        }
+        do_work(s_critical_section_work);
+        pthread_rwlock_unlock(&s_rwlock);
+        ++operations;
+    }
+    return nullptr;
+}
+
+int main(int argc, char** argv)
+{
+    const char* mode = "mutex";
+    int thread_count = 4;
+    int seconds = 3;
+
+    Core::ArgsParser args_parser;
+    args_parser.set_general_help("Measure throughput of contended pthread synchronization primitives.");
+    args_parser.add_option(thread_count, "Number of contending threads", "threads", 't', "count");
+    args_parser.add_option(seconds, "Duration of the benchmark in seconds", "seconds", 's', "seconds");
+    args_parser.add_option(s_critical_section_work, "Busy loop iterations inside the critical section", "work", 'w', "iterations");
+    args_parser.add_positional_argument(mode, "One of mutex, condvar or rwlock", "mode", Core::ArgsParser::Required::No);
+    args_parser.parse(argc, argv);
+
+    void* (*worker)(void*) = nullptr;
+    if (!strcmp(mode, "mutex")) {
+        worker = mutex_worker;
+    } else if (!strcmp(mode, "condvar")) {
+        worker = condvar_worker;
+    } else if (!strcmp(mode, "rwlock")) {
+        worker = rwlock_worker;
+    } else {
+        warnln("Unknown mode '{}'", mode);
+        return 1;
+    }
+
+    Vector<pthread_t> threads;
+    Vector<u64> operations;
+    threads.resize(thread_count);
+    operations.resize(thread_count);
+
+    Core::ElapsedTimer timer(true);
+    timer.start();
+    for (int i = 0; i < thread_count; ++i) {
+        if (pthread_create(&threads[i], nullptr, worker, &operations[i]) != 0) {
+            perror("pthread_create");
+            return 1;
+        }
+    }
+
+    sleep(seconds);
+    s_stop.store(true);
+    // Make sure nobody stays parked on the condition variable.
+    pthread_mutex_lock(&s_mutex);
+    pthread_cond_broadcast(&s_cond);
+    pthread_mutex_unlock(&s_mutex);
+
+    u64 total_operations = 0;
+    for (int i = 0; i < thread_count; ++i) {
+        pthread_join(threads[i], nullptr);
+        total_operations += operations[i];
+    }
+    auto elapsed_ms = max(timer.elapsed(), 1);
+
+    outln("{}: {} threads, {} operations in {} ms, {} ops/s", mode, thread_count, total_operations, elapsed_ms, total_operations * 1000 / elapsed_ms);
+    for (int i = 0; i < thread_count; ++i)
+        outln("  thread {}: {} operations", i, operations[i]);
+    return 0;
+}
@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2021, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+// A thread that holds a read lock must be able to take it again,
+// even while a writer is queued up behind it.
+
+static pthread_rwlock_t s_rwlock = PTHREAD_RWLOCK_INITIALIZER;
+
+static void* writer(void*)
+{
+    pthread_rwlock_wrlock(&s_rwlock);
+    pthread_rwlock_unlock(&s_rwlock);
+    return nullptr;
+}
+
+int main()
+{
+    if (pthread_rwlock_rdlock(&s_rwlock) != 0) {
+        printf("\x1b[01;35mTests failed: couldn't take the first read lock\n");
+        return 1;
+    }
+
+    pthread_t writer_thread;
+    pthread_create(&writer_thread, nullptr, writer, nullptr);
+    // Give the writer time to give up spinning and go to sleep on the lock.
+    usleep(100000);
+
+    timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += 2;
+    int rc = pthread_rwlock_timedrdlock(&s_rwlock, &deadline);
+    if (rc != 0) {
+        printf("\x1b[01;35mTests failed: recursive read lock returned %d\n", rc);
+        return 1;
+    }
+
+    pthread_rwlock_unlock(&s_rwlock);
+    pthread_rwlock_unlock(&s_rwlock);
+    pthread_join(writer_thread, nullptr);
+
+    // With every read lock gone, the writer got its turn and we can get back in.
+    if (pthread_rwlock_tryrdlock(&s_rwlock) != 0) {
+        printf("\x1b[01;35mTests failed: lock still held after the writer finished\n");
+        return 1;
+    }
+    pthread_rwlock_unlock(&s_rwlock);
+
+    printf("PASS\n");
+    return 0;
+}
@@ -0,0 +1,320 @@
+/*
+ * Copyright (c) 2021, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <AK/Atomic.h>
+#include <AK/QuickSort.h>
+#include <AK/String.h>
+#include <AK/StringBuilder.h>
+#include <AK/URL.h>
+#include <AK/Vector.h>
+#include <LibCore/ArgsParser.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+// A small HTTP load generator in the spirit of ApacheBench. A number of
+// concurrent connections issue GET requests for the same URL, and we report
+// throughput along with the latency distribution.
+
+static sockaddr_in s_address;
+static String s_request;
+static int s_total_requests;
+static int s_pipeline_depth;
+static bool s_keep_alive;
+static Atomic<int> s_next_request;
+
+static u64 now_in_microseconds()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1'000'000 + ts.tv_nsec / 1000;
+}
+
+struct WorkerState {
+    pthread_t thread {};
+    Vector<u32> latencies_us;
+    u64 bytes_received { 0 };
+    int failures { 0 };
+};
+
+class Connection {
+public:
+    ~Connection() { disconnect(); }
+
+    bool is_connected() const { return m_fd >= 0; }
+
+    bool connect()
+    {
+        m_fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (m_fd < 0) {
+            perror("socket");
+            return false;
+        }
+        if (::connect(m_fd, (const sockaddr*)&s_address, sizeof(s_address)) < 0) {
+            perror("connect");
+            disconnect();
+            return false;
+        }
+        m_buffer.clear();
+        return true;
+    }
+
+    void disconnect()
+    {
+        if (m_fd >= 0)
+            close(m_fd);
+        m_fd = -1;
+    }
+
+    bool send_requests(int count)
+    {
+        StringBuilder builder;
+        for (int i = 0; i < count; ++i)
+            builder.append(s_request);
+        auto requests = builder.to_string();
+        for (size_t sent = 0; sent < requests.length();) {
+            auto nwritten = write(m_fd, requests.characters() + sent, requests.length() - sent);
+            if (nwritten <= 0)
+                return false;
+            sent += nwritten;
+        }
+        return true;
+    }
+
+    // Reads one response, returning the number of bytes it took, or 0 on failure.
+    size_t receive_response(bool& server_closes)
+    {
+        Optional<size_t> end_of_header;
+        while (!(end_of_header = find_end_of_header()).has_value()) {
+            if (!fill_buffer())
+                return 0;
+        }
+
+        StringView header { m_buffer.data(), end_of_header.value() };
+        // Anything but a 2xx or 3xx status counts as a failure.
+        if (header.length() < 10 || !header.starts_with("HTTP/1.") || (header[9] != '2' && header[9] != '3'))
+            return 0;
+
+        Optional<size_t> content_length;
+        server_closes = header.starts_with("HTTP/1.0");
+        for (auto& line : header.lines()) {
+            auto colon = line.find_first_of(':');
+            if (!colon.has_value())
+                continue;
+            auto name = line.substring_view(0, colon.value());
+            auto value = line.substring_view(colon.value() + 1).trim_whitespace();
+            if (name.equals_ignoring_case("Content-Length"))
+                content_length = value.to_uint();
+            else if (name.equals_ignoring_case("Connection"))
+                server_closes = value.equals_ignoring_case("close");
+        }
+
+        size_t header_size = end_of_header.value() + 4;
+        if (!content_length.has_value()) {
+            // The body extends until the server hangs up.
+            while (fill_buffer())
+                ;
+            content_length = m_buffer.size() - header_size;
+            server_closes = true;
+        }
+        while (m_buffer.size() < header_size + content_length.value()) {
+            if (!fill_buffer())
+                return 0;
+        }
+        m_buffer.remove(0, header_size + content_length.value());
+        return header_size + content_length.value();
+    }
+
+private:
+    Optional<size_t> find_end_of_header() const
+    {
+        for (size_t i = 0; i + 3 < m_buffer.size(); ++i) {
+            if (m_buffer[i] == '\r' && m_buffer[i + 1] == '\n' && m_buffer[i + 2] == '\r' && m_buffer[i + 3] == '\n')
+                return i;
+        }
+        return {};
+    }
+
+    bool fill_buffer()
+    {
+        u8 chunk[16 * KiB];
+        auto nread = read(m_fd, chunk, sizeof(chunk));
+        if (nread <= 0)
+            return false;
+        m_buffer.append(chunk, nread);
+        return true;
+    }
+
+    int m_fd { -1 };
+    Vector<u8> m_buffer;
+};
+
+static void* worker_main(void* arg)
+{
+    auto& state = *reinterpret_cast<WorkerState*>(arg);
+    Connection connection;
+
+    for (;;) {
+        // Claim a batch of requests to send back-to-back on this connection.
+        int first = s_next_request.fetch_add(s_pipeline_depth);
+        if (first >= s_total_requests)
+            break;
+        int batch_size = min(s_pipeline_depth, s_total_requests - first);
+
+        if (!connection.is_connected() && !connection.connect()) {
+            state.failures += batch_size;
+            continue;
+        }
+
+        // NOTE: With pipelining, every response's latency counts from when the whole batch was sent.
+        auto start = now_in_microseconds();
+        if (!connection.send_requests(batch_size)) {
+            state.failures += batch_size;
+            connection.disconnect();
+            continue;
+        }
+
+        bool server_closes = !s_keep_alive;
+        for (int i = 0; i < batch_size; ++i) {
+            auto nreceived = connection.receive_response(server_closes);
+            if (nreceived == 0) {
+                state.failures += batch_size - i;
+                server_closes = true;
+                break;
+            }
+            state.bytes_received += nreceived;
+            state.latencies_us.append(now_in_microseconds() - start);
+            if (server_closes && i + 1 < batch_size) {
+                state.failures += batch_size - i - 1;
+                break;
+            }
+        }
+        if (server_closes || !s_keep_alive)
+            connection.disconnect();
+    }
+    return nullptr;
+}
+
+int main(int argc, char** argv)
+{
+    const char* url_string = nullptr;
+    int concurrency = 1;
+    s_total_requests = 1;
+    s_pipeline_depth = 1;
+    s_keep_alive = false;
+
+    Core::ArgsParser args_parser;
+    args_parser.set_general_help("Benchmark an HTTP server by sending it many requests for the same URL.");
+    args_parser.add_option(s_total_requests, "Number of requests to perform", "requests", 'n', "count");
+    args_parser.add_option(concurrency, "Number of requests to perform at the same time", "concurrency", 'c', "count");
+    args_parser.add_option(s_keep_alive, "Reuse connections (HTTP keep-alive)", "keep-alive", 'k');
+    args_parser.add_option(s_pipeline_depth, "Number of requests to pipeline on a connection (implies -k)", "pipeline", 'P', "count");
+    args_parser.add_positional_argument(url_string, "URL to request, e.g. http://127.0.0.1:8000/", "url");
+    args_parser.parse(argc, argv);
+
+    if (s_total_requests < 1 || concurrency < 1 || s_pipeline_depth < 1) {
+        warnln("Counts must be positive");
+        return 1;
+    }
+    if (s_pipeline_depth > 1)
+        s_keep_alive = true;
+
+    URL url(url_string);
+    if (!url.is_valid() || url.protocol() != "http") {
+        warnln("Invalid URL '{}', only http:// is supported", url_string);
+        return 1;
+    }
+
+    auto* hostent = gethostbyname(url.host().characters());
+    if (!hostent || hostent->h_addrtype != AF_INET) {
+        warnln("Unable to resolve '{}'", url.host());
+        return 1;
+    }
+    s_address.sin_family = AF_INET;
+    s_address.sin_port = htons(url.port());
+    memcpy(&s_address.sin_addr, hostent->h_addr_list[0], sizeof(s_address.sin_addr));
+
+    auto path = url.path().is_empty() ? "/" : url.path();
+    s_request = String::formatted("GET {} HTTP/1.1\r\nHost: {}\r\nUser-Agent: ab (SerenityOS)\r\nConnection: {}\r\n\r\n",
+        path, url.host(), s_keep_alive ? "keep-alive" : "close");
+
+    outln("Benchmarking {} ({} requests, concurrency {}{}{})", url_string, s_total_requests, concurrency,
+        s_keep_alive ? ", keep-alive" : "", s_pipeline_depth > 1 ? String::formatted(", pipeline depth {}", s_pipeline_depth) : "");
+
+    Vector<WorkerState> workers;
+    workers.resize(concurrency);
+
+    auto start = now_in_microseconds();
+    for (auto& worker : workers) {
+        if (pthread_create(&worker.thread, nullptr, worker_main, &worker) != 0) {
+            perror("pthread_create");
+            return 1;
+        }
+    }
+    for (auto& worker : workers)
+        pthread_join(worker.thread, nullptr);
+    auto elapsed_us = max(now_in_microseconds() - start, (u64)1);
+
+    Vector<u32> latencies;
+    u64 bytes_received = 0;
+    int failures = 0;
+    for (auto& worker : workers) {
+        latencies.append(worker.latencies_us.data(), worker.latencies_us.size());
+        bytes_received += worker.bytes_received;
+        failures += worker.failures;
+    }
+    quick_sort(latencies);
+
+    outln();
+    outln("Time taken:          {}.{:03} s", elapsed_us / 1'000'000, (elapsed_us / 1000) % 1000);
+    outln("Complete requests:   {}", latencies.size());
+    outln("Failed requests:     {}", failures);
+    outln("Requests per second: {}", (u64)latencies.size() * 1'000'000 / elapsed_us);
+    outln("Transfer rate:       {} KiB/s", bytes_received * 1'000'000 / elapsed_us / KiB);
+
+    if (latencies.is_empty())
+        return 1;
+
+    u64 total_latency = 0;
+    for (auto latency : latencies)
+        total_latency += latency;
+    auto percentile = [&](int p) {
+        return latencies[min(latencies.size() - 1, latencies.size() * p / 100)];
+    };
+
+    outln();
+    outln("Latency (us): min {}  mean {}  max {}", latencies.first(), total_latency / latencies.size(), latencies.last());
+    for (int p : { 50, 90, 99 })
+        outln("  {:>3}%  {}", p, percentile(p));
+    outln("  99.9%  {}", latencies[min(latencies.size() - 1, latencies.size() * 999 / 1000)]);
+    return failures ? 1 : 0;
+}
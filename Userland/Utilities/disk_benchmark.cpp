@@ -35,11 +35,18 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/stat.h>
+#include <sys/wait.h>
 #include <unistd.h>
 
 struct Result {
     u64 write_bps {};
     u64 read_bps {};
+    u64 read_iops {};
+};
+
+struct ReadOptions {
+    int queue_depth { 1 };
+    bool random { false };
 };
 
 static Result average_result(const Vector<Result>& results)
@@ -49,21 +56,23 @@ static Result average_result(const Vector<Result>& results)
     for (auto& res : results) {
         average.write_bps += res.write_bps;
         average.read_bps += res.read_bps;
+        average.read_iops += res.read_iops;
     }
 
     average.write_bps /= results.size();
     average.read_bps /= results.size();
+    average.read_iops /= results.size();
 
     return average;
 }
 
 static void exit_with_usage(int rc)
 {
-    warnln("Usage: disk_benchmark [-h] [-d directory] [-t time_per_benchmark] [-f file_size1,file_size2,...] [-b block_size1,block_size2,...]");
+    warnln("Usage: disk_benchmark [-h] [-c] [-r] [-q queue_depth] [-d directory] [-t time_per_benchmark] [-f file_size1,file_size2,...] [-b block_size1,block_size2,...]");
     exit(rc);
 }
 
-static Optional<Result> benchmark(const String& filename, int file_size, int block_size, ByteBuffer& buffer, bool allow_cache);
+static Optional<Result> benchmark(const String& filename, int file_size, int block_size, ByteBuffer& buffer, bool allow_cache, const ReadOptions&);
 
 int main(int argc, char** argv)
 {
@@ -72,9 +81,10 @@ int main(int argc, char** argv)
     Vector<size_t> file_sizes;
     Vector<size_t> block_sizes;
     bool allow_cache = false;
+    ReadOptions read_options;
 
     int opt;
-    while ((opt = getopt(argc, argv, "chd:t:f:b:")) != -1) {
+    while ((opt = getopt(argc, argv, "chrq:d:t:f:b:")) != -1) {
         switch (opt) {
         case 'h':
             exit_with_usage(0);
@@ -82,6 +92,14 @@ int main(int argc, char** argv)
         case 'c':
             allow_cache = true;
             break;
+        case 'r':
+            read_options.random = true;
+            break;
+        case 'q':
+            read_options.queue_depth = atoi(optarg);
+            if (read_options.queue_depth < 1)
+                exit_with_usage(1);
+            break;
         case 'd':
             directory = optarg;
             break;
@@ -118,20 +136,20 @@ int main(int argc, char** argv)
             auto buffer = ByteBuffer::create_uninitialized(block_size);
             Vector<Result> results;
 
-            outln("Running: file_size={} block_size={}", file_size, block_size);
+            outln("Running: file_size={} block_size={} queue_depth={} reads={}", file_size, block_size, read_options.queue_depth, read_options.random ? "random" : "sequential");
             Core::ElapsedTimer timer;
             timer.start();
             while (timer.elapsed() < time_per_benchmark * 1000) {
                 out(".");
                 fflush(stdout);
-                auto result = benchmark(filename, file_size, block_size, buffer, allow_cache);
+                auto result = benchmark(filename, file_size, block_size, buffer, allow_cache, read_options);
                 if (!result.has_value())
                     return 1;
                 results.append(result.release_value());
                 usleep(100);
             }
             auto average = average_result(results);
-            outln("Finished: runs={} time={}ms write_bps={} read_bps={}", results.size(), timer.elapsed(), average.write_bps, average.read_bps);
+            outln("Finished: runs={} time={}ms write_bps={} read_bps={} read_iops={}", results.size(), timer.elapsed(), average.write_bps, average.read_bps, average.read_iops);
 
             sleep(1);
         }
@@ -140,7 +158,54 @@ int main(int argc, char** argv)
     return 0;
 }
 
-Optional<Result> benchmark(const String& filename, int file_size, int block_size, ByteBuffer& buffer, bool allow_cache)
+// Reads every block of the file once (or as many random blocks) with queue_depth
+// processes, so the disk has that many requests outstanding at any time.
+static bool run_concurrent_reads(const String& filename, int file_size, int block_size, bool allow_cache, const ReadOptions& options)
+{
+    int block_count = file_size / block_size;
+    Vector<pid_t> workers;
+    for (int worker = 0; worker < options.queue_depth; worker++) {
+        pid_t pid = fork();
+        if (pid < 0) {
+            perror("fork");
+            break;
+        }
+        if (pid > 0) {
+            workers.append(pid);
+            continue;
+        }
+
+        int fd = open(filename.characters(), O_RDONLY | (allow_cache ? 0 : O_DIRECT));
+        if (fd < 0) {
+            perror("open");
+            _exit(1);
+        }
+        auto buffer = ByteBuffer::create_uninitialized(block_size);
+        for (int block = worker; block < block_count; block += options.queue_depth) {
+            int index = options.random ? (int)arc4random_uniform(block_count) : block;
+            if (pread(fd, buffer.data(), block_size, (off_t)index * block_size) < 0) {
+                perror("pread");
+                _exit(1);
+            }
+        }
+        _exit(0);
+    }
+
+    bool success = workers.size() == (size_t)options.queue_depth;
+    for (auto pid : workers) {
+        int status = 0;
+        if (waitpid(pid, &status, 0) < 0) {
+            perror("waitpid");
+            success = false;
+            continue;
+        }
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+            success = false;
+    }
+    return success;
+}
+
+Optional<Result> benchmark(const String& filename, int file_size, int block_size, ByteBuffer& buffer, bool allow_cache, const ReadOptions& read_options)
 {
     int flags = O_CREAT | O_TRUNC | O_RDWR;
     if (!allow_cache)
@@ -182,16 +247,24 @@ Optional<Result> benchmark(const String& filename, int file_size, int block_size
     }
 
     timer.start();
-    ssize_t total_read = 0;
-    while (total_read < file_size) {
-        auto nread = read(fd, buffer.data(), block_size);
-        if (nread < 0) {
-            perror("read");
+    if (read_options.queue_depth > 1 || read_options.random) {
+        if (!run_concurrent_reads(filename, file_size, block_size, allow_cache, read_options))
             return {};
+    } else {
+        ssize_t total_read = 0;
+        while (total_read < file_size) {
+            auto nread = read(fd, buffer.data(), block_size);
+            if (nread < 0) {
+                perror("read");
+                return {};
+            }
+            total_read += nread;
         }
-        total_read += nread;
     }
 
-    result.read_bps = (u64)(timer.elapsed() ? (file_size / timer.elapsed()) : file_size) * 1000;
+    auto elapsed = timer.elapsed();
+    u64 reads = file_size / block_size;
+    result.read_bps = (u64)(elapsed ? (file_size / elapsed) : file_size) * 1000;
+    result.read_iops = elapsed ? (reads * 1000 / elapsed) : reads * 1000;
     return result;
 }
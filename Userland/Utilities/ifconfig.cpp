@@ -79,6 +79,10 @@ int main(int argc, char** argv)
             auto bytes_in = if_object.get("bytes_in").to_u32();
             auto packets_out = if_object.get("packets_out").to_u32();
             auto bytes_out = if_object.get("bytes_out").to_u32();
+            auto packets_in_per_second = if_object.get("packets_in_per_second").to_u32();
+            auto bytes_in_per_second = if_object.get("bytes_in_per_second").to_u32();
+            auto packets_out_per_second = if_object.get("packets_out_per_second").to_u32();
+            auto bytes_out_per_second = if_object.get("bytes_out_per_second").to_u32();
             auto mtu = if_object.get("mtu").to_u32();
 
             printf("%s:\n", name.characters());
@@ -89,6 +93,8 @@ int main(int argc, char** argv)
             printf("\tclass: %s\n", class_name.characters());
             printf("\tRX: %u packets %u bytes (%s)\n", packets_in, bytes_in, human_readable_size(bytes_in).characters());
             printf("\tTX: %u packets %u bytes (%s)\n", packets_out, bytes_out, human_readable_size(bytes_out).characters());
+            printf("\tRX rate: %u packets/s (%s/s)\n", packets_in_per_second, human_readable_size(bytes_in_per_second).characters());
+            printf("\tTX rate: %u packets/s (%s/s)\n", packets_out_per_second, human_readable_size(bytes_out_per_second).characters());
             printf("\tMTU: %u\n", mtu);
             printf("\n");
         });
@@ -39,11 +39,13 @@ int main(int argc, char** argv)
     bool enable = false;
     bool disable = false;
     bool all_processes = false;
+    bool flight_recorder = false;
 
     args_parser.add_option(pid_argument, "Target PID", nullptr, 'p', "PID");
     args_parser.add_option(all_processes, "Profile all processes (super-user only)", nullptr, 'a');
     args_parser.add_option(enable, "Enable", nullptr, 'e');
     args_parser.add_option(disable, "Disable", nullptr, 'd');
+    args_parser.add_option(flight_recorder, "Keep only the most recent events once the buffer is full", "flight-recorder", 'f');
     args_parser.add_option(cmd_argument, "Command", nullptr, 'c', "command");
 
     args_parser.parse(argc, argv);
@@ -62,7 +64,7 @@ int main(int argc, char** argv)
         pid_t pid = all_processes ? -1 : atoi(pid_argument);
 
         if (enable) {
-            if (profiling_enable(pid) < 0) {
+            if (profiling_enable_with_flags(pid, flight_recorder ? PROFILING_FLAG_OVERWRITE : 0) < 0) {
                 perror("profiling_enable");
                 return 1;
             }
@@ -86,7 +88,7 @@ int main(int argc, char** argv)
     cmd_argv.append(nullptr);
 
     dbgln("Enabling profiling for PID {}", getpid());
-    profiling_enable(getpid());
+    profiling_enable_with_flags(getpid(), flight_recorder ? PROFILING_FLAG_OVERWRITE : 0);
     if (execvp(cmd_argv[0], const_cast<char**>(cmd_argv.data())) < 0) {
         perror("execv");
         return 1;
@@ -90,14 +90,13 @@ struct Snapshot {
     u32 sum_times_scheduled { 0 };
 };
 
-static Snapshot get_snapshot()
+static Snapshot get_snapshot(Core::ProcessStatisticsReader& reader)
 {
-    auto all_processes = Core::ProcessStatisticsReader::get_all();
-    if (!all_processes.has_value())
+    if (!reader.update())
         return {};
 
     Snapshot snapshot;
-    for (auto& it : all_processes.value()) {
+    for (auto& it : reader.processes()) {
         auto& stats = it.value;
         for (auto& thread : stats.threads) {
             snapshot.sum_times_scheduled += thread.times_scheduled;
@@ -164,7 +163,8 @@ int main(int, char**)
     }
 
     Vector<ThreadData*> threads;
-    auto prev = get_snapshot();
+    Core::ProcessStatisticsReader reader;
+    auto prev = get_snapshot(reader);
     usleep(10000);
     for (;;) {
         if (g_window_size_changed) {
@@ -176,7 +176,7 @@ int main(int, char**)
             g_window_size_changed = false;
         }
 
-        auto current = get_snapshot();
+        auto current = get_snapshot(reader);
         auto sum_diff = current.sum_times_scheduled - prev.sum_times_scheduled;
 
         printf("\033[3J\033[H\033[2J");